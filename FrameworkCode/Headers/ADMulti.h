@@ -17,4 +17,18 @@ void ADC_MultiInit(uint8_t HowMany);
 // lowest numbered converted channel is in data[0]
 
 void ADC_MultiRead(uint32_t data[4]);
+
+//------------ADC_MultiInitTriggered------------
+// Same channels, converted whenever the trigger source fires (an
+// ADC_EMUX_EM2_ value, e.g. ADC_EMUX_EM2_PWM0) instead of on request.
+// ADC_MultiISR (ADC0 sequence 2 vector) collects the results.
+void ADC_MultiInitTriggered(uint8_t HowMany, uint32_t Trigger);
+
+//------------ADC_MultiLatest------------
+// Copies out the results of the last triggered conversion, never waits
+// Output: number of triggered conversions completed so far, compare with
+// the last call to tell a new result from an old one
+uint32_t ADC_MultiLatest(uint32_t data[4]);
+
+void ADC_MultiISR(void);
 #endif
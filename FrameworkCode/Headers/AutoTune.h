@@ -0,0 +1,40 @@
+/****************************************************************************
+ Header
+   AutoTune.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Relay-feedback identification of the drive wheel speed loops and PI gains
+   computed from it
+
+****************************************************************************/
+
+#ifndef AutoTune_H
+#define AutoTune_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+  float Ku;     // ultimate gain, percent duty per RPM
+  float Tu;     // ultimate period, s
+  float PGain;  // in the units of the wheel PI loops in MotorSpeedControl
+  float IGain;
+}AT_Result_t;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void AT_Start(uint16_t UpdatePeriodUS, uint16_t NominalPeriodUS);
+void AT_Abort(void);
+bool AT_IsRunning(void);
+void AT_Step(float RPM_1, float RPM_2, float *Duty_1, float *Duty_2);
+bool AT_QueryResult(uint8_t Wheel, AT_Result_t *Result);
+
+//***************************************************************************
+
+#endif /* AutoTune_H */
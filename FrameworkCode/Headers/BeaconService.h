@@ -0,0 +1,32 @@
+/****************************************************************************
+
+  Header file for the IR beacon bearing service
+  based on the Gen 2 Events and Services Framework
+
+ ****************************************************************************/
+
+#ifndef BeaconService_H
+#define BeaconService_H
+
+#include "ES_Types.h"
+#include <stdint.h>
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+// Public Function Prototypes
+
+bool InitBeaconService(uint8_t Priority);
+bool PostBeaconService(ES_Event_t ThisEvent);
+ES_Event_t RunBeaconService(ES_Event_t ThisEvent);
+
+void Beacon_CaptureISR(void);
+
+// Bearings from the last sweep, as Triangulate expects them (-1 if unseen)
+void Beacon_QueryBearings(float *Angles);
+uint8_t Beacon_QuerySeen(void);
+// Capture to ISR exit in CPU clocks, divide by 40 for microseconds
+uint32_t Beacon_QueryISRTime(void);
+uint32_t Beacon_QueryISRMaxTime(void);
+void Beacon_ResetISRTime(void);
+
+#endif /* BeaconService_H */
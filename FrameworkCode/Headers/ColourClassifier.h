@@ -0,0 +1,55 @@
+/****************************************************************************
+ Header
+   ColourClassifier.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Ball colour from the TCS3472x samples, by nearest calibrated centroid in
+   chromaticity
+
+****************************************************************************/
+
+#ifndef ColourClassifier_H
+#define ColourClassifier_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// In the order of the centroid parameters in ParamStore, CC_UNKNOWN last
+typedef enum
+{
+  CC_EMPTY,     // nothing in front of the sensor
+  CC_RED,
+  CC_ORANGE,
+  CC_YELLOW,
+  CC_GREEN,
+  CC_BLUE,
+  CC_PINK,
+  CC_UNKNOWN    // too dark, or too far from every centroid
+}BallColour_t;
+
+#define CC_NUM_CENTROIDS CC_UNKNOWN
+
+// EV_BALL_COLOUR parameter: colour in the low byte, confidence in the high
+#define CC_EVENT_PARAM(Colour, Confidence) \
+  ((uint16_t)(Colour) | ((uint16_t)(Confidence) << 8))
+#define CC_PARAM_COLOUR(Param) ((BallColour_t)((Param) & 0xff))
+#define CC_PARAM_CONFIDENCE(Param) ((uint8_t)((Param) >> 8))
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void CC_ApplyParams(void);
+BallColour_t CC_Classify(uint16_t Clear, uint16_t Red, uint16_t Green,
+                         uint8_t *Confidence);
+void CC_NewSample(uint16_t Clear, uint16_t Red, uint16_t Green);
+bool CC_StartCalibration(BallColour_t Colour);
+bool CC_QueryCalibration(uint8_t *R, uint8_t *G);
+const char *CC_QueryName(BallColour_t Colour);
+
+//***************************************************************************
+
+#endif /* ColourClassifier_H */
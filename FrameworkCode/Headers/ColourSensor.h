@@ -0,0 +1,53 @@
+/****************************************************************************
+ Header
+   ColourSensor.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   TCS3472x colour sensor service, the sensor is on I2C1 and driven
+   through the I2CService queue
+
+****************************************************************************/
+
+#ifndef ColourSensor_H
+#define ColourSensor_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ES_Configure.h"
+#include "ES_Events.h"
+
+// What CS_Read reads
+typedef enum
+{
+  CS_CLEAR,
+  CS_RED,
+  CS_GREEN,
+  CS_BLUE,
+  CS_ALL        // all four in one burst
+}CSChannel_t;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+bool InitColourSensor(uint8_t Priority);
+bool PostColourSensor(ES_Event_t ThisEvent);
+ES_Event_t RunColourSensor(ES_Event_t ThisEvent);
+
+void CS_ApplyParams(void);
+bool CS_Read(CSChannel_t Which);
+void CS_IntISR(void);
+uint16_t CS_GetSampleAge(void);
+
+uint16_t CS_GetClearValue(void);
+uint16_t CS_GetRedValue(void);
+uint16_t CS_GetGreenValue(void);
+uint16_t CS_GetBlueValue(void);
+
+//***************************************************************************
+
+#endif /* ColourSensor_H */
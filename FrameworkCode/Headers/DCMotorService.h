@@ -12,6 +12,11 @@
 #include <stdint.h>
 #include "ES_Configure.h"
 #include "ES_Framework.h"
+#include "MotorController.h"
+
+// MotorController Ids, the EventParam of EV_MOTOR_JAM / EV_MOTOR_FAULT
+#define PICKUP_MOTOR 0
+#define TRANSPORT_MOTOR 1
 
 // Public Function Prototypes
 /*------- Leaving these in case we change our minds & we don't want a simple service --------*/
@@ -19,9 +24,11 @@ bool InitDCMotorService(uint8_t Priority);
 bool PostDCMotorService(ES_Event_t ThisEvent);
 ES_Event_t RunDCMotorService(ES_Event_t ThisEvent);
 /*-------------------------------------------------------------------------------------------*/
-void startPickupMotor(uint32_t DutyCycle); 
+void startPickupMotor(float RPM); 
 void stopPickupMotor(void);
-void startTransportMotor(uint32_t DutyCycle); 
+void startTransportMotor(float RPM); 
 void stopTransportMotor(void);
+MC_State_t QueryDCMotorState(uint8_t Motor);
+float QueryDCMotorSpeed(uint8_t Motor);
 void InitDCPWM(void);
 #endif /* DCMotorService_H */
@@ -17,5 +17,16 @@ void Drive_Control_Init(void);
 void Drive_Straight(float distancex100);
 void Drive_Turn(float degreesx10);
 void StopDrive(void);
+bool Drive_QueueStraight(float distancex100);
+bool Drive_QueueTurn(float degreesx10);
+bool Drive_QueueArc(float distancex100, float degreesx10);
+bool Drive_QueueVelocity(float speedx100, uint16_t duration);
+bool Drive_QueueWait(uint16_t duration);
+void Drive_StartQueue(void);
+bool Drive_AddWaypoint(float xx100, float yx100);
+void Drive_ClearWaypoints(void);
+bool Drive_FollowPath(void);
+void Drive_StartDistanceCal(void);
+float Drive_FinishDistanceCal(float distancex100);
 
 #endif //DriveCommandModule_H
@@ -33,7 +33,7 @@
 /****************************************************************************/
 // This macro determines that nuber of services that are *actually* used in
 // a particular application. It will vary in value from 1 to MAX_NUM_SERVICES
-#define NUM_SERVICES 5
+#define NUM_SERVICES 8
 
 /****************************************************************************/
 // These are the definitions for Service 0, the lowest priority service.
@@ -102,18 +102,18 @@
 // the name of the run function
 #define SERV_4_RUN RunMotorService
 // How big should this services Queue be?
-#define SERV_4_QUEUE_SIZE 3
+#define SERV_4_QUEUE_SIZE 8
 #endif
 
 /****************************************************************************/
 // These are the definitions for Service 5
 #if NUM_SERVICES > 5
 // the header file with the public function prototypes
-#define SERV_5_HEADER "EncoderService.h"
+#define SERV_5_HEADER "BeaconService.h"
 // the name of the Init function
-#define SERV_5_INIT InitEncoderService
+#define SERV_5_INIT InitBeaconService
 // the name of the run function
-#define SERV_5_RUN RunEncoderService
+#define SERV_5_RUN RunBeaconService
 // How big should this services Queue be?
 #define SERV_5_QUEUE_SIZE 5
 #endif
@@ -122,26 +122,26 @@
 // These are the definitions for Service 6
 #if NUM_SERVICES > 6
 // the header file with the public function prototypes
-#define SERV_6_HEADER "TestHarnessService6.h"
+#define SERV_6_HEADER "ParamConsole.h"
 // the name of the Init function
-#define SERV_6_INIT InitTestHarnessService6
+#define SERV_6_INIT InitParamConsole
 // the name of the run function
-#define SERV_6_RUN RunTestHarnessService6
+#define SERV_6_RUN RunParamConsole
 // How big should this services Queue be?
-#define SERV_6_QUEUE_SIZE 3
+#define SERV_6_QUEUE_SIZE 5
 #endif
 
 /****************************************************************************/
 // These are the definitions for Service 7
 #if NUM_SERVICES > 7
 // the header file with the public function prototypes
-#define SERV_7_HEADER "TestHarnessService7.h"
+#define SERV_7_HEADER "ColourSensor.h"
 // the name of the Init function
-#define SERV_7_INIT InitTestHarnessService7
+#define SERV_7_INIT InitColourSensor
 // the name of the run function
-#define SERV_7_RUN RunTestHarnessService7
+#define SERV_7_RUN RunColourSensor
 // How big should this services Queue be?
-#define SERV_7_QUEUE_SIZE 3
+#define SERV_7_QUEUE_SIZE 5
 #endif
 
 /****************************************************************************/
@@ -266,17 +266,26 @@ typedef enum
   EV_I2C_ReadGreen,
   EV_I2C_ReadBlue,
   EV_I2C_ReadAll,
-  EV_I2C_StepFinished,
-  EV_I2C_InitSensor,
-  EV_I2C_NextStep,
   EV_I2C_EOS,
-  EV_I2C_Wait4Busy,
   EV_I2C_Wait4Time,
+  EV_I2C_BusError,
+  EV_COLOUR_INT,
   RESPONSE_RECEIVED,
   ES_GAME_OVER,
   ES_CLEANING_UP,
   ES_BUMPER_HIT,
-  EV_MOVE_COMPLETED
+  EV_MOVE_COMPLETED,
+  EV_SEGMENT_COMPLETED,
+  EV_BEACON_SWEEP,
+  EV_BEARINGS_READY,
+  EV_WHEEL_STALL,
+  EV_WHEEL_SLIP,
+  EV_MOTOR_JAM,
+  EV_MOTOR_FAULT,
+  EV_AUTOTUNE_DONE,
+  EV_BALL_COLOUR,
+  EV_COLOUR_CAL_DONE,
+  EV_CONSOLE_LIST
 }ES_EventType_t;
 
 /****************************************************************************/
@@ -311,7 +320,7 @@ typedef enum
 
 /****************************************************************************/
 // This is the list of event checking functions
-#define EVENT_CHECK_LIST Check4Keystroke, IsI2C1Finished
+#define EVENT_CHECK_LIST Check4Keystroke
 
 /****************************************************************************/
 // These are the definitions for the post functions to be executed when the
@@ -322,8 +331,8 @@ typedef enum
 #define TIMER_UNUSED ((pPostFunc)0)
 #define TIMER0_RESP_FUNC TIMER_UNUSED//PostTestHarnessI2C
 #define TIMER1_RESP_FUNC PostSPISM
-#define TIMER2_RESP_FUNC PostSPISM
-#define TIMER3_RESP_FUNC TIMER_UNUSED
+#define TIMER2_RESP_FUNC TIMER_UNUSED
+#define TIMER3_RESP_FUNC PostBeaconService
 #define TIMER4_RESP_FUNC TIMER_UNUSED
 #define TIMER5_RESP_FUNC TIMER_UNUSED
 #define TIMER6_RESP_FUNC TIMER_UNUSED
@@ -334,7 +343,7 @@ typedef enum
 #define TIMER11_RESP_FUNC TIMER_UNUSED
 #define TIMER12_RESP_FUNC TIMER_UNUSED
 #define TIMER13_RESP_FUNC TIMER_UNUSED
-#define TIMER14_RESP_FUNC TIMER_UNUSED
+#define TIMER14_RESP_FUNC PostColourSensor
 #define TIMER15_RESP_FUNC PostI2CService
 
 /****************************************************************************/
@@ -346,7 +355,8 @@ typedef enum
 
 #define I2C_TEST_TIMER 0
 #define SPI_TIMER 1
-#define SPI_REFRESH_TIMER 2
+#define BEACON_TIMER 3
+#define COLOUR_TIMER 14
 #define I2C_TIMER 15
 
 /**************************************************************************/
@@ -116,6 +116,7 @@ void _HW_DebugLines_ClearLine2(void);
 #endif
 
 #ifdef _INCLUDE_BYTE_DEBUG_
+// task level only, a full SSI1 queue waits on the SSI1 interrupt
 void _HW_ByteDebug_Init( void);
 void _HW_ByteDebug_ClearBit( uint8_t WhichBit );
 void _HW_ByteDebug_SetBit( uint8_t WhichBit );
@@ -30,6 +30,7 @@
 void Enc_Init(void);
 float QueryEncoderTickCount(uint8_t wheel);
 void ResetEncoderTickCount(uint8_t wheel);
+int32_t QueryEncoderOdometer(uint8_t wheel);
 float QueryEncoderPeriod(uint8_t sensor);
 uint32_t QueryEncoderLastEdge(uint8_t sensor);
 
@@ -0,0 +1,47 @@
+/****************************************************************************
+ Header
+   FastMath.h
+
+ Module Revision
+   1.0.1
+
+ Max error over the stated input range, measured on the host against
+ double precision libm by HostTests/FastMathTest:
+   FM_Sinf, FM_Cosf, FM_SinCosf   |x| < 1e4 rad         1e-7 absolute
+   FM_Tanf                        |x| < 1e4, |tan| < 100 2.5e-7 absolute below
+                                                         1, relative above
+   FM_Atan2f                      all                   1.2e-5 rad absolute
+   FM_Recipf                      normal floats         1.5e-7 relative
+   FM_SinQ15, FM_CosQ15           all                   5 LSB (1.4e-4)
+
+****************************************************************************/
+
+#ifndef FastMath_H
+#define FastMath_H
+
+#include <stdint.h>
+
+#define FM_PI 3.14159265358979f
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+float FM_Sinf(float x);
+float FM_Cosf(float x);
+void FM_SinCosf(float x, float *Sin, float *Cos);
+float FM_Tanf(float x);
+float FM_Atan2f(float y, float x);
+float FM_Recipf(float x);
+
+// Binary angle (2^32 is a full turn) in, Q15 out
+int32_t FM_SinQ15(uint32_t Angle);
+int32_t FM_CosQ15(uint32_t Angle);
+
+// Batch versions, written to auto-vectorize on the host
+void FM_SinCosBatch(const float *x, float *Sin, float *Cos, uint16_t Count);
+void FM_Atan2Batch(const float *y, const float *x, float *Out, uint16_t Count);
+
+//***************************************************************************
+
+#endif /* FastMath_H */
@@ -0,0 +1,50 @@
+/****************************************************************************
+ Header
+   FrequencyTable.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Frequency lists for the IR beacons and the recycling centers, and O(1)
+   classification of a capture period (40MHz ticks) into a beacon index
+
+****************************************************************************/
+
+#ifndef FrequencyTable_H
+#define FrequencyTable_H
+
+#include <stdint.h>
+
+#define FT_TICKS_PER_SECOND 40000000
+#define FT_PERIOD(f) (FT_TICKS_PER_SECOND / (f))
+#define FT_NO_MATCH 0xFF
+
+// Each list is X(Index, Frequency in Hz, c, t), c and t are passed through
+// for the table generator in FrequencyTable.c
+
+// Beacons A, B, C, D as in Triangulate
+#define FT_BEACON_LIST(X, c, t) \
+  X(0, 2000, c, t) X(1, 1667, c, t) X(2, 1429, c, t) X(3, 1200, c, t)
+#define FT_NUM_BEACON_FREQUENCIES 4
+
+// Recycling center frequencies, indexed by the 4 bit COMPASS code
+#define FT_RECYCLE_LIST(X, c, t) \
+  X(0, 1000, c, t) X(1, 947, c, t) X(2, 893, c, t) X(3, 840, c, t) \
+  X(4, 787, c, t) X(5, 733, c, t) X(6, 680, c, t) X(7, 627, c, t) \
+  X(8, 573, c, t) X(9, 520, c, t) X(10, 467, c, t) X(11, 413, c, t) \
+  X(12, 360, c, t) X(13, 307, c, t) X(14, 253, c, t) X(15, 200, c, t)
+#define FT_NUM_RECYCLE_FREQUENCIES 16
+
+// For building plain arrays from a list: { FT_RECYCLE_LIST(FT_FREQUENCY, 0, 0) }
+#define FT_FREQUENCY(i, f, c, t) f,
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+uint8_t FT_ClassifyBeacon(uint32_t Period);
+
+//***************************************************************************
+
+#endif /* FrequencyTable_H */
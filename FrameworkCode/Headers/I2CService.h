@@ -1,6 +1,6 @@
 /****************************************************************************
 
-  Header file for sample I2C implementation 
+  Header file for the I2C1 transaction manager
   based on the Gen2 Events and Services Framework
 
  ****************************************************************************/
@@ -13,24 +13,90 @@
 #include "ES_Types.h"     /* gets bool type for returns */
 #include "ES_Events.h"    /* gets ES_Event_t type */
 
+// Requests that can wait for the bus, more are refused by I2C_Request
+#define I2C_QUEUE_SIZE 8
+
+// do transaction with/without stop generation
+#define DO_STOP  true
+#define NO_STOP  false
+
+// do transaction with/without start generation
+#define DO_START  true
+#define NO_START  false
+
+// are we aiting on busy or time?
+#define BUSY_WAIT  true
+#define TIME_WAIT  false
+
 // typedefs for the states
 // State definitions for use with the query function
 typedef enum
 {
-  InitPState, Idle, Interpreting, Waiting4Busy, Waiting4Time
+  InitPState, Idle, Running, Waiting4Time
 }I2CState_t;
 
+typedef enum    /* definitions for the possible steps in command sequence */
+{
+  CMD_Write8,     /* write 8 bits to I2C with start & stop */
+  CMD_Write8NS,   /* write 8 bits to I2C with no start but with stop */
+  CMD_WriteMult,  /* write 8 bits to I2C with start but with-out stop */
+  CMD_WriteMultNS,/* write 8 bits to I2C with no start or stop */
+  CMD_Read8,      /* read 8 bits to I2C with start & stop */
+  CMD_Read8NS,    /* read 8 bits to I2C with no start but with stop */
+  CMD_ReadMult,   /* read 8 bits to I2C with start but with-out stop */
+  CMD_ReadMultNS, /* read 8 bits to I2C with no start or stop */
+  CMD_ReadBurst,  /* read Value bytes into Result, start before & stop after */
+  CMD_GetResult,  /* fetches the result of the last read operation */
+  CMD_Form16,     /* combine 2 8-bit temp values into 16bit result */
+  CMD_NOP,        /* No-Operation, used for time-only delays */
+  CMD_EOS         /* End Of Sequence marker */
+} CMD_t;
+
+typedef struct  /* definition of each step */
+{
+  CMD_t Command;
+  uint8_t Value;
+  uint16_t WaitTime;
+  bool BusyWait;
+  void * Result;
+}StepDefinition_t;
+
+typedef struct  /* one device on I2C1 */
+{
+  uint8_t Address;                           /* 7 bit slave address */
+  bool FastMode;                             /* 400 kbps, else 100 kbps */
+  const StepDefinition_t * const *Sequences; /* each ends with CMD_EOS */
+  uint8_t NumSequences;
+}I2CDevice_t;
+
+// Called from the service once a request is done, false if it failed
+typedef void I2CDoneFunc_t(bool Ok);
+
+typedef struct
+{
+  uint32_t Requests;    /* accepted by I2C_Request */
+  uint32_t Refused;     /* queue full or bad sequence */
+  uint32_t Completed;
+  uint32_t Errors;      /* requests that failed every retry */
+  uint32_t Retries;     /* requests run again after a bus error */
+  uint32_t Recoveries;  /* times the bus was cleared by hand */
+  uint32_t BusUS;       /* time the bus was clocking, from the bit counts */
+  uint32_t ElapsedMS;   /* since the last I2C_ResetStats */
+  uint8_t MaxWaiting;   /* deepest the queue has been */
+}I2CStats_t;
+
 // Public Function Prototypes
 
 bool InitI2CService(uint8_t Priority);
 bool PostI2CService(ES_Event_t ThisEvent);
 ES_Event_t RunI2CService(ES_Event_t ThisEvent);
 I2CState_t QueryI2CService(void);
-bool IsI2C1Finished(void);
-uint16_t I2C_GetClearValue(void);
-uint16_t I2C_GetRedValue(void);
-uint16_t I2C_GetGreenValue(void);
-uint16_t I2C_GetBlueValue(void);
+void I2C_MasterISR(void);
 
-#endif /* I2CService_H */
+bool I2C_Request(const I2CDevice_t *Device, uint8_t Sequence,
+                 I2CDoneFunc_t *Done);
+uint8_t I2C_QueryWaiting(void);
+void I2C_QueryStats(I2CStats_t *Stats);
+void I2C_ResetStats(void);
 
+#endif /* I2CService_H */
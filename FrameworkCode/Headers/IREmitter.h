@@ -15,6 +15,7 @@
 
 void InitEmitterPWM(void);
 void UpdateEmitterPeriod(uint32_t RecycleIRPeriod);
+void ApplyEmitterParams(void);
 void EnableEmitterPWM(void);
 void DisableEmitterPWM(void);
 
@@ -0,0 +1,56 @@
+/****************************************************************************
+ Header
+   MotionProfile.h
+
+ Module Revision
+   1.0.1
+
+****************************************************************************/
+
+#ifndef MotionProfile_H
+#define MotionProfile_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MP_NUM_PHASES 7
+
+// Limits are in encoder ticks and seconds, a MaxJerk of 0 gives a
+// trapezoidal profile (acceleration steps in a single control period)
+typedef struct
+{
+  float MaxVelocity;  // ticks/s
+  float MaxAccel;     // ticks/s^2
+  float MaxJerk;      // ticks/s^3
+}MotionLimits_t;
+
+// Precomputed profile, all internal quantities are per control period
+typedef struct
+{
+  uint32_t PhaseEnd[MP_NUM_PHASES];   // period count at which each phase ends
+  float PhaseJerk[MP_NUM_PHASES];     // jerk applied during each phase
+  float Accel;
+  float Velocity;
+  float Position;
+  float Target;
+  uint32_t Tick;
+  uint8_t Phase;
+  bool Active;
+}MotionProfile_t;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void MP_Plan(MotionProfile_t *Profile, float Distance,
+             const MotionLimits_t *Limits, uint32_t UpdateTimeUS);
+float MP_Step(MotionProfile_t *Profile);
+void MP_Cancel(MotionProfile_t *Profile);
+bool MP_IsActive(const MotionProfile_t *Profile);
+float MP_GetVelocity(const MotionProfile_t *Profile);
+float MP_GetPosition(const MotionProfile_t *Profile);
+uint32_t MP_GetDuration(const MotionProfile_t *Profile);
+
+//***************************************************************************
+
+#endif /* MotionProfile_H */
@@ -0,0 +1,68 @@
+/****************************************************************************
+ Header
+   MotionQueue.h
+
+ Module Revision
+   1.0.1
+
+****************************************************************************/
+
+#ifndef MotionQueue_H
+#define MotionQueue_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MQ_SIZE 8
+
+// Motion primitives
+typedef enum
+{
+  MQ_STRAIGHT,  // Distance
+  MQ_TURN,      // Heading, in place
+  MQ_ARC,       // Distance and Heading together
+  MQ_VELOCITY,  // hold Speed for Duration
+  MQ_WAIT       // hold position for Duration
+}MotionType_t;
+
+// Distance and Heading in encoder ticks (as Drive_SetDistance and
+// Drive_SetHeading), Speed in ticks/s, Duration in ms
+typedef struct
+{
+  MotionType_t Type;
+  float Distance;
+  float Heading;
+  float Speed;
+  uint16_t Duration;
+}MotionSegment_t;
+
+// Setpoints handed to the control loop, positions are relative to
+// MQ_Start and velocities are per control period
+typedef struct
+{
+  float Distance;
+  float Heading;
+  float DistanceVelocity;
+  float HeadingVelocity;
+}MotionSetpoint_t;
+
+// MQ_Step status bits
+#define MQ_SEGMENT_DONE 0x01  // a segment finished this period
+#define MQ_DRAINED 0x02       // ...and it was the last one queued
+#define MQ_IDLE 0x04          // nothing left to run
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void MQ_Init(void);
+bool MQ_Push(const MotionSegment_t *Segment);
+void MQ_Clear(void);
+uint8_t MQ_Count(void);
+void MQ_SetLimits(float MaxVelocity, float MaxAccel);
+void MQ_Start(void);
+uint8_t MQ_Step(uint32_t UpdateTimeUS, MotionSetpoint_t *Setpoint);
+
+//***************************************************************************
+
+#endif /* MotionQueue_H */
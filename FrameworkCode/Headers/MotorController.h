@@ -0,0 +1,90 @@
+/****************************************************************************
+ Header
+   MotorController.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Per-motor PI speed controller with jam detection and reverse-and-retry,
+   all registered controllers are serviced from the drive control ISR
+
+****************************************************************************/
+
+#ifndef MotorController_H
+#define MotorController_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+// Controllers are updated at this period, measurements are taken in between
+#define MC_SERVICE_US 10000
+#define MC_MAX_CONTROLLERS 4
+
+typedef enum
+{
+  MC_STOPPED, MC_RUNNING, MC_REVERSING, MC_FAULT
+}MC_State_t;
+
+// PI loop on speed, also used on its own by the drive wheels
+typedef struct
+{
+  float PGain;     // percent duty per RPM
+  float IGain;
+  float Integral;  // IGain * Integral is clamped to the duty limit
+  float Error;
+}MC_PI_t;
+
+// Takes a speed measurement if it can right now, returns false if not
+typedef bool MC_MeasureFunc_t (float *RPM);
+// Applies a signed duty in percent, negative is reverse
+typedef void MC_OutputFunc_t (float Duty);
+
+typedef struct
+{
+  // Filled in by the owner before MC_Register
+  uint8_t Id;                 // EventParam of EV_MOTOR_JAM / EV_MOTOR_FAULT
+  MC_PI_t PI;
+  float IntegralScale;        // error weight per MC_SERVICE_US period
+  MC_MeasureFunc_t *Measure;
+  MC_OutputFunc_t *Output;
+  PostFunc_t *Post;           // where jam events go
+  float MaxDuty;
+  float ReverseDuty;
+  uint8_t MaxRetries;
+
+  // Owned by MotorController.c
+  float Setpoint;
+  float Speed;
+  float Duty;
+  bool Measured;
+  MC_State_t State;
+  uint16_t JamMS;
+  uint16_t StateMS;
+  uint16_t CleanMS;
+  uint8_t Retries;
+}MotorController_t;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void MC_Init(uint16_t UpdatePeriodUS);
+bool MC_Register(MotorController_t *Controller);
+void MC_SetSpeed(MotorController_t *Controller, float RPM);
+void MC_Stop(MotorController_t *Controller);
+MC_State_t MC_QueryState(MotorController_t *Controller);
+float MC_QuerySpeed(MotorController_t *Controller);
+float MC_QueryDuty(MotorController_t *Controller);
+void MC_ServiceAll(void);
+
+void MC_ResetPI(MC_PI_t *PI);
+float MC_RunPI(MC_PI_t *PI, float Setpoint, float Measured,
+               float IntegralScale, float Limit);
+
+//***************************************************************************
+
+#endif /* MotorController_H */
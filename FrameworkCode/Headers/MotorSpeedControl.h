@@ -19,6 +19,16 @@
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 
+//Stages of the control ISR, for the CPU time queries
+#define CONTROL_STAGE_RPM				0
+#define CONTROL_STAGE_POSITION	1
+#define CONTROL_STAGE_VELOCITY	2
+#define CONTROL_STAGE_MOTORS		3
+#define NUM_CONTROL_STAGES			4
+
+//Period the gains were tuned at, I and D terms are rescaled from it
+#define NOMINAL_UPDATE_US	2000
+
 /****************************************************************************
 	FUNCTION PROTOTYPES
 ****************************************************************************/
@@ -29,8 +39,19 @@ void Drive_SetDistance(float newLimit);
 void Drive_SetHeading(float newLimit);
 void Drive_Stop(void);
 void Drive_SetClampRPM(float newRPM);
+void Drive_RunQueue(void);
+bool Drive_RunPath(void);
+void Drive_SetDistanceLimits(float MaxVelocity, float MaxAccel, float MaxJerk);
+void Drive_SetHeadingLimits(float MaxVelocity, float MaxAccel, float MaxJerk);
+void Drive_ApplyParams(void);
+void Drive_StartAutoTune(void);
 
-void Drive_SpeedUpdateTimer_Init(uint16_t updateTime);
+void Drive_SpeedUpdateTimer_Init(uint16_t VelocityPeriod, uint16_t PositionPeriod);
+uint8_t QueryControlDecimation(void);
+uint32_t QueryStageTime(uint8_t Stage);
+uint32_t QueryStageMaxTime(uint8_t Stage);
+uint32_t QueryLostPosts(void);
+void ResetStageTimes(void);
 
 
 
@@ -0,0 +1,47 @@
+/****************************************************************************
+ Header
+   Odometry.h
+
+ Module Revision
+   1.0.1
+
+****************************************************************************/
+
+#ifndef Odometry_H
+#define Odometry_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pose in fixed point: X and Y in 1/65536 inch, Theta as a binary angle
+// (2^32 is a full turn, so it wraps for free). Theta grows when wheel 2
+// runs ahead of wheel 1, the same sense as Drive_SetHeading.
+typedef struct
+{
+  int32_t X;
+  int32_t Y;
+  uint32_t Theta;
+}Pose_t;
+
+#define POSE_ONE_INCH 65536
+#define POSE_TO_INCHES(q) ((q) / 65536.0f)
+#define POSE_TO_DEGREES(t) ((int32_t)(t) * (360.0f / 4294967296.0f))
+#define ROTATION_TO_DEGREES(r) ((r) * (360.0f / 65536.0f))
+#define DEGREES_TO_POSE(d) ((uint32_t)(int32_t)((d) * (4294967296.0f / 360.0f)))
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void Odo_Init(void);
+void Odo_Update(void);
+void Odo_ApplyParams(void);
+void Odo_QueryPose(Pose_t *Pose);
+uint32_t Odo_QueryHeading(void);
+void Odo_SetPose(const Pose_t *Pose);
+void Odo_AdjustPose(int32_t DeltaX, int32_t DeltaY, int32_t DeltaTheta);
+void Odo_QueryTravel(uint32_t *Travel, uint32_t *Rotation);
+
+//***************************************************************************
+
+#endif /* Odometry_H */
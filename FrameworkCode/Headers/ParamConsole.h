@@ -0,0 +1,28 @@
+/****************************************************************************
+
+  Header file for the parameter console service
+  based on the Gen 2 Events and Services Framework
+
+ ****************************************************************************/
+
+#ifndef ParamConsole_H
+#define ParamConsole_H
+
+#include "ES_Types.h"
+#include <stdint.h>
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+// Key that opens a command line, every key goes to the console until Enter
+// or Esc
+#define PC_OPEN_KEY ':'
+
+// Public Function Prototypes
+
+bool InitParamConsole(uint8_t Priority);
+bool PostParamConsole(ES_Event_t ThisEvent);
+ES_Event_t RunParamConsole(ES_Event_t ThisEvent);
+
+bool PC_IsActive(void);
+
+#endif /* ParamConsole_H */
@@ -0,0 +1,119 @@
+/****************************************************************************
+ Header
+   ParamStore.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Run time tuning parameters: one RAM block read directly by the modules
+   that use them, a registry with names and ranges for the console, and a
+   copy in the EEPROM
+
+****************************************************************************/
+
+#ifndef ParamStore_H
+#define ParamStore_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Each entry is X(Name, Type, Min, Max, Default, OnChange)
+//   Type is PS_FLOAT or PS_UINT, every parameter is one 32 bit word
+//   OnChange is called after the value is changed at run time, for modules
+//   that derive something from it (0 if the value is only read directly)
+// Append new entries at the end, the EEPROM copy is dropped for any change
+// to the list.
+#define PS_PARAM_LIST(X) \
+  /* wheel speed PI loops, MotorSpeedControl */ \
+  X(WheelP1, PS_FLOAT, 0, 50, 2, Drive_ApplyParams) \
+  X(WheelI1, PS_FLOAT, 0, 10, 0.3f, Drive_ApplyParams) \
+  X(WheelP2, PS_FLOAT, 0, 50, 2, Drive_ApplyParams) \
+  X(WheelI2, PS_FLOAT, 0, 10, 0.3f, Drive_ApplyParams) \
+  /* distance and heading PD loops, MotorSpeedControl */ \
+  X(DistanceP, PS_FLOAT, 0, 100, 2, 0) \
+  X(DistanceD, PS_FLOAT, 0, 100, 10, 0) \
+  X(HeadingP, PS_FLOAT, 0, 100, 5, 0) \
+  X(HeadingD, PS_FLOAT, 0, 100, 10, 0) \
+  /* control loop periods in us, MotorSpeedControl */ \
+  X(VelocityUS, PS_UINT, 250, 5000, 500, Drive_ApplyParams) \
+  X(PositionUS, PS_UINT, 250, 20000, 2000, Drive_ApplyParams) \
+  /* DriveCommandModule */ \
+  X(StraightRPM, PS_FLOAT, 10, 150, 100, 0) \
+  X(TurnRPM, PS_FLOAT, 10, 150, 100, 0) \
+  X(TicksPerInch, PS_FLOAT, 5, 30, 15.1595f, Odo_ApplyParams) \
+  X(TicksPerDegree, PS_FLOAT, 0.5f, 3, 1.35468f, Odo_ApplyParams) \
+  /* shortest gap between COMPASS frames in ms, SPISM */ \
+  X(SPIQueryMS, PS_UINT, 1, 100, 2, 0) \
+  /* colour sensor integration time in ms, one sample each, ColourSensor */ \
+  X(ColourIntegMS, PS_UINT, 3, 614, 350, CS_ApplyParams) \
+  /* IR emitter period in us before the COMPASS assigns one, IREmitter */ \
+  X(EmitterUS, PS_UINT, 100, 5000, 600, ApplyEmitterParams) \
+  /* colour sensor I2C speed, 1 for 400 kbps and 0 for 100 kbps */ \
+  X(ColourI2CFast, PS_UINT, 0, 1, 1, 0) \
+  /* ball colour centroids, r and g chromaticity (256 * Red or Green / */ \
+  /* Clear) in the order of BallColour_t, ColourClassifier */ \
+  X(EmptyR, PS_UINT, 0, 255, 92, CC_ApplyParams) \
+  X(EmptyG, PS_UINT, 0, 255, 85, CC_ApplyParams) \
+  X(RedR, PS_UINT, 0, 255, 159, CC_ApplyParams) \
+  X(RedG, PS_UINT, 0, 255, 51, CC_ApplyParams) \
+  X(OrangeR, PS_UINT, 0, 255, 141, CC_ApplyParams) \
+  X(OrangeG, PS_UINT, 0, 255, 69, CC_ApplyParams) \
+  X(YellowR, PS_UINT, 0, 255, 115, CC_ApplyParams) \
+  X(YellowG, PS_UINT, 0, 255, 97, CC_ApplyParams) \
+  X(GreenR, PS_UINT, 0, 255, 72, CC_ApplyParams) \
+  X(GreenG, PS_UINT, 0, 255, 115, CC_ApplyParams) \
+  X(BlueR, PS_UINT, 0, 255, 51, CC_ApplyParams) \
+  X(BlueG, PS_UINT, 0, 255, 77, CC_ApplyParams) \
+  X(PinkR, PS_UINT, 0, 255, 125, CC_ApplyParams) \
+  X(PinkG, PS_UINT, 0, 255, 52, CC_ApplyParams) \
+  /* COMPASS status polling in ms, SPISM: every frame within StatusHotMS */ \
+  /* of a change, past or expected, and while waiting for the start, */ \
+  /* else every StatusSlowMS */ \
+  X(StatusHotMS, PS_UINT, 0, 10000, 1000, 0) \
+  X(StatusSlowMS, PS_UINT, 5, 1000, 100, 0)
+
+#define PS_CTYPE_PS_FLOAT float
+#define PS_CTYPE_PS_UINT uint32_t
+
+#define PS_FIELD(Name, Type, Min, Max, Default, OnChange) \
+  PS_CTYPE_##Type Name;
+#define PS_ID(Name, Type, Min, Max, Default, OnChange) PS_ID_##Name,
+
+typedef struct
+{
+  PS_PARAM_LIST(PS_FIELD)
+}ParamBlock_t;
+
+typedef enum
+{
+  PS_PARAM_LIST(PS_ID)
+  PS_NUM_PARAMS
+}ParamId_t;
+
+typedef enum
+{
+  PS_FLOAT, PS_UINT
+}ParamType_t;
+
+// The parameters, read them as Param.Name (a single load, no lookup).
+// Only written through PS_Set / PS_RestoreDefaults, never from an ISR.
+extern ParamBlock_t Param;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+bool PS_Init(void);
+bool PS_Find(const char *Name, ParamId_t *Id);
+const char *PS_QueryName(ParamId_t Id);
+ParamType_t PS_QueryType(ParamId_t Id);
+void PS_QueryRange(ParamId_t Id, float *Min, float *Max);
+float PS_Get(ParamId_t Id);
+bool PS_Set(ParamId_t Id, float Value);
+void PS_RestoreDefaults(void);
+bool PS_Save(void);
+
+//***************************************************************************
+
+#endif /* ParamStore_H */
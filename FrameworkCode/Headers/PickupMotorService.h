@@ -19,7 +19,6 @@ bool InitPickupMotorService(uint8_t Priority);
 bool PostPickupMotorService(ES_Event_t ThisEvent);
 ES_Event_t RunPickupMotorService(ES_Event_t ThisEvent);
 /*-------------------------------------------------------------------------------------------*/
-void startPickupMotor(uint32_t DutyCycle); 
-void stopPickupMotor(void);
+// startPickupMotor and stopPickupMotor are in DCMotorService.h
 
 #endif /* PickupMotorService_H */
@@ -0,0 +1,32 @@
+/****************************************************************************
+ Header
+   PoseFilter.h
+
+ Module Revision
+   1.0.1
+
+****************************************************************************/
+
+#ifndef PoseFilter_H
+#define PoseFilter_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void PF_Init(void);
+void PF_Predict(void);
+bool PF_Correct(float X, float Y, float Heading, uint8_t NumBeacons,
+                const float *BeaconX, const float *BeaconY);
+bool PF_CorrectFromBeacons(float AngleA, float AngleB, float AngleC, float AngleD);
+bool PF_CorrectFromBearings(const float *Angles, const float *Confidence);
+void PF_QueryPose(float *X, float *Y, float *Heading);
+void PF_QueryVariance(float *VarX, float *VarY, float *VarHeading);
+uint16_t PF_QueryRejectCount(void);
+
+//***************************************************************************
+
+#endif /* PoseFilter_H */
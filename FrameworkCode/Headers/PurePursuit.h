@@ -0,0 +1,38 @@
+/****************************************************************************
+ Header
+   PurePursuit.h
+
+ Module Revision
+   1.0.1
+
+ Description
+   Pure pursuit waypoint follower, run from the position loop
+
+****************************************************************************/
+
+#ifndef PurePursuit_H
+#define PurePursuit_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Waypoints per path, not counting the start (the pose at PP_Start)
+#define PP_MAX_WAYPOINTS 15
+
+// PP_Step status bits
+#define PP_WAYPOINT_DONE 0x01  // passed a waypoint this period
+#define PP_ARRIVED 0x02        // at the last waypoint, wheels set to zero
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void PP_Clear(void);
+bool PP_AddWaypoint(float X, float Y);
+uint8_t PP_Count(void);
+bool PP_Start(void);
+uint8_t PP_Step(uint32_t UpdateTimeUS, float MaxRPM, float *RPM_1, float *RPM_2);
+
+//***************************************************************************
+
+#endif /* PurePursuit_H */
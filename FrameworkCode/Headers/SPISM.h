@@ -44,7 +44,8 @@ uint16_t GetRightRecycleFreq(void);
 uint8_t GetAssignedColor(void);
 uint8_t QueryWhichRecycle(void);
 uint16_t GetAssignedFreq(void);
-void InitSPI(void);
+uint16_t GetStatusLatency(void);
+uint16_t GetMaxStatusLatency(void);
 
 
 #endif /* SPISM_H */
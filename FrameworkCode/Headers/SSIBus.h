@@ -0,0 +1,81 @@
+/****************************************************************************
+ Header
+   SSIBus.h
+
+ Module Revision
+   1.1.0
+
+ Description
+   Queued frame transfers on SSI0 and SSI1 for any number of devices, the
+   receive side run by the uDMA
+
+****************************************************************************/
+
+#ifndef SSIBus_H
+#define SSIBus_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// longest frame, the depth of the transmit FIFO so a frame goes out at once
+#define SSI_MAX_FRAME 8
+
+// frames a bus holds, the one on the wire included
+#define SSI_QUEUE_SIZE 4
+
+// the buses, also the SSI module numbers
+#define SSI_BUS0 0
+#define SSI_BUS1 1
+#define SSI_NUM_BUSES 2
+
+// Mode is the SPI mode, SPO in bit 1 and SPH in bit 0
+#define SSI_MODE_SPH 0x01
+#define SSI_MODE_SPO 0x02
+
+// CSPort of a device that uses the FSS pin of its bus
+#define SSI_CS_FSS 0
+
+// How to talk to one device. The bit rate is 40 MHz / (Divisor * (1 + Rate)).
+typedef struct
+{
+  uint8_t Bus;          /* SSI_BUS0 or SSI_BUS1 */
+  uint8_t Mode;         /* 0 to 3 */
+  uint8_t Divisor;      /* CPSDVSR, even, 2 to 254 */
+  uint8_t Rate;         /* SCR */
+  uint8_t DataBits;     /* bits per item, 4 to 16 */
+  uint32_t CSPort;      /* GPIO port base of an active low select, or SSI_CS_FSS */
+  uint8_t CSPin;        /* bit of the select in CSPort */
+}SSIDevice_t;
+
+// Called from the completion interrupt with the items clocked in, uint8_t
+// for devices of up to 8 data bits and uint16_t above that
+typedef void SSIDoneFunc_t(const void *Rx, uint8_t Length);
+
+typedef struct
+{
+  uint32_t Transfers;   /* completed */
+  uint32_t Refused;     /* queue full or bad length */
+  uint32_t Items;       /* clocked out (and in) by the completed transfers */
+  uint32_t BusUS;       /* time the bus was clocking, from the item counts */
+  uint32_t ElapsedMS;   /* since the last SSI_ResetStats */
+  uint32_t Clocks;      /* CPU clocks spent on the last transfer */
+  uint32_t MaxClocks;   /* worst since the last SSI_ResetStats */
+  uint8_t MaxWaiting;   /* most frames queued at once */
+}SSIStats_t;
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void SSI_InitDevice(const SSIDevice_t *Device);
+bool SSI_Transfer(const SSIDevice_t *Device, const void *Tx, uint8_t Length,
+                  SSIDoneFunc_t *Done);
+uint8_t SSI_QueryWaiting(uint8_t Bus);
+void SSI_0ISR(void);
+void SSI_1ISR(void);
+void SSI_QueryStats(uint8_t Bus, SSIStats_t *Stats);
+void SSI_ResetStats(uint8_t Bus);
+
+//***************************************************************************
+
+#endif /* SSIBus_H */
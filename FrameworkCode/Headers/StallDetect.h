@@ -0,0 +1,36 @@
+/****************************************************************************
+ Header
+   StallDetect.h
+
+ Module Revision
+   1.0.1
+
+****************************************************************************/
+
+#ifndef StallDetect_H
+#define StallDetect_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// SD_Update status bits, set once when a condition is first detected
+#define SD_STALL_1 0x01
+#define SD_STALL_2 0x02
+#define SD_SLIP_1 0x04
+#define SD_SLIP_2 0x08
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+void SD_Init(uint16_t UpdatePeriodUS);
+void SD_Reset(void);
+uint8_t SD_Update(float Duty_1, float Duty_2, float RPM_1, float RPM_2,
+                  float CommandRPM_1, float CommandRPM_2);
+void SD_SetDutyLimit(bool Enable, float SafeDuty);
+float SD_QueryDutyLimit(uint8_t Wheel);
+uint8_t SD_QueryFaults(void);
+
+//***************************************************************************
+
+#endif /* StallDetect_H */
@@ -7,6 +7,9 @@ Header file for the TCS3472x Color Sensor
 #define TCS3472x_ADDRESS          (0x29)
 
 #define TCS3472x_COMMAND_BIT      (0x80)
+#define TCS3472x_AUTO_INCREMENT   (0x20)    /* OR with COMMAND_BIT, consecutive reads step through the registers */
+#define TCS3472x_SPECIAL_FN       (0x60)    /* OR with COMMAND_BIT, the low 5 bits select a special function */
+#define TCS3472x_SF_INT_CLEAR     (0x06)    /* Special function: clear the clear channel interrupt */
 
 #define TCS3472x_ENABLE_REG       (0x00)    /* address of the Eanble/control register */
 #define TCS3472x_ENABLE_AIEN      (0x10)    /* Interrupt Enable */
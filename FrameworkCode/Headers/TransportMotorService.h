@@ -19,7 +19,6 @@ bool InitTransportMotorService(uint8_t Priority);
 bool PostTransportMotorService(ES_Event_t ThisEvent);
 ES_Event_t RunTransportMotorService(ES_Event_t ThisEvent);
 /*-------------------------------------------------------------------------------------------*/
-void startTransportMotor(uint32_t DutyCycle); 
-void stopTransportMotor(void);
+// startTransportMotor and stopTransportMotor are in DCMotorService.h
 
 #endif /* TransportMotorService_H */
@@ -10,17 +10,32 @@
 
 #include "ES_Types.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 
+#define NUM_BEACONS 4
+#define BEACON_A 0
+#define BEACON_B 1
+#define BEACON_C 2
+#define BEACON_D 3
+#define NO_BEACON 0xFF
+
 //Public Function prototypes
 
-void Triangulate(float AngleA, float AngleB, float AngleC, float AngleD);
+bool Triangulate(float AngleA, float AngleB, float AngleC, float AngleD);
+bool TriangulateWeighted(const float *Angles, const float *Confidence,
+  const float *Prior);
 float QueryXCoordinate(void);
 float QueryYCoordinate(void);
 //Heading is defined as number of degrees CCW from the East
 float QueryHeading(void);
 float QueryAngle2Origin(void);
+void QueryResiduals(float *Residuals);
+uint8_t QueryFixBeacons(void);
+uint8_t QueryRejectedBeacon(void);
+uint8_t QueryUncheckedBeacons(void);
+void QueryBeaconPosition(uint8_t Beacon, float *X, float *Y);
 
 #endif /* Triangulation_H */
 
@@ -0,0 +1,233 @@
+/****************************************************************************
+ Module
+   ColourClassifierTest.c
+
+ Description
+   Runs sets of (Clear, Red, Green) samples, one set per ball colour,
+   through ColourClassifier with the ParamStore default centroids, then the
+   events and the calibration that MotorService relies on
+
+ Notes
+   Each set is eight reads at four distances (clear 400 to 20000 counts)
+   with the chromaticity up to 6/256 off the colour's centroid, about the
+   spread between reads of one ball. They are in the layout of the sensor
+   reads, so captured reads can replace them set for set.
+
+   EV_BALL_COLOUR and EV_COLOUR_CAL_DONE are caught by the PostMotorService
+   stand-in below.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+
+#include "ParamStore.h"
+#include "MotorService.h"
+#include "ColourClassifier.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define SET_SIZE 8
+#define MIN_CONFIDENCE 16       // 6/256 off orange, hemmed in by red and pink
+#define CAL_SAMPLES 8           // as ColourClassifier
+#define TIMING_REPEATS 1000000
+
+/*---------------------------- Module Variables ---------------------------*/
+typedef struct
+{
+  uint16_t Clear, Red, Green;
+}Sample_t;
+
+// In the order of BallColour_t
+static const Sample_t Sets[CC_NUM_CENTROIDS][SET_SIZE] = {
+  { // empty
+    {   400,   152,   128 }, {  1500,   516,   521 },
+    {  6000,  2203,  2133 }, { 20000,  6719,  6484 },
+    {   537,   193,   178 }, {  1637,   607,   512 },
+    {  6137,  2158,  1894 }, { 20137,  7709,  6843 }
+  },
+  { // red
+    {   400,   256,    75 }, {  1500,   908,   322 },
+    {  6000,  3773,  1336 }, { 20000, 11953,  3828 },
+    {   537,   334,   107 }, {  1637,  1036,   294 },
+    {  6137,  3764,  1079 }, { 20137, 12979,  4169 }
+  },
+  { // orange
+    {   400,   228,   103 }, {  1500,   803,   428 },
+    {  6000,  3352,  1758 }, { 20000, 10547,  5234 },
+    {   537,   296,   145 }, {  1637,   921,   409 },
+    {  6137,  3332,  1510 }, { 20137, 11563,  5585 }
+  },
+  { // yellow
+    {   400,   188,   147 }, {  1500,   650,   592 },
+    {  6000,  2742,  2414 }, { 20000,  8516,  7422 },
+    {   537,   241,   203 }, {  1637,   755,   588 },
+    {  6137,  2709,  2182 }, { 20137,  9518,  7787 }
+  },
+  { // green
+    {   400,   120,   175 }, {  1500,   398,   697 },
+    {  6000,  1734,  2836 }, { 20000,  5156,  8828 },
+    {   537,   151,   241 }, {  1637,   480,   703 },
+    {  6137,  1678,  2613 }, { 20137,  6135,  9203 }
+  },
+  { // blue
+    {   400,    88,   116 }, {  1500,   275,   475 },
+    {  6000,  1242,  1945 }, { 20000,  3516,  5859 },
+    {   537,   107,   162 }, {  1637,   345,   460 },
+    {  6137,  1175,  1702 }, { 20137,  4484,  6214 }
+  },
+  { // pink
+    {   400,   203,    77 }, {  1500,   709,   328 },
+    {  6000,  2977,  1359 }, { 20000,  9297,  3906 },
+    {   537,   262,   109 }, {  1637,   818,   301 },
+    {  6137,  2949,  1103 }, { 20137, 10304,  4248 }
+  }
+};
+
+static ES_Event_t LastPost;
+static unsigned Posts;
+static volatile unsigned Sink;
+
+/*------------------------------ Module Code ------------------------------*/
+bool PostMotorService(ES_Event_t ThisEvent)
+{
+  LastPost = ThisEvent;
+  Posts++;
+  return true;
+}
+
+static void Feed(const Sample_t *Sample)
+{
+  CC_NewSample(Sample->Clear, Sample->Red, Sample->Green);
+}
+
+// Every read in a set comes out as the set's colour, with some confidence
+static void TestSampleSets(void)
+{
+  BallColour_t Colour;
+  uint8_t n;
+
+  printf("set      correct  min confidence\n");
+  for (Colour = CC_EMPTY; Colour < CC_NUM_CENTROIDS; Colour++)
+  {
+    unsigned Correct = 0;
+    uint8_t MinConfidence = 255;
+
+    for (n = 0; n < SET_SIZE; n++)
+    {
+      const Sample_t *Sample = &Sets[Colour][n];
+      uint8_t Confidence;
+
+      Correct += (CC_Classify(Sample->Clear, Sample->Red, Sample->Green,
+          &Confidence) == Colour);
+      MinConfidence = (Confidence < MinConfidence) ? Confidence : MinConfidence;
+    }
+    printf("  %-7s %u/%u     %3u\n", CC_QueryName(Colour), Correct, SET_SIZE,
+        MinConfidence);
+    HT_CHECK(Correct == SET_SIZE);
+    HT_CHECK(MinConfidence >= MIN_CONFIDENCE);
+  }
+}
+
+// Too dark, or nowhere near a colour
+static void TestUnknown(void)
+{
+  uint8_t Confidence;
+
+  HT_CHECK(CC_Classify(50, 20, 20, &Confidence) == CC_UNKNOWN);
+  HT_CHECK(Confidence == 0);
+  HT_CHECK(CC_Classify(0, 0, 0, &Confidence) == CC_UNKNOWN);
+  HT_CHECK(CC_Classify(1000, 980, 980, &Confidence) == CC_UNKNOWN);
+  HT_CHECK(CC_Classify(1000, 5, 5, &Confidence) == CC_UNKNOWN);
+  HT_CHECK(CC_QueryName((BallColour_t)200) == CC_QueryName(CC_UNKNOWN));
+}
+
+// One EV_BALL_COLOUR per change of colour, none for unknown reads
+static void TestEvents(void)
+{
+  const Sample_t Dark = { 50, 20, 20 };
+  uint8_t n;
+
+  Posts = 0;
+  for (n = 0; n < SET_SIZE; n++)
+  {
+    Feed(&Sets[CC_RED][n]);
+  }
+  HT_CHECK(Posts == 1);
+  HT_CHECK(LastPost.EventType == EV_BALL_COLOUR);
+  HT_CHECK(CC_PARAM_COLOUR(LastPost.EventParam) == CC_RED);
+  HT_CHECK(CC_PARAM_CONFIDENCE(LastPost.EventParam) >= MIN_CONFIDENCE);
+
+  //a dark read between balls does not count as a change
+  Feed(&Dark);
+  Feed(&Sets[CC_RED][0]);
+  HT_CHECK(Posts == 1);
+
+  Feed(&Sets[CC_GREEN][2]);
+  HT_CHECK(Posts == 2);
+  HT_CHECK(CC_PARAM_COLOUR(LastPost.EventParam) == CC_GREEN);
+  Feed(&Sets[CC_EMPTY][2]);
+  HT_CHECK(Posts == 3);
+  HT_CHECK(CC_PARAM_COLOUR(LastPost.EventParam) == CC_EMPTY);
+}
+
+// Calibrate orange on reads off to one side of it, the tables follow the
+// new centroid once it is in Param
+static void TestCalibration(void)
+{
+  uint8_t R, G;
+  uint8_t Confidence;
+  uint8_t n;
+
+  HT_CHECK(!CC_StartCalibration(CC_UNKNOWN));
+  HT_CHECK(CC_StartCalibration(CC_ORANGE));
+  Posts = 0;
+  for (n = 0; n < CAL_SAMPLES; n++)
+  {
+    //orange shifted 10/256 towards yellow in g
+    uint16_t Clear = Sets[CC_ORANGE][n].Clear;
+
+    CC_NewSample(Clear, (uint16_t)(Clear * 141 / 256), (uint16_t)(Clear * 79 / 256));
+    HT_CHECK(Posts == ((n == CAL_SAMPLES - 1) ? 1 : 0));
+  }
+  HT_CHECK(LastPost.EventType == EV_COLOUR_CAL_DONE);
+  HT_CHECK(LastPost.EventParam == CC_ORANGE);
+  HT_CHECK(CC_QueryCalibration(&R, &G));
+  printf("orange calibrated to (%u, %u)\n", R, G);
+  HT_CHECK((R >= 140) && (R <= 141) && (G >= 78) && (G <= 79));
+
+  Param.OrangeR = R;
+  Param.OrangeG = G;
+  CC_ApplyParams();
+  HT_CHECK(CC_Classify(10000, 10000 * 141 / 256, 10000 * 79 / 256, &Confidence) ==
+      CC_ORANGE);
+  HT_CHECK(Confidence > 200);
+  HT_CHECK(CC_StartCalibration(CC_ORANGE) && !CC_QueryCalibration(&R, &G));
+  HT_LoadParamDefaults();
+  CC_ApplyParams();
+}
+
+static void Benchmark(void)
+{
+  double Start = HT_Seconds();
+  uint8_t Confidence;
+  uint32_t n;
+
+  for (n = 0; n < TIMING_REPEATS; n++)
+  {
+    Sink += CC_Classify(1000 + (n & 4095), 500 + (n & 1023), 300 + (n & 511),
+        &Confidence);
+  }
+  printf("host timing: %.1f ns per CC_Classify\n",
+      (HT_Seconds() - Start) * 1e9 / TIMING_REPEATS);
+}
+
+int main(void)
+{
+  HT_LoadParamDefaults();
+  CC_ApplyParams();
+  TestSampleSets();
+  TestUnknown();
+  TestEvents();
+  TestCalibration();
+  Benchmark();
+  return HT_Finish("ColourClassifierTest");
+}
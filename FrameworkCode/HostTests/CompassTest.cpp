@@ -0,0 +1,642 @@
+/****************************************************************************
+ Module
+   CompassTest.cpp
+
+ Description
+   Runs SPISM and SSIBus, built for the host, against a register level
+   stand-in for SSI0 and its uDMA receive channel and a scripted COMPASS,
+   in simulated time: registration, team info, game start and game over,
+   with slow answers and corrupted bytes
+
+ Notes
+   Everything runs on one simulated clock in us. Step does the next thing
+   due: an event waiting for RunSPISM (DISPATCH_US each), the end of a
+   byte on the wire, or an ES timer. The timers expire on the 1 ms tick,
+   so the first tick can come at once, as on the target.
+
+   The SSI keeps its FIFOs and the status bits SSIBus looks at, and clocks
+   a byte in CPSR * (1 + SCR) / 40 us a bit. Channel 10 moves each byte
+   received into the buffer of its control table entry while it is
+   enabled, then sets its CHIS bit and runs SSI_0ISR. The SysTick count
+   comes from the simulated time, the PRxxx registers are always ready,
+   every other register just holds what was written. The control table
+   addresses are 32 bits, so the test is linked -no-pie.
+
+   The COMPASS answers in byte 2 of the frame, if the command byte came
+   MinGapUS or more after the end of the last frame and the answer was
+   ready ReadyUS after the end of the command byte; else that byte is 0.
+   CorruptP of the answers have one bit flipped.
+
+   Registered is when SPISM sends its first team info query, it only does
+   once the ACK has come back.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_udma.h"
+#include "inc/hw_nvic.h"
+
+#include "FrequencyTable.h"
+#include "ParamStore.h"
+#include "SPISM.h"
+#include "SSIBus.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define CLOCKS_PER_US 40
+#define SYSTICK_RELOAD 39999
+#define SSI0_CHANNEL 10
+#define SSI0_INTERRUPT BIT7HI   // in NVIC_EN0
+#define FIFO_DEPTH 8
+#define MAX_REGISTERS 64
+#define NUM_TIMERS 16
+#define QUEUE_SIZE 16
+#define DISPATCH_US 20          // RunSPISM for one event
+#define NEVER 1e18
+
+#define CMD_REG_NORTH 0x10
+#define CMD_REG_SOUTH 0x01
+#define CMD_TEAM_INFO 0xD2
+#define CMD_STATUS 0x78
+#define CMD_VALUE 0x69
+
+#define START_TRIALS 100
+#define MAX_REGISTER_MS 10.0
+#define MAX_GAME_OVER_MS 120.0  // StatusSlowMS and a frame
+#define TIMEOUT_US 2e6
+
+/*---------------------------- Module Types -------------------------------*/
+typedef struct
+{
+  const char *Name;
+  double MinGapUS;
+  double ReadyUS;
+  double CorruptP;
+  bool Answers;               // fast enough for SPISM to register
+  double MaxStartMS;          // two gaps, two frames and the tick, more
+                              // to ask again after a corrupted answer
+  unsigned MaxFalse;          // two answers in a row corrupted alike
+}Scenario_t;
+
+typedef struct
+{
+  uint8_t Team;               // the registration command, 0 before
+  uint8_t Colour, FreqIndex, State, Recycle, Value;
+  double MinGapUS, ReadyUS, CorruptP;
+
+  double LastFrameEndUS;
+  uint8_t ByteInFrame;
+  double CommandEndUS;
+  bool Ignored;
+  uint8_t Answer;
+
+  double RegisteredUS;        // first team info query, -1 before
+  unsigned Frames, IgnoredFrames, Corrupted;
+}Compass_t;
+
+/*---------------------------- Module Variables ---------------------------*/
+static const Scenario_t Scenarios[] = {
+  { "prompt", 0, 0, 0, true, 15, 0 },
+  { "slow (2 ms gap, 700 us to answer)", 2000, 700, 0, true, 15, 0 },
+  { "1% of answers corrupted", 0, 0, 0.01, true, 20, 0 },
+  { "5% of answers corrupted", 0, 0, 0.05, true, 30, 2 },
+  { "answer later than the next byte", 0, 1000, 0, false, 0, 0 }
+};
+#define NUM_SCENARIOS (sizeof(Scenarios) / sizeof(Scenarios[0]))
+
+static const uint16_t RecycleFreq[FT_NUM_RECYCLE_FREQUENCIES] = {
+  FT_RECYCLE_LIST(FT_FREQUENCY, 0, 0)
+};
+
+static double Now = 1;        // us
+
+static struct
+{
+  uint32_t Address, Value;
+}Registers[MAX_REGISTERS];
+static uint8_t NumRegisters;
+
+static uint8_t TxFifo[FIFO_DEPTH], RxFifo[FIFO_DEPTH];
+static uint8_t TxCount, RxCount;
+static bool Shifting;
+static uint8_t ShiftOut;
+static double ByteStartUS, ByteEndUS;
+static bool ChannelOn;
+static uint8_t ChannelMoved;
+static uint32_t ChannelDone;
+static double BusUS;          // time the SSI was clocking
+
+static Compass_t Compass;
+
+static ES_Event_t Queue[QUEUE_SIZE];
+static uint8_t QueueHead, QueueCount;
+static double TimerAt[NUM_TIMERS];   // 0 when stopped
+static double LimitUS = NEVER;
+
+static double StartSeenUS, GameOverSeenUS;
+static unsigned FalseStarts, FalseGameOvers;
+
+/*------------------------------ Module Code ------------------------------*/
+// the printf of SPISM, renamed by the Makefile as SPISM talks a lot. It is
+// declared by stdio.h, so C linkage.
+extern "C" int HT_FirmwarePrintf(const char *Format, ...)
+{
+  return 0;
+}
+
+// what the firmware wrote, 0 for a register never written
+static uint32_t *Register(uint32_t Address)
+{
+  uint8_t i;
+
+  for (i = 0; i < NumRegisters; i++)
+  {
+    if (Registers[i].Address == Address)
+    {
+      return &Registers[i].Value;
+    }
+  }
+  if (NumRegisters == MAX_REGISTERS)
+  {
+    HT_CHECK(!"too many registers");
+    return &Registers[0].Value;
+  }
+  Registers[NumRegisters].Address = Address;
+  return &Registers[NumRegisters++].Value;
+}
+
+/*------------------------------ The COMPASS ------------------------------*/
+static uint8_t CompassAnswer(uint8_t Command)
+{
+  switch (Command)
+  {
+    case CMD_REG_NORTH: Compass.Team = Command; return 0xA1;
+    case CMD_REG_SOUTH: Compass.Team = Command; return 0xA3;
+    case CMD_TEAM_INFO:
+      if ((Compass.RegisteredUS < 0) && Compass.Team)
+      {
+        Compass.RegisteredUS = Now;
+      }
+      return Compass.Team ?
+          (uint8_t)((Compass.FreqIndex << 4) | (Compass.Colour << 1)) : 0;
+    case CMD_STATUS: return (uint8_t)((Compass.Recycle << 2) | Compass.State);
+    case CMD_VALUE: return Compass.Value;
+  }
+  return 0;
+}
+
+// the COMPASS side of a byte, Out is what the master clocked out
+static uint8_t CompassByte(uint8_t Out)
+{
+  uint8_t In = 0;
+
+  if (Compass.ByteInFrame == 0)
+  {
+    Compass.Frames++;
+    Compass.Ignored = (ByteStartUS - Compass.LastFrameEndUS) < Compass.MinGapUS;
+    Compass.IgnoredFrames += Compass.Ignored;
+    Compass.CommandEndUS = ByteEndUS;
+    Compass.Answer = Compass.Ignored ? 0 : CompassAnswer(Out);
+  }
+  else if ((Compass.ByteInFrame == 2) && !Compass.Ignored &&
+      (ByteStartUS - Compass.CommandEndUS >= Compass.ReadyUS))
+  {
+    In = Compass.Answer;
+    if (HT_Uniform() < Compass.CorruptP)
+    {
+      In ^= (uint8_t)(1 << (int)(HT_Uniform() * 8));
+      Compass.Corrupted++;
+    }
+  }
+  Compass.ByteInFrame++;
+  return In;
+}
+
+static void CompassReset(const Scenario_t *Scenario, uint8_t Colour,
+                         uint8_t FreqIndex)
+{
+  Compass.Team = 0;
+  Compass.Colour = Colour;
+  Compass.FreqIndex = FreqIndex;
+  Compass.State = WAITING_FOR_START;
+  Compass.Recycle = 0x2a;
+  Compass.Value = 0x42;
+  Compass.MinGapUS = Scenario->MinGapUS;
+  Compass.ReadyUS = Scenario->ReadyUS;
+  Compass.CorruptP = Scenario->CorruptP;
+  Compass.LastFrameEndUS = -NEVER;
+  Compass.ByteInFrame = 0;
+  Compass.RegisteredUS = -1;
+  Compass.Frames = Compass.IgnoredFrames = Compass.Corrupted = 0;
+}
+
+/*------------------------------ SSI0 and uDMA ----------------------------*/
+static double BitUS(void)
+{
+  uint32_t Divisor = *Register(SSI0_BASE + SSI_O_CPSR) & SSI_CPSR_CPSDVSR_M;
+  uint32_t Rate = (*Register(SSI0_BASE + SSI_O_CR0) & SSI_CR0_SCR_M) >>
+      SSI_CR0_SCR_S;
+
+  return (double)Divisor * (1 + Rate) / CLOCKS_PER_US;
+}
+
+static void StartByte(void)
+{
+  uint8_t i;
+
+  ShiftOut = TxFifo[0];
+  for (i = 1; i < TxCount; i++)
+  {
+    TxFifo[i - 1] = TxFifo[i];
+  }
+  TxCount--;
+  Shifting = true;
+  ByteStartUS = Now;
+  ByteEndUS = Now + 8 * BitUS();
+}
+
+static uint8_t PopRx(void)
+{
+  uint8_t Item = RxFifo[0];
+  uint8_t i;
+
+  for (i = 1; i < RxCount; i++)
+  {
+    RxFifo[i - 1] = RxFifo[i];
+  }
+  RxCount--;
+  return Item;
+}
+
+// channel 10 takes the byte into its buffer, the last one raises the done
+static void ChannelRequest(void)
+{
+  uint32_t *Entry = (uint32_t *)(uintptr_t)*Register(UDMA_CTLBASE) +
+      SSI0_CHANNEL * 4;
+  uint32_t Items = ((Entry[2] & UDMA_CHCTL_XFERSIZE_M) >>
+      UDMA_CHCTL_XFERSIZE_S) + 1;
+
+  if (Entry[2] & UDMA_CHCTL_DSTSIZE_16)
+  {
+    uint16_t *Last = (uint16_t *)(uintptr_t)Entry[1];
+
+    Last[(int)ChannelMoved - (int)(Items - 1)] = PopRx();
+  }
+  else
+  {
+    uint8_t *Last = (uint8_t *)(uintptr_t)Entry[1];
+
+    Last[(int)ChannelMoved - (int)(Items - 1)] = PopRx();
+  }
+  if (++ChannelMoved == Items)
+  {
+    ChannelOn = false;
+    ChannelMoved = 0;
+    Entry[2] &= ~UDMA_CHCTL_XFERMODE_M;
+    ChannelDone |= (uint32_t)1 << SSI0_CHANNEL;
+  }
+}
+
+static void EndByte(void)
+{
+  uint8_t In = CompassByte(ShiftOut);
+
+  Shifting = false;
+  BusUS += ByteEndUS - ByteStartUS;
+  if (RxCount < FIFO_DEPTH)
+  {
+    RxFifo[RxCount++] = In;
+  }
+  if (TxCount != 0)
+  {
+    StartByte();
+  }
+  else
+  {
+    Compass.LastFrameEndUS = Now;
+    Compass.ByteInFrame = 0;
+  }
+  if (ChannelOn && (*Register(SSI0_BASE + SSI_O_DMACTL) & SSI_DMACTL_RXDMAE))
+  {
+    ChannelRequest();
+  }
+  if ((ChannelDone & ((uint32_t)1 << SSI0_CHANNEL)) &&
+      (*Register(NVIC_EN0) & SSI0_INTERRUPT))
+  {
+    SSI_0ISR();
+  }
+}
+
+uint32_t HT_RegRead(uint32_t Address)
+{
+  if (Address == NVIC_ST_CURRENT)
+  {
+    return SYSTICK_RELOAD -
+        (uint32_t)((uint64_t)(Now * CLOCKS_PER_US) % (SYSTICK_RELOAD + 1));
+  }
+  if (Address == NVIC_ST_RELOAD)
+  {
+    return SYSTICK_RELOAD;
+  }
+  if ((Address == SYSCTL_PRGPIO) || (Address == SYSCTL_PRSSI) ||
+      (Address == SYSCTL_PRDMA))
+  {
+    return 0xffffffff;
+  }
+  if (Address == SSI0_BASE + SSI_O_DR)
+  {
+    return (RxCount != 0) ? PopRx() : 0;
+  }
+  if (Address == SSI0_BASE + SSI_O_SR)
+  {
+    return ((RxCount != 0) ? SSI_SR_RNE : 0) |
+        ((TxCount == 0) ? SSI_SR_TFE : 0) |
+        ((TxCount < FIFO_DEPTH) ? SSI_SR_TNF : 0) |
+        ((Shifting || (TxCount != 0)) ? SSI_SR_BSY : 0);
+  }
+  if (Address == UDMA_CHIS)
+  {
+    return ChannelDone;
+  }
+  return *Register(Address);
+}
+
+void HT_RegWrite(uint32_t Address, uint32_t Value)
+{
+  if (Address == SSI0_BASE + SSI_O_DR)
+  {
+    if (TxCount < FIFO_DEPTH)
+    {
+      TxFifo[TxCount++] = (uint8_t)Value;
+    }
+    if (!Shifting && (*Register(SSI0_BASE + SSI_O_CR1) & SSI_CR1_SSE))
+    {
+      StartByte();
+    }
+  }
+  else if (Address == UDMA_ENASET)
+  {
+    ChannelOn = ChannelOn || (Value & ((uint32_t)1 << SSI0_CHANNEL));
+  }
+  else if (Address == UDMA_CHIS)
+  {
+    ChannelDone &= ~Value;
+  }
+  else
+  {
+    *Register(Address) = Value;
+  }
+}
+
+/*------------------------------ The framework ----------------------------*/
+bool ES_PostToService(uint8_t WhichService, ES_Event_t ThisEvent)
+{
+  if (QueueCount == QUEUE_SIZE)
+  {
+    return false;
+  }
+  Queue[(QueueHead + QueueCount++) % QUEUE_SIZE] = ThisEvent;
+  return true;
+}
+
+ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
+{
+  TimerAt[Num] = (floor(Now / 1000) + NewTime) * 1000;
+  return ES_Timer_OK;
+}
+
+ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
+{
+  TimerAt[Num] = 0;
+  return ES_Timer_OK;
+}
+
+uint16_t ES_Timer_GetTime(void)
+{
+  return (uint16_t)(uint32_t)(Now / 1000);
+}
+
+bool PostMotorService(ES_Event_t ThisEvent)
+{
+  if (ThisEvent.EventType == ES_CLEANING_UP)
+  {
+    if (Compass.State == RECYCLING)
+    {
+      StartSeenUS = (StartSeenUS < 0) ? Now : StartSeenUS;
+    }
+    else
+    {
+      FalseStarts++;
+    }
+  }
+  else if (ThisEvent.EventType == ES_GAME_OVER)
+  {
+    if (Compass.State == GAME_OVER)
+    {
+      GameOverSeenUS = (GameOverSeenUS < 0) ? Now : GameOverSeenUS;
+    }
+    else
+    {
+      FalseGameOvers++;
+    }
+  }
+  return true;
+}
+
+/*------------------------------ Simulation -------------------------------*/
+// does the next thing due, or moves on to LimitUS if that comes first
+static void Step(void)
+{
+  double Next = NEVER;
+  int Which = -1;
+  int i;
+
+  if (QueueCount != 0)
+  {
+    ES_Event_t ThisEvent = Queue[QueueHead];
+
+    QueueHead = (QueueHead + 1) % QUEUE_SIZE;
+    QueueCount--;
+    Now += DISPATCH_US;
+    RunSPISM(ThisEvent);
+    return;
+  }
+  if (Shifting)
+  {
+    Next = ByteEndUS;
+  }
+  for (i = 0; i < NUM_TIMERS; i++)
+  {
+    if ((TimerAt[i] > 0) && (TimerAt[i] < Next))
+    {
+      Next = TimerAt[i];
+      Which = i;
+    }
+  }
+  if (Next > LimitUS)
+  {
+    Now = (LimitUS > Now) ? LimitUS : Now;
+    return;
+  }
+  Now = (Next > Now) ? Next : Now;
+  if (Which < 0)
+  {
+    EndByte();
+  }
+  else
+  {
+    ES_Event_t ThisEvent;
+
+    TimerAt[Which] = 0;
+    ThisEvent.EventType = ES_TIMEOUT;
+    ThisEvent.EventParam = (uint16_t)Which;
+    ES_PostToService(0, ThisEvent);
+  }
+}
+
+static void RunUntil(double EndUS)
+{
+  LimitUS = EndUS;
+  while (Now < EndUS)
+  {
+    Step();
+  }
+  LimitUS = NEVER;
+}
+
+// lets the frame on the wire finish with no timer running, so SPISM can
+// be started over
+static void Quiesce(void)
+{
+  int i;
+
+  do
+  {
+    for (i = 0; i < NUM_TIMERS; i++)
+    {
+      TimerAt[i] = 0;
+    }
+    if (Shifting || (QueueCount != 0))
+    {
+      Step();
+    }
+  } while (Shifting || (QueueCount != 0));
+  for (i = 0; i < NUM_TIMERS; i++)
+  {
+    TimerAt[i] = 0;
+  }
+}
+
+// runs until Done or TIMEOUT_US, the time it took in ms, -1 on a timeout
+static double WaitFor(double *SeenUS, double FromUS)
+{
+  double EndUS = Now + TIMEOUT_US;
+
+  while ((*SeenUS < 0) && (Now < EndUS))
+  {
+    Step();
+  }
+  return (*SeenUS < 0) ? -1 : (*SeenUS - FromUS) / 1000;
+}
+
+static void Play(const Scenario_t *Scenario, uint8_t Colour, uint8_t FreqIndex)
+{
+  double StartUS = Now;
+  double TeamInfoUS = -1;
+  double Sum = 0, Max = 0;
+  double Latency, GameOver;
+  unsigned Detected = 0;
+  uint16_t i;
+
+  printf("%s:\n", Scenario->Name);
+  Quiesce();
+  CompassReset(Scenario, Colour, FreqIndex);
+  StartSeenUS = GameOverSeenUS = -1;
+  FalseStarts = FalseGameOvers = 0;
+  HT_CHECK(InitSPISM(0));
+  BusUS = 0;
+
+  while ((GetTeamInfoByte() == 0xFF) && (Now < StartUS + TIMEOUT_US))
+  {
+    Step();
+  }
+  if (!Scenario->Answers)
+  {
+    printf("  %u frames, never registered\n", Compass.Frames);
+    HT_CHECK(Compass.RegisteredUS < 0);
+    HT_CHECK(GetTeamInfoByte() == 0xFF);
+    HT_CHECK(Compass.Frames > 100);
+    return;
+  }
+  if (HT_CHECK(GetTeamInfoByte() != 0xFF))
+  {
+    TeamInfoUS = Now;
+  }
+  printf("  registered %.1f ms, team info %.1f ms: colour %u, %u Hz\n",
+      (Compass.RegisteredUS - StartUS) / 1000, (TeamInfoUS - StartUS) / 1000,
+      GetAssignedColor(), GetAssignedFreq());
+  HT_CHECK(Compass.RegisteredUS >= 0);
+  HT_CHECK((Compass.RegisteredUS - StartUS) / 1000 < MAX_REGISTER_MS);
+  HT_CHECK(GetAssignedColor() == Colour);
+  HT_CHECK(GetAssignedFreq() == RecycleFreq[FreqIndex]);
+
+  //starts at random times while waiting, back to waiting once seen
+  for (i = 0; i < START_TRIALS; i++)
+  {
+    double ChangeUS;
+
+    RunUntil(Now + 300e3 + 200e3 * HT_Uniform());
+    StartSeenUS = -1;
+    Compass.State = RECYCLING;
+    ChangeUS = Now;
+    Latency = WaitFor(&StartSeenUS, ChangeUS);
+    if (Latency >= 0)
+    {
+      Detected++;
+      Sum += Latency;
+      Max = (Latency > Max) ? Latency : Max;
+    }
+    RunUntil(Now + 50e3);
+    Compass.State = WAITING_FOR_START;
+  }
+  printf("  start detected %u/%u, mean %.1f ms, max %.1f ms\n", Detected,
+      START_TRIALS, (Detected != 0) ? Sum / Detected : 0, Max);
+  HT_CHECK(Detected == START_TRIALS);
+  HT_CHECK(Max < Scenario->MaxStartMS);
+
+  //a game long enough for status to be polled slowly, then game over
+  Compass.State = RECYCLING;
+  RunUntil(Now + 5e6);
+  Compass.State = GAME_OVER;
+  GameOver = WaitFor(&GameOverSeenUS, Now);
+  printf("  game over detected %.1f ms\n", GameOver);
+  printf("  %u frames, %u ignored, %u answers corrupted, %u false starts, "
+      "%u false game overs, bus busy %.0f%%\n", Compass.Frames,
+      Compass.IgnoredFrames, Compass.Corrupted, FalseStarts, FalseGameOvers,
+      100 * BusUS / (Now - StartUS));
+  HT_CHECK(Compass.IgnoredFrames == 0);
+  HT_CHECK((GameOver >= 0) && (GameOver < MAX_GAME_OVER_MS));
+  HT_CHECK(FalseStarts <= Scenario->MaxFalse);
+  HT_CHECK(FalseGameOvers <= Scenario->MaxFalse);
+}
+
+int main(void)
+{
+  uint8_t i;
+
+  HT_LoadParamDefaults();
+  HT_Seed(49);
+  for (i = 0; i < NUM_SCENARIOS; i++)
+  {
+    Play(&Scenarios[i], (uint8_t)(i % 6), (uint8_t)(5 + 2 * i));
+  }
+  return HT_Finish("CompassTest");
+}
@@ -0,0 +1,238 @@
+/****************************************************************************
+ Module
+   FastMathTest.c
+
+ Description
+   Checks the FastMath kernels against double precision libm over the
+   ranges stated in FastMath.h, and times them against single precision
+   libm
+
+ Notes
+   The timings are host numbers (whatever CFLAGS the Makefile uses), only
+   printed, never checked.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "FastMath.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+
+#define SAMPLES 2000000
+#define BATCH 4096
+#define BATCH_REPEATS 2000
+#define Q15_STEP 997            // binary angle stride, covers every table gap
+
+// Limits from the table in FastMath.h
+#define SIN_COS_MAX_ERROR 1.0e-7
+#define TAN_MAX_ERROR 2.5e-7         // absolute below 1, relative above
+#define ATAN2_MAX_ERROR 1.2e-5
+#define RECIP_MAX_RELATIVE 1.5e-7
+#define Q15_MAX_LSB 5.0
+
+/*---------------------------- Module Variables ---------------------------*/
+static float InX[BATCH], InY[BATCH];
+static float OutA[BATCH], OutB[BATCH];
+static volatile float Sink;
+
+/*------------------------------ Module Code ------------------------------*/
+static double Between(double Low, double High)
+{
+  return Low + (High - Low) * HT_Uniform();
+}
+
+static void TestAccuracy(void)
+{
+  double SinError = 0, CosError = 0, TanError = 0, Atan2Error = 0;
+  double RecipError = 0, Q15Error = 0;
+  uint64_t Angle;
+  long k;
+
+  HT_Seed(33);
+  for (k = 0; k < SAMPLES; k++)
+  {
+    float x = (float)Between(-1e4, 1e4);
+    float y = (float)Between(-100, 100);
+    float z = (float)Between(-100, 100);
+    float r = (float)exp(Between(-80, 80));
+    float Sin, Cos;
+    double Tan = tan((double)x);
+
+    FM_SinCosf(x, &Sin, &Cos);
+    SinError = fmax(SinError, fabs(Sin - sin((double)x)));
+    CosError = fmax(CosError, fabs(Cos - cos((double)x)));
+    SinError = fmax(SinError, fabs(FM_Sinf(x) - sin((double)x)));
+    CosError = fmax(CosError, fabs(FM_Cosf(x) - cos((double)x)));
+    if (fabs(Tan) < 100)
+    {
+      TanError = fmax(TanError, fabs(FM_Tanf(x) - Tan) / fmax(fabs(Tan), 1));
+    }
+    Atan2Error = fmax(Atan2Error, fabs(FM_Atan2f(y, z) - atan2((double)y, (double)z)));
+    RecipError = fmax(RecipError, fabs(FM_Recipf(r) * (double)r - 1));
+  }
+  for (Angle = 0; Angle < ((uint64_t)1 << 32); Angle += Q15_STEP)
+  {
+    double Turn = Angle * (2 * PI / 4294967296.0);
+
+    Q15Error = fmax(Q15Error, fabs(FM_SinQ15((uint32_t)Angle) - 32768 * sin(Turn)));
+    Q15Error = fmax(Q15Error, fabs(FM_CosQ15((uint32_t)Angle) - 32768 * cos(Turn)));
+  }
+
+  printf("max error: sin %.2g cos %.2g tan %.2g atan2 %.2g recip %.2g (rel) q15 %.2g LSB\n",
+      SinError, CosError, TanError, Atan2Error, RecipError, Q15Error);
+  HT_CHECK(SinError <= SIN_COS_MAX_ERROR);
+  HT_CHECK(CosError <= SIN_COS_MAX_ERROR);
+  HT_CHECK(TanError <= TAN_MAX_ERROR);
+  HT_CHECK(Atan2Error <= ATAN2_MAX_ERROR);
+  HT_CHECK(RecipError <= RECIP_MAX_RELATIVE);
+  HT_CHECK(Q15Error <= Q15_MAX_LSB);
+}
+
+// Quadrant edges and the atan2 conventions Triangulation relies on
+static void TestEdges(void)
+{
+  float Sin, Cos;
+
+  HT_CHECK(FM_Atan2f(0, 0) == 0);
+  HT_CHECK(fabs(FM_Atan2f(0, -1) - PI) < ATAN2_MAX_ERROR);
+  HT_CHECK(fabs(FM_Atan2f(1, 0) - PI / 2) < ATAN2_MAX_ERROR);
+  HT_CHECK(fabs(FM_Atan2f(-1, 0) + PI / 2) < ATAN2_MAX_ERROR);
+  HT_CHECK(fabs(FM_Atan2f(-1e-20f, 1) + 1e-20) < ATAN2_MAX_ERROR);
+
+  FM_SinCosf(0, &Sin, &Cos);
+  HT_CHECK((Sin == 0) && (Cos == 1));
+  FM_SinCosf((float)(PI / 2), &Sin, &Cos);
+  HT_CHECK((fabs(Sin - 1) < SIN_COS_MAX_ERROR) && (fabs(Cos) < SIN_COS_MAX_ERROR));
+
+  HT_CHECK(FM_SinQ15(0) == 0);
+  HT_CHECK(FM_CosQ15(0) >= 32768 - Q15_MAX_LSB);
+  HT_CHECK(FM_SinQ15(0x40000000) >= 32768 - Q15_MAX_LSB);
+  HT_CHECK(FM_SinQ15(0xC0000000) <= -32768 + Q15_MAX_LSB);
+}
+
+// The batch loops give the same answers as the scalar kernels
+static void TestBatch(void)
+{
+  uint16_t i;
+  bool Same = true;
+
+  HT_Seed(34);
+  for (i = 0; i < BATCH; i++)
+  {
+    InX[i] = (float)Between(-10, 10);
+    InY[i] = (float)Between(-10, 10);
+  }
+  FM_SinCosBatch(InX, OutA, OutB, BATCH);
+  for (i = 0; i < BATCH; i++)
+  {
+    float Sin, Cos;
+
+    FM_SinCosf(InX[i], &Sin, &Cos);
+    Same = Same && (fabsf(OutA[i] - Sin) <= 1e-7f) && (fabsf(OutB[i] - Cos) <= 1e-7f);
+  }
+  HT_CHECK(Same);
+  FM_Atan2Batch(InY, InX, OutA, BATCH);
+  for (i = 0; i < BATCH; i++)
+  {
+    Same = Same && (fabsf(OutA[i] - FM_Atan2f(InY[i], InX[i])) <= 1e-6f);
+  }
+  HT_CHECK(Same);
+}
+
+static void PrintTime(const char *Name, double Start)
+{
+  printf("  %-22s %6.2f ns/element\n", Name,
+      (HT_Seconds() - Start) * 1e9 / ((double)BATCH_REPEATS * BATCH));
+}
+
+static void Benchmark(void)
+{
+  double Start;
+  int Repeat;
+  uint16_t i;
+
+  printf("host timings:\n");
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    for (i = 0; i < BATCH; i++)
+    {
+      OutA[i] = sinf(InX[i]);
+      OutB[i] = cosf(InX[i]);
+    }
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("libm sinf + cosf", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    for (i = 0; i < BATCH; i++)
+    {
+      FM_SinCosf(InX[i], &OutA[i], &OutB[i]);
+    }
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("FM_SinCosf", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    FM_SinCosBatch(InX, OutA, OutB, BATCH);
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("FM_SinCosBatch", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    for (i = 0; i < BATCH; i++)
+    {
+      OutA[i] = atan2f(InY[i], InX[i]);
+    }
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("libm atan2f", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    FM_Atan2Batch(InY, InX, OutA, BATCH);
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("FM_Atan2Batch", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    for (i = 0; i < BATCH; i++)
+    {
+      OutA[i] = tanf(InX[i]);
+    }
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("libm tanf", Start);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < BATCH_REPEATS; Repeat++)
+  {
+    for (i = 0; i < BATCH; i++)
+    {
+      OutA[i] = FM_Tanf(InX[i]);
+    }
+    Sink += OutA[Repeat & (BATCH - 1)];
+  }
+  PrintTime("FM_Tanf", Start);
+}
+
+int main(void)
+{
+  TestAccuracy();
+  TestEdges();
+  TestBatch();
+  Benchmark();
+  return HT_Finish("FastMathTest");
+}
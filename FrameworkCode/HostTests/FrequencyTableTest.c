@@ -0,0 +1,123 @@
+/****************************************************************************
+ Module
+   FrequencyTableTest.c
+
+ Description
+   Boundaries and jitter for FT_ClassifyBeacon
+
+ Notes
+   The table decides per bin, and a bin is 0.8% wide, so the edge of the
+   5% tolerance band is only known to within a bin: every period within
+   4.2% of a beacon has to be classified as that beacon, nothing beyond
+   5.8% may be.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "FrequencyTable.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define TOLERANCE 0.05
+#define BIN_WIDTH 0.008
+#define SWEEP_STEP 0.0002
+#define JITTER_SAMPLES 1000000
+
+/*---------------------------- Module Variables ---------------------------*/
+static const uint32_t Frequencies[FT_NUM_BEACON_FREQUENCIES] = {
+  FT_BEACON_LIST(FT_FREQUENCY, 0, 0)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+static uint32_t Period(uint8_t Beacon, double Offset)
+{
+  return (uint32_t)(FT_PERIOD(Frequencies[Beacon]) * (1 + Offset));
+}
+
+// Sweeps +-10% around each beacon: inside the band it is that beacon,
+// outside it is nothing or a neighbour that is itself within its own band
+static void TestBands(void)
+{
+  double Offset;
+  double Narrowest = 1, Widest = 0;
+  uint8_t Beacon;
+  bool Inside = true, Outside = true;
+
+  for (Beacon = 0; Beacon < FT_NUM_BEACON_FREQUENCIES; Beacon++)
+  {
+    HT_CHECK(FT_ClassifyBeacon(Period(Beacon, 0)) == Beacon);
+    for (Offset = -0.10; Offset <= 0.10; Offset += SWEEP_STEP)
+    {
+      uint8_t Class = FT_ClassifyBeacon(Period(Beacon, Offset));
+
+      if (fabs(Offset) <= TOLERANCE - BIN_WIDTH)
+      {
+        Inside = Inside && (Class == Beacon);
+      }
+      if ((Class == Beacon) && (fabs(Offset) > Widest))
+      {
+        Widest = fabs(Offset);
+      }
+      if ((Class != Beacon) && (fabs(Offset) < Narrowest))
+      {
+        Narrowest = fabs(Offset);
+      }
+      if (Class != Beacon)
+      {
+        Outside = Outside && ((Class == FT_NO_MATCH) ||
+            (fabs((double)Period(Beacon, Offset) / FT_PERIOD(Frequencies[Class]) - 1) <=
+            TOLERANCE + BIN_WIDTH));
+      }
+    }
+  }
+  printf("bands: always accepted within %.2f%%, never beyond %.2f%%\n",
+      Narrowest * 100, Widest * 100);
+  HT_CHECK(Inside);
+  HT_CHECK(Outside);
+  HT_CHECK(Widest <= TOLERANCE + BIN_WIDTH);
+}
+
+// Ends of the covered range and the periods around them
+static void TestRange(void)
+{
+  HT_CHECK(FT_ClassifyBeacon(0) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon(1) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon((1 << 14) - 1) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon(1 << 14) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon((1 << 18) - 1) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon(1 << 18) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon(0xFFFFFFFF) == FT_NO_MATCH);
+  //halfway between neighbouring beacons is nobody's
+  HT_CHECK(FT_ClassifyBeacon((FT_PERIOD(2000) + FT_PERIOD(1667)) / 2) == FT_NO_MATCH);
+  HT_CHECK(FT_ClassifyBeacon((FT_PERIOD(1429) + FT_PERIOD(1200)) / 2) == FT_NO_MATCH);
+}
+
+// Edge to edge jitter of 1% rms: nearly all hits, and never the wrong beacon
+static void TestJitter(void)
+{
+  unsigned Hits = 0, Wrong = 0;
+  long k;
+
+  HT_Seed(35);
+  for (k = 0; k < JITTER_SAMPLES; k++)
+  {
+    uint8_t Beacon = (uint8_t)(HT_Uniform() * FT_NUM_BEACON_FREQUENCIES);
+    uint8_t Class = FT_ClassifyBeacon(Period(Beacon, 0.01 * HT_Gauss()));
+
+    Hits += (Class == Beacon);
+    Wrong += ((Class != Beacon) && (Class != FT_NO_MATCH));
+  }
+  printf("1%% jitter: %.3f%% classified, %u wrong\n", 100.0 * Hits / JITTER_SAMPLES,
+      Wrong);
+  HT_CHECK(Hits >= JITTER_SAMPLES * 0.999);
+  HT_CHECK(Wrong == 0);
+}
+
+int main(void)
+{
+  TestBands();
+  TestRange();
+  TestJitter();
+  return HT_Finish("FrequencyTableTest");
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+ Module
+   HostPort.c
+
+ Description
+   What the host tests need from ES_Port and ParamStore, plus the checks
+   and the noise source of HostTest.h
+
+ Notes
+   Interrupts do not exist on the host, so the critical section calls only
+   keep the PRIMASK bookkeeping. A test that models interrupts asks
+   HT_InterruptsEnabled before it runs an ISR. Param holds the ParamStore
+   defaults, set by HT_LoadParamDefaults, without the EEPROM. PS_Get reads
+   it back by id.
+
+   The noise comes from a xorshift generator so every run, on any libc,
+   sees the same samples.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "ParamStore.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+
+/*---------------------------- Module Variables ---------------------------*/
+uint32_t _PRIMASK_temp;
+ParamBlock_t Param;
+
+static uint32_t PRIMASK;
+static uint32_t RandomState = 1;
+static unsigned Checks;
+static unsigned Failures;
+
+/*------------------------------ Module Code ------------------------------*/
+uint32_t CPUgetPRIMASK_cpsid(void)
+{
+  uint32_t Old = PRIMASK;
+
+  PRIMASK = 1;
+  return Old;
+}
+
+void CPUsetPRIMASK(uint32_t NewPRIMASK)
+{
+  PRIMASK = NewPRIMASK;
+}
+
+bool HT_InterruptsEnabled(void)
+{
+  return PRIMASK == 0;
+}
+
+bool HT_Check(bool Passed, const char *File, int Line, const char *Text)
+{
+  Checks++;
+  if (!Passed)
+  {
+    Failures++;
+    printf("%s:%d: check failed: %s\n", File, Line, Text);
+  }
+  return Passed;
+}
+
+// Summary line, the return value is the exit code of the test
+int HT_Finish(const char *Name)
+{
+  printf("%s: %u checks, %u failed\n", Name, Checks, Failures);
+  return (Failures == 0) ? 0 : 1;
+}
+
+void HT_Seed(uint32_t Seed)
+{
+  RandomState = (Seed == 0) ? 1 : Seed;
+}
+
+// 0 < x < 1
+double HT_Uniform(void)
+{
+  RandomState ^= RandomState << 13;
+  RandomState ^= RandomState >> 17;
+  RandomState ^= RandomState << 5;
+  return (RandomState + 0.5) / 4294967296.0;
+}
+
+// zero mean, unit variance (Box-Muller)
+double HT_Gauss(void)
+{
+  double u = HT_Uniform();
+  double v = HT_Uniform();
+
+  return sqrt(-2 * log(u)) * cos(2 * PI * v);
+}
+
+#define HT_DEFAULT(Name, Type, Min, Max, Default, OnChange) \
+  Param.Name = Default;
+
+void HT_LoadParamDefaults(void)
+{
+  PS_PARAM_LIST(HT_DEFAULT)
+}
+
+#define HT_GET(Name, Type, Min, Max, Default, OnChange) \
+  case PS_ID_##Name: return (float)Param.Name;
+
+float PS_Get(ParamId_t Id)
+{
+  switch (Id)
+  {
+    PS_PARAM_LIST(HT_GET)
+    default: return 0;
+  }
+}
+
+// Process time, for host timings only
+double HT_Seconds(void)
+{
+  return (double)clock() / CLOCKS_PER_SEC;
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+ Header
+   HostTest.h
+
+ Description
+   Checks, a repeatable noise source and the port layer stand-ins shared by
+   the host tests
+
+****************************************************************************/
+
+#ifndef HostTest_H
+#define HostTest_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Counts a failure (and prints where) when Cond is false, the test carries on
+#define HT_CHECK(Cond) HT_Check((Cond), __FILE__, __LINE__, #Cond)
+
+/****************************************************************************
+	FUNCTION PROTOTYPES
+****************************************************************************/
+
+bool HT_Check(bool Passed, const char *File, int Line, const char *Text);
+int HT_Finish(const char *Name);
+
+void HT_Seed(uint32_t Seed);
+double HT_Uniform(void);
+double HT_Gauss(void);
+
+void HT_LoadParamDefaults(void);
+double HT_Seconds(void);
+
+// PRIMASK clear, as left by CPUgetPRIMASK_cpsid/CPUsetPRIMASK
+bool HT_InterruptsEnabled(void);
+
+//***************************************************************************
+
+#endif /* HostTest_H */
@@ -0,0 +1,661 @@
+/****************************************************************************
+ Module
+   I2CTest.c
+
+ Description
+   Runs I2CService, built for the host, against a stand-in for the I2C1
+   master, its pins and a TCS3472x, in simulated time: back to back full
+   colour reads at 100 and 400 kbps, with NACKs, with the sensor holding
+   SDA low and with no sensor at all
+
+ Notes
+   Everything runs on one simulated clock in us. Step does the next thing
+   due: the I2C1 interrupt if it is pending and PRIMASK is clear (ISR_US
+   each), an event for RunI2CService (DISPATCH_US each), the end of the
+   transfer on the bus or the I2C timer. The events go through the real
+   ES_Queue, so a post does its own EnterCritical/ExitCritical on the one
+   _PRIMASK_temp, as on the target. Interrupts left off stop the bus, and
+   are checked after every list.
+
+   The master takes 10 bit times for a start and the address, 9 for the
+   byte and 1 for a stop, at the speed it was set up for. The busy polls
+   of the service take POLL_US each and SysCtlDelay 3 clocks a loop, the
+   transfer can end and its interrupt come during them.
+
+   A NACK is injected on the address of the first try of every NackEvery-th
+   read. With a stop in the command the master sends it itself, else the
+   bus stays held until the error stop. For SDA held low the sensor starts
+   driving SDA after a byte of read StuckRead and lets go after
+   STUCK_CLOCKS more clocks on SCL; the master reads 0s and loses
+   arbitration at the stop. With no sensor every address is NACKed.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Queue.h"
+
+#include "inc/hw_memmap.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/i2c.h"
+
+#include "I2CService.h"
+#include "TCS3472x.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define CLOCKS_PER_US 40
+#define DISPATCH_US 20          // RunI2CService for one event
+#define ISR_US 2                // I2C_MasterISR
+#define POLL_US 0.5             // one ROM_I2CMasterBusy in a loop
+#define NEVER 1e18
+#define QUEUE_SIZE 8
+#define TIMEOUT_US 20e6
+
+// the MCS bits of a command
+#define MCS_RUN 0x1
+#define MCS_START 0x2
+#define MCS_STOP 0x4
+
+#define TRIES 3                 // the first and MAX_RETRIES more
+#define STUCK_CLOCKS 6          // of the byte the sensor thinks it is sending
+#define MAX_RECOVERY_US 1000.0
+
+#define COLOUR_BYTES 8
+#define READ_FROM(Reg) \
+  ((Reg) | TCS3472x_COMMAND_BIT | TCS3472x_AUTO_INCREMENT)
+#define TYPE_MASK 0x60          // of the command byte
+#define REG_MASK 0x1f
+
+// the lists of the sensor
+#define POWER_UP 0
+#define READ_ALL 1
+#define NOTHING 2
+
+/*---------------------------- Module Types -------------------------------*/
+typedef struct
+{
+  const char *Name;
+  bool Fast;
+  uint16_t Reads;
+  uint8_t NackEvery;          // NACK the first try of every n-th read, 0 never
+  uint16_t StuckRead;         // the read SDA is held low in, 0 never
+  bool Present;               // the sensor answers its address
+  double MinRate;             // reads/s
+}Scenario_t;
+
+/*---------------------------- Module Variables ---------------------------*/
+static const Scenario_t Scenarios[] = {
+  { "100 kbps", false, 1000, 0, 0, true, 900 },
+  { "100 kbps, NACK every 10 reads", false, 1000, 10, 0, true, 850 },
+  { "400 kbps", true, 1000, 0, 0, true, 3200 },
+  { "400 kbps, NACK every 10 reads", true, 1000, 10, 0, true, 3000 },
+  { "400 kbps, SDA held low in read 500", true, 1000, 0, 500, true, 3200 },
+  { "400 kbps, no sensor", true, 5, 0, 0, false, 0 }
+};
+#define NUM_SCENARIOS (sizeof(Scenarios) / sizeof(Scenarios[0]))
+
+static uint8_t Sample[COLOUR_BYTES];
+
+static const StepDefinition_t PowerUp[] = {
+  {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL},
+  {CMD_Write8NS, TCS3472x_ENABLE_PON, 0, BUSY_WAIT, NULL},
+  {CMD_NOP, 0, 3, TIME_WAIT, NULL},
+  {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL},
+  {CMD_Write8NS, (TCS3472x_ENABLE_PON | TCS3472x_ENABLE_AEN), 0, BUSY_WAIT, NULL},
+  {CMD_NOP, 0, 3, TIME_WAIT, NULL}, /* the end comes after the timer */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL}
+};
+static const StepDefinition_t ReadAll[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_CDATAL_REG), 0, BUSY_WAIT, NULL},
+  {CMD_ReadBurst, COLOUR_BYTES, 0, BUSY_WAIT, Sample},
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL}
+};
+/* ends inside I2C_Request */
+static const StepDefinition_t Nothing[] = {
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL}
+};
+static const StepDefinition_t * const Sequences[] = {
+  PowerUp, ReadAll, Nothing
+};
+static I2CDevice_t Sensor = {
+  TCS3472x_ADDRESS, false, Sequences, 3
+};
+
+static double Now = 1;        // us
+
+static struct
+{
+  bool Fast;
+  bool Receive;
+  uint8_t DataOut, DataIn;
+  bool Busy;                  // a command is running
+  bool Held;                  // between a start and its stop
+  uint32_t Command;
+  double DoneUS;
+  uint32_t Error;
+  uint32_t RawInt, IntMask;
+  bool IntEnabled;            // in the NVIC
+  bool SclGpio;               // SCL taken off the module
+  uint8_t Scl;
+}Master;
+
+static struct
+{
+  bool Present;
+  uint8_t Regs[REG_MASK + 1];
+  uint8_t Pointer;
+  bool AutoIncrement;
+  bool NackNext;              // the next address
+  bool StuckNext;             // holds SDA after the next burst byte
+  uint8_t StuckClocks;        // left before it lets go, 0 when SDA is free
+}Tcs;
+
+static bool InISR;
+static ES_Event_t Queue[QUEUE_SIZE + 1];
+static double TimerAt;        // I2C_TIMER, 0 when stopped
+
+static const Scenario_t *This;
+static unsigned Requested, Wanted, Finished, Good, Failed, BadData;
+static unsigned Nacks, Clocks;
+static double StuckUS, RecoveredUS;
+
+/*------------------------------ The framework ----------------------------*/
+bool ES_PostToService(uint8_t WhichService, ES_Event_t ThisEvent)
+{
+  return ES_EnQueueFIFO(Queue, ThisEvent);
+}
+
+ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
+{
+  HT_CHECK(Num == I2C_TIMER);
+  TimerAt = (floor(Now / 1000) + NewTime) * 1000;
+  return ES_Timer_OK;
+}
+
+uint16_t ES_Timer_GetTime(void)
+{
+  return (uint16_t)(uint32_t)(Now / 1000);
+}
+
+/*------------------------------ The TCS3472x -----------------------------*/
+static void TcsWrite(uint8_t Data, bool First)
+{
+  if (First && (Data & TCS3472x_COMMAND_BIT))
+  {
+    // the command byte, special functions leave the pointer alone
+    if ((Data & TYPE_MASK) != TCS3472x_SPECIAL_FN)
+    {
+      Tcs.Pointer = Data & REG_MASK;
+      Tcs.AutoIncrement = (Data & TYPE_MASK) == TCS3472x_AUTO_INCREMENT;
+    }
+  }
+  else
+  {
+    Tcs.Regs[Tcs.Pointer & REG_MASK] = Data;
+  }
+}
+
+static uint8_t TcsRead(void)
+{
+  uint8_t Data = Tcs.Regs[Tcs.Pointer & REG_MASK];
+
+  Tcs.Pointer += Tcs.AutoIncrement;
+  return Data;
+}
+
+// the next result in CDATAL..BDATAH
+static void NewSample(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < COLOUR_BYTES; i++)
+  {
+    Tcs.Regs[TCS3472x_CDATAL_REG + i] = (uint8_t)(256 * HT_Uniform());
+  }
+}
+
+/*------------------------------ The I2C1 master --------------------------*/
+static double BitUS(void)
+{
+  return Master.Fast ? 2.5 : 10;
+}
+
+static void EndTransfer(void)
+{
+  uint32_t Command = Master.Command;
+  bool First = false;
+
+  Master.Busy = false;
+  Master.RawInt |= I2C_MASTER_INT_DATA;
+  if (!(Command & MCS_RUN))
+  {
+    // the error stop
+    Master.Held = false;
+    return;
+  }
+  if ((Tcs.StuckClocks != 0) && (Command & (MCS_START | MCS_STOP)))
+  {
+    // SDA held low, neither a start nor a stop can be made
+    Master.Error = I2C_MASTER_ERR_ARB_LOST;
+    Master.Held = true;
+    return;
+  }
+  if (Command & MCS_START)
+  {
+    if (!Tcs.Present || Tcs.NackNext)
+    {
+      Tcs.NackNext = false;
+      Nacks++;
+      Master.Error = I2C_MASTER_ERR_ADDR_ACK;
+      Master.Held = !(Command & MCS_STOP);
+      return;
+    }
+    First = true;
+  }
+  if (Master.Receive)
+  {
+    Master.DataIn = (Tcs.StuckClocks != 0) ? 0 : TcsRead();
+    if (Tcs.StuckNext && !First)
+    {
+      Tcs.StuckNext = false;
+      Tcs.StuckClocks = STUCK_CLOCKS;
+      StuckUS = Now;
+    }
+  }
+  else
+  {
+    TcsWrite(Master.DataOut, First);
+  }
+  Master.Held = !(Command & MCS_STOP);
+}
+
+static bool InterruptPending(void)
+{
+  return Master.IntEnabled && ((Master.RawInt & Master.IntMask) != 0);
+}
+
+static void RunISR(void)
+{
+  InISR = true;
+  Now += ISR_US;
+  I2C_MasterISR();
+  InISR = false;
+}
+
+// moves the clock on in a busy wait of the service, the transfer can end
+// and its interrupt come meanwhile
+static void Advance(double US)
+{
+  Now += US;
+  if (Master.Busy && (Master.DoneUS <= Now))
+  {
+    EndTransfer();
+  }
+  if (!InISR && InterruptPending() && HT_InterruptsEnabled())
+  {
+    RunISR();
+  }
+}
+
+uint32_t SysCtlClockGet(void)
+{
+  return 1000000 * CLOCKS_PER_US;
+}
+
+void ROM_SysCtlPeripheralEnable(uint32_t Peripheral)
+{
+}
+
+bool ROM_SysCtlPeripheralReady(uint32_t Peripheral)
+{
+  return true;
+}
+
+void ROM_SysCtlPeripheralReset(uint32_t Peripheral)
+{
+  bool IntEnabled = Master.IntEnabled;
+  bool SclGpio = Master.SclGpio;
+  uint8_t Scl = Master.Scl;
+
+  HT_CHECK(Peripheral == SYSCTL_PERIPH_I2C1);
+  memset(&Master, 0, sizeof(Master));
+  Master.IntEnabled = IntEnabled;
+  Master.SclGpio = SclGpio;
+  Master.Scl = Scl;
+}
+
+void ROM_SysCtlDelay(uint32_t Count)
+{
+  Advance(3.0 * Count / CLOCKS_PER_US);
+}
+
+void ROM_GPIOPinConfigure(uint32_t PinConfig)
+{
+}
+
+void ROM_GPIOPinTypeI2C(uint32_t Port, uint8_t Pins)
+{
+}
+
+void ROM_GPIOPinTypeI2CSCL(uint32_t Port, uint8_t Pins)
+{
+  Master.SclGpio = false;
+}
+
+void ROM_GPIOPinTypeGPIOInput(uint32_t Port, uint8_t Pins)
+{
+}
+
+void ROM_GPIOPinTypeGPIOOutputOD(uint32_t Port, uint8_t Pins)
+{
+  if ((Port == GPIO_PORTA_BASE) && (Pins & GPIO_PIN_6))
+  {
+    // the pull up has SCL high
+    Master.SclGpio = true;
+    Master.Scl = GPIO_PIN_6;
+  }
+}
+
+int32_t ROM_GPIOPinRead(uint32_t Port, uint8_t Pins)
+{
+  HT_CHECK((Port == GPIO_PORTA_BASE) && (Pins == GPIO_PIN_7));
+  return (Tcs.StuckClocks != 0) ? 0 : GPIO_PIN_7;
+}
+
+void ROM_GPIOPinWrite(uint32_t Port, uint8_t Pins, uint8_t Val)
+{
+  if ((Port != GPIO_PORTA_BASE) || !(Pins & GPIO_PIN_6) || !Master.SclGpio)
+  {
+    return;
+  }
+  // the sensor moves on a bit on each rising edge
+  if ((Val & GPIO_PIN_6) && !Master.Scl && (Tcs.StuckClocks != 0))
+  {
+    Clocks++;
+    Tcs.StuckClocks--;
+  }
+  Master.Scl = Val & GPIO_PIN_6;
+}
+
+void ROM_I2CMasterInitExpClk(uint32_t Base, uint32_t I2CClk, bool Fast)
+{
+  HT_CHECK(I2CClk == SysCtlClockGet());
+  Master.Fast = Fast;
+}
+
+void ROM_I2CMasterDisable(uint32_t Base)
+{
+}
+
+void ROM_I2CMasterTimeoutSet(uint32_t Base, uint32_t Value)
+{
+}
+
+void ROM_I2CMasterIntEnableEx(uint32_t Base, uint32_t IntFlags)
+{
+  Master.IntMask |= IntFlags;
+}
+
+void ROM_I2CMasterIntClearEx(uint32_t Base, uint32_t IntFlags)
+{
+  Master.RawInt &= ~IntFlags;
+}
+
+uint32_t ROM_I2CMasterIntStatusEx(uint32_t Base, bool Masked)
+{
+  return Masked ? (Master.RawInt & Master.IntMask) : Master.RawInt;
+}
+
+void ROM_I2CMasterSlaveAddrSet(uint32_t Base, uint8_t SlaveAddr, bool Receive)
+{
+  HT_CHECK(SlaveAddr == TCS3472x_ADDRESS);
+  Master.Receive = Receive;
+}
+
+void ROM_I2CMasterDataPut(uint32_t Base, uint8_t Data)
+{
+  Master.DataOut = Data;
+}
+
+uint32_t ROM_I2CMasterDataGet(uint32_t Base)
+{
+  return Master.DataIn;
+}
+
+void ROM_I2CMasterControl(uint32_t Base, uint32_t Cmd)
+{
+  double Bits = 1;            // the error stop
+
+  HT_CHECK(!Master.Busy);
+  if (Cmd & MCS_RUN)
+  {
+    Bits = ((Cmd & MCS_START) ? 10 : 0) + 9 + ((Cmd & MCS_STOP) ? 1 : 0);
+  }
+  Master.Command = Cmd;
+  Master.Error = I2C_MASTER_ERR_NONE;
+  Master.Busy = true;
+  Master.DoneUS = Now + Bits * BitUS();
+}
+
+uint32_t ROM_I2CMasterErr(uint32_t Base)
+{
+  return Master.Busy ? I2C_MASTER_ERR_NONE : Master.Error;
+}
+
+bool ROM_I2CMasterBusy(uint32_t Base)
+{
+  Advance(POLL_US);
+  return Master.Busy;
+}
+
+bool ROM_I2CMasterBusBusy(uint32_t Base)
+{
+  return Master.Held || (Tcs.StuckClocks != 0);
+}
+
+void ROM_IntEnable(uint32_t Interrupt)
+{
+  Master.IntEnabled = true;
+}
+
+/*------------------------------ Simulation -------------------------------*/
+// does the next thing due, false when there is nothing left to do
+static bool Step(void)
+{
+  ES_Event_t ThisEvent;
+  double Next = NEVER;
+
+  if (InterruptPending() && HT_InterruptsEnabled())
+  {
+    RunISR();
+    return true;
+  }
+  if (!ES_IsQueueEmpty(Queue))
+  {
+    ES_DeQueue(Queue, &ThisEvent);
+    Now += DISPATCH_US;
+    RunI2CService(ThisEvent);
+    return true;
+  }
+  if (Master.Busy)
+  {
+    Next = Master.DoneUS;
+  }
+  if ((TimerAt > 0) && (TimerAt < Next))
+  {
+    Now = (TimerAt > Now) ? TimerAt : Now;
+    TimerAt = 0;
+    ThisEvent.EventType = ES_TIMEOUT;
+    ThisEvent.EventParam = I2C_TIMER;
+    ES_PostToService(0, ThisEvent);
+    return true;
+  }
+  if (Next == NEVER)
+  {
+    return false;
+  }
+  Now = (Next > Now) ? Next : Now;
+  EndTransfer();
+  return true;
+}
+
+// runs until the bus and the service have nothing left to do
+static void RunIdle(void)
+{
+  double EndUS = Now + TIMEOUT_US;
+
+  while (Step() && (Now < EndUS))
+  {
+  }
+  HT_CHECK(HT_InterruptsEnabled());
+  HT_CHECK(QueryI2CService() == Idle);
+  HT_CHECK(I2C_QueryWaiting() == 0);
+}
+
+static void ReadDone(bool Ok);
+
+static void RequestRead(void)
+{
+  Requested++;
+  Tcs.NackNext = (This->NackEvery != 0) &&
+      ((Requested % This->NackEvery) == 0);
+  Tcs.StuckNext = (Requested == This->StuckRead);
+  HT_CHECK(I2C_Request(&Sensor, READ_ALL, ReadDone));
+}
+
+// the next read is asked for from here, at task level, so the bus runs
+// back to back
+static void ReadDone(bool Ok)
+{
+  Finished++;
+  if (Ok)
+  {
+    Good++;
+    if (memcmp(Sample, &Tcs.Regs[TCS3472x_CDATAL_REG], COLOUR_BYTES) != 0)
+    {
+      BadData++;
+    }
+    if ((StuckUS >= 0) && (RecoveredUS < 0))
+    {
+      RecoveredUS = Now;
+    }
+    NewSample();
+  }
+  else
+  {
+    Failed++;
+  }
+  if (Requested < Wanted)
+  {
+    RequestRead();
+  }
+}
+
+static void Play(const Scenario_t *Scenario)
+{
+  I2CStats_t Stats;
+  double StartUS, ElapsedUS;
+  unsigned Before;
+
+  printf("%s:\n", Scenario->Name);
+  This = Scenario;
+  Sensor.FastMode = Scenario->Fast;
+  Tcs.Present = true;
+
+  //power up, with a time wait inside the list and one at its end
+  Tcs.Regs[TCS3472x_ENABLE_REG] = 0;
+  HT_CHECK(I2C_Request(&Sensor, POWER_UP, 0));
+  RunIdle();
+  HT_CHECK(Tcs.Regs[TCS3472x_ENABLE_REG] ==
+      (TCS3472x_ENABLE_PON | TCS3472x_ENABLE_AEN));
+
+  //a list with no steps is over before I2C_Request returns
+  HT_CHECK(I2C_Request(&Sensor, NOTHING, 0));
+  HT_CHECK(HT_InterruptsEnabled());
+  RunIdle();
+
+  Tcs.Present = Scenario->Present;
+  Requested = Finished = Good = Failed = BadData = 0;
+  Nacks = Clocks = 0;
+  StuckUS = RecoveredUS = -1;
+  Wanted = Scenario->Reads;
+  I2C_ResetStats();
+  NewSample();
+  StartUS = Now;
+  RequestRead();
+  RunIdle();
+  ElapsedUS = Now - StartUS;
+  I2C_QueryStats(&Stats);
+
+  printf("  %u of %u good, %.0f reads/s, %.0f us each, bus busy %.0f%%\n",
+      Good, Scenario->Reads, 1e6 * Good / ElapsedUS,
+      ElapsedUS / Scenario->Reads, 100 * Stats.BusUS / ElapsedUS);
+  printf("  %u NACKs, %lu retries, %lu recoveries, %lu failed\n", Nacks,
+      (unsigned long)Stats.Retries, (unsigned long)Stats.Recoveries,
+      (unsigned long)Stats.Errors);
+  HT_CHECK(Finished == Scenario->Reads);
+  HT_CHECK(Stats.Requests == Scenario->Reads);
+  HT_CHECK(Stats.Completed == Good);
+  HT_CHECK(Stats.Errors == Failed);
+  HT_CHECK(BadData == 0);
+  if (Scenario->Present)
+  {
+    HT_CHECK(Good == Scenario->Reads);
+    HT_CHECK(Stats.Retries == Nacks + (Scenario->StuckRead != 0));
+    HT_CHECK(Stats.Recoveries == (Scenario->StuckRead != 0));
+    HT_CHECK(1e6 * Good / ElapsedUS >= Scenario->MinRate);
+  }
+  else
+  {
+    //each read tried TRIES times then reported as failed
+    HT_CHECK(Failed == Scenario->Reads);
+    HT_CHECK(Nacks == TRIES * Scenario->Reads);
+    HT_CHECK(Stats.Retries == (TRIES - 1) * Scenario->Reads);
+    HT_CHECK(Stats.Recoveries == 0);
+  }
+  if (Scenario->StuckRead != 0)
+  {
+    printf("  SDA let go after %u clocks, good read %.0f us later\n",
+        Clocks, RecoveredUS - StuckUS);
+    HT_CHECK(Clocks == STUCK_CLOCKS);
+    HT_CHECK((RecoveredUS >= 0) && (RecoveredUS - StuckUS < MAX_RECOVERY_US));
+  }
+
+  //the bus works afterwards
+  Tcs.Present = true;
+  Before = Good;
+  Wanted = Requested + 1;
+  RequestRead();
+  RunIdle();
+  HT_CHECK(Good == Before + 1);
+}
+
+int main(void)
+{
+  uint8_t i;
+
+  HT_Seed(44);
+  ES_InitQueue(Queue, QUEUE_SIZE + 1);
+  HT_CHECK(InitI2CService(0));
+
+  //requests made before ES_INIT wait for it
+  Tcs.Present = true;
+  HT_CHECK(I2C_Request(&Sensor, NOTHING, 0));
+  HT_CHECK(I2C_Request(&Sensor, POWER_UP, 0));
+  HT_CHECK(QueryI2CService() == InitPState);
+  RunIdle();
+  HT_CHECK(Tcs.Regs[TCS3472x_ENABLE_REG] ==
+      (TCS3472x_ENABLE_PON | TCS3472x_ENABLE_AEN));
+
+  for (i = 0; i < NUM_SCENARIOS; i++)
+  {
+    Play(&Scenarios[i]);
+  }
+  return HT_Finish("I2CTest");
+}
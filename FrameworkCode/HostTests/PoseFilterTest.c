@@ -0,0 +1,246 @@
+/****************************************************************************
+ Module
+   PoseFilterTest.c
+
+ Description
+   Replays a drive against Odometry, Triangulation and PoseFilter and checks
+   that the blended pose beats both the odometry alone and the raw fixes
+
+ Notes
+   The robot weaves across the field at 12 in/s for 60 s. The encoder
+   totals are synthesized every 0.5 ms (the control tick) with wheel 2 2%
+   larger than the drive parameters assume, so the odometry drifts. Every
+   200 ms the four bearings are generated with 1 degree of noise, one in
+   four fixes misses a beacon and one in twenty has a 20 degree error on
+   one bearing.
+
+   The second case moves the robot 30 inches behind the filter's back and
+   checks that the outlier gate lets go after a few rejected fixes.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "ParamStore.h"
+#include "EncoderCapture.h"
+#include "Odometry.h"
+#include "Triangulation.h"
+#include "PoseFilter.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+#define DEG_TO_RAD (PI / 180)
+#define RAD_TO_DEG (180 / PI)
+
+#define TICK_S 0.0005
+#define FIX_TICKS 400           // 5 Hz
+#define RUN_TICKS 120000        // 60 s
+#define SETTLE_TICKS 20000      // first 10 s not scored
+#define WHEEL_2_SCALE 1.02      // real wheel 2 over the one in the params
+
+#define SPEED 12.0              // in/s
+#define TURN_RATE 34.377        // deg/s, a 20 inch radius
+#define WEAVE_S 10.472          // half a circle each way
+
+#define BEARING_SIGMA 1.0       // deg
+#define OUTLIER_DEG 20.0
+
+/*---------------------------- Module Variables ---------------------------*/
+typedef struct
+{
+  double X, Y, Heading;         // inches, degrees CCW from East
+}TruePose_t;
+
+static double Wheel_1, Wheel_2; // encoder totals, fractional ticks
+static TruePose_t Robot;
+static double OdoX, OdoY, OdoHeading; // odometry alone, same drift
+
+/*------------------------------ Module Code ------------------------------*/
+int32_t QueryEncoderOdometer(uint8_t Wheel)
+{
+  return (int32_t)floor((Wheel == WHEEL_1) ? Wheel_1 : Wheel_2);
+}
+
+static double Wrap180(double Angle)
+{
+  return Angle - 360 * floor((Angle + 180) / 360);
+}
+
+// Moves the robot and its wheels through one control tick
+static void Step(double Distance, double Turn)
+{
+  double Mid = (Robot.Heading + Turn / 2) * DEG_TO_RAD;
+  double Ticks = Distance * Param.TicksPerInch;
+  double TurnTicks = Turn * Param.TicksPerDegree;
+
+  Robot.X += Distance * cos(Mid);
+  Robot.Y += Distance * sin(Mid);
+  Robot.Heading += Turn;
+  Wheel_1 += Ticks - TurnTicks;
+  Wheel_2 += (Ticks + TurnTicks) / WHEEL_2_SCALE;
+
+  //what the odometry believes the wheels did, for the odometry-only error
+  Distance = (Ticks - TurnTicks + (Ticks + TurnTicks) / WHEEL_2_SCALE) /
+      (2 * Param.TicksPerInch);
+  Turn = ((Ticks + TurnTicks) / WHEEL_2_SCALE - (Ticks - TurnTicks)) /
+      (2 * Param.TicksPerDegree);
+  Mid = (OdoHeading + Turn / 2) * DEG_TO_RAD;
+  OdoX += Distance * cos(Mid);
+  OdoY += Distance * sin(Mid);
+  OdoHeading += Turn;
+  Odo_Update();
+}
+
+// Bearings of the four beacons as the sensor reports them
+static void Measure(float *Angles)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    float BX, BY;
+    double Field;
+
+    QueryBeaconPosition(i, &BX, &BY);
+    Field = atan2(BY - Robot.Y, BX - Robot.X) * RAD_TO_DEG;
+    Angles[i] = (float)fmod(Robot.Heading - Field + BEARING_SIGMA * HT_Gauss() +
+        720, 360);
+  }
+}
+
+static double PoseError(void)
+{
+  float X, Y, Heading;
+
+  PF_QueryPose(&X, &Y, &Heading);
+  return hypot(X - Robot.X, Y - Robot.Y);
+}
+
+static void StartRun(double X, double Y, double Heading)
+{
+  Pose_t Start;
+
+  Robot.X = OdoX = X;
+  Robot.Y = OdoY = Y;
+  Robot.Heading = OdoHeading = Heading;
+  Odo_Init();
+  PF_Init();
+
+  //the odometry knows where it starts, the filter does not yet trust it
+  Start.X = (int32_t)(X * POSE_ONE_INCH);
+  Start.Y = (int32_t)(Y * POSE_ONE_INCH);
+  Start.Theta = DEGREES_TO_POSE(Heading);
+  Odo_SetPose(&Start);
+}
+
+static void TestDriftReplay(void)
+{
+  double FusedSq = 0, FixSq = 0, OdoSq = 0;
+  double MaxFused = 0;
+  unsigned Fused = 0, Fixes = 0, Outliers = 0, Used = 0;
+  uint32_t Tick;
+
+  HT_Seed(29);
+  StartRun(0, -10, 0);
+  for (Tick = 1; Tick <= RUN_TICKS; Tick++)
+  {
+    double Turn = (fmod(Tick * TICK_S, 2 * WEAVE_S) < WEAVE_S) ? TURN_RATE : -TURN_RATE;
+
+    Step(SPEED * TICK_S, Turn * TICK_S);
+    if ((Tick % FIX_TICKS) == 0)
+    {
+      float Angles[NUM_BEACONS];
+
+      Measure(Angles);
+      if (HT_Uniform() < 0.05)
+      {
+        uint8_t Bad = (uint8_t)(HT_Uniform() * NUM_BEACONS);
+        Angles[Bad] = (float)fmod(Angles[Bad] + OUTLIER_DEG, 360);
+        Outliers++;
+      }
+      if (HT_Uniform() < 0.25)
+      {
+        Angles[(uint8_t)(HT_Uniform() * NUM_BEACONS)] = -1;
+      }
+      if (PF_CorrectFromBeacons(Angles[0], Angles[1], Angles[2], Angles[3]))
+      {
+        Used++;
+      }
+      if (QueryFixBeacons() != 0)
+      {
+        Fixes++;
+        FixSq += pow(QueryXCoordinate() - Robot.X, 2) +
+            pow(QueryYCoordinate() - Robot.Y, 2);
+      }
+    }
+    //scored halfway between fixes, where the odometry has drifted most
+    if (((Tick % FIX_TICKS) == FIX_TICKS / 2) && (Tick > SETTLE_TICKS))
+    {
+      double Error = PoseError();
+
+      FusedSq += Error * Error;
+      MaxFused = (Error > MaxFused) ? Error : MaxFused;
+      OdoSq += pow(OdoX - Robot.X, 2) + pow(OdoY - Robot.Y, 2);
+      Fused++;
+    }
+  }
+
+  printf("drift replay: %u fixes (%u used), %u outliers, %u rejected\n",
+      Fixes, Used, Outliers, PF_QueryRejectCount());
+  printf("  rms error: odometry %.2f in, raw fix %.2f in, fused %.2f in (max %.2f)\n",
+      sqrt(OdoSq / Fused), sqrt(FixSq / Fixes), sqrt(FusedSq / Fused), MaxFused);
+
+  HT_CHECK(Outliers > 0);
+  HT_CHECK(sqrt(FusedSq / Fused) < sqrt(FixSq / Fixes));
+  HT_CHECK(sqrt(FusedSq / Fused) < sqrt(OdoSq / Fused) / 4);
+  HT_CHECK(MaxFused < 3.0);
+  HT_CHECK(PoseError() < 2.0);
+}
+
+static void TestKidnap(void)
+{
+  unsigned FixesToRecover = 0;
+  uint32_t Tick;
+  float X, Y, Heading;
+
+  HT_Seed(30);
+  StartRun(10, 0, 90);
+  for (Tick = 1; Tick <= 40 * FIX_TICKS; Tick++)
+  {
+    Step(0, 0);
+    if ((Tick % FIX_TICKS) == 0)
+    {
+      float Angles[NUM_BEACONS];
+
+      Measure(Angles);
+      PF_CorrectFromBeacons(Angles[0], Angles[1], Angles[2], Angles[3]);
+    }
+  }
+  HT_CHECK(PoseError() < 1.0);
+
+  //carried 30 inches away, the wheels never turned
+  Robot.X -= 30;
+  do
+  {
+    float Angles[NUM_BEACONS];
+
+    Measure(Angles);
+    PF_CorrectFromBeacons(Angles[0], Angles[1], Angles[2], Angles[3]);
+    FixesToRecover++;
+  } while ((PoseError() > 2.0) && (FixesToRecover < 50));
+
+  PF_QueryPose(&X, &Y, &Heading);
+  printf("kidnap: back within 2 in after %u fixes, %u rejected\n",
+      FixesToRecover, PF_QueryRejectCount());
+  HT_CHECK(FixesToRecover <= 10);
+  HT_CHECK(fabs(Wrap180(Heading - Robot.Heading)) < 3.0);
+}
+
+int main(void)
+{
+  HT_LoadParamDefaults();
+  TestDriftReplay();
+  TestKidnap();
+  return HT_Finish("PoseFilterTest");
+}
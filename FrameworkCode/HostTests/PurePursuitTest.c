@@ -0,0 +1,242 @@
+/****************************************************************************
+ Module
+   PurePursuitTest.c
+
+ Description
+   Laps a square with PurePursuit and with the turn-and-drive moves it
+   replaces, and checks that the path follower is quicker and still gets
+   round the corners and home
+
+ Notes
+   The wheels are the speed loop as seen from the position loop: each one
+   follows its RPM setpoint with a 50 ms lag, capped at 130 RPM. The
+   encoder totals (150 ticks per rev) feed the real Odometry, which is the
+   pose PP_Step steers on. The true pose is integrated alongside from the
+   same wheel motion, so the odometry here has no drift.
+
+   The turn-and-drive lap is the position loop of MotorSpeedControl: one
+   MotionProfile per move with the default limits, the Param PD gains with
+   the profile velocity fed forward, and the move done once the profile has
+   finished and both errors are within 2 ticks. Both run at the default
+   2 ms position period and 100 RPM.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "ParamStore.h"
+#include "EncoderCapture.h"
+#include "MotorSpeedControl.h"
+#include "MotionProfile.h"
+#include "Odometry.h"
+#include "PurePursuit.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+
+#define UPDATE_US 2000
+#define TICK_S (UPDATE_US * 1e-6)
+#define MAX_RPM 100
+#define TIMEOUT_S 60
+
+#define TIME_CONSTANT_S 0.05
+#define WHEEL_MAX_RPM 130
+#define TICKS_PER_REV 150
+
+// As MotorSpeedControl
+#define PROFILE_MAX_VEL 250     // ticks/s
+#define PROFILE_MAX_ACC 1000
+#define PROFILE_MAX_JERK 10000
+#define MIN_ERROR 2             // ticks
+#define PROFILE_TO_RPM ((1000000.0 / UPDATE_US) * 60 / TICKS_PER_REV)
+#define DERIVATIVE_SCALE ((double)NOMINAL_UPDATE_US / UPDATE_US)
+
+#define MAX_LAP_RATIO 0.85      // pursuit lap over turn-and-drive lap
+#define MAX_CORNER_MISS 4.0     // inches, the arc cuts inside each corner
+#define MAX_END_ERROR 1.0       // inches
+
+/*---------------------------- Module Variables ---------------------------*/
+static double RPM_1, RPM_2;
+static double Wheel_1, Wheel_2; // encoder totals, fractional ticks
+static double RobotX, RobotY, RobotHeading; // inches, radians CCW from East
+
+/*------------------------------ Module Code ------------------------------*/
+int32_t QueryEncoderOdometer(uint8_t Wheel)
+{
+  return (int32_t)floor((Wheel == WHEEL_1) ? Wheel_1 : Wheel_2);
+}
+
+static double Clamp(double Value, double Limit)
+{
+  return fmax(-Limit, fmin(Limit, Value));
+}
+
+// One position period of the wheels, the robot and the odometry
+static void Step(double Setpoint_1, double Setpoint_2)
+{
+  double Delta_1, Delta_2, Distance, Turn;
+
+  RPM_1 += (Clamp(Setpoint_1, WHEEL_MAX_RPM) - RPM_1) * TICK_S / TIME_CONSTANT_S;
+  RPM_2 += (Clamp(Setpoint_2, WHEEL_MAX_RPM) - RPM_2) * TICK_S / TIME_CONSTANT_S;
+  Delta_1 = RPM_1 * TICKS_PER_REV / 60 * TICK_S;
+  Delta_2 = RPM_2 * TICKS_PER_REV / 60 * TICK_S;
+  Wheel_1 += Delta_1;
+  Wheel_2 += Delta_2;
+
+  Distance = (Delta_1 + Delta_2) / (2 * Param.TicksPerInch);
+  Turn = (Delta_2 - Delta_1) / (2 * Param.TicksPerDegree) * PI / 180;
+  RobotX += Distance * cos(RobotHeading + Turn / 2);
+  RobotY += Distance * sin(RobotHeading + Turn / 2);
+  RobotHeading += Turn;
+  Odo_Update();
+}
+
+static void StartLap(void)
+{
+  RPM_1 = RPM_2 = 0;
+  Wheel_1 = Wheel_2 = 0;
+  RobotX = RobotY = RobotHeading = 0;
+  Odo_Init();
+}
+
+// A profiled move, Distance or Heading in encoder ticks, returns seconds
+static double Move(double Target, bool Heading)
+{
+  MotionProfile_t Profile;
+  MotionLimits_t Limits = { PROFILE_MAX_VEL, PROFILE_MAX_ACC, PROFILE_MAX_JERK };
+  int32_t Start_1 = QueryEncoderOdometer(WHEEL_1);
+  int32_t Start_2 = QueryEncoderOdometer(WHEEL_2);
+  double LastDistanceError = 0, LastHeadingError = 0;
+  double Desired = 0;
+  double t = 0;
+
+  MP_Plan(&Profile, (float)Target, &Limits, UPDATE_US);
+  for (;;)
+  {
+    int32_t Ticks_1 = QueryEncoderOdometer(WHEEL_1) - Start_1;
+    int32_t Ticks_2 = QueryEncoderOdometer(WHEEL_2) - Start_2;
+    double DistanceError, HeadingError, DistanceTerm, HeadingTerm;
+
+    if (MP_IsActive(&Profile))
+    {
+      Desired = MP_Step(&Profile);
+    }
+    DistanceError = (Heading ? 0 : Desired) - (Ticks_1 + Ticks_2) / 2;
+    HeadingError = (Heading ? Desired : 0) - (Ticks_2 - Ticks_1) / 2;
+    DistanceTerm = Param.DistanceP * DistanceError +
+        Param.DistanceD * DERIVATIVE_SCALE * (DistanceError - LastDistanceError);
+    HeadingTerm = Param.HeadingP * HeadingError +
+        Param.HeadingD * DERIVATIVE_SCALE * (HeadingError - LastHeadingError);
+    if (Heading)
+    {
+      HeadingTerm += PROFILE_TO_RPM * MP_GetVelocity(&Profile);
+    }
+    else
+    {
+      DistanceTerm += PROFILE_TO_RPM * MP_GetVelocity(&Profile);
+    }
+    LastDistanceError = DistanceError;
+    LastHeadingError = HeadingError;
+    if (!MP_IsActive(&Profile) && (fabs(DistanceError) <= MIN_ERROR) &&
+        (fabs(HeadingError) <= MIN_ERROR))
+    {
+      return t;
+    }
+    if (t > TIMEOUT_S)
+    {
+      HT_CHECK(!"move timed out");
+      return t;
+    }
+    Step(Clamp(DistanceTerm - HeadingTerm, MAX_RPM),
+        Clamp(DistanceTerm + HeadingTerm, MAX_RPM));
+    t += TICK_S;
+  }
+}
+
+static double TurnAndDrive(double Side)
+{
+  double t = 0;
+  uint8_t Leg;
+
+  StartLap();
+  for (Leg = 0; Leg < 4; Leg++)
+  {
+    t += Move(Side * Param.TicksPerInch, false);
+    if (Leg < 3)
+    {
+      t += Move(90 * Param.TicksPerDegree, true);
+    }
+  }
+  printf("  turn-and-drive: %.2f s, ends %.2f in from the start\n", t,
+      hypot(RobotX, RobotY));
+  return t;
+}
+
+static double Pursuit(double Side)
+{
+  const double CornerX[4] = { Side, Side, 0, 0 };
+  const double CornerY[4] = { 0, Side, Side, 0 };
+  double Miss[4] = { 1e9, 1e9, 1e9, 1e9 };
+  double FastestWheel = 0;
+  double t = 0;
+  unsigned Waypoints = 0;
+  uint8_t Status;
+  uint8_t i;
+
+  StartLap();
+  PP_Clear();
+  for (i = 0; i < 4; i++)
+  {
+    HT_CHECK(PP_AddWaypoint((float)CornerX[i], (float)CornerY[i]));
+  }
+  HT_CHECK(PP_Start());
+  do
+  {
+    float Setpoint_1, Setpoint_2;
+
+    Status = PP_Step(UPDATE_US, MAX_RPM, &Setpoint_1, &Setpoint_2);
+    Waypoints += (Status & PP_WAYPOINT_DONE) != 0;
+    FastestWheel = fmax(FastestWheel, fmax(fabsf(Setpoint_1), fabsf(Setpoint_2)));
+    Step(Setpoint_1, Setpoint_2);
+    t += TICK_S;
+    for (i = 0; i < 4; i++)
+    {
+      Miss[i] = fmin(Miss[i], hypot(RobotX - CornerX[i], RobotY - CornerY[i]));
+    }
+  } while (!(Status & PP_ARRIVED) && (t < TIMEOUT_S));
+  //let the wheels spin down before scoring the end point
+  for (i = 0; i < 100; i++)
+  {
+    Step(0, 0);
+  }
+
+  printf("  pure pursuit: %.2f s, ends %.2f in from the start, corners missed by"
+      " %.1f %.1f %.1f in\n", t, hypot(RobotX, RobotY), Miss[0], Miss[1], Miss[2]);
+  HT_CHECK(Status & PP_ARRIVED);
+  HT_CHECK(Waypoints == 4);
+  HT_CHECK(FastestWheel < MAX_RPM * 1.0001); //float rounding
+  HT_CHECK(Miss[0] < MAX_CORNER_MISS);
+  HT_CHECK(Miss[1] < MAX_CORNER_MISS);
+  HT_CHECK(Miss[2] < MAX_CORNER_MISS);
+  HT_CHECK(hypot(RobotX, RobotY) < MAX_END_ERROR);
+  return t;
+}
+
+int main(void)
+{
+  const double Sides[] = { 24, 48 };
+  uint8_t i;
+
+  HT_LoadParamDefaults();
+  for (i = 0; i < sizeof(Sides) / sizeof(Sides[0]); i++)
+  {
+    double Baseline, Lap;
+
+    printf("%.0f in square lap:\n", Sides[i]);
+    Baseline = TurnAndDrive(Sides[i]);
+    Lap = Pursuit(Sides[i]);
+    HT_CHECK(Lap < MAX_LAP_RATIO * Baseline);
+  }
+  return HT_Finish("PurePursuitTest");
+}
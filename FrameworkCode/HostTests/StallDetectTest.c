@@ -0,0 +1,192 @@
+/****************************************************************************
+ Module
+   StallDetectTest.c
+
+ Description
+   Runs StallDetect inside a simulated speed loop and drive wheel, with a
+   stall or a slipping wheel injected part way through a move
+
+ Notes
+   Each wheel is a first order plant, 130 RPM at full duty with a 50 ms
+   time constant, driven by a PI loop on the 500 us control tick that
+   honours SD_QueryDutyLimit the way the firmware does. The encoder
+   odometers count 150 ticks per rev.
+
+   The move is a trapezoid: 0.3 s ramp to 100 RPM, 3 s cruise, 0.3 s down.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "EncoderCapture.h"
+#include "StallDetect.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define TICK_US 500
+#define TICK_S (TICK_US * 1e-6)
+#define RUN_TICKS 8000          // 4 s
+
+#define RPM_PER_DUTY 1.3
+#define TIME_CONSTANT_S 0.05
+#define TICKS_PER_REV 150
+#define PGAIN 2.0
+#define IGAIN 0.3
+#define INTEGRAL_STEP 0.25
+
+#define FAULT_TIME_S 1.0
+#define SAFE_DUTY 30            // SD default
+#define MAX_LATENCY_S 0.25      // one 200 ms window plus a slot
+#define RATE_CHANGE_S 2.0       // SD_Init again, as a loop period change does
+
+/*---------------------------- Module Variables ---------------------------*/
+typedef enum
+{
+  NormalMove,
+  Wheel1Blocked,                // hits a wall at FAULT_TIME_S
+  Wheel1Dragging,               // a third of the speed from FAULT_TIME_S
+  CommandedArc,                 // wheel 2 commanded at half speed
+  Wheel2BlockedFromRest,
+  Wheel1BlockedRateChange       // blocked, then the control rate is changed
+}Scenario_t;
+
+typedef struct
+{
+  uint8_t Faults;
+  double FirstFaultS;           // -1 if none
+  double MaxDutyAfterStall;
+}Outcome_t;
+
+static double Odometer[3];      // ticks, index by WHEEL_1 / WHEEL_2
+
+/*------------------------------ Module Code ------------------------------*/
+int32_t QueryEncoderOdometer(uint8_t Wheel)
+{
+  return (int32_t)floor(Odometer[Wheel]);
+}
+
+static double Clamp(double Value, double Limit)
+{
+  return fmax(-Limit, fmin(Limit, Value));
+}
+
+static double Setpoint(double t)
+{
+  if (t < 0.3)
+  {
+    return 100 * t / 0.3;
+  }
+  if (t < 3.3)
+  {
+    return 100;
+  }
+  return fmax(0, 100 - (t - 3.3) * 333);
+}
+
+static void Run(Scenario_t Scenario, Outcome_t *Outcome)
+{
+  double RPM[3] = { 0 }, Integral[3] = { 0 }, Duty[3] = { 0 };
+  uint32_t Tick;
+  uint8_t Wheel;
+
+  Odometer[WHEEL_1] = Odometer[WHEEL_2] = 0;
+  Outcome->Faults = 0;
+  Outcome->FirstFaultS = -1;
+  Outcome->MaxDutyAfterStall = 0;
+  SD_Init(TICK_US);
+  SD_Reset();
+
+  for (Tick = 0; Tick < RUN_TICKS; Tick++)
+  {
+    double t = Tick * TICK_S;
+    double Command[3];
+    uint8_t Faults;
+
+    if ((Scenario == Wheel1BlockedRateChange) && (Tick == (uint32_t)(RATE_CHANGE_S / TICK_S)))
+    {
+      SD_Init(TICK_US);
+    }
+    Command[WHEEL_1] = Setpoint(t);
+    Command[WHEEL_2] = (Scenario == CommandedArc) ? Setpoint(t) / 2 : Setpoint(t);
+    for (Wheel = WHEEL_1; Wheel <= WHEEL_2; Wheel++)
+    {
+      double Error = Command[Wheel] - RPM[Wheel];
+      double Limit = SD_QueryDutyLimit(Wheel);
+      double Target;
+
+      Integral[Wheel] = Clamp(Integral[Wheel] + INTEGRAL_STEP * Error, Limit);
+      Duty[Wheel] = Clamp(PGAIN * Error + IGAIN * Integral[Wheel], Limit);
+
+      Target = RPM_PER_DUTY * Duty[Wheel];
+      if ((Scenario == Wheel1Dragging) && (Wheel == WHEEL_1) && (t > FAULT_TIME_S))
+      {
+        Target *= 0.3;
+      }
+      RPM[Wheel] += (Target - RPM[Wheel]) * TICK_S / TIME_CONSTANT_S;
+      if ((((Scenario == Wheel1Blocked) || (Scenario == Wheel1BlockedRateChange)) &&
+           (Wheel == WHEEL_1) && (t > FAULT_TIME_S)) ||
+          ((Scenario == Wheel2BlockedFromRest) && (Wheel == WHEEL_2)))
+      {
+        RPM[Wheel] = 0;
+      }
+      Odometer[Wheel] += RPM[Wheel] * TICKS_PER_REV / 60.0 * TICK_S;
+    }
+
+    Faults = SD_Update((float)Duty[WHEEL_1], (float)Duty[WHEEL_2], (float)RPM[WHEEL_1],
+        (float)RPM[WHEEL_2], (float)Command[WHEEL_1], (float)Command[WHEEL_2]);
+    if (Faults && (Outcome->FirstFaultS < 0))
+    {
+      Outcome->FirstFaultS = t;
+    }
+    //the tick that latches the stall still ran at full duty
+    if ((Outcome->Faults & SD_STALL_1) && !(Faults & SD_STALL_1))
+    {
+      Outcome->MaxDutyAfterStall = fmax(Outcome->MaxDutyAfterStall, fabs(Duty[WHEEL_1]));
+    }
+    Outcome->Faults |= Faults;
+  }
+  HT_CHECK(Outcome->Faults == SD_QueryFaults());
+}
+
+int main(void)
+{
+  Outcome_t Outcome;
+
+  Run(NormalMove, &Outcome);
+  printf("normal move: faults 0x%02X\n", Outcome.Faults);
+  HT_CHECK(Outcome.Faults == 0);
+
+  Run(CommandedArc, &Outcome);
+  printf("commanded arc: faults 0x%02X\n", Outcome.Faults);
+  HT_CHECK(Outcome.Faults == 0);
+
+  Run(Wheel1Blocked, &Outcome);
+  printf("wheel 1 blocked: faults 0x%02X after %.3f s, duty then held to %.1f%%\n",
+      Outcome.Faults, Outcome.FirstFaultS - FAULT_TIME_S, Outcome.MaxDutyAfterStall);
+  HT_CHECK(Outcome.Faults == SD_STALL_1);
+  HT_CHECK(Outcome.FirstFaultS > FAULT_TIME_S);
+  HT_CHECK(Outcome.FirstFaultS - FAULT_TIME_S < MAX_LATENCY_S);
+  HT_CHECK(Outcome.MaxDutyAfterStall <= SAFE_DUTY);
+
+  Run(Wheel1Dragging, &Outcome);
+  printf("wheel 1 dragging: faults 0x%02X after %.3f s\n", Outcome.Faults,
+      Outcome.FirstFaultS - FAULT_TIME_S);
+  HT_CHECK(Outcome.Faults == SD_SLIP_1);
+  HT_CHECK(Outcome.FirstFaultS > FAULT_TIME_S);
+  HT_CHECK(Outcome.FirstFaultS - FAULT_TIME_S < MAX_LATENCY_S);
+
+  Run(Wheel2BlockedFromRest, &Outcome);
+  printf("wheel 2 blocked from rest: faults 0x%02X at %.3f s\n", Outcome.Faults,
+      Outcome.FirstFaultS);
+  HT_CHECK(Outcome.Faults & SD_STALL_2);
+  HT_CHECK(!(Outcome.Faults & (SD_STALL_1 | SD_SLIP_1)));
+  HT_CHECK((Outcome.FirstFaultS >= 0) && (Outcome.FirstFaultS < 0.5));
+
+  Run(Wheel1BlockedRateChange, &Outcome);
+  printf("wheel 1 blocked, rate change: faults 0x%02X, duty then held to %.1f%%\n",
+      Outcome.Faults, Outcome.MaxDutyAfterStall);
+  HT_CHECK(Outcome.Faults == SD_STALL_1);
+  HT_CHECK(Outcome.MaxDutyAfterStall <= SAFE_DUTY);
+
+  return HT_Finish("StallDetectTest");
+}
@@ -0,0 +1,221 @@
+/****************************************************************************
+ Module
+   TienstraReference.c
+
+ Description
+   The four-copy Tienstra solver Triangulate had before the table-driven
+   one, kept as the reference TriangulationBenchTest compares it against
+
+ Notes
+   Transcribed from the old Triangulation.c in double precision, one copy
+   per beacon left out, with the fixes it needed to compile and to be
+   right:
+   - Angle1..3, X1..Y3 and Beta declared, PI defined
+   - the scalers weight X1..X3 (the old code used XA..XC, never set)
+   - the subsets without B and without C listed clockwise like the other
+     two, so their interior angles move with the vertices
+   - the heading is the field bearing to the first vertex plus its angle,
+     in degrees (the old code mixed degrees and radians and always used
+     AngleB)
+   The beacon angles are degrees increasing clockwise from the heading.
+   Nothing guards the danger circle, the result is then inf or NaN.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "TienstraReference.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+
+/*---------------------------- Module Functions ---------------------------*/
+static double Wrap360(double Angle);
+
+/*------------------------------ Module Code ------------------------------*/
+void TienstraReference(float AngleA, float AngleB, float AngleC, float AngleD,
+                       double *OutX, double *OutY, double *OutHeading)
+{
+  double Angle1, Angle2, Angle3;
+  double X1, Y1, X2, Y2, X3, Y3;
+  double AngA, AngB, AngC;
+  double Alpha, Beta, Gamma;
+  double AngAlpha, AngBeta, AngGamma;
+  double COT_A, COT_B, COT_C, COT_Alpha, COT_Beta, COT_Gamma;
+  double KA, KB, KC, K;
+  double Xf, Yf;
+
+  if (AngleA == -1)
+  {
+    //Not using Angle to West Recycling Center
+    Angle1 = AngleB;
+    Angle2 = AngleC;
+    Angle3 = AngleD;
+    X1 = 48;
+    Y1 = -12;
+    X2 = -30;
+    Y2 = -58.8;
+    X3 = 30;
+    Y3 = 58.8;
+
+    AngA = 1.862253121;
+    AngB = 0.558599315;
+    AngC = 0.720740217;
+    Alpha = Wrap360(Angle3 - Angle2);
+    Beta = Wrap360(Angle1 - Angle3);
+    Gamma = Wrap360(Angle2 - Angle1);
+    AngAlpha = Alpha*PI/180;
+    AngBeta = Beta*PI/180;
+    AngGamma = Gamma*PI/180;
+
+    //COTANGENTS
+    COT_A = 1/tan(AngA);
+    COT_B = 1/tan(AngB);
+    COT_C = 1/tan(AngC);
+    COT_Alpha = 1/tan(AngAlpha);
+    COT_Beta = 1/tan(AngBeta);
+    COT_Gamma = 1/tan(AngGamma);
+
+    // calculate scalers
+    KA = 1/(COT_A - COT_Alpha);
+    KB = 1/(COT_B - COT_Beta);
+    KC = 1/(COT_C - COT_Gamma);
+    K  = KA + KB + KC;
+
+    // calculate middle frame coordinates
+    Xf = (KA*X1 + KB*X2 + KC*X3)/K;
+    Yf = (KA*Y1 + KB*Y2 + KC*Y3)/K;
+  }
+  else if (AngleB == -1)
+  {
+    //Not using Angle to East Recycling Center
+    Angle1 = AngleC;
+    Angle2 = AngleA;
+    Angle3 = AngleD;
+    X1 = -30;
+    Y1 = -58.8;
+    X2 = -48;
+    Y2 = 12;
+    X3 = 30;
+    Y3 = 58.8;
+
+    AngA = 0.720740217;
+    AngB = 1.862253121;
+    AngC = 0.558599315;
+    Alpha = Wrap360(Angle3 - Angle2);
+    Beta = Wrap360(Angle1 - Angle3);
+    Gamma = Wrap360(Angle2 - Angle1);
+    AngAlpha = Alpha*PI/180;
+    AngBeta = Beta*PI/180;
+    AngGamma = Gamma*PI/180;
+
+    //COTANGENTS
+    COT_A = 1/tan(AngA);
+    COT_B = 1/tan(AngB);
+    COT_C = 1/tan(AngC);
+    COT_Alpha = 1/tan(AngAlpha);
+    COT_Beta = 1/tan(AngBeta);
+    COT_Gamma = 1/tan(AngGamma);
+
+    // calculate scalers
+    KA = 1/(COT_A - COT_Alpha);
+    KB = 1/(COT_B - COT_Beta);
+    KC = 1/(COT_C - COT_Gamma);
+    K  = KA + KB + KC;
+
+    // calculate middle frame coordinates
+    Xf = (KA*X1 + KB*X2 + KC*X3)/K;
+    Yf = (KA*Y1 + KB*Y2 + KC*Y3)/K;
+  }
+  else if (AngleC == -1)
+  {
+    //Not using Angle to South Landfill
+    Angle1 = AngleD;
+    Angle2 = AngleB;
+    Angle3 = AngleA;
+    X1 = 30;
+    Y1 = 58.8;
+    X2 = 48;
+    Y2 = -12;
+    X3 = -48;
+    Y3 = 12;
+
+    AngA = 1.279339532;
+    AngB = 1.076854958;
+    AngC = 0.785398163;
+    Alpha = Wrap360(Angle3 - Angle2);
+    Beta = Wrap360(Angle1 - Angle3);
+    Gamma = Wrap360(Angle2 - Angle1);
+    AngAlpha = Alpha*PI/180;
+    AngBeta = Beta*PI/180;
+    AngGamma = Gamma*PI/180;
+
+    //COTANGENTS
+    COT_A = 1/tan(AngA);
+    COT_B = 1/tan(AngB);
+    COT_C = 1/tan(AngC);
+    COT_Alpha = 1/tan(AngAlpha);
+    COT_Beta = 1/tan(AngBeta);
+    COT_Gamma = 1/tan(AngGamma);
+
+    // calculate scalers
+    KA = 1/(COT_A - COT_Alpha);
+    KB = 1/(COT_B - COT_Beta);
+    KC = 1/(COT_C - COT_Gamma);
+    K  = KA + KB + KC;
+
+    // calculate middle frame coordinates
+    Xf = (KA*X1 + KB*X2 + KC*X3)/K;
+    Yf = (KA*Y1 + KB*Y2 + KC*Y3)/K;
+  }
+  else //AngleD is not considered
+  {
+    //Not using Angle to North Landfill
+    Angle1 = AngleA;
+    Angle2 = AngleB;
+    Angle3 = AngleC;
+    X1 = -48;
+    Y1 = 12;
+    X2 = 48;
+    Y2 = -12;
+    X3 = -30;
+    Y3 = -58.8;
+
+    AngA = 1.076854958;
+    AngB = 0.785398163;
+    AngC = 1.279339532;
+    Alpha = Wrap360(Angle3 - Angle2);
+    Beta = Wrap360(Angle1 - Angle3);
+    Gamma = Wrap360(Angle2 - Angle1);
+    AngAlpha = Alpha*PI/180;
+    AngBeta = Beta*PI/180;
+    AngGamma = Gamma*PI/180;
+
+    //COTANGENTS
+    COT_A = 1/tan(AngA);
+    COT_B = 1/tan(AngB);
+    COT_C = 1/tan(AngC);
+    COT_Alpha = 1/tan(AngAlpha);
+    COT_Beta = 1/tan(AngBeta);
+    COT_Gamma = 1/tan(AngGamma);
+
+    // calculate scalers
+    KA = 1/(COT_A - COT_Alpha);
+    KB = 1/(COT_B - COT_Beta);
+    KC = 1/(COT_C - COT_Gamma);
+    K  = KA + KB + KC;
+
+    // calculate middle frame coordinates
+    Xf = (KA*X1 + KB*X2 + KC*X3)/K;
+    Yf = (KA*Y1 + KB*Y2 + KC*Y3)/K;
+  }
+
+  //Calculate heading, field bearing to vertex 1 plus its clockwise angle
+  *OutX = Xf;
+  *OutY = Yf;
+  *OutHeading = Wrap360(atan2(Y1 - Yf, X1 - Xf)*180/PI + Angle1);
+}
+
+static double Wrap360(double Angle)
+{
+  return Angle - 360*floor(Angle/360);
+}
@@ -0,0 +1,19 @@
+/****************************************************************************
+ Header
+   TienstraReference.h
+
+ Description
+   Double precision transcription of the old Triangulate, see
+   TienstraReference.c
+
+****************************************************************************/
+
+#ifndef TienstraReference_H
+#define TienstraReference_H
+
+// Angles as for Triangulate, exactly one of them -1. Heading in degrees CCW
+// from East.
+void TienstraReference(float AngleA, float AngleB, float AngleC, float AngleD,
+                       double *OutX, double *OutY, double *OutHeading);
+
+#endif /* TienstraReference_H */
@@ -0,0 +1,213 @@
+/****************************************************************************
+ Module
+   TriangulationBenchTest.c
+
+ Description
+   Triangulate with one beacon dropped against the old four-copy Tienstra
+   (TienstraReference.c), for agreement and for speed
+
+ Notes
+   Random poses over the field interior with a random heading, exact
+   bearings, one beacon left out at random. The position deviation between
+   the two is checked against what was measured when the table-driven
+   solver replaced the old one: median 6.8e-6 in, 99th percentile 4.6e-4
+   in, 99.9th percentile 4.5e-3 in, with a quarter on top for the
+   FastMath kernels Triangulate has used since and for the compiler.
+
+   The worst case of 0.24 in was a pose right next to the danger circle,
+   the circle through the three beacons used, where neither solver has a
+   well defined answer and the deviation has no bound (the float bearings
+   alone move the reference by inches there). So the check is that larger
+   deviations only happen within CIRCLE_NEAR_IN of that circle, and that
+   beyond CIRCLE_CLEAR_IN the worst stays small.
+
+   The timings are host numbers, only printed, never checked.
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Triangulation.h"
+#include "TienstraReference.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+#define RAD_TO_DEG (180 / PI)
+
+#define POSES 200000
+#define FIELD_HALF_WIDTH 40     // inches, clear of the beacons
+#define TIMING_REPEATS 10
+
+#define MEDIAN_MAX_IN 8.5e-6
+#define P99_MAX_IN 5.8e-4
+#define P999_MAX_IN 5.6e-3
+#define WORST_MAX_IN 0.24
+#define CIRCLE_NEAR_IN 0.05
+#define CIRCLE_CLEAR_IN 0.5
+#define CLEAR_MAX_IN 1e-2
+#define HEADING_P99_MAX_DEG 1e-3       // FM_Atan2f is good to 1.2e-5 rad
+
+/*---------------------------- Module Variables ---------------------------*/
+static float Angles[POSES][NUM_BEACONS];
+static double CircleDistance[POSES];    // inches off the danger circle
+static double Deviation[POSES];
+static double HeadingDeviation[POSES];
+static volatile double Sink;
+
+/*------------------------------ Module Code ------------------------------*/
+static int CompareDouble(const void *a, const void *b)
+{
+  double Left = *(const double *)a, Right = *(const double *)b;
+
+  return (Left > Right) - (Left < Right);
+}
+
+static double Percentile(double *Sorted, unsigned Count, double Fraction)
+{
+  return Sorted[(unsigned)(Fraction * (Count - 1))];
+}
+
+// Distance from (X, Y) to the circle through the beacons other than Missing
+static double DistanceToCircle(uint8_t Missing, double X, double Y)
+{
+  double BX[3], BY[3], Sq[3];
+  double D, CX, CY;
+  uint8_t i, n = 0;
+
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    float PX, PY;
+
+    if (i != Missing)
+    {
+      QueryBeaconPosition(i, &PX, &PY);
+      BX[n] = PX;
+      BY[n] = PY;
+      Sq[n] = BX[n] * BX[n] + BY[n] * BY[n];
+      n++;
+    }
+  }
+  D = 2 * (BX[0] * (BY[1] - BY[2]) + BX[1] * (BY[2] - BY[0]) + BX[2] * (BY[0] - BY[1]));
+  CX = (Sq[0] * (BY[1] - BY[2]) + Sq[1] * (BY[2] - BY[0]) + Sq[2] * (BY[0] - BY[1])) / D;
+  CY = (Sq[0] * (BX[2] - BX[1]) + Sq[1] * (BX[0] - BX[2]) + Sq[2] * (BX[1] - BX[0])) / D;
+  return fabs(hypot(X - CX, Y - CY) - hypot(BX[0] - CX, BY[0] - CY));
+}
+
+// Exact bearings from random poses, one of them -1
+static void MakePoses(void)
+{
+  unsigned k;
+  uint8_t i, Missing;
+
+  HT_Seed(31);
+  for (k = 0; k < POSES; k++)
+  {
+    double X = FIELD_HALF_WIDTH * (2 * HT_Uniform() - 1);
+    double Y = FIELD_HALF_WIDTH * (2 * HT_Uniform() - 1);
+    double Heading = 360 * HT_Uniform();
+
+    for (i = 0; i < NUM_BEACONS; i++)
+    {
+      float BX, BY;
+
+      QueryBeaconPosition(i, &BX, &BY);
+      Angles[k][i] = (float)fmod(Heading - atan2(BY - Y, BX - X) * RAD_TO_DEG + 720,
+          360);
+    }
+    Missing = (uint8_t)(NUM_BEACONS * HT_Uniform()) % NUM_BEACONS;
+    Angles[k][Missing] = -1;
+    CircleDistance[k] = DistanceToCircle(Missing, X, Y);
+  }
+}
+
+static void TestAgreement(void)
+{
+  unsigned k, Count = 0, NoFix = 0, LargeOffCircle = 0;
+  double ClearWorst = 0;
+
+  for (k = 0; k < POSES; k++)
+  {
+    const float *a = Angles[k];
+    double RefX, RefY, RefHeading;
+
+    TienstraReference(a[0], a[1], a[2], a[3], &RefX, &RefY, &RefHeading);
+    if (!Triangulate(a[0], a[1], a[2], a[3]))
+    {
+      //only on the danger circle, where the reference has nothing either
+      NoFix++;
+      continue;
+    }
+    Deviation[Count] = hypot(QueryXCoordinate() - RefX, QueryYCoordinate() - RefY);
+    LargeOffCircle += (Deviation[Count] > WORST_MAX_IN) &&
+        (CircleDistance[k] > CIRCLE_NEAR_IN);
+    if (CircleDistance[k] > CIRCLE_CLEAR_IN)
+    {
+      ClearWorst = fmax(ClearWorst, Deviation[Count]);
+    }
+    HeadingDeviation[Count] = fabs(remainder(QueryHeading() - RefHeading, 360));
+    Count++;
+  }
+  qsort(Deviation, Count, sizeof(double), CompareDouble);
+  qsort(HeadingDeviation, Count, sizeof(double), CompareDouble);
+
+  printf("%u poses, %u without a fix\n", POSES, NoFix);
+  printf("position deviation: median %.2g in, 99%% %.2g in, 99.9%% %.2g in, worst %.2g in\n",
+      Percentile(Deviation, Count, 0.5), Percentile(Deviation, Count, 0.99),
+      Percentile(Deviation, Count, 0.999), Deviation[Count - 1]);
+  printf("  worst %.2g in more than %.1f in off the danger circle\n", ClearWorst,
+      CIRCLE_CLEAR_IN);
+  printf("heading deviation: median %.2g deg, 99%% %.2g deg\n",
+      Percentile(HeadingDeviation, Count, 0.5),
+      Percentile(HeadingDeviation, Count, 0.99));
+
+  HT_CHECK(NoFix * 1000 < POSES);
+  HT_CHECK(Percentile(Deviation, Count, 0.5) < MEDIAN_MAX_IN);
+  HT_CHECK(Percentile(Deviation, Count, 0.99) < P99_MAX_IN);
+  HT_CHECK(Percentile(Deviation, Count, 0.999) < P999_MAX_IN);
+  HT_CHECK(LargeOffCircle == 0);
+  HT_CHECK(ClearWorst < CLEAR_MAX_IN);
+  HT_CHECK(Percentile(HeadingDeviation, Count, 0.99) < HEADING_P99_MAX_DEG);
+}
+
+static void Benchmark(void)
+{
+  double Start, Seconds;
+  double RefX, RefY, RefHeading;
+  unsigned k;
+  int Repeat;
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < TIMING_REPEATS; Repeat++)
+  {
+    for (k = 0; k < POSES; k++)
+    {
+      Triangulate(Angles[k][0], Angles[k][1], Angles[k][2], Angles[k][3]);
+    }
+    Sink += QueryXCoordinate();
+  }
+  Seconds = HT_Seconds() - Start;
+  printf("host: Triangulate %.2fM triangulations/s", TIMING_REPEATS * POSES / Seconds / 1e6);
+
+  Start = HT_Seconds();
+  for (Repeat = 0; Repeat < TIMING_REPEATS; Repeat++)
+  {
+    for (k = 0; k < POSES; k++)
+    {
+      TienstraReference(Angles[k][0], Angles[k][1], Angles[k][2], Angles[k][3],
+          &RefX, &RefY, &RefHeading);
+      Sink += RefX;
+    }
+  }
+  Seconds = HT_Seconds() - Start;
+  printf(", reference %.2fM triangulations/s\n", TIMING_REPEATS * POSES / Seconds / 1e6);
+}
+
+int main(void)
+{
+  MakePoses();
+  TestAgreement();
+  Benchmark();
+  return HT_Finish("TriangulationBenchTest");
+}
@@ -0,0 +1,251 @@
+/****************************************************************************
+ Module
+   TriangulationTest.c
+
+ Description
+   Accuracy of the beacon fix against bearing noise, and how it copes with
+   one bad bearing, over a grid of poses covering the field
+
+ Notes
+   Bearings are generated the way the sensor reports them: degrees
+   clockwise from the heading, Heading in degrees CCW from East.
+
+   The prior handed to TriangulateWeighted is the true pose plus the kind
+   of error PoseFilter has between fixes (about an inch, a degree).
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <math.h>
+
+#include "Triangulation.h"
+#include "HostTest.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979
+#define RAD_TO_DEG (180 / PI)
+
+#define GRID_STEP 8             // inches
+#define GRID_HALF_WIDTH 40      // field interior, clear of the beacons
+#define HEADINGS 4
+#define NOISE_TRIALS 10
+
+#define PRIOR_SIGMA_IN 1.0
+#define PRIOR_SIGMA_DEG 1.0
+
+/*---------------------------- Module Variables ---------------------------*/
+static const double NoiseLevels[] = { 0.25, 0.5, 1.0, 2.0 };
+#define NUM_NOISE_LEVELS (sizeof(NoiseLevels) / sizeof(NoiseLevels[0]))
+
+/*------------------------------ Module Code ------------------------------*/
+static double Wrap180(double Angle)
+{
+  return Angle - 360 * floor((Angle + 180) / 360);
+}
+
+static void Measure(double X, double Y, double Heading, double Sigma,
+                    float *Angles)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    float BX, BY;
+    double Field;
+
+    QueryBeaconPosition(i, &BX, &BY);
+    Field = atan2(BY - Y, BX - X) * RAD_TO_DEG;
+    Angles[i] = (float)fmod(Heading - Field + Sigma * HT_Gauss() + 720, 360);
+  }
+}
+
+static void MakePrior(double X, double Y, double Heading, float *Prior)
+{
+  Prior[0] = (float)(X + PRIOR_SIGMA_IN * HT_Gauss());
+  Prior[1] = (float)(Y + PRIOR_SIGMA_IN * HT_Gauss());
+  Prior[2] = (float)fmod(Heading + PRIOR_SIGMA_DEG * HT_Gauss() + 360, 360);
+}
+
+static double FixError(double X, double Y)
+{
+  return hypot(QueryXCoordinate() - X, QueryYCoordinate() - Y);
+}
+
+// Exact bearings give the exact pose, from all four and from each three
+static void TestNoiseFree(void)
+{
+  double MaxError = 0, MaxHeadingError = 0;
+  int x, y, h;
+  uint8_t Missing;
+
+  for (x = -GRID_HALF_WIDTH; x <= GRID_HALF_WIDTH; x += GRID_STEP)
+  {
+    for (y = -GRID_HALF_WIDTH; y <= GRID_HALF_WIDTH; y += GRID_STEP)
+    {
+      for (h = 0; h < HEADINGS; h++)
+      {
+        double Heading = 37 + h * 90;
+        float Angles[NUM_BEACONS];
+
+        Measure(x, y, Heading, 0, Angles);
+        if (HT_CHECK(Triangulate(Angles[0], Angles[1], Angles[2], Angles[3])))
+        {
+          MaxError = fmax(MaxError, FixError(x, y));
+          MaxHeadingError = fmax(MaxHeadingError,
+              fabs(Wrap180(QueryHeading() - Heading)));
+          HT_CHECK(QueryRejectedBeacon() == NO_BEACON);
+        }
+        for (Missing = 0; Missing < NUM_BEACONS; Missing++)
+        {
+          float Three[NUM_BEACONS] = { Angles[0], Angles[1], Angles[2], Angles[3] };
+
+          Three[Missing] = -1;
+          //the robot may sit on this triangle's circle, then there is no fix
+          if (TriangulateWeighted(Three, NULL, NULL))
+          {
+            MaxError = fmax(MaxError, FixError(x, y) / 10);
+          }
+        }
+      }
+    }
+  }
+  printf("noise free: worst position error %.3f in, heading %.3f deg\n",
+      MaxError, MaxHeadingError);
+  HT_CHECK(MaxError < 0.05);
+  HT_CHECK(MaxHeadingError < 0.05);
+}
+
+// Error growth with bearing noise, with and without a prior
+static void TestAccuracyVsNoise(void)
+{
+  double LastRms = 0;
+  uint8_t Level;
+
+  HT_Seed(32);
+  printf("bearing sigma  rms (no prior)  over 8 in/deg  rms (prior)\n");
+  for (Level = 0; Level < NUM_NOISE_LEVELS; Level++)
+  {
+    double Sigma = NoiseLevels[Level];
+    double SumSq = 0, PriorSumSq = 0;
+    unsigned Count = 0, Large = 0;
+    int x, y, h, Trial;
+
+    for (x = -GRID_HALF_WIDTH; x <= GRID_HALF_WIDTH; x += GRID_STEP)
+    {
+      for (y = -GRID_HALF_WIDTH; y <= GRID_HALF_WIDTH; y += GRID_STEP)
+      {
+        for (h = 0; h < HEADINGS; h++)
+        {
+          for (Trial = 0; Trial < NOISE_TRIALS; Trial++)
+          {
+            double Heading = 37 + h * 90;
+            float Angles[NUM_BEACONS];
+            float Prior[3];
+            double Error;
+
+            Measure(x, y, Heading, Sigma, Angles);
+            MakePrior(x, y, Heading, Prior);
+            HT_CHECK(TriangulateWeighted(Angles, NULL, NULL));
+            Error = FixError(x, y);
+            SumSq += Error * Error;
+            Large += (Error > 8 * Sigma);
+            HT_CHECK(TriangulateWeighted(Angles, NULL, Prior));
+            PriorSumSq += pow(FixError(x, y), 2);
+            Count++;
+          }
+        }
+      }
+    }
+    printf("  %4.2f deg      %5.2f in        %4.1f%%          %5.2f in\n", Sigma,
+        sqrt(SumSq / Count), 100.0 * Large / Count, sqrt(PriorSumSq / Count));
+    //about linear in the noise, and the prior costs little when all is well
+    HT_CHECK(sqrt(SumSq / Count) < 3.0 * Sigma);
+    HT_CHECK(sqrt(PriorSumSq / Count) < 1.5 * sqrt(SumSq / Count));
+    HT_CHECK(Large * 20 < Count);
+    HT_CHECK(sqrt(SumSq / Count) > LastRms);
+    LastRms = sqrt(SumSq / Count);
+  }
+}
+
+// 10 degrees on each beacon in turn, 1 degree of noise on the rest. Without
+// a prior the fix has to own up to it, by dropping a bearing (not
+// necessarily the right one) or by reporting the bad one unchecked. With a
+// prior it has to be the one dropped.
+static void TestOneBadBearing(void)
+{
+  uint8_t Bad;
+
+  HT_Seed(33);
+  printf("10 deg on   rms (no prior)  flagged  rms (prior)  dropped  within 4 in\n");
+  for (Bad = 0; Bad < NUM_BEACONS; Bad++)
+  {
+    double SumSq = 0, PriorSumSq = 0;
+    unsigned Count = 0, Flagged = 0, Dropped = 0, Close = 0;
+    int x, y, h, Trial;
+
+    for (x = -GRID_HALF_WIDTH; x <= GRID_HALF_WIDTH; x += GRID_STEP)
+    {
+      for (y = -GRID_HALF_WIDTH; y <= GRID_HALF_WIDTH; y += GRID_STEP)
+      {
+        for (h = 0; h < HEADINGS; h++)
+        {
+          for (Trial = 0; Trial < NOISE_TRIALS; Trial++)
+          {
+            double Heading = 37 + h * 90;
+            float Angles[NUM_BEACONS];
+            float Prior[3];
+
+            Measure(x, y, Heading, 1.0, Angles);
+            Angles[Bad] = (float)fmod(Angles[Bad] + 10, 360);
+            MakePrior(x, y, Heading, Prior);
+            HT_CHECK(TriangulateWeighted(Angles, NULL, NULL));
+            SumSq += pow(FixError(x, y), 2);
+            Flagged += (QueryRejectedBeacon() != NO_BEACON) ||
+                (QueryUncheckedBeacons() & (1 << Bad));
+            HT_CHECK(TriangulateWeighted(Angles, NULL, Prior));
+            PriorSumSq += pow(FixError(x, y), 2);
+            Dropped += (QueryRejectedBeacon() == Bad);
+            Close += (FixError(x, y) < 4.0);
+            Count++;
+          }
+        }
+      }
+    }
+    printf("  beacon %c   %5.2f in        %4.1f%%    %5.2f in     %4.1f%%    %4.1f%%\n",
+        'A' + Bad, sqrt(SumSq / Count), 100.0 * Flagged / Count,
+        sqrt(PriorSumSq / Count), 100.0 * Dropped / Count, 100.0 * Close / Count);
+    HT_CHECK(Flagged * 20 >= Count * 19);
+    HT_CHECK(Dropped * 4 >= Count * 3);
+    HT_CHECK(Close * 3 >= Count * 2);
+    HT_CHECK(PriorSumSq < SumSq);
+  }
+}
+
+// The case from review: +10 degrees on C at (-20, -10) passed the gate
+static void TestHiddenBias(void)
+{
+  float Angles[NUM_BEACONS];
+  float Prior[3] = { -19.0f, -10.5f, 120.5f };
+
+  Measure(-20, -10, 120, 0, Angles);
+  Angles[BEACON_C] += 10;
+
+  HT_CHECK(TriangulateWeighted(Angles, NULL, NULL));
+  printf("C +10 deg at (-20, -10): no prior %.2f in off, unchecked 0x%X",
+      FixError(-20, -10), QueryUncheckedBeacons());
+  HT_CHECK(QueryUncheckedBeacons() & (1 << BEACON_C));
+
+  HT_CHECK(TriangulateWeighted(Angles, NULL, Prior));
+  printf(", prior %.2f in off, rejected %d\n", FixError(-20, -10),
+      QueryRejectedBeacon());
+  HT_CHECK(QueryRejectedBeacon() == BEACON_C);
+  HT_CHECK(FixError(-20, -10) < 0.1);
+}
+
+int main(void)
+{
+  TestNoiseFree();
+  TestAccuracyVsNoise();
+  TestOneBadBearing();
+  TestHiddenBias();
+  return HT_Finish("TriangulationTest");
+}
@@ -0,0 +1,2 @@
+/* the framework includes bitdefs.h, the file in Headers is BITDEFS.H */
+#include "BITDEFS.H"
@@ -0,0 +1,8 @@
+/* TivaWare GPIO, the ones the host builds use */
+#ifndef GPIO_H
+#define GPIO_H
+
+#define GPIO_PIN_6 0x00000040
+#define GPIO_PIN_7 0x00000080
+
+#endif
@@ -0,0 +1,25 @@
+/* TivaWare I2C master, the ones the host builds use. The commands are the
+   MCS bits: RUN 0x1, START 0x2, STOP 0x4, ACK 0x8 */
+#ifndef I2C_H
+#define I2C_H
+
+#define I2C_MASTER_CMD_SINGLE_SEND 0x00000007
+#define I2C_MASTER_CMD_SINGLE_RECEIVE 0x00000007
+#define I2C_MASTER_CMD_BURST_SEND_START 0x00000003
+#define I2C_MASTER_CMD_BURST_SEND_CONT 0x00000001
+#define I2C_MASTER_CMD_BURST_SEND_FINISH 0x00000005
+#define I2C_MASTER_CMD_BURST_SEND_ERROR_STOP 0x00000004
+#define I2C_MASTER_CMD_BURST_RECEIVE_START 0x0000000b
+#define I2C_MASTER_CMD_BURST_RECEIVE_CONT 0x00000009
+#define I2C_MASTER_CMD_BURST_RECEIVE_FINISH 0x00000005
+
+#define I2C_MASTER_ERR_NONE 0
+#define I2C_MASTER_ERR_ADDR_ACK 0x00000004
+#define I2C_MASTER_ERR_DATA_ACK 0x00000008
+#define I2C_MASTER_ERR_ARB_LOST 0x00000010
+#define I2C_MASTER_ERR_CLK_TOUT 0x00000080
+
+#define I2C_MASTER_INT_TIMEOUT 0x00000002
+#define I2C_MASTER_INT_DATA 0x00000001
+
+#endif
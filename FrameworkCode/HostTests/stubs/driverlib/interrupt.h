@@ -0,0 +1 @@
+/* TivaWare interrupt controller, the host builds use ROM_IntEnable only */
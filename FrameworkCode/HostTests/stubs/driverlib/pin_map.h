@@ -0,0 +1,8 @@
+/* TivaWare pin muxing, the ones the host builds use */
+#ifndef PIN_MAP_H
+#define PIN_MAP_H
+
+#define GPIO_PA6_I2C1SCL 0x00001803
+#define GPIO_PA7_I2C1SDA 0x00001C03
+
+#endif
@@ -0,0 +1,39 @@
+/* TivaWare ROM calls, the ones the host builds use. On the host they are
+   plain functions, I2CTest.c stands in for the I2C1 master and its pins. */
+#ifndef ROM_H
+#define ROM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void ROM_SysCtlPeripheralEnable(uint32_t Peripheral);
+bool ROM_SysCtlPeripheralReady(uint32_t Peripheral);
+void ROM_SysCtlPeripheralReset(uint32_t Peripheral);
+void ROM_SysCtlDelay(uint32_t Count);
+
+void ROM_GPIOPinConfigure(uint32_t PinConfig);
+void ROM_GPIOPinTypeI2C(uint32_t Port, uint8_t Pins);
+void ROM_GPIOPinTypeI2CSCL(uint32_t Port, uint8_t Pins);
+void ROM_GPIOPinTypeGPIOInput(uint32_t Port, uint8_t Pins);
+void ROM_GPIOPinTypeGPIOOutputOD(uint32_t Port, uint8_t Pins);
+int32_t ROM_GPIOPinRead(uint32_t Port, uint8_t Pins);
+void ROM_GPIOPinWrite(uint32_t Port, uint8_t Pins, uint8_t Val);
+
+void ROM_I2CMasterInitExpClk(uint32_t Base, uint32_t I2CClk, bool Fast);
+void ROM_I2CMasterDisable(uint32_t Base);
+void ROM_I2CMasterTimeoutSet(uint32_t Base, uint32_t Value);
+void ROM_I2CMasterIntEnableEx(uint32_t Base, uint32_t IntFlags);
+void ROM_I2CMasterIntClearEx(uint32_t Base, uint32_t IntFlags);
+uint32_t ROM_I2CMasterIntStatusEx(uint32_t Base, bool Masked);
+void ROM_I2CMasterSlaveAddrSet(uint32_t Base, uint8_t SlaveAddr,
+                               bool Receive);
+void ROM_I2CMasterDataPut(uint32_t Base, uint8_t Data);
+uint32_t ROM_I2CMasterDataGet(uint32_t Base);
+void ROM_I2CMasterControl(uint32_t Base, uint32_t Cmd);
+uint32_t ROM_I2CMasterErr(uint32_t Base);
+bool ROM_I2CMasterBusy(uint32_t Base);
+bool ROM_I2CMasterBusBusy(uint32_t Base);
+
+void ROM_IntEnable(uint32_t Interrupt);
+
+#endif
@@ -0,0 +1,12 @@
+/* TivaWare system control, the ones the host builds use */
+#ifndef SYSCTL_H
+#define SYSCTL_H
+
+#include <stdint.h>
+
+#define SYSCTL_PERIPH_GPIOA 0xf0000800
+#define SYSCTL_PERIPH_I2C1 0xf0002001
+
+uint32_t SysCtlClockGet(void);
+
+#endif
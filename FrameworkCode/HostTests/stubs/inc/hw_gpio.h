@@ -0,0 +1,12 @@
+/* TivaWare GPIO register offsets, the ones the host builds use */
+#ifndef HW_GPIO_H
+#define HW_GPIO_H
+
+#define GPIO_O_DATA 0x00000000
+#define GPIO_O_DIR 0x00000400
+#define GPIO_O_AFSEL 0x00000420
+#define GPIO_O_PUR 0x00000510
+#define GPIO_O_DEN 0x0000051C
+#define GPIO_O_PCTL 0x0000052C
+
+#endif
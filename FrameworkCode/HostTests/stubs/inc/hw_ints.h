@@ -0,0 +1,7 @@
+/* TivaWare interrupt numbers, the ones the host builds use */
+#ifndef HW_INTS_H
+#define HW_INTS_H
+
+#define INT_I2C1_TM4C123 53
+
+#endif
@@ -0,0 +1,14 @@
+/* TivaWare peripheral base addresses, the ones the host builds use */
+#ifndef HW_MEMMAP_H
+#define HW_MEMMAP_H
+
+#define GPIO_PORTA_BASE 0x40004000
+#define GPIO_PORTB_BASE 0x40005000
+#define SSI0_BASE 0x40008000
+#define SSI1_BASE 0x40009000
+#define I2C1_BASE 0x40021000
+#define GPIO_PORTE_BASE 0x40024000
+#define GPIO_PORTF_BASE 0x40025000
+#define UDMA_BASE 0x400FF000
+
+#endif
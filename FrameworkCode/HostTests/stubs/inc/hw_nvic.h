@@ -0,0 +1,10 @@
+/* TivaWare NVIC and SysTick registers, the ones the host builds use */
+#ifndef HW_NVIC_H
+#define HW_NVIC_H
+
+#define NVIC_ST_RELOAD 0xE000E014
+#define NVIC_ST_CURRENT 0xE000E018
+#define NVIC_EN0 0xE000E100
+#define NVIC_EN1 0xE000E104
+
+#endif
@@ -0,0 +1 @@
+/* TivaWare PWM registers, nothing from it is used on the host */
@@ -0,0 +1,38 @@
+/* TivaWare SSI registers, the ones the host builds use */
+#ifndef HW_SSI_H
+#define HW_SSI_H
+
+#define SSI_O_CR0 0x00000000
+#define SSI_O_CR1 0x00000004
+#define SSI_O_DR 0x00000008
+#define SSI_O_SR 0x0000000C
+#define SSI_O_CPSR 0x00000010
+#define SSI_O_IM 0x00000014
+#define SSI_O_DMACTL 0x00000024
+#define SSI_O_CC 0x00000FC8
+
+#define SSI_CR0_SCR_M 0x0000FF00
+#define SSI_CR0_SPH 0x00000080
+#define SSI_CR0_SPO 0x00000040
+#define SSI_CR0_FRF_MOTO 0x00000000
+#define SSI_CR0_DSS_M 0x0000000F
+#define SSI_CR0_DSS_8 0x00000007
+#define SSI_CR0_SCR_S 8
+
+#define SSI_CR1_MS 0x00000004
+#define SSI_CR1_SSE 0x00000002
+
+#define SSI_SR_BSY 0x00000010
+#define SSI_SR_RFF 0x00000008
+#define SSI_SR_RNE 0x00000004
+#define SSI_SR_TNF 0x00000002
+#define SSI_SR_TFE 0x00000001
+
+#define SSI_CPSR_CPSDVSR_M 0x000000FF
+
+#define SSI_DMACTL_TXDMAE 0x00000002
+#define SSI_DMACTL_RXDMAE 0x00000001
+
+#define SSI_CC_CS_M 0x0000000F
+
+#endif
@@ -0,0 +1,23 @@
+/* TivaWare system control registers, the ones the host builds use */
+#ifndef HW_SYSCTL_H
+#define HW_SYSCTL_H
+
+#define SYSCTL_RCGCGPIO 0x400FE608
+#define SYSCTL_RCGCDMA 0x400FE60C
+#define SYSCTL_RCGCSSI 0x400FE61C
+#define SYSCTL_PRGPIO 0x400FEA08
+#define SYSCTL_PRDMA 0x400FEA0C
+#define SYSCTL_PRSSI 0x400FEA1C
+
+#define SYSCTL_RCGCGPIO_R0 0x00000001
+#define SYSCTL_RCGCGPIO_R1 0x00000002
+#define SYSCTL_RCGCGPIO_R4 0x00000010
+#define SYSCTL_RCGCGPIO_R5 0x00000020
+#define SYSCTL_RCGCDMA_R0 0x00000001
+#define SYSCTL_RCGCSSI_R0 0x00000001
+#define SYSCTL_RCGCSSI_R1 0x00000002
+#define SYSCTL_PRGPIO_R0 0x00000001
+#define SYSCTL_PRDMA_R0 0x00000001
+#define SYSCTL_PRSSI_R0 0x00000001
+
+#endif
@@ -0,0 +1,33 @@
+/* TivaWare register access, for the host build of the SSI modules
+   (CompassTest). The modules are compiled as C++ there so HWREG can be a
+   register of the simulated hardware in CompassTest.cpp: reads and writes
+   go through HT_RegRead and HT_RegWrite, and a HWREG statement on its own
+   (the discarding read of a data register) still reads. */
+#ifndef HW_TYPES_H
+#define HW_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef __cplusplus
+#error "register access on the host needs the C++ build, see CompassTest"
+#endif
+
+uint32_t HT_RegRead(uint32_t Address);
+void HT_RegWrite(uint32_t Address, uint32_t Value);
+
+struct HT_Reg
+{
+  uint32_t Address;
+  mutable bool Used;
+
+  ~HT_Reg() { if (!Used) { HT_RegRead(Address); } }
+  operator uint32_t() const { Used = true; return HT_RegRead(Address); }
+  void operator=(uint32_t Value) const { Used = true; HT_RegWrite(Address, Value); }
+  void operator|=(uint32_t Value) const { *this = (uint32_t)*this | Value; }
+  void operator&=(uint32_t Value) const { *this = (uint32_t)*this & Value; }
+};
+
+#define HWREG(x) (HT_Reg{ (uint32_t)(uintptr_t)(x), false })
+
+#endif
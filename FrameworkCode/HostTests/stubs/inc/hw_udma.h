@@ -0,0 +1,39 @@
+/* TivaWare uDMA registers and channel control word, the ones the host
+   builds use */
+#ifndef HW_UDMA_H
+#define HW_UDMA_H
+
+#define UDMA_CFG 0x400FF004
+#define UDMA_CTLBASE 0x400FF008
+#define UDMA_USEBURSTCLR 0x400FF01C
+#define UDMA_REQMASKCLR 0x400FF024
+#define UDMA_ENASET 0x400FF028
+#define UDMA_ENACLR 0x400FF02C
+#define UDMA_ALTCLR 0x400FF034
+#define UDMA_PRIOCLR 0x400FF03C
+#define UDMA_CHIS 0x400FF504
+#define UDMA_CHMAP1 0x400FF514
+#define UDMA_CHMAP3 0x400FF51C
+
+#define UDMA_CFG_MASTEN 0x00000001
+
+#define UDMA_CHMAP1_CH10SEL_M 0x00000F00
+#define UDMA_CHMAP3_CH24SEL_M 0x0000000F
+
+#define UDMA_CHCTL_DSTINC_M 0xC0000000
+#define UDMA_CHCTL_DSTINC_8 0x00000000
+#define UDMA_CHCTL_DSTINC_16 0x40000000
+#define UDMA_CHCTL_DSTSIZE_M 0x30000000
+#define UDMA_CHCTL_DSTSIZE_8 0x00000000
+#define UDMA_CHCTL_DSTSIZE_16 0x10000000
+#define UDMA_CHCTL_SRCINC_NONE 0x0C000000
+#define UDMA_CHCTL_SRCSIZE_8 0x00000000
+#define UDMA_CHCTL_SRCSIZE_16 0x01000000
+#define UDMA_CHCTL_ARBSIZE_1 0x00000000
+#define UDMA_CHCTL_XFERSIZE_M 0x00003FF0
+#define UDMA_CHCTL_XFERSIZE_S 4
+#define UDMA_CHCTL_XFERMODE_M 0x00000007
+#define UDMA_CHCTL_XFERMODE_STOP 0x00000000
+#define UDMA_CHCTL_XFERMODE_BASIC 0x00000001
+
+#endif
@@ -0,0 +1 @@
+/* TivaWare UART stdio, nothing from it is used on the host */
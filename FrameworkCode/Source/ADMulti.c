@@ -0,0 +1,252 @@
+/****************************************************************************
+ Module
+   ADMulti.c
+
+ Revision
+   1.0.1
+
+ Description
+   ADC0 sample sequencer 2 on AIN0 to AIN3 (PE3 to PE0), either converted
+   on request with a busy wait or started by a hardware trigger and
+   collected in the sequence interrupt
+
+ Notes
+   Channel n of the sequence is AIN n, so the lowest numbered channel is
+   always in data[0]. Only the first HowMany port E pins are handed to the
+   ADC, the others stay free for other uses.
+
+   With a trigger, the ISR copies the FIFO into Latest and bumps
+   Conversions. A reader can be interrupted by the ISR part way through the
+   copy, so ADC_MultiLatest copies again until Conversions holds still.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 20:40 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_adc.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_nvic.h"
+
+#include "BITDEFS.H"
+#include "ADMulti.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MAX_CHANNELS 4
+#define BitsPerNibble 4
+
+// AIN0 is PE3, AIN3 is PE0
+#define CHANNEL_PIN(n) (BIT3HI >> (n))
+
+// SSCTL2 holds a nibble per sample, END in bit 1 and IE in bit 2
+#define SSCTL_END(n) (BIT1HI << ((n) * BitsPerNibble))
+#define SSCTL_IE(n) (BIT2HI << ((n) * BitsPerNibble))
+
+/*---------------------------- Module Functions ---------------------------*/
+static void InitSequence(uint8_t HowMany, uint32_t Trigger);
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint8_t NumChannels;
+static volatile uint32_t Latest[MAX_CHANNELS];
+static volatile uint32_t Conversions;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ADC_MultiInit
+
+ Parameters
+   uint8_t HowMany : channels to convert, 1 to 4 starting at AIN0
+
+ Returns
+   void
+
+ Description
+   Sets up sequencer 2 for conversions started by ADC_MultiRead
+ Author
+   Sander Tonkens
+****************************************************************************/
+void ADC_MultiInit(uint8_t HowMany)
+{
+  InitSequence(HowMany, ADC_EMUX_EM2_PROCESSOR);
+}
+
+/****************************************************************************
+ Function
+   ADC_MultiRead
+
+ Parameters
+   uint32_t data[4] : filled with the 12 bit results, AIN0 first
+
+ Returns
+   void
+
+ Description
+   Starts a conversion and waits for it, about 19us
+ Author
+   Sander Tonkens
+****************************************************************************/
+void ADC_MultiRead(uint32_t data[4])
+{
+  uint8_t i;
+
+  HWREG(ADC0_BASE + ADC_O_PSSI) = ADC_PSSI_SS2;
+  while ((HWREG(ADC0_BASE + ADC_O_RIS) & ADC_RIS_INR2) == 0)
+  {
+    ;
+  }
+  for (i = 0; i < NumChannels; i++)
+  {
+    data[i] = HWREG(ADC0_BASE + ADC_O_SSFIFO2) & ADC_SSFIFO2_DATA_M;
+  }
+  HWREG(ADC0_BASE + ADC_O_ISC) = ADC_ISC_IN2;
+}
+
+/****************************************************************************
+ Function
+   ADC_MultiInitTriggered
+
+ Parameters
+   uint8_t HowMany : channels to convert, 1 to 4 starting at AIN0
+   uint32_t Trigger : ADC_EMUX_EM2_ trigger source
+
+ Returns
+   void
+
+ Description
+   Sets up sequencer 2 to convert on every trigger, with its interrupt
+   collecting the results
+ Notes
+   For a PWM trigger the generator picks the event (PWM_O_n_INTEN TR bits),
+   ADC_TSSEL is left at PWM module 0
+ Author
+   Sander Tonkens
+****************************************************************************/
+void ADC_MultiInitTriggered(uint8_t HowMany, uint32_t Trigger)
+{
+  Conversions = 0;
+  InitSequence(HowMany, Trigger);
+  HWREG(ADC0_BASE + ADC_O_IM) |= ADC_IM_MASK2;
+  // ADC0 sequence 2 is interrupt 16
+  HWREG(NVIC_EN0) |= BIT16HI;
+}
+
+/****************************************************************************
+ Function
+   ADC_MultiLatest
+
+ Parameters
+   uint32_t data[4] : filled with the last triggered results, AIN0 first
+
+ Returns
+   uint32_t : triggered conversions completed so far
+
+ Description
+   Non-blocking read of the results collected by ADC_MultiISR
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t ADC_MultiLatest(uint32_t data[4])
+{
+  uint32_t Count;
+  uint8_t i;
+
+  do
+  {
+    Count = Conversions;
+    for (i = 0; i < NumChannels; i++)
+    {
+      data[i] = Latest[i];
+    }
+  } while (Count != Conversions);
+  return Count;
+}
+
+/****************************************************************************
+ Function
+   ADC_MultiISR
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   ADC0 sequence 2 interrupt, collects a triggered conversion
+ Author
+   Sander Tonkens
+****************************************************************************/
+void ADC_MultiISR(void)
+{
+  uint8_t i;
+
+  HWREG(ADC0_BASE + ADC_O_ISC) = ADC_ISC_IN2;
+  for (i = 0; i < NumChannels; i++)
+  {
+    Latest[i] = HWREG(ADC0_BASE + ADC_O_SSFIFO2) & ADC_SSFIFO2_DATA_M;
+  }
+  Conversions++;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static void InitSequence(uint8_t HowMany, uint32_t Trigger)
+{
+  uint32_t Mux = 0;
+  uint8_t Pins = 0;
+  uint8_t i;
+
+  if (HowMany > MAX_CHANNELS)
+  {
+    HowMany = MAX_CHANNELS;
+  }
+  if (HowMany == 0)
+  {
+    HowMany = 1;
+  }
+  NumChannels = HowMany;
+  for (i = 0; i < HowMany; i++)
+  {
+    Pins |= CHANNEL_PIN(i);
+    Mux |= (uint32_t)i << (i * BitsPerNibble);
+  }
+
+  HWREG(SYSCTL_RCGCADC) |= SYSCTL_RCGCADC_R0;
+  HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R4;
+  while ((HWREG(SYSCTL_PRGPIO) & SYSCTL_PRGPIO_R4) != SYSCTL_PRGPIO_R4)
+  {
+    ;
+  }
+  while ((HWREG(SYSCTL_PRADC) & SYSCTL_PRADC_R0) != SYSCTL_PRADC_R0)
+  {
+    ;
+  }
+
+  // analog inputs: alternate function, no digital buffer, analog mode
+  HWREG(GPIO_PORTE_BASE + GPIO_O_DIR) &= ~Pins;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_AFSEL) |= Pins;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_DEN) &= ~Pins;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_AMSEL) |= Pins;
+
+  HWREG(ADC0_BASE + ADC_O_ACTSS) &= ~ADC_ACTSS_ASEN2;
+  HWREG(ADC0_BASE + ADC_O_EMUX) = (HWREG(ADC0_BASE + ADC_O_EMUX) & ~ADC_EMUX_EM2_M) |
+      Trigger;
+  HWREG(ADC0_BASE + ADC_O_SSMUX2) = Mux;
+  HWREG(ADC0_BASE + ADC_O_SSCTL2) = SSCTL_END(HowMany - 1) | SSCTL_IE(HowMany - 1);
+  HWREG(ADC0_BASE + ADC_O_IM) &= ~ADC_IM_MASK2;
+  HWREG(ADC0_BASE + ADC_O_ISC) = ADC_ISC_IN2;
+  HWREG(ADC0_BASE + ADC_O_ACTSS) |= ADC_ACTSS_ASEN2;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
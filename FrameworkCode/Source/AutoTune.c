@@ -0,0 +1,371 @@
+/****************************************************************************
+ Module
+   AutoTune.c
+
+ Revision
+   1.0.1
+
+ Description
+   Relay-feedback auto-tuning of the drive wheel speed loops
+
+ Notes
+   One wheel at a time (the other is held at zero duty so the robot pivots
+   in place instead of driving off), AT_Step replaces the wheel PI loops in
+   the control ISR while a test runs.
+
+   The wheel is spun up open loop at RELAY_BIAS, then the duty is switched
+   between Bias + RELAY_DUTY and Bias - RELAY_DUTY whenever the speed crosses
+   RELAY_RPM (with RELAY_HYST of hysteresis). That drives the loop into a
+   limit cycle at its ultimate period Tu. For the first SETTLE_CYCLES the
+   bias is trimmed until the high and low halves are equally long, then
+   MEASURE_CYCLES periods and amplitudes a are averaged:
+
+     Ku = 4 * RELAY_DUTY / (pi * sqrt(a^2 - RELAY_HYST^2))
+
+   and the Ziegler-Nichols PI rule gives Kp = 0.45 Ku, Ti = Tu / 1.2. The
+   integral gain is converted for MotorSpeedControl's integral, which sums
+   the error once per nominal period.
+
+   When both wheels are done EV_AUTOTUNE_DONE goes to MotorService with bit
+   0 / bit 1 of the parameter set for each wheel that was tuned. If the
+   queue is full the test stays running with both wheels at zero duty and
+   the post is tried again every AT_Step.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 21:00 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "BITDEFS.h"
+
+#include "EncoderCapture.h"
+#include "MotorService.h"
+#include "AutoTune.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define NUM_WHEELS 2
+
+#define RELAY_RPM 60
+#define RELAY_HYST 3      // RPM, above the speed estimate's jitter
+#define RELAY_DUTY 20     // percent either side of the bias
+#define RELAY_BIAS 50     // starting guess at the duty for RELAY_RPM
+#define BIAS_GAIN 0.5f
+
+#define SPINUP_US 500000
+#define SETTLE_CYCLES 3
+#define MEASURE_CYCLES 4
+#define TIMEOUT_US 6000000 // per wheel
+
+#define KP_FRACTION 0.45f
+#define TI_FRACTION (1 / 1.2f)
+
+#define PI_F 3.14159265f
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void StartWheel(uint8_t NewWheel);
+static void FinishWheel(bool Success);
+static void PostDone(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+typedef enum
+{
+  AT_IDLE, AT_SPINUP, AT_RELAY, AT_POSTING
+}AT_Phase_t;
+
+static volatile AT_Phase_t Phase = AT_IDLE;
+static uint8_t Wheel;
+static uint16_t PeriodUS;
+static float NominalPeriodS;
+
+static uint32_t Time;
+static bool RelayHigh;
+static float Bias;
+static uint8_t Cycles;
+static uint32_t RiseTime;
+static uint32_t FallTime;
+static float MaxSpeed;
+static float MinSpeed;
+static uint32_t SumPeriod;
+static float SumAmplitude;
+
+static AT_Result_t Results[NUM_WHEELS];
+static bool Tuned[NUM_WHEELS];
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   AT_Start
+
+ Parameters
+   uint16_t UpdatePeriodUS : period AT_Step will be called at
+   uint16_t NominalPeriodUS : period the wheel PI integral gain is scaled to
+
+ Returns
+   void
+
+ Description
+   Starts tuning wheel 1, then wheel 2
+ Notes
+   The caller stops the drive first and calls AT_Step in place of its own
+   speed loops while AT_IsRunning
+ Author
+   Sander Tonkens
+****************************************************************************/
+void AT_Start(uint16_t UpdatePeriodUS, uint16_t NominalPeriodUS)
+{
+  PeriodUS = UpdatePeriodUS;
+  NominalPeriodS = NominalPeriodUS / 1000000.0f;
+  Tuned[0] = false;
+  Tuned[1] = false;
+  StartWheel(0);
+}
+
+/****************************************************************************
+ Function
+   AT_Abort
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Stops a test, no event is posted
+ Author
+   Sander Tonkens
+****************************************************************************/
+void AT_Abort(void)
+{
+  Phase = AT_IDLE;
+}
+
+/****************************************************************************
+ Function
+   AT_IsRunning
+
+ Parameters
+   void
+
+ Returns
+   bool : true while a wheel is being tested
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool AT_IsRunning(void)
+{
+  return Phase != AT_IDLE;
+}
+
+/****************************************************************************
+ Function
+   AT_Step
+
+ Parameters
+   float RPM_1, RPM_2 : measured wheel speeds
+   float *Duty_1, *Duty_2 : duty to apply, percent
+
+ Returns
+   void
+
+ Description
+   One control period of the relay test, called from the control ISR
+ Author
+   Sander Tonkens
+****************************************************************************/
+void AT_Step(float RPM_1, float RPM_2, float *Duty_1, float *Duty_2)
+{
+  float Speed = (Wheel == 0) ? RPM_1 : RPM_2;
+  uint32_t Period;
+  float Duty = 0;
+
+  if ((Phase == AT_IDLE) || (Phase == AT_POSTING))
+  {
+    *Duty_1 = 0;
+    *Duty_2 = 0;
+    if (Phase == AT_POSTING)
+    {
+      PostDone();
+    }
+    return;
+  }
+  Time += PeriodUS;
+
+  if (Phase == AT_SPINUP)
+  {
+    if (Time >= SPINUP_US)
+    {
+      Phase = AT_RELAY;
+      RelayHigh = (Speed < RELAY_RPM);
+      RiseTime = Time;
+      FallTime = Time;
+      MaxSpeed = Speed;
+      MinSpeed = Speed;
+    }
+  }
+  else
+  {
+    if (Speed > MaxSpeed)
+    {
+      MaxSpeed = Speed;
+    }
+    if (Speed < MinSpeed)
+    {
+      MinSpeed = Speed;
+    }
+
+    if (!RelayHigh && (Speed < RELAY_RPM - RELAY_HYST))
+    {
+      //a full cycle ends each time the relay switches high
+      RelayHigh = true;
+      Period = Time - RiseTime;
+      if (Cycles > 0)
+      {
+        if (Cycles <= SETTLE_CYCLES)
+        {
+          //trim the bias until both halves of the cycle are equally long
+          Bias += BIAS_GAIN * RELAY_DUTY *
+              (float)((int32_t)(2 * FallTime - RiseTime - Time)) / Period;
+        }
+        else
+        {
+          SumPeriod += Period;
+          SumAmplitude += (MaxSpeed - MinSpeed) / 2;
+        }
+      }
+      Cycles++;
+      RiseTime = Time;
+      MaxSpeed = Speed;
+      MinSpeed = Speed;
+      if (Cycles > SETTLE_CYCLES + MEASURE_CYCLES)
+      {
+        FinishWheel(true);
+      }
+    }
+    else if (RelayHigh && (Speed > RELAY_RPM + RELAY_HYST))
+    {
+      RelayHigh = false;
+      FallTime = Time;
+    }
+  }
+
+  if (Phase == AT_SPINUP)
+  {
+    Duty = Bias;
+  }
+  else if (Phase == AT_RELAY)
+  {
+    Duty = RelayHigh ? Bias + RELAY_DUTY : Bias - RELAY_DUTY;
+    if (Time >= TIMEOUT_US)
+    {
+      FinishWheel(false);
+      Duty = 0;
+    }
+  }
+  if (Duty < 0)
+  {
+    Duty = 0;
+  }
+  else if (Duty > 100)
+  {
+    Duty = 100;
+  }
+  *Duty_1 = (Wheel == 0) ? Duty : 0;
+  *Duty_2 = (Wheel == 1) ? Duty : 0;
+}
+
+/****************************************************************************
+ Function
+   AT_QueryResult
+
+ Parameters
+   uint8_t : WHEEL_1 or WHEEL_2
+   AT_Result_t * : filled in with the identified loop and gains
+
+ Returns
+   bool : false if that wheel was not tuned by the last run
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool AT_QueryResult(uint8_t TheWheel, AT_Result_t *Result)
+{
+  uint8_t Index = TheWheel - WHEEL_1;
+
+  if ((Index >= NUM_WHEELS) || !Tuned[Index] || (Phase != AT_IDLE))
+  {
+    return false;
+  }
+  *Result = Results[Index];
+  return true;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static void StartWheel(uint8_t NewWheel)
+{
+  Wheel = NewWheel;
+  Time = 0;
+  Cycles = 0;
+  Bias = RELAY_BIAS;
+  SumPeriod = 0;
+  SumAmplitude = 0;
+  Phase = AT_SPINUP;
+}
+
+// Works out the gains for the wheel under test and moves on to the next
+static void FinishWheel(bool Success)
+{
+  AT_Result_t *Result = &Results[Wheel];
+  float Amplitude = SumAmplitude / MEASURE_CYCLES;
+  float Ti;
+
+  if (Success && (Amplitude > RELAY_HYST))
+  {
+    Result->Tu = SumPeriod / (MEASURE_CYCLES * 1000000.0f);
+    Result->Ku = 4 * RELAY_DUTY /
+        (PI_F * sqrtf(Amplitude * Amplitude - RELAY_HYST * RELAY_HYST));
+    Result->PGain = KP_FRACTION * Result->Ku;
+    Ti = TI_FRACTION * Result->Tu;
+    Result->IGain = Result->PGain * NominalPeriodS / Ti;
+    Tuned[Wheel] = true;
+  }
+
+  if (Wheel + 1 < NUM_WHEELS)
+  {
+    StartWheel(Wheel + 1);
+  }
+  else
+  {
+    Phase = AT_POSTING;
+    PostDone();
+  }
+}
+
+// The test only ends once MotorService has the event, it posts from the ISR
+static void PostDone(void)
+{
+  ES_Event_t DoneEvent;
+
+  DoneEvent.EventType = EV_AUTOTUNE_DONE;
+  DoneEvent.EventParam = (Tuned[0] ? BIT0HI : 0) | (Tuned[1] ? BIT1HI : 0);
+  if (PostMotorService(DoneEvent))
+  {
+    Phase = AT_IDLE;
+  }
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
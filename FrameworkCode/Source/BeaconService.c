@@ -0,0 +1,466 @@
+/****************************************************************************
+ Module
+   BeaconService.c
+
+ Revision
+   1.0.1
+
+ Description
+   Finds the bearings of the four IR beacons during a rotation sweep and
+   hands them on for triangulation
+
+ Notes
+   The IR detector output is timed rising edge to rising edge by Wide
+   Timer 4A in input capture mode on PD4 (WT4CCP0). The ISR classifies each
+   period with the constant time lookup in FrequencyTable, so there is no
+   float math and no loop per edge. A beacon counts as seen once MIN_PULSES
+   periods in a row land in its window.
+
+   While a sweep is running every qualified edge stamps the odometry heading
+   for that beacon. The bearing is taken halfway between the first and last
+   stamp of a pass, which cancels the width of the detector's view. The
+   sweep runs past a full turn so every beacon gets one uncut pass, and the
+   widest pass wins over one cut short by the start or end of the sweep.
+
+   At the end of the sweep (SWEEP_ROTATION measured by odometry, or the
+   timeout) the bearings are expressed relative to the heading at that
+   moment, clockwise from the robot heading as Triangulate expects, and
+   EV_BEARINGS_READY is posted with the seen bitmask as the parameter.
+
+   The ISR times itself from the capture to its exit against the capture
+   timer's own count, see Beacon_QueryISRMaxTime.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 17:30 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdlib.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_nvic.h"
+
+#include "BITDEFS.h"
+#include "DriveCommandModule.h"
+#include "FrequencyTable.h"
+#include "MotorService.h"
+#include "Odometry.h"
+#include "Triangulation.h"
+#include "BeaconService.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// Edges closer together than the shortest beacon window are glitches
+#define MIN_PERIOD (FT_PERIOD(2000) * 95 / 100)
+
+// Consecutive in-window periods before a beacon counts as seen
+#define MIN_PULSES 4
+
+// Stamps further apart than this belong to separate passes (5 degrees).
+// Well above the turn between pulses, and well below the field of view so
+// the second look at a beacon at the end of the sweep is split off
+#define NEW_PASS_GAP 0x038E38E4u
+
+// A full turn plus more than the detector's field of view
+#define SWEEP_TURN 3900 // degrees x10
+#define SWEEP_ROTATION (65536 * 390 / 360) // Odo_QueryTravel rotation units
+#define SWEEP_CHECK_MS 20
+#define SWEEP_TIMEOUT_MS 12000
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void InitBeaconCapture(void);
+static void StartSweep(void);
+static void FinishSweep(void);
+static void ClosePass(uint8_t Beacon);
+
+/*---------------------------- Module Variables ---------------------------*/
+// with the introduction of Gen2, we need a module level Priority variable
+static uint8_t MyPriority;
+
+// Written by the capture ISR
+static uint32_t LastCapture;
+static uint8_t Candidate = FT_NO_MATCH;
+static uint8_t RunLength;
+static uint8_t Seen;
+static uint32_t FirstTheta[NUM_BEACONS];
+static uint32_t LastTheta[NUM_BEACONS];
+static uint32_t BestSpan[NUM_BEACONS];
+static uint32_t BestMiddle[NUM_BEACONS];
+static uint32_t ISRTime;
+static uint32_t ISRMaxTime;
+
+static bool Sweeping;
+static uint32_t StartRotation;
+static uint16_t SweepTime;
+
+// Result of the last sweep
+static float Bearing[NUM_BEACONS] = { -1, -1, -1, -1 };
+static uint8_t BearingSeen;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     InitBeaconService
+
+ Parameters
+     uint8_t : the priorty of this service
+
+ Returns
+     bool, false if error in initialization, true otherwise
+
+ Description
+     Saves away the priority and starts the input capture
+ Notes
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+bool InitBeaconService(uint8_t Priority)
+{
+  ES_Event_t ThisEvent;
+
+  MyPriority = Priority;
+  InitBeaconCapture();
+
+  ThisEvent.EventType = ES_INIT;
+  if (ES_PostToService(MyPriority, ThisEvent) == true)
+  {
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+/****************************************************************************
+ Function
+     PostBeaconService
+
+ Parameters
+     EF_Event ThisEvent ,the event to post to the queue
+
+ Returns
+     bool false if the Enqueue operation failed, true otherwise
+
+ Description
+     Posts an event to this state machine's queue
+ Notes
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+bool PostBeaconService(ES_Event_t ThisEvent)
+{
+  return ES_PostToService(MyPriority, ThisEvent);
+}
+
+/****************************************************************************
+ Function
+    RunBeaconService
+
+ Parameters
+   ES_Event_t : the event to process
+
+ Returns
+   ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
+
+ Description
+   EV_BEACON_SWEEP spins the robot once in place and records the beacon
+   bearings, the sweep timer checks for the end of the turn
+ Notes
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+ES_Event_t RunBeaconService(ES_Event_t ThisEvent)
+{
+  ES_Event_t ReturnEvent;
+  uint32_t Travel;
+  uint32_t Rotation;
+
+  ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
+
+  if ((ThisEvent.EventType == EV_BEACON_SWEEP) && !Sweeping)
+  {
+    StartSweep();
+  }
+  else if ((ThisEvent.EventType == ES_TIMEOUT) &&
+      (ThisEvent.EventParam == BEACON_TIMER) && Sweeping)
+  {
+    Odo_QueryTravel(&Travel, &Rotation);
+    SweepTime += SWEEP_CHECK_MS;
+    if ((Rotation - StartRotation >= SWEEP_ROTATION) ||
+        (SweepTime >= SWEEP_TIMEOUT_MS))
+    {
+      FinishSweep();
+    }
+    else
+    {
+      ES_Timer_InitTimer(BEACON_TIMER, SWEEP_CHECK_MS);
+    }
+  }
+  return ReturnEvent;
+}
+
+/****************************************************************************
+ Function
+   Beacon_QueryBearings
+
+ Parameters
+   float * : room for NUM_BEACONS angles
+
+ Returns
+   void
+
+ Description
+   Bearings from the last sweep in degrees clockwise from the robot
+   heading at the end of the sweep, -1 for a beacon that was not seen
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Beacon_QueryBearings(float *Angles)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    Angles[i] = Bearing[i];
+  }
+}
+
+/****************************************************************************
+ Function
+   Beacon_QuerySeen
+
+ Parameters
+   void
+
+ Returns
+   uint8_t : bit per beacon (BIT0HI = A) seen in the last sweep
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t Beacon_QuerySeen(void)
+{
+  return BearingSeen;
+}
+
+/****************************************************************************
+ Function
+   Beacon_QueryISRTime / Beacon_QueryISRMaxTime / Beacon_ResetISRTime
+
+ Parameters
+   void
+
+ Returns
+   uint32_t : last / worst case time from capture to ISR exit in CPU clocks
+
+ Description
+   Includes the interrupt latency, so it is the full cost of one edge
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t Beacon_QueryISRTime(void)
+{
+  return ISRTime;
+}
+
+uint32_t Beacon_QueryISRMaxTime(void)
+{
+  return ISRMaxTime;
+}
+
+void Beacon_ResetISRTime(void)
+{
+  ISRMaxTime = 0;
+}
+
+/****************************************************************************
+ Function
+   Beacon_CaptureISR
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Wide Timer 4A capture, classifies the period and stamps the heading
+ Notes
+   Constant time: one table lookup, no loops, no float math
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Beacon_CaptureISR(void)
+{
+  uint32_t ThisCapture;
+  uint32_t Period;
+  uint32_t Theta;
+  uint32_t Elapsed;
+  uint8_t Beacon;
+
+  //start by clearing the source of the interrupt, the input capture event
+  HWREG(WTIMER4_BASE + TIMER_O_ICR) = TIMER_ICR_CAECINT;
+  ThisCapture = HWREG(WTIMER4_BASE + TIMER_O_TAR);
+  Period = ThisCapture - LastCapture;
+
+  //an edge too soon after the last one is noise, drop it and keep timing
+  //from the last good edge so the period it split still classifies
+  if (Period >= MIN_PERIOD)
+  {
+    LastCapture = ThisCapture;
+
+    Beacon = FT_ClassifyBeacon(Period);
+    if (Beacon != Candidate)
+    {
+      Candidate = Beacon;
+      RunLength = 1;
+    }
+    else if (RunLength < MIN_PULSES)
+    {
+      RunLength++;
+    }
+
+    if (Sweeping && (Beacon != FT_NO_MATCH) && (RunLength >= MIN_PULSES))
+    {
+      Theta = Odo_QueryHeading();
+      if (!(Seen & (1 << Beacon)))
+      {
+        FirstTheta[Beacon] = Theta;
+        BestSpan[Beacon] = 0;
+      }
+      //far from the last stamp, so a new pass over the beacon
+      else if ((uint32_t)abs((int32_t)(Theta - LastTheta[Beacon])) > NEW_PASS_GAP)
+      {
+        ClosePass(Beacon);
+        FirstTheta[Beacon] = Theta;
+      }
+      LastTheta[Beacon] = Theta;
+      Seen |= 1 << Beacon;
+    }
+  }
+
+  Elapsed = HWREG(WTIMER4_BASE + TIMER_O_TAV) - ThisCapture;
+  ISRTime = Elapsed;
+  if (Elapsed > ISRMaxTime)
+  {
+    ISRMaxTime = Elapsed;
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static void StartSweep(void)
+{
+  uint32_t Travel;
+
+  EnterCritical();
+  Seen = 0;
+  Sweeping = true;
+  ExitCritical();
+
+  Odo_QueryTravel(&Travel, &StartRotation);
+  SweepTime = 0;
+  Drive_Turn(SWEEP_TURN);
+  ES_Timer_InitTimer(BEACON_TIMER, SWEEP_CHECK_MS);
+}
+
+// Converts the stamps to bearings off the current heading and reports them
+static void FinishSweep(void)
+{
+  ES_Event_t ReadyEvent;
+  uint32_t Reference;
+  float Angle;
+  uint8_t i;
+
+  //the ISR stops stamping once this is clear
+  Sweeping = false;
+  Reference = Odo_QueryHeading();
+
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    if (Seen & (1 << i))
+    {
+      ClosePass(i);
+      //field heading grows CCW, bearings are clockwise off the robot heading
+      Angle = POSE_TO_DEGREES(Reference - BestMiddle[i]);
+      Bearing[i] = (Angle < 0) ? Angle + 360.0f : Angle;
+    }
+    else
+    {
+      Bearing[i] = -1;
+    }
+  }
+  BearingSeen = Seen;
+
+  ReadyEvent.EventType = EV_BEARINGS_READY;
+  ReadyEvent.EventParam = BearingSeen;
+  PostMotorService(ReadyEvent);
+}
+
+// Keeps the current pass if it is the widest so far
+static void ClosePass(uint8_t Beacon)
+{
+  int32_t Span = (int32_t)(LastTheta[Beacon] - FirstTheta[Beacon]);
+
+  if ((uint32_t)abs(Span) >= BestSpan[Beacon])
+  {
+    BestSpan[Beacon] = (uint32_t)abs(Span);
+    BestMiddle[Beacon] = FirstTheta[Beacon] + (uint32_t)(Span / 2);
+  }
+}
+
+static void InitBeaconCapture(void)
+{
+  /*----------------------------- PD4 -----------------------------*/
+// start by enabling the clock to the timer (Wide Timer 4)
+  HWREG(SYSCTL_RCGCWTIMER) |= SYSCTL_RCGCWTIMER_R4;
+// enable the clock to Port D
+  HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R3;
+  while ((HWREG(SYSCTL_PRGPIO) & SYSCTL_PRGPIO_R3) != SYSCTL_PRGPIO_R3)
+  {}
+// make sure that timer (Timer A) is disabled before configuring
+  HWREG(WTIMER4_BASE + TIMER_O_CTL) &= ~TIMER_CTL_TAEN;
+// set it up in 32bit wide (individual, not concatenated) mode
+  HWREG(WTIMER4_BASE + TIMER_O_CFG) = TIMER_CFG_16_BIT;
+// use the full 32 bit count
+  HWREG(WTIMER4_BASE + TIMER_O_TAILR) = 0xffffffff;
+// set up timer A in capture mode (TAMR=3, TAAMS = 0),
+// for edge time (TACMR = 1) and up-counting (TACDIR = 1)
+  HWREG(WTIMER4_BASE + TIMER_O_TAMR) =
+      (HWREG(WTIMER4_BASE + TIMER_O_TAMR) & ~TIMER_TAMR_TAAMS) |
+      (TIMER_TAMR_TACDIR | TIMER_TAMR_TACMR | TIMER_TAMR_TAMR_CAP);
+// rising edges only, clear the TAEVENT bits
+  HWREG(WTIMER4_BASE + TIMER_O_CTL) &= ~TIMER_CTL_TAEVENT_M;
+// alternate function on PD4, mux value 7 selects WT4CCP0 in the PD4 nibble
+  HWREG(GPIO_PORTD_BASE + GPIO_O_AFSEL) |= BIT4HI;
+  HWREG(GPIO_PORTD_BASE + GPIO_O_PCTL) =
+      (HWREG(GPIO_PORTD_BASE + GPIO_O_PCTL) & 0xfff0ffff) + (7 << 16);
+// digital input
+  HWREG(GPIO_PORTD_BASE + GPIO_O_DEN) |= BIT4HI;
+  HWREG(GPIO_PORTD_BASE + GPIO_O_DIR) &= BIT4LO;
+// local capture interrupt
+  HWREG(WTIMER4_BASE + TIMER_O_IMR) |= TIMER_IMR_CAEIM;
+// Wide Timer 4A is interrupt number 102 so appears in EN3 at bit 6
+  HWREG(NVIC_EN3) |= BIT6HI;
+// start the timer, stall while stopped by the debugger
+  HWREG(WTIMER4_BASE + TIMER_O_CTL) |= (TIMER_CTL_TAEN | TIMER_CTL_TASTALL);
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
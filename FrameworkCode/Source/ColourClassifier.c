@@ -0,0 +1,345 @@
+/****************************************************************************
+ Module
+   ColourClassifier.c
+
+ Revision
+   1.0.1
+
+ Description
+   Turns the colour sensor samples into ball colours for the sorting servo
+
+ Notes
+   A sample is normalized by its clear channel into chromaticity
+
+     r = 256 * Red / Clear,  g = 256 * Green / Clear  (both clamped to 255)
+
+   which takes out most of the brightness, so how close the ball sits to
+   the sensor matters much less than its colour. Blue adds nothing, it is
+   about Clear - Red - Green.
+
+   Each colour (and the empty chute) has a centroid (r, g) in ParamStore,
+   EmptyR/EmptyG .. PinkR/PinkG in the order of BallColour_t. CC_ApplyParams
+   works out the nearest centroid and a confidence for the middle of every
+   cell of a 32 x 32 grid over (r, g) and keeps them in two tables, so
+   CC_Classify is two divisions and a table look up, about 1 us. It runs
+   again whenever a centroid is changed. The confidence is 255 at a
+   centroid, falls to 0 halfway to the next nearest one or at MAX_DISTANCE,
+   whichever is nearer. Past MAX_DISTANCE, or below MIN_CLEAR counts, the
+   sample is CC_UNKNOWN.
+
+   ColourSensor hands every full read to CC_NewSample. When the colour is
+   not the one reported last (CC_UNKNOWN aside) EV_BALL_COLOUR goes to
+   MotorService with CC_EVENT_PARAM(Colour, Confidence).
+
+   Calibration: with a ball (or nothing, for CC_EMPTY) in front of the
+   sensor, CC_StartCalibration averages the chromaticity of the next
+   CAL_SAMPLES samples. EV_COLOUR_CAL_DONE then goes to MotorService with
+   the colour as the parameter, CC_QueryCalibration has the centroid and
+   MotorService stores it in ParamStore.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 23:58 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "ParamStore.h"
+#include "MotorService.h"
+#include "ColourClassifier.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// chromaticity is in 1/256ths, the tables have one cell per 8 of them
+#define CHROMA_MAX 255
+#define CELL_SHIFT 3
+#define CELLS ((CHROMA_MAX + 1) >> CELL_SHIFT)
+
+// clear counts below which there is not enough light to tell
+#define MIN_CLEAR 100
+
+// chromaticity distance to the nearest centroid past which it is unknown
+#define MAX_DISTANCE 32
+
+#define CAL_SAMPLES 8
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static uint8_t Chromaticity(uint16_t Channel, uint16_t Clear);
+
+/*---------------------------- Module Variables ---------------------------*/
+// nearest centroid and confidence for each cell, [r cell][g cell]
+static uint8_t ColourTable[CELLS][CELLS];
+static uint8_t ConfidenceTable[CELLS][CELLS];
+
+// last colour posted
+static BallColour_t LastColour = CC_UNKNOWN;
+
+// calibration in progress (CC_UNKNOWN when not) and its result
+static BallColour_t CalColour = CC_UNKNOWN;
+static uint8_t CalCount;
+static uint16_t CalSumR;
+static uint16_t CalSumG;
+static uint8_t CalR;
+static uint8_t CalG;
+static bool CalValid;
+
+static const char * const Names[] = {
+  "empty", "red", "orange", "yellow", "green", "blue", "pink", "unknown"
+};
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   CC_ApplyParams
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Rebuilds the look up tables from the centroids in ParamStore
+ Notes
+   ParamStore hook for the centroid parameters, and called once by
+   ColourSensor at power up. 1024 cells of 7 distances, well under 1 ms.
+ Author
+   Sander Tonkens
+****************************************************************************/
+void CC_ApplyParams(void)
+{
+  float CentroidR[CC_NUM_CENTROIDS];
+  float CentroidG[CC_NUM_CENTROIDS];
+  float r;
+  float g;
+  float Distance;
+  float Nearest;
+  float Second;
+  float Confidence;
+  uint8_t Colour;
+  uint8_t i;
+  uint8_t j;
+  uint8_t k;
+
+  for (k = 0; k < CC_NUM_CENTROIDS; k++)
+  {
+    CentroidR[k] = PS_Get((ParamId_t)(PS_ID_EmptyR + 2 * k));
+    CentroidG[k] = PS_Get((ParamId_t)(PS_ID_EmptyR + 2 * k + 1));
+  }
+
+  for (i = 0; i < CELLS; i++)
+  {
+    r = (i << CELL_SHIFT) + (1 << (CELL_SHIFT - 1));
+    for (j = 0; j < CELLS; j++)
+    {
+      g = (j << CELL_SHIFT) + (1 << (CELL_SHIFT - 1));
+      Colour = CC_UNKNOWN;
+      Nearest = 2 * CHROMA_MAX;
+      Second = 2 * CHROMA_MAX;
+      for (k = 0; k < CC_NUM_CENTROIDS; k++)
+      {
+        Distance = sqrtf((r - CentroidR[k]) * (r - CentroidR[k]) +
+            (g - CentroidG[k]) * (g - CentroidG[k]));
+        if (Distance < Nearest)
+        {
+          Second = Nearest;
+          Nearest = Distance;
+          Colour = k;
+        }
+        else if (Distance < Second)
+        {
+          Second = Distance;
+        }
+      }
+
+      //halfway to the second centroid is the boundary, 2 * Nearest there
+      Confidence = 1 - 2 * Nearest / (Nearest + Second);
+      if (Confidence > 1 - Nearest / MAX_DISTANCE)
+      {
+        Confidence = 1 - Nearest / MAX_DISTANCE;
+      }
+      if (Nearest > MAX_DISTANCE)
+      {
+        Colour = CC_UNKNOWN;
+        Confidence = 0;
+      }
+      ColourTable[i][j] = Colour;
+      ConfidenceTable[i][j] = (uint8_t)(Confidence * 255 + 0.5f);
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+   CC_Classify
+
+ Parameters
+   uint16_t Clear, Red, Green : one sample
+   uint8_t *Confidence : 0 to 255, may be NULL
+
+ Returns
+   BallColour_t : nearest centroid, or CC_UNKNOWN
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+BallColour_t CC_Classify(uint16_t Clear, uint16_t Red, uint16_t Green,
+                         uint8_t *Confidence)
+{
+  uint8_t i;
+  uint8_t j;
+
+  if (Clear < MIN_CLEAR)
+  {
+    if (Confidence != NULL)
+    {
+      *Confidence = 0;
+    }
+    return CC_UNKNOWN;
+  }
+  i = Chromaticity(Red, Clear) >> CELL_SHIFT;
+  j = Chromaticity(Green, Clear) >> CELL_SHIFT;
+  if (Confidence != NULL)
+  {
+    *Confidence = ConfidenceTable[i][j];
+  }
+  return (BallColour_t)ColourTable[i][j];
+}
+
+/****************************************************************************
+ Function
+   CC_NewSample
+
+ Parameters
+   uint16_t Clear, Red, Green : a full read of the sensor
+
+ Returns
+   void
+
+ Description
+   Adds it to the calibration if one is running, else classifies it and
+   posts EV_BALL_COLOUR when the colour changed
+ Notes
+   Called by ColourSensor from the I2CService
+ Author
+   Sander Tonkens
+****************************************************************************/
+void CC_NewSample(uint16_t Clear, uint16_t Red, uint16_t Green)
+{
+  ES_Event_t ColourEvent;
+  BallColour_t Colour;
+  uint8_t Confidence;
+
+  if (CalColour != CC_UNKNOWN)
+  {
+    if (Clear < MIN_CLEAR)
+    {
+      return;
+    }
+    CalSumR += Chromaticity(Red, Clear);
+    CalSumG += Chromaticity(Green, Clear);
+    if (++CalCount >= CAL_SAMPLES)
+    {
+      CalR = (CalSumR + CAL_SAMPLES / 2) / CAL_SAMPLES;
+      CalG = (CalSumG + CAL_SAMPLES / 2) / CAL_SAMPLES;
+      CalValid = true;
+      ColourEvent.EventType = EV_COLOUR_CAL_DONE;
+      ColourEvent.EventParam = CalColour;
+      CalColour = CC_UNKNOWN;
+      PostMotorService(ColourEvent);
+    }
+    return;
+  }
+
+  Colour = CC_Classify(Clear, Red, Green, &Confidence);
+  if ((Colour != CC_UNKNOWN) && (Colour != LastColour))
+  {
+    LastColour = Colour;
+    ColourEvent.EventType = EV_BALL_COLOUR;
+    ColourEvent.EventParam = CC_EVENT_PARAM(Colour, Confidence);
+    PostMotorService(ColourEvent);
+  }
+}
+
+/****************************************************************************
+ Function
+   CC_StartCalibration
+
+ Parameters
+   BallColour_t : the colour in front of the sensor now
+
+ Returns
+   bool : false for CC_UNKNOWN
+
+ Description
+   Averages the next CAL_SAMPLES samples into a centroid for Colour
+ Notes
+   Takes CAL_SAMPLES * Param.ColourIntegMS, no colours are posted meanwhile
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool CC_StartCalibration(BallColour_t Colour)
+{
+  if (Colour >= CC_NUM_CENTROIDS)
+  {
+    return false;
+  }
+  CalCount = 0;
+  CalSumR = 0;
+  CalSumG = 0;
+  CalValid = false;
+  CalColour = Colour;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   CC_QueryCalibration
+
+ Parameters
+   uint8_t *R, *G : the centroid of the last calibration
+
+ Returns
+   bool : false if no calibration has finished since the last start
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool CC_QueryCalibration(uint8_t *R, uint8_t *G)
+{
+  *R = CalR;
+  *G = CalG;
+  return CalValid;
+}
+
+const char *CC_QueryName(BallColour_t Colour)
+{
+  if (Colour > CC_UNKNOWN)
+  {
+    Colour = CC_UNKNOWN;
+  }
+  return Names[Colour];
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Channel / Clear in 1/256ths, the colour channels can read a little over
+// the clear one so it is clamped
+static uint8_t Chromaticity(uint16_t Channel, uint16_t Clear)
+{
+  uint32_t Ratio = ((uint32_t)Channel << 8) / Clear;
+
+  return (Ratio > CHROMA_MAX) ? CHROMA_MAX : (uint8_t)Ratio;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
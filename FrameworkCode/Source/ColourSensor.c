@@ -0,0 +1,532 @@
+/****************************************************************************
+ Module
+   ColourSensor.c
+
+ Revision
+   1.0.1
+
+ Description
+   Service for the TCS3472x colour sensor, a device on the I2CService
+   transaction manager
+
+ Notes
+   The lists of steps for the sensor used to be the SequenceLists table of
+   I2CService. They are the same lists, now one array each and handed to
+   the manager through the TCS3472x device descriptor.
+
+   The results are read with CMD_ReadBurst: one register address write
+   with the auto-increment bit set, then consecutive reads with a repeated
+   start, CDATAL..BDATAH landing in ColourData in register order.
+
+   Sampling follows the sensor's own integration cycles. The persistence
+   register is set so that every cycle raises the interrupt (AIEN), the
+   open drain INT output pulls PE1 low and the PE1 falling edge interrupt
+   posts EV_COLOUR_INT with the time to this service. That queues one read of all four channels followed by the
+   special function that clears the interrupt, so INT goes high again and
+   the next cycle makes the next edge: exactly one read per integration.
+   If an edge is lost (a failed read leaves INT low) COLOUR_TIMER, started
+   at every edge for two integration times, does the read and the clear
+   itself to get the edges going again.
+
+   The integration time is Param.ColourIntegMS, in 2.4 ms steps from 2.4 ms
+   (fast, a ball is seen sooner) to 614 ms (sensitive, less noise). It is
+   written to ATIME at power up and again whenever the parameter changes.
+   CS_GetSampleAge is the time since the end of the integration the last
+   sample came from (the INT edge), the light in it is from up to one
+   integration time before that.
+
+   The sensor runs at 400 kbps unless Param.ColourI2CFast is 0, for long or
+   noisy wiring. It is looked at for every request, so it can be changed
+   from the console while the reads are running.
+
+   Every good read of all four channels goes to the ColourClassifier.
+
+   The I2CService knows nothing of the sensor: requests made before it has
+   set up the module wait in its queue, and finished reads come back
+   through the SampleDone callback handed over with each request.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 23:55 ST       first pass, moved out of I2CService
+ 10/20/26 09:40 ST       own service, no longer called from I2CService
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_nvic.h"
+
+#include "BITDEFS.h"
+#include "TCS3472x.h"
+#include "ParamStore.h"
+#include "I2CService.h"
+#include "ColourSensor.h"
+#include "ColourClassifier.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// ATIME counts integration cycles of 2.4 ms down from 256
+#define CYCLE_US 2400
+#define MAX_CYCLES 256
+
+// extra wait on top of two integrations before COLOUR_TIMER re-arms INT
+#define MISSED_INT_MARGIN_MS 20
+
+// sensor INT on PE1, GPIO Port E is interrupt number 4
+#define INT_PIN BIT1HI
+
+// confirm that these match the order in Sequences
+#define INIT_INDEX 0
+#define READ_CLR   1    // then red, green, blue and all, as CSChannel_t
+#define SAMPLE_INDEX 6
+#define INTEGRATION_INDEX 7
+
+// the ATIME value in IntegrationSteps
+#define ATIME_STEP 1
+
+// where each channel starts in ColourData, in register order from CDATAL
+#define CLEAR_OFFSET 0
+#define RED_OFFSET   2
+#define GREEN_OFFSET 4
+#define BLUE_OFFSET  6
+#define COLOUR_BYTES 8
+
+// command byte that points at a register and auto-increments from it
+#define READ_FROM(Reg) ((Reg) | TCS3472x_COMMAND_BIT | TCS3472x_AUTO_INCREMENT)
+
+// command byte that clears the INT output
+#define CLEAR_INT (TCS3472x_COMMAND_BIT | TCS3472x_SPECIAL_FN | TCS3472x_SF_INT_CLEAR)
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void SampleDone(bool Ok);
+static bool Request(uint8_t Sequence, I2CDoneFunc_t *Done);
+static void ReadSample(uint16_t Stamp);
+static void InitIntPin(void);
+static uint16_t Channel(uint8_t Offset);
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint8_t MyPriority;
+
+// CDATAL..BDATAH as read from the sensor, low byte first
+static uint8_t ColourData[COLOUR_BYTES];
+
+// ES_Timer_GetTime at the INT edge of the sample being read, and of the
+// last one read
+static uint16_t PendingStamp;
+static uint16_t SampleStamp;
+
+// integration time the sensor is set to, rounded to whole cycles
+static uint16_t IntegrationMS;
+// COLOUR_TIMER time, longer for the first edges after a change while a
+// cycle at the old time may still be under way
+static uint16_t MissedIntMS;
+static uint8_t ChangeEdges;
+
+// ATIME is only written once the power up sequence is queued
+static bool Started;
+
+/* First up is the power-up initialization sequence */
+static const StepDefinition_t InitSteps[] = {
+  {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the Enable register */
+  {CMD_Write8NS, TCS3472x_ENABLE_PON, 0, BUSY_WAIT, NULL}, /* set the PON bit to power up */
+  {CMD_NOP, 0, 4, TIME_WAIT, NULL}, /* time wait for min. 3ms with timer uncertainty */
+  {CMD_WriteMult, (TCS3472x_PERS_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the Persistence register */
+  {CMD_Write8NS, TCS3472x_PERS_NONE, 0, BUSY_WAIT, NULL}, /* every conversion cycle raises INT */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence, IntegrationSteps starts the conversions */
+};
+/* next is read the clear results */
+static const StepDefinition_t ReadClear[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_CDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
+  {CMD_ReadBurst, 2, 0, BUSY_WAIT, &ColourData[CLEAR_OFFSET]}, /* read the lo & hi bytes */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* next is read the red results */
+static const StepDefinition_t ReadRed[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_RDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
+  {CMD_ReadBurst, 2, 0, BUSY_WAIT, &ColourData[RED_OFFSET]}, /* read the lo & hi bytes */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* next is read the green results */
+static const StepDefinition_t ReadGreen[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_GDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
+  {CMD_ReadBurst, 2, 0, BUSY_WAIT, &ColourData[GREEN_OFFSET]}, /* read the lo & hi bytes */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* next is read the blue results */
+static const StepDefinition_t ReadBlue[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_BDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
+  {CMD_ReadBurst, 2, 0, BUSY_WAIT, &ColourData[BLUE_OFFSET]}, /* read the lo & hi bytes */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* last is read all four channels in one go */
+static const StepDefinition_t ReadAll[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_CDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the clear lo byte result register */
+  {CMD_ReadBurst, COLOUR_BYTES, 0, BUSY_WAIT, ColourData}, /* read CDATAL through BDATAH */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* the read for an INT edge, all four channels then clear INT */
+static const StepDefinition_t ReadSampleSteps[] = {
+  {CMD_WriteMult, READ_FROM(TCS3472x_CDATAL_REG), 0, BUSY_WAIT, NULL}, /* select the clear lo byte result register */
+  {CMD_ReadBurst, COLOUR_BYTES, 0, BUSY_WAIT, ColourData}, /* read CDATAL through BDATAH */
+  {CMD_Write8, CLEAR_INT, 0, BUSY_WAIT, NULL}, /* release INT for the next cycle */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+/* set the integration time and (re)start the conversions, ATIME_STEP is
+   filled in by CS_ApplyParams */
+static StepDefinition_t IntegrationSteps[] = {
+  {CMD_WriteMult, (TCS3472x_ATIME_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the ATIME register */
+  {CMD_Write8NS, TCS3472x_INT_TIME_350MS, 0, BUSY_WAIT, NULL}, /* program the integration time */
+  {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the Enable register */
+  {CMD_Write8NS, (TCS3472x_ENABLE_PON | TCS3472x_ENABLE_AEN | TCS3472x_ENABLE_AIEN), 0, BUSY_WAIT, NULL}, /* convert, with INT at the end of each cycle */
+  {CMD_Write8, CLEAR_INT, 0, BUSY_WAIT, NULL}, /* INT high, ready for the first edge */
+  {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
+};
+
+static const StepDefinition_t * const Sequences[] = {
+  InitSteps, ReadClear, ReadRed, ReadGreen, ReadBlue, ReadAll, ReadSampleSteps,
+  IntegrationSteps
+};
+
+// FastMode follows Param.ColourI2CFast, see Request
+static I2CDevice_t Sensor = {
+  TCS3472x_ADDRESS, true, Sequences, ARRAY_SIZE(Sequences)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   InitColourSensor
+
+ Parameters
+   uint8_t : the priorty of this service
+
+ Returns
+   bool, false if error in initialization, true otherwise
+
+ Description
+   Saves away the priority and posts the ES_INIT that powers the sensor up
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool InitColourSensor(uint8_t Priority)
+{
+  ES_Event_t ThisEvent;
+
+  MyPriority = Priority;
+  ThisEvent.EventType = ES_INIT;
+  if (ES_PostToService(MyPriority, ThisEvent) == true)
+  {
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+/****************************************************************************
+ Function
+   PostColourSensor
+
+ Parameters
+   ES_Event_t ThisEvent , the event to post to the queue
+
+ Returns
+   bool false if the Enqueue operation failed, true otherwise
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PostColourSensor(ES_Event_t ThisEvent)
+{
+  return ES_PostToService(MyPriority, ThisEvent);
+}
+
+/****************************************************************************
+ Function
+   CS_ApplyParams
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Writes Param.ColourIntegMS to the sensor
+ Notes
+   ParamStore hook. The sample already integrating finishes at the old time.
+   A list already on the bus writes either the old ATIME or the new one,
+   the request queued here then writes the new one.
+ Author
+   Sander Tonkens
+****************************************************************************/
+void CS_ApplyParams(void)
+{
+  uint32_t Cycles = (Param.ColourIntegMS * 1000 + CYCLE_US / 2) / CYCLE_US;
+  uint16_t PreviousMS = IntegrationMS;
+
+  if (Cycles < 1)
+  {
+    Cycles = 1;
+  }
+  else if (Cycles > MAX_CYCLES)
+  {
+    Cycles = MAX_CYCLES;
+  }
+  IntegrationMS = (Cycles * CYCLE_US + 500) / 1000;
+  // the I2C ISR may be running IntegrationSteps
+  EnterCritical();
+  IntegrationSteps[ATIME_STEP].Value = (uint8_t)(MAX_CYCLES - Cycles);
+  ExitCritical();
+  if (Started)
+  {
+    Request(INTEGRATION_INDEX, 0);
+    // the cycle under way ends at the old time, then one at the new
+    MissedIntMS = PreviousMS + 2 * IntegrationMS + MISSED_INT_MARGIN_MS;
+    ChangeEdges = 2;
+    ES_Timer_InitTimer(COLOUR_TIMER, MissedIntMS);
+  }
+}
+
+/****************************************************************************
+ Function
+   RunColourSensor
+
+ Parameters
+   ES_Event_t : the event to process
+
+ Returns
+   ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
+
+ Description
+   Queues the power up sequence and the integration time at ES_INIT, the
+   INT edges start the reads from then on. Also the read requests
+   (EV_I2C_ReadClear .. EV_I2C_ReadAll) and the COLOUR_TIMER time out for
+   a missed edge.
+ Author
+   Sander Tonkens
+****************************************************************************/
+ES_Event_t RunColourSensor(ES_Event_t ThisEvent)
+{
+  ES_Event_t ReturnEvent;
+  ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
+
+  switch (ThisEvent.EventType)
+  {
+    case ES_INIT:
+    {
+      CC_ApplyParams();
+      InitIntPin();
+      Request(INIT_INDEX, 0);
+      Started = true;
+      CS_ApplyParams();
+    }
+    break;
+
+    case EV_I2C_ReadClear:
+    {
+      CS_Read(CS_CLEAR);
+    }
+    break;
+
+    case EV_I2C_ReadRed:
+    {
+      CS_Read(CS_RED);
+    }
+    break;
+
+    case EV_I2C_ReadGreen:
+    {
+      CS_Read(CS_GREEN);
+    }
+    break;
+
+    case EV_I2C_ReadBlue:
+    {
+      CS_Read(CS_BLUE);
+    }
+    break;
+
+    case EV_I2C_ReadAll:
+    {
+      CS_Read(CS_ALL);
+    }
+    break;
+
+    case EV_COLOUR_INT:  /* This is how we get repeating measurements */
+    {
+      ReadSample(ThisEvent.EventParam);
+    }
+    break;
+
+    case ES_TIMEOUT:  /* no edge for two integrations, INT was left low */
+    {
+      if (COLOUR_TIMER == ThisEvent.EventParam)
+      {
+        ReadSample(ES_Timer_GetTime());
+      }
+    }
+    break;
+
+    default:
+    {
+    }
+    break;
+  }
+  return ReturnEvent;
+}
+
+/****************************************************************************
+ Function
+   CS_Read
+
+ Parameters
+   CSChannel_t : channel to read, or CS_ALL
+
+ Returns
+   bool : false if the I2C queue is full
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool CS_Read(CSChannel_t Which)
+{
+  return Request(READ_CLR + Which, 0);
+}
+
+/****************************************************************************
+ Function
+   CS_IntISR
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   PE1 falling edge, the sensor finished an integration
+ Author
+   Sander Tonkens
+****************************************************************************/
+void CS_IntISR(void)
+{
+  ES_Event_t ThisEvent;
+
+  HWREG(GPIO_PORTE_BASE + GPIO_O_ICR) = INT_PIN;
+  ThisEvent.EventType = EV_COLOUR_INT;
+  ThisEvent.EventParam = ES_Timer_GetTime();
+  PostColourSensor(ThisEvent);
+}
+
+/****************************************************************************
+ Function
+   CS_GetSampleAge
+
+ Parameters
+   void
+
+ Returns
+   uint16_t : ms since the end of the integration of the last sample
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint16_t CS_GetSampleAge(void)
+{
+  return (uint16_t)(ES_Timer_GetTime() - SampleStamp);
+}
+
+uint16_t CS_GetClearValue( void )
+{
+  return(Channel(CLEAR_OFFSET));
+}
+
+uint16_t CS_GetRedValue( void )
+{
+  return(Channel(RED_OFFSET));
+}
+
+uint16_t CS_GetGreenValue( void )
+{
+  return(Channel(GREEN_OFFSET));
+}
+
+uint16_t CS_GetBlueValue( void )
+{
+  return(Channel(BLUE_OFFSET));
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// One read per INT edge, the timer catches the edge that never comes if
+// this read (or its clear) fails
+static void ReadSample(uint16_t Stamp)
+{
+  PendingStamp = Stamp;
+  Request(SAMPLE_INDEX, SampleDone);
+  if (ChangeEdges > 0)
+  {
+    ChangeEdges--;
+  }
+  else
+  {
+    MissedIntMS = 2 * IntegrationMS + MISSED_INT_MARGIN_MS;
+  }
+  ES_Timer_InitTimer(COLOUR_TIMER, MissedIntMS);
+}
+
+// A fresh sample for the classifier
+static void SampleDone(bool Ok)
+{
+  if (Ok)
+  {
+    SampleStamp = PendingStamp;
+    CC_NewSample(CS_GetClearValue(), CS_GetRedValue(), CS_GetGreenValue());
+  }
+}
+
+static bool Request(uint8_t Sequence, I2CDoneFunc_t *Done)
+{
+  Sensor.FastMode = (0 != Param.ColourI2CFast);
+  return I2C_Request(&Sensor, Sequence, Done);
+}
+
+// PE1 input with pull up (INT is open drain, active low), interrupt on
+// the falling edge
+static void InitIntPin(void)
+{
+  HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R4;
+  while ((HWREG(SYSCTL_PRGPIO) & SYSCTL_PRGPIO_R4) != SYSCTL_PRGPIO_R4)
+  {}
+  HWREG(GPIO_PORTE_BASE + GPIO_O_DEN) |= INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_DIR) &= ~INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_PUR) |= INT_PIN;
+// edge sensitive, one edge only, falling
+  HWREG(GPIO_PORTE_BASE + GPIO_O_IS) &= ~INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_IBE) &= ~INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_IEV) &= ~INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_ICR) = INT_PIN;
+  HWREG(GPIO_PORTE_BASE + GPIO_O_IM) |= INT_PIN;
+// GPIO Port E is interrupt number 4 so appears in EN0 at bit 4
+  HWREG(NVIC_EN0) |= BIT4HI;
+}
+
+static uint16_t Channel(uint8_t Offset)
+{
+  return ((uint16_t)ColourData[Offset + 1] << 8) | ColourData[Offset];
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -8,11 +8,22 @@
  Description
    Runs the DC Motors associated with ball collection 
  Notes
+   Both motors run closed loop on speed through MotorController. Speed is
+   measured from the back-EMF: the motor sense lines go to AIN0 (pickup) and
+   AIN1 (transport) through a divider, and are only sampled in the middle of
+   the PWM off time, when the motor is coasting and its terminal voltage is
+   the generated voltage. The PWM generator triggers the conversion at its
+   zero count, which is the middle of the off time of both outputs, and the
+   ADC interrupt keeps the result, so the control ISR only picks it up. The
+   drivers have no direction input, so the reverse half of the jam cycle
+   lets the motor coast instead.
 
  History
  When           Who     What/Why
  -------------- ---     --------
  02/24/19 17:50 kchen    First pass 
+ 10/19/26 20:10 ST       speed control and jam recovery via MotorController
+ 10/19/26 20:40 ST       back-EMF sampled on the PWM trigger, no busy wait
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
 // Hardware
@@ -20,6 +31,7 @@
 #include "inc/hw_types.h"
 #include "inc/hw_gpio.h"
 #include "inc/hw_sysctl.h"
+#include "inc/hw_adc.h"
 #include "termio.h"
 
 // Specific Hardware
@@ -33,6 +45,8 @@
 
 // Project modules
 #include "DriveMotorPWM.h"
+#include "MotorController.h"
+#include "ADMulti.h"
 
 // This module
 #include "DCMotorService.h"
@@ -44,6 +58,23 @@
 #define GenA_Normal (PWM_0_GENA_ACTCMPAU_ONE | PWM_0_GENA_ACTCMPAD_ZERO)
 #define PeriodInMS 5 //200Hz 
 #define PWMTicksPerMS 40000 / 32  //system clock frequency/32
+
+// Back-EMF sensing
+#define PICKUP_CHANNEL 0
+#define TRANSPORT_CHANNEL 1
+#define NUM_BEMF_CHANNELS 2
+#define BEMF_RPM_PER_COUNT 0.1f   // 4095 counts = 410 RPM at the output shaft
+#define BEMF_FILTER 0.5f          // weight of a new sample
+// off time before the sample for the sense divider to settle, PWM clocks
+#define MIN_OFF_TICKS 100
+
+// Speed control, the integral is in percent duty
+#define MOTOR_P_GAIN 0.15f
+#define MOTOR_I_GAIN 1
+#define MOTOR_I_SCALE 0.03f // per MC_SERVICE_US period
+#define MOTOR_MAX_DUTY 90   // keeps an off time to sample the back-EMF in
+#define MOTOR_REVERSE_DUTY 60
+#define MOTOR_MAX_RETRIES 3
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this machine.
 */ 
@@ -51,11 +82,35 @@ static void setPickupDuty(uint32_t duty);
 static void setTransportDuty(uint32_t duty); 
 static void RestorePickupDC(void); 
 static void RestoreTransportDC(void); 
+static void OutputPickup(float Duty);
+static void OutputTransport(float Duty);
+static bool MeasurePickup(float *RPM);
+static bool MeasureTransport(float *RPM);
+static bool SampleBackEMF(uint8_t Channel, uint32_t Compare, uint32_t Duty,
+    uint32_t *LastConversion, float *RPM);
 
 
 
 /*---------------------------- Module Variables ---------------------------*/
 static uint8_t    MyPriority;
+
+static uint32_t PickupDuty;
+static uint32_t TransportDuty;
+
+// ADC conversions already used for each motor
+static uint32_t PickupConversion;
+static uint32_t TransportConversion;
+
+static MotorController_t PickupController = {
+  PICKUP_MOTOR, {MOTOR_P_GAIN, MOTOR_I_GAIN}, MOTOR_I_SCALE, MeasurePickup,
+  OutputPickup, PostDCMotorService, MOTOR_MAX_DUTY, MOTOR_REVERSE_DUTY,
+  MOTOR_MAX_RETRIES
+};
+static MotorController_t TransportController = {
+  TRANSPORT_MOTOR, {MOTOR_P_GAIN, MOTOR_I_GAIN}, MOTOR_I_SCALE,
+  MeasureTransport, OutputTransport, PostDCMotorService, MOTOR_MAX_DUTY,
+  MOTOR_REVERSE_DUTY, MOTOR_MAX_RETRIES
+};
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
  Function
@@ -130,48 +185,103 @@ bool PostDCMotorService(ES_Event_t ThisEvent)
  Description
    Regulates commands, and sets motors accordingly
  Notes
-
+   Jams are handled by the controllers, this only reports them
  Author
 ****************************************************************************/
 ES_Event_t RunDCMotorService(ES_Event_t ThisEvent)
 {
   ES_Event_t ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
+
+  if (ThisEvent.EventType == EV_MOTOR_JAM)
+  {
+    printf("%s motor jammed, reversing\r\n",
+        (ThisEvent.EventParam == PICKUP_MOTOR) ? "Pickup" : "Transport");
+  }
+  else if (ThisEvent.EventType == EV_MOTOR_FAULT)
+  {
+    printf("%s motor still jammed, stopped\r\n",
+        (ThisEvent.EventParam == PICKUP_MOTOR) ? "Pickup" : "Transport");
+  }
   return ReturnEvent;
 }
 
 /****************************************************************************
  Function
-    startPickupMotorService
+    startPickupMotor
 
  Parameters
-   ES_Event: the event to process
+   float : output shaft speed in RPM
 
  Returns
-   ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
+   void
 
  Description
-   Regulates commands, and sets motors accordingly
+   Runs the pickup motor closed loop at the given speed, 0 stops it
  Notes
 
  Author
 ****************************************************************************/
-void startPickupMotor(uint32_t DutyCycle){
-  setPickupDuty(DutyCycle); 
+void startPickupMotor(float RPM){
+  MC_SetSpeed(&PickupController, RPM);
 }
 
 void stopPickupMotor(){
-  setPickupDuty(0); 
+  MC_Stop(&PickupController);
 } 
 
-void startTransportMotor(uint32_t DutyCycle){
-  setTransportDuty(DutyCycle); 
+void startTransportMotor(float RPM){
+  MC_SetSpeed(&TransportController, RPM);
 }
 
 void stopTransportMotor(){
-  setTransportDuty(0); 
+  MC_Stop(&TransportController);
 } 
 
+/****************************************************************************
+ Function
+    QueryDCMotorState
+
+ Parameters
+   uint8_t : PICKUP_MOTOR or TRANSPORT_MOTOR
+
+ Returns
+   MC_State_t : MC_FAULT once a jam could not be cleared
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+MC_State_t QueryDCMotorState(uint8_t Motor)
+{
+  if (Motor == PICKUP_MOTOR)
+  {
+    return MC_QueryState(&PickupController);
+  }
+  return MC_QueryState(&TransportController);
+}
+
+/****************************************************************************
+ Function
+    QueryDCMotorSpeed
+
+ Parameters
+   uint8_t : PICKUP_MOTOR or TRANSPORT_MOTOR
+
+ Returns
+   float : speed from the back-EMF, RPM
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+float QueryDCMotorSpeed(uint8_t Motor)
+{
+  if (Motor == PICKUP_MOTOR)
+  {
+    return MC_QuerySpeed(&PickupController);
+  }
+  return MC_QuerySpeed(&TransportController);
+}
+
 /***************************************************************************
  private functions
  ***************************************************************************/
@@ -179,6 +289,7 @@ void stopTransportMotor(){
 
 static void setPickupDuty(uint32_t duty) //PB7
 {
+  PickupDuty = duty;
   if (duty == 0)
   {
     HWREG(PWM0_BASE + PWM_O_0_GENB) = PWM_0_GENB_ACTZERO_ZERO;
@@ -196,6 +307,7 @@ static void setPickupDuty(uint32_t duty) //PB7
 
 static void setTransportDuty(uint32_t duty) //PB6
 {
+  TransportDuty = duty;
   if (duty == 0)
   {
     HWREG(PWM0_BASE + PWM_O_0_GENA) = PWM_0_GENA_ACTZERO_ZERO;
@@ -222,6 +334,52 @@ static void RestoreTransportDC(void)
   HWREG(PWM0_BASE + PWM_O_0_GENA) = GenA_Normal;
 }
 
+// MotorController outputs, no direction line so negative duty coasts
+static void OutputPickup(float Duty)
+{
+  setPickupDuty((Duty > 0) ? (uint32_t)Duty : 0);
+}
+
+static void OutputTransport(float Duty)
+{
+  setTransportDuty((Duty > 0) ? (uint32_t)Duty : 0);
+}
+
+static bool MeasurePickup(float *RPM)
+{
+  return SampleBackEMF(PICKUP_CHANNEL, HWREG(PWM0_BASE + PWM_O_0_CMPB),
+      PickupDuty, &PickupConversion, RPM);
+}
+
+static bool MeasureTransport(float *RPM)
+{
+  return SampleBackEMF(TRANSPORT_CHANNEL, HWREG(PWM0_BASE + PWM_O_0_CMPA),
+      TransportDuty, &TransportConversion, RPM);
+}
+
+// The output is high while the up/down counter is above the compare value,
+// so at the zero count trigger the motor has been coasting for Compare
+// ticks. A result is used once, at most one per PWM period.
+static bool SampleBackEMF(uint8_t Channel, uint32_t Compare, uint32_t Duty,
+    uint32_t *LastConversion, float *RPM)
+{
+  uint32_t Results[4];
+  uint32_t Conversion;
+
+  Conversion = ADC_MultiLatest(Results);
+  if (Conversion == *LastConversion)
+  {
+    return false;
+  }
+  *LastConversion = Conversion;
+  if ((Duty != 0) && (Compare < MIN_OFF_TICKS))
+  {
+    return false;
+  }
+  *RPM += BEMF_FILTER * (Results[Channel] * BEMF_RPM_PER_COUNT - *RPM);
+  return true;
+}
+
 void InitDCPWM(void)
 {
 // start by enabling the clock to the PWM Module (PWM0)
@@ -274,6 +432,12 @@ void InitDCPWM(void)
 // both generator updates locally synchronized to zero count
   HWREG(PWM0_BASE + PWM_O_0_CTL) = (PWM_0_CTL_MODE | PWM_0_CTL_ENABLE |
       PWM_0_CTL_GENAUPD_LS | PWM_0_CTL_GENBUPD_LS);
+// back-EMF sense on AIN0 (PE3) and AIN1 (PE2), converted at every zero count
+  ADC_MultiInitTriggered(NUM_BEMF_CHANNELS, ADC_EMUX_EM2_PWM0);
+  HWREG(PWM0_BASE + PWM_O_0_INTEN) |= PWM_0_INTEN_TRCNTZERO;
+// both motors start stopped, serviced from the drive control ISR
+  MC_Register(&PickupController);
+  MC_Register(&TransportController);
 }
 
 
@@ -20,9 +20,14 @@
 */
 #include "DriveCommandModule.h"
 #include "MotorSpeedControl.h"
+#include "MotionQueue.h"
+#include "PurePursuit.h"
+#include "EncoderCapture.h"
+#include "ParamStore.h"
 #include "BITDEFS.h"
 
 #include <stdlib.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -52,13 +57,14 @@
 #define STRAIGHT	0
 #define TURN			1
 
-#define STRAIGHT_DRIVE_SPEED	100 //Max drive speed
-#define TURNING_SPEED					100 //Max rotation speed
+//Max drive and rotation speeds, and the distance and turn calibration
+//(ticks per inch, ticks per degree) are Param.StraightRPM, Param.TurnRPM,
+//Param.TicksPerInch and Param.TicksPerDegree
 
 #define ROTATION_RADIUS 5.12 //In inches (IF RECALIBRATED UPDATED BELOW)
 
-#define TICKS_PER_INCHx10	606.38/4 //TO BE RECALIBRATED
-#define TICKS_PER_DEGREEx100	541.87/4 //TO BE RECALIBRATED
+#define CAL_DISTANCEx100	4800	//48 inches
+#define CAL_SPEED	50	//RPM, slow enough not to slip
 
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service.They should be functions
@@ -67,6 +73,9 @@
 
 /*---------------------------- Module Variables ---------------------------*/
 // Data private to the module
+//encoder totals at the start of a calibration drive
+static int32_t CalStart_1;
+static int32_t CalStart_2;
 
 
 
@@ -115,8 +124,8 @@ void Drive_Control_Init(void){
    Sander Tonkens
 ****************************************************************************/
 void Drive_Straight(float distancex100){
-	Drive_SetClampRPM(STRAIGHT_DRIVE_SPEED);
-	Drive_SetDistance(distancex100*TICKS_PER_INCHx10/1000);
+	Drive_SetClampRPM(Param.StraightRPM);
+	Drive_SetDistance(distancex100*Param.TicksPerInch/100);
 }
 
 /****************************************************************************
@@ -137,8 +146,8 @@ void Drive_Straight(float distancex100){
    Sander Tonkens
 ****************************************************************************/
 void Drive_Turn(float degreesx10){
-	Drive_SetClampRPM(TURNING_SPEED);
-	Drive_SetHeading(degreesx10*TICKS_PER_DEGREEx100/1000);
+	Drive_SetClampRPM(Param.TurnRPM);
+	Drive_SetHeading(degreesx10*Param.TicksPerDegree/10);
 }
 
 void StopDrive(void)
@@ -146,5 +155,193 @@ void StopDrive(void)
   Drive_Stop();
 }
 
+/****************************************************************************
+ Function
+   Drive_QueueStraight / Drive_QueueTurn / Drive_QueueArc
+
+ Parameters
+	float : distance (in inches*100) and/or angle (in degrees*10), same
+	units and signs as Drive_Straight and Drive_Turn
+
+ Returns
+   bool : false if the motion queue is full
+
+ Description
+   add a segment to the motion queue, run the queue with Drive_StartQueue
+ Notes
+   Consecutive segments in the same direction are driven without stopping
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool Drive_QueueStraight(float distancex100){
+	MotionSegment_t Segment = {MQ_STRAIGHT};
+	Segment.Distance = distancex100*Param.TicksPerInch/100;
+	return MQ_Push(&Segment);
+}
+
+bool Drive_QueueTurn(float degreesx10){
+	MotionSegment_t Segment = {MQ_TURN};
+	Segment.Heading = degreesx10*Param.TicksPerDegree/10;
+	return MQ_Push(&Segment);
+}
+
+bool Drive_QueueArc(float distancex100, float degreesx10){
+	MotionSegment_t Segment = {MQ_ARC};
+	Segment.Distance = distancex100*Param.TicksPerInch/100;
+	Segment.Heading = degreesx10*Param.TicksPerDegree/10;
+	return MQ_Push(&Segment);
+}
+
+/****************************************************************************
+ Function
+   Drive_QueueVelocity / Drive_QueueWait
+
+ Parameters
+	float : speed (in inches/s*100), Forward >0, Backward < 0
+	uint16_t : how long to hold the speed / stand still, in ms
+
+ Returns
+   bool : false if the motion queue is full
+
+ Description
+   add a timed segment to the motion queue
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool Drive_QueueVelocity(float speedx100, uint16_t duration){
+	MotionSegment_t Segment = {MQ_VELOCITY};
+	Segment.Speed = speedx100*Param.TicksPerInch/100;
+	Segment.Duration = duration;
+	return MQ_Push(&Segment);
+}
+
+bool Drive_QueueWait(uint16_t duration){
+	MotionSegment_t Segment = {MQ_WAIT};
+	Segment.Duration = duration;
+	return MQ_Push(&Segment);
+}
+
+/****************************************************************************
+ Function
+   Drive_StartQueue
+
+ Parameters
+	void
+
+ Returns
+   void
+
+ Description
+   start driving the queued segments
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_StartQueue(void){
+	Drive_SetClampRPM(Param.StraightRPM);
+	Drive_RunQueue();
+}
+
+/****************************************************************************
+ Function
+   Drive_AddWaypoint / Drive_ClearWaypoints
+
+ Parameters
+	float : field position X and Y (in inches*100), as the pose filter
+
+ Returns
+   bool : false if the path is full
+
+ Description
+   build the path for Drive_FollowPath
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool Drive_AddWaypoint(float xx100, float yx100){
+	return PP_AddWaypoint(xx100/100, yx100/100);
+}
+
+void Drive_ClearWaypoints(void){
+	PP_Clear();
+}
+
+/****************************************************************************
+ Function
+   Drive_FollowPath
+
+ Parameters
+	void
+
+ Returns
+   bool : false if there are no waypoints
+
+ Description
+   drive smooth arcs through the waypoints from the current pose, without
+   stopping at each one
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool Drive_FollowPath(void){
+	Drive_SetClampRPM(Param.StraightRPM);
+	return Drive_RunPath();
+}
+
+/****************************************************************************
+ Function
+   Drive_StartDistanceCal
+
+ Parameters
+	void
+
+ Returns
+   void
+
+ Description
+   drive straight 48 inches by the current calibration, slowly. Measure how
+   far the robot really went and pass it to Drive_FinishDistanceCal.
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_StartDistanceCal(void){
+	StopDrive();
+	CalStart_1 = QueryEncoderOdometer(WHEEL_1);
+	CalStart_2 = QueryEncoderOdometer(WHEEL_2);
+	Drive_SetClampRPM(CAL_SPEED);
+	Drive_SetDistance(CAL_DISTANCEx100*Param.TicksPerInch/100);
+}
+
+/****************************************************************************
+ Function
+   Drive_FinishDistanceCal
+
+ Parameters
+	float : distance actually driven by Drive_StartDistanceCal (inches*100)
+
+ Returns
+   float : measured ticks per inch, 0 if the measurement makes no sense
+
+ Description
+   works out ticks per inch from the encoder travel over the measured
+   distance, the caller stores it as Param.TicksPerInch
+ Notes
+   Takes the mean of both wheels, so a slight curve doesn't matter
+ Author
+   Sander Tonkens
+****************************************************************************/
+float Drive_FinishDistanceCal(float distancex100){
+	float Ticks = ((QueryEncoderOdometer(WHEEL_1) - CalStart_1) +
+		(QueryEncoderOdometer(WHEEL_2) - CalStart_2))/2.0f;
+	float TicksPerInch;
+	
+	if(distancex100 <= 0 || Ticks <= 0){
+		return 0;
+	}
+	TicksPerInch = Ticks*100/distancex100;
+	//more than 25% off the current value is a typo, not a calibration
+	if(fabsf(TicksPerInch - Param.TicksPerInch) > Param.TicksPerInch/4){
+		return 0;
+	}
+	return TicksPerInch;
+}
+
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
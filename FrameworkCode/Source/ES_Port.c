@@ -15,6 +15,9 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/20/26 10:15 ST      byte debug port writes wait for room in the queue
+ 10/19/26 23:59 ST      byte debug port writes go through the SSI1 queue
+                        of SSIBus instead of polling the FIFO
  08/21/17 13:47 jec     added functions to init 2 lines for debugging the framework
                         and functions to set & clear those lines.
  03/13/14 10:30	joa		  Updated files to use with Cortex M4 processor core.
@@ -46,6 +49,7 @@
 #include "ES_Port.h"
 #include "ES_Types.h"
 #include "ES_Timers.h"
+#include "SSIBus.h"
 
 #define UART_PORT 0
 #define UART_BAUD 115200UL
@@ -94,6 +98,14 @@ uint32_t _PRIMASK_temp;
 
 static uint8_t ByteDebugPortShadow = 0;
 
+// the 'HC595 on SSI1: mode 0 so FSS pulses on every byte to latch it,
+// 40 MHz / BYTE_DEBUG_SSI1__DIVISOR, 8 bits
+static const SSIDevice_t ByteDebugDevice = {
+  SSI_BUS1, 0, BYTE_DEBUG_SSI1__DIVISOR, 0, 8, SSI_CS_FSS, 0
+};
+
+static void ByteDebugSend(const uint8_t *Bytes, uint8_t Length);
+
 /****************************************************************************
  Function
      _HW_Timer_Init
@@ -370,72 +382,21 @@ void _HW_DebugLines_ClearLine2(void)
  Notes
     based on code from SSIDemo.c in project GIT_FrameworkWithSPIDemo
     Does not use the Rx line on SSI1 so PF0 is still free
+    The bytes go out through the SSI1 queue of SSIBus, a write with the
+    queue full waits for room, so call these from task level only
  Author
      J. Edward Carryer, 07/29/18 15:03
 ****************************************************************************/
 void _HW_ByteDebug_Init( void){
-// enable the clock to the GPIO port (PortF for SSI1)
-	HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R5;
-
-// enable the clock to SSI1
-	HWREG(SYSCTL_RCGCSSI) |= SYSCTL_RCGCSSI_R1;
-
-// wait for the GPIO port to be ready
-  while( (HWREG(SYSCTL_PRGPIO) & SYSCTL_PRGPIO_R5) != SYSCTL_PRGPIO_R5 )
-    ;    
-
-// program the GPIO to use the alternate functions on the SSI1 pins(1,2 & 3)
-  HWREG(GPIO_PORTF_BASE + GPIO_O_AFSEL) |= 
-                     (BIT3HI | BIT2HI | BIT1HI );
-  
-// select the SSI1 functions on those pins. first clear the fields, then
-// set mux position 2 for each of pins 3,2 & 1 to get the SSI functions
-  HWREG(GPIO_PORTF_BASE + GPIO_O_PCTL) = (HWREG(GPIO_PORTF_BASE + GPIO_O_PCTL) &
-    ~(GPIO_PCTL_PF3_M | GPIO_PCTL_PF2_M | GPIO_PCTL_PF1_M)) | 
-      ( GPIO_PCTL_PF3_SSI1FSS | GPIO_PCTL_PF2_SSI1CLK | GPIO_PCTL_PF1_SSI1TX);
-  
-// program those lines for digital I/O
-  HWREG(GPIO_PORTF_BASE + GPIO_O_DEN) |= (BIT3HI | BIT2HI | BIT1HI );
-  
-// program the required data directions on the port pins 
-// Tx(1), Fs(3) & Clk(2) are all outputs  
-  HWREG(GPIO_PORTF_BASE + GPIO_O_DIR) = (HWREG(GPIO_PORTF_BASE + GPIO_O_DIR) |
-    (BIT3HI | BIT2HI | BIT1HI ));
-
-// Since we are using SPI mode 3, enable the pull-up on the clock line (bit 2)
-  HWREG(GPIO_PORTF_BASE + GPIO_O_PUR) |= BIT2HI;
-  
-// wait for the SSI1 to be ready, it really should be ready by now
-  while( (HWREG(SYSCTL_PRSSI) & SYSCTL_PRSSI_R1) != SYSCTL_PRSSI_R1 )
-    ;    
-  
-// make sure the the SSI is disabled before programming mode bits
-  HWREG(SSI1_BASE + SSI_O_CR1) &= ~SSI_CR1_SSE;
-  
-// select master mode (MS=0) with TXRIS indicating End of Transmit (EOT=1)
-  HWREG(SSI1_BASE + SSI_O_CR1) = (HWREG(SSI1_BASE + SSI_O_CR1) & 
-    ~SSI_CR1_MS) | SSI_CR1_EOT ;
-
-// configure the SSI clock source to the system clock
-  HWREG(SSI1_BASE + SSI_O_CC) = 0;
-  
-// configure the clock pre-scaler
-  HWREG(SSI1_BASE + SSI_O_CPSR) = BYTE_DEBUG_SSI1__DIVISOR;
-  
-// Configure clock rate (SCR=0), Phase & polarity (SPH=0, SPO=0), 
-// SPI mode (FRF=0), data size to 8 bits (DSS)
+// SSI1 on PF1-3 as master, set up by the SSI bus module. The device settings
+// (SPH=0, SPO=0, SCR=0, 8 bit data) go into the SSI with the first byte.
 // SPH=0, SPO=0 is required to get the FS line to pulse on every byte
 // and have the rising edge of the clock in the center of the valid data
 // for latching by the '595
-  HWREG(SSI1_BASE + SSI_O_CR0) =  (HWREG(SSI1_BASE + SSI_O_CR0) & 
-    ~(SSI_CR0_SCR_M | SSI_CR0_FRF_M | SSI_CR0_DSS_M | SSI_CR0_SPH | 
-      SSI_CR0_SPO )) | (SSI_CR0_DSS_8);
-
-// make sure the the SSI is enabled for operation
-  HWREG(SSI1_BASE + SSI_O_CR1) |= SSI_CR1_SSE;
+  SSI_InitDevice(&ByteDebugDevice);
   
 // set all of the output lines lo
-  HWREG(SSI1_BASE + SSI_O_DR) = 0;
+  ByteDebugSend(&ByteDebugPortShadow, 1);
 
 }
 
@@ -459,10 +420,8 @@ void _HW_ByteDebug_ClearBit( uint8_t WhichBit ){
 // update the shadow register contents and write the new data to the SSI 
 // data register
     ByteDebugPortShadow &= ~(BIT0HI << WhichBit);
-  // make sure that there is room in the FIFO, then write new data
-  while(0 == (HWREG(SSI1_BASE + SSI_O_SR) & SSI_SR_TNF))
-    ;
-  HWREG(SSI1_BASE + SSI_O_DR) = ByteDebugPortShadow;
+  // queue the new data for SSI1
+  ByteDebugSend(&ByteDebugPortShadow, 1);
 }
 
 /****************************************************************************
@@ -485,10 +444,8 @@ void _HW_ByteDebug_SetBit( uint8_t WhichBit ){
 // update the shadow register contents and write the new data to the SSI 
 // data register
     ByteDebugPortShadow |= (BIT0HI << WhichBit);
-  // make sure that there is room in the FIFO, then write new data
-  while(0 == (HWREG(SSI1_BASE + SSI_O_SR) & SSI_SR_TNF))
-    ;
-  HWREG(SSI1_BASE + SSI_O_DR) = ByteDebugPortShadow;
+  // queue the new data for SSI1
+  ByteDebugSend(&ByteDebugPortShadow, 1);
 }
 
 /****************************************************************************
@@ -508,19 +465,15 @@ void _HW_ByteDebug_SetBit( uint8_t WhichBit ){
      J. Edward Carryer, 07/30/18 09:50
 ****************************************************************************/
 void _HW_ByteDebug_SetValueWithStrobe( uint8_t NewValue ){
+  uint8_t Strobe[2];
   
 // update the shadow register contents and write the new data to the SSI 
 // data register first with bit 7 hi, then with bit 7 lo
     ByteDebugPortShadow = NewValue;
-  // make sure that there is room in the FIFO, then write new data with B7 hi
-  while(0 == (HWREG(SSI1_BASE + SSI_O_SR) & SSI_SR_TNF))
-      ;
-  HWREG(SSI1_BASE + SSI_O_DR) = ByteDebugPortShadow | BIT7HI;
-  
-  // make sure that there is room in the FIFO, then write new data with B7 lo
-  while(0 == (HWREG(SSI1_BASE + SSI_O_SR) & SSI_SR_TNF))
-      ;
-  HWREG(SSI1_BASE + SSI_O_DR) = ByteDebugPortShadow & BIT7LO;
+  Strobe[0] = ByteDebugPortShadow | BIT7HI;
+  Strobe[1] = ByteDebugPortShadow & BIT7LO;
+  // one frame, so the two bytes go out back to back
+  ByteDebugSend(Strobe, 2);
   
 }
 
@@ -544,9 +497,33 @@ void _HW_ByteDebug_SetValue( uint8_t NewValue ){
 // update the shadow register contents and write the new data to the SSI 
 // data register
     ByteDebugPortShadow = NewValue;
-  // make sure that there is room in the FIFO, then write new data
-  while(0 == (HWREG(SSI1_BASE + SSI_O_SR) & SSI_SR_TNF))
-      ;
-  HWREG(SSI1_BASE + SSI_O_DR) = ByteDebugPortShadow;
+  // queue the new data for SSI1
+  ByteDebugSend(&ByteDebugPortShadow, 1);
     
 }
+
+/****************************************************************************
+ Function
+     ByteDebugSend
+ Parameters
+     const uint8_t *Bytes, the frame for the 'HC595
+     uint8_t Length, bytes in it
+ Returns
+     None.
+ Description
+     Queues the frame on SSI1, waiting for room if the queue is full
+ Notes
+     Task level only: room comes from the SSI1 done interrupt, so called
+     from an interrupt or a critical section a full queue never drains.
+     A frame refused with the queue empty (never set up) is dropped.
+ Author
+     Sander Tonkens
+****************************************************************************/
+static void ByteDebugSend(const uint8_t *Bytes, uint8_t Length)
+{
+  while (!SSI_Transfer(&ByteDebugDevice, Bytes, Length, NULL) &&
+         (SSI_QueryWaiting(SSI_BUS1) != 0))
+  {
+    // the SSI1 interrupt takes the frame ahead of this one off the queue
+  }
+}
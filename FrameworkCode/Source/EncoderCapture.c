@@ -66,6 +66,10 @@ static uint32_t Last_Capture_2B;
 static float TickCount_1;
 static float TickCount_2;
 
+//Running tick totals, never reset (used by odometry)
+static int32_t Odometer_1;
+static int32_t Odometer_2;
+
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service.They should be functions
    relevant to the behavior of this service
@@ -136,6 +140,40 @@ float QueryEncoderTickCount(uint8_t wheel)
 	}
 }
 
+/****************************************************************************
+ Function
+   QueryEncoderOdometer
+
+ Parameters
+uint8_t: select which wheel's running tick total to return
+
+ Returns
+   Signed tick total for the selected wheel since power up
+
+ Description
+	Unlike the tick count this is never reset, so deltas taken from it
+	stay valid across Drive_Stop
+ Notes
+   
+ Author
+   Sander Tonkens
+****************************************************************************/
+int32_t QueryEncoderOdometer(uint8_t wheel)
+{
+	if (wheel == WHEEL_1)
+	{
+		return Odometer_1;
+	}
+	else if (wheel == WHEEL_2)
+	{
+		return Odometer_2;
+	}
+	else
+	{
+		return 0;
+	}
+}
+
 /****************************************************************************
  Function
    Enc_ResetTickCount
@@ -463,6 +501,7 @@ void Enc_1AISR(void)
     //Testing alternative
     //Decrement Tick Count and take negative of Last Period
 		TickCount_1--;
+		Odometer_1--;
 		Last_Period_1A = -Last_Period_1A;    
 	}
 	else
@@ -472,6 +511,7 @@ void Enc_1AISR(void)
 		//Last_Period_1A = -Last_Period_1A;
     //Testing alternative
 		TickCount_1++;
+		Odometer_1++;
 	}
 	
 }
@@ -508,10 +548,12 @@ void Enc_2AISR(void)
 	if(HWREG(GPIO_PORTC_BASE + (GPIO_O_DATA + ALL_BITS)) & BIT7HI)
 	{
 		TickCount_2++;
+		Odometer_2++;
 	}
 	else
 	{
 		TickCount_2--;
+		Odometer_2--;
 		Last_Period_2A = - Last_Period_2A;
 	}
 }
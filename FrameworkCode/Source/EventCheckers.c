@@ -112,9 +112,15 @@ bool Check4Keystroke(void)
 		ES_Event_t ThisEvent;
     ThisEvent.EventType   = ES_NEW_KEY;
     ThisEvent.EventParam  = GetNewKey();
-    // test distribution list functionality by sending the 'L' key out via
-    // a distribution list.
-    PostMotorService(ThisEvent);
+    // an open parameter console command line takes every key
+    if (PC_IsActive() || (ThisEvent.EventParam == PC_OPEN_KEY))
+    {
+      PostParamConsole(ThisEvent);
+    }
+    else
+    {
+      PostMotorService(ThisEvent);
+    }
 
     return true;
   }else
@@ -0,0 +1,381 @@
+/****************************************************************************
+ Module
+   FastMath.c
+
+ Revision
+   1.0.1
+
+ Description
+   Single precision trig and reciprocal approximations for the localization
+   and control code
+
+ Notes
+   The scalar functions and the batch loops share the same kernels. The
+   kernels have no branches and no table lookups: range reduction rounds
+   with the 1.5*2^23 trick, both quadrant polynomials are always evaluated
+   and the result is picked with selects, so on the M4F they run in a fixed
+   time and on the host the batch loops auto-vectorize.
+
+   The rounding trick depends on strict float evaluation, do not build this
+   file with fast-math style options.
+
+   sin/cos use the Cody-Waite split of PI/2 and the Cephes minimax
+   polynomials on [-PI/4, PI/4]. atan uses the Hastings polynomial
+   (Abramowitz and Stegun 4.4.49, |error| <= 1e-5) after folding into
+   [0, 1].
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 16:40 ST       first pass, SineQ15 moved here from Odometry
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <string.h> //for memcpy
+
+#include "FastMath.h"
+
+/*---------------------------- Module Defines ----------------------------*/
+#define TWO_OVER_PI 0.636619772367581f
+#define PI_OVER_2 1.57079632679490f
+// PI/2 split so that n*PIO2_HI is exact for |n| < 2^13
+#define PIO2_HI 1.5703125f
+#define PIO2_MID 4.83751296997e-4f
+#define PIO2_LO 7.54978995489e-8f
+// Adding and subtracting this rounds to the nearest integer for |x| < 2^22
+#define ROUND_MAGIC 12582912.0f
+
+// sin(r) = r + r^3*(S1 + r^2*(S2 + r^2*S3))
+#define S1 -1.6666654611e-1f
+#define S2 8.3321608736e-3f
+#define S3 -1.9515295891e-4f
+// cos(r) = 1 - r^2/2 + r^4*(C1 + r^2*(C2 + r^2*C3))
+#define C1 4.166664568298827e-2f
+#define C2 -1.388731625493765e-3f
+#define C3 2.443315711809948e-5f
+
+// atan(z) = z*(A1 + z^2*(A3 + z^2*(A5 + z^2*(A7 + z^2*A9)))), 0 <= z <= 1
+#define A1 0.9998660f
+#define A3 -0.3302995f
+#define A5 0.1801410f
+#define A7 -0.0851330f
+#define A9 0.0208351f
+
+// Reciprocal seed, exponent negation with a tuned mantissa
+#define RECIP_MAGIC 0x7EF311C3u
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void SinCosKernel(float x, float *Sin, float *Cos);
+static float Atan2Kernel(float y, float x);
+
+/*---------------------------- Module Variables ---------------------------*/
+// First quadrant of sin() in Q15, 64 steps plus the end point
+static const int16_t SineTable[65] = {
+  0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+  6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+  12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+  18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+  23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+  27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+  30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+  32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+  32767
+};
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   FM_Sinf
+
+ Parameters
+   float x, radians
+
+ Returns
+   float, sin(x)
+
+ Description
+   Polynomial sin, see FastMath.h for the error bound
+ Author
+   Sander Tonkens
+****************************************************************************/
+float FM_Sinf(float x)
+{
+  float Sin, Cos;
+
+  SinCosKernel(x, &Sin, &Cos);
+  return Sin;
+}
+
+/****************************************************************************
+ Function
+   FM_Cosf
+
+ Parameters
+   float x, radians
+
+ Returns
+   float, cos(x)
+
+ Description
+   Polynomial cos, see FastMath.h for the error bound
+ Author
+   Sander Tonkens
+****************************************************************************/
+float FM_Cosf(float x)
+{
+  float Sin, Cos;
+
+  SinCosKernel(x, &Sin, &Cos);
+  return Cos;
+}
+
+/****************************************************************************
+ Function
+   FM_SinCosf
+
+ Parameters
+   float x, radians
+   float *Sin, float *Cos: results
+
+ Returns
+   void
+
+ Description
+   sin and cos together for the price of one range reduction
+ Author
+   Sander Tonkens
+****************************************************************************/
+void FM_SinCosf(float x, float *Sin, float *Cos)
+{
+  SinCosKernel(x, Sin, Cos);
+}
+
+/****************************************************************************
+ Function
+   FM_Tanf
+
+ Parameters
+   float x, radians
+
+ Returns
+   float, tan(x)
+
+ Description
+   sin/cos, one divide. Returns +-inf at the poles like tanf
+ Author
+   Sander Tonkens
+****************************************************************************/
+float FM_Tanf(float x)
+{
+  float Sin, Cos;
+
+  SinCosKernel(x, &Sin, &Cos);
+  return Sin/Cos;
+}
+
+/****************************************************************************
+ Function
+   FM_Atan2f
+
+ Parameters
+   float y, float x
+
+ Returns
+   float, atan2(y, x) in -PI..PI
+
+ Description
+   Polynomial atan2, returns 0 for (0, 0)
+ Author
+   Sander Tonkens
+****************************************************************************/
+float FM_Atan2f(float y, float x)
+{
+  return Atan2Kernel(y, x);
+}
+
+/****************************************************************************
+ Function
+   FM_Recipf
+
+ Parameters
+   float x, must be a normal float
+
+ Returns
+   float, 1/x
+
+ Description
+   Bit trick seed and three Newton-Raphson steps. Only worth it where a
+   divide stalls the pipeline (VDIV is 14 cycles and blocks the FPU on
+   the M4F), otherwise plain division is as fast and exact
+ Author
+   Sander Tonkens
+****************************************************************************/
+float FM_Recipf(float x)
+{
+  uint32_t Bits;
+  float r;
+
+  memcpy(&Bits, &x, sizeof(Bits));
+  Bits = RECIP_MAGIC - Bits;
+  memcpy(&r, &Bits, sizeof(r));
+  r = r*(2.0f - x*r);
+  r = r*(2.0f - x*r);
+  r = r*(2.0f - x*r);
+  return r;
+}
+
+/****************************************************************************
+ Function
+   FM_SinQ15
+
+ Parameters
+   uint32_t Angle, binary angle (2^32 is a full turn)
+
+ Returns
+   int32_t, sin(Angle) in Q15
+
+ Description
+   Table lookup with linear interpolation, integer only so it is safe in
+   the control ISR without touching the FPU
+ Author
+   Sander Tonkens
+****************************************************************************/
+int32_t FM_SinQ15(uint32_t Angle)
+{
+  uint32_t Quadrant = Angle >> 30;
+  uint32_t Offset = Angle << 2;
+  uint32_t Index;
+  int32_t Fraction;
+  int32_t Value;
+
+  //second and fourth quadrants run the table backwards
+  if (Quadrant & 1)
+  {
+    Offset = ~Offset;
+  }
+  Index = Offset >> 26;
+  Fraction = (Offset >> 10) & 0xFFFF;
+  Value = SineTable[Index] +
+      (((SineTable[Index + 1] - SineTable[Index]) * Fraction) >> 16);
+
+  if (Quadrant & 2)
+  {
+    return -Value;
+  }
+  return Value;
+}
+
+/****************************************************************************
+ Function
+   FM_CosQ15
+
+ Parameters
+   uint32_t Angle, binary angle (2^32 is a full turn)
+
+ Returns
+   int32_t, cos(Angle) in Q15
+
+ Description
+   FM_SinQ15 a quarter turn ahead
+ Author
+   Sander Tonkens
+****************************************************************************/
+int32_t FM_CosQ15(uint32_t Angle)
+{
+  return FM_SinQ15(Angle + 0x40000000u);
+}
+
+/****************************************************************************
+ Function
+   FM_SinCosBatch
+
+ Parameters
+   const float *x: angles in radians
+   float *Sin, float *Cos: results, may not alias x
+   uint16_t Count
+
+ Returns
+   void
+
+ Description
+   FM_SinCosf over an array
+ Author
+   Sander Tonkens
+****************************************************************************/
+void FM_SinCosBatch(const float *x, float *Sin, float *Cos, uint16_t Count)
+{
+  uint16_t i;
+
+  for (i = 0; i < Count; i++)
+  {
+    SinCosKernel(x[i], &Sin[i], &Cos[i]);
+  }
+}
+
+/****************************************************************************
+ Function
+   FM_Atan2Batch
+
+ Parameters
+   const float *y, const float *x
+   float *Out: results in radians, may not alias the inputs
+   uint16_t Count
+
+ Returns
+   void
+
+ Description
+   FM_Atan2f over an array
+ Author
+   Sander Tonkens
+****************************************************************************/
+void FM_Atan2Batch(const float *y, const float *x, float *Out, uint16_t Count)
+{
+  uint16_t i;
+
+  for (i = 0; i < Count; i++)
+  {
+    Out[i] = Atan2Kernel(y[i], x[i]);
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static void SinCosKernel(float x, float *Sin, float *Cos)
+{
+  float n = (x*TWO_OVER_PI + ROUND_MAGIC) - ROUND_MAGIC;
+  int32_t Quadrant = (int32_t)n;
+  float r = ((x - n*PIO2_HI) - n*PIO2_MID) - n*PIO2_LO;
+  float r2 = r*r;
+  float s = r + r*r2*(S1 + r2*(S2 + r2*S3));
+  float c = 1.0f - 0.5f*r2 + r2*r2*(C1 + r2*(C2 + r2*C3));
+  float OutSin = (Quadrant & 1) ? c : s;
+  float OutCos = (Quadrant & 1) ? s : c;
+
+  //quadrants 2 and 3 negate sin, 1 and 2 negate cos
+  *Sin = (Quadrant & 2) ? -OutSin : OutSin;
+  *Cos = ((Quadrant + 1) & 2) ? -OutCos : OutCos;
+}
+
+static float Atan2Kernel(float y, float x)
+{
+  float ax = (x < 0) ? -x : x;
+  float ay = (y < 0) ? -y : y;
+  float Big = (ay > ax) ? ay : ax;
+  float Small = (ay > ax) ? ax : ay;
+  float z = Small/((Big > 0) ? Big : 1.0f);
+  float z2 = z*z;
+  float a = z*(A1 + z2*(A3 + z2*(A5 + z2*(A7 + z2*A9))));
+
+  a = (ay > ax) ? PI_OVER_2 - a : a;
+  a = (x < 0) ? FM_PI - a : a;
+  return (y < 0) ? -a : a;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,120 @@
+/****************************************************************************
+ Module
+   FrequencyTable.c
+
+ Revision
+   1.0.1
+
+ Description
+   Constant time lookup from a capture period to the index of the matching
+   beacon frequency
+
+ Notes
+   Periods are binned like a float: the position of the top bit picks the
+   octave (one CLZ instruction) and the next MANT_BITS bits pick one of 128
+   bins inside it, so every bin is within 0.8% of its neighbours whatever the
+   frequency, and covers 153Hz to 2.4kHz in 512 bins.
+
+   The bin table is a const initializer expanded by the preprocessor from
+   the frequency list, so it lives in flash and nothing runs at init. A
+   bin maps to a frequency when the period at the center of the bin is
+   within the tolerance of that frequency's period.
+
+   The recycling centers send on beacon frequencies and the recycle list is
+   only ever sent by us (IREmitter), so it needs no table.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 18:40 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "FrequencyTable.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MANT_BITS 7
+#define MANT_MASK ((1 << MANT_BITS) - 1)
+#define MIN_EXP 14    // 2^14 ticks, 2441Hz
+#define NUM_OCTAVES 4 // up to 2^18 ticks, 153Hz
+#define NUM_BINS (NUM_OCTAVES << MANT_BITS)
+
+// Tolerance on the period in parts per thousand
+#define BEACON_TOLERANCE 50  // neighbours are at least 16% apart
+
+#if defined(__CC_ARM)
+#define CLZ(x) __clz(x)
+#else
+#define CLZ(x) __builtin_clz(x)
+#endif
+
+// Period in the middle of bin b
+#define BIN_CENTER(b) \
+  (((((b) & MANT_MASK) | (1 << MANT_BITS)) * 2 + 1) << \
+      (((b) >> MANT_BITS) + MIN_EXP - MANT_BITS - 1))
+#define ABS_DIFF(a, b) (((a) > (b)) ? ((a) - (b)) : ((b) - (a)))
+#define IN_BAND(c, f, t) (ABS_DIFF(c, FT_PERIOD(f)) * 1000 <= FT_PERIOD(f) * (t))
+
+// One list entry: its index if the bin center is in band, else try the next
+#define BAND_TEST(i, f, c, t) IN_BAND(c, f, t) ? (i) :
+#define BIN(List, b, t) (List(BAND_TEST, BIN_CENTER(b), t) FT_NO_MATCH)
+
+#define BINS_4(List, b, t) BIN(List, (b), t), BIN(List, (b) + 1, t), \
+  BIN(List, (b) + 2, t), BIN(List, (b) + 3, t)
+#define BINS_16(List, b, t) BINS_4(List, (b), t), BINS_4(List, (b) + 4, t), \
+  BINS_4(List, (b) + 8, t), BINS_4(List, (b) + 12, t)
+#define BINS_64(List, b, t) BINS_16(List, (b), t), BINS_16(List, (b) + 16, t), \
+  BINS_16(List, (b) + 32, t), BINS_16(List, (b) + 48, t)
+#define BINS_256(List, b, t) BINS_64(List, (b), t), BINS_64(List, (b) + 64, t), \
+  BINS_64(List, (b) + 128, t), BINS_64(List, (b) + 192, t)
+#define BINS_512(List, t) BINS_256(List, 0, t), BINS_256(List, 256, t)
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static uint8_t Lookup(const uint8_t *Bins, uint32_t Period);
+
+/*---------------------------- Module Variables ---------------------------*/
+static const uint8_t BeaconBins[NUM_BINS] = {
+  BINS_512(FT_BEACON_LIST, BEACON_TOLERANCE)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   FT_ClassifyBeacon
+
+ Parameters
+   uint32_t Period : edge to edge, in 40MHz ticks
+
+ Returns
+   uint8_t : beacon index (0 = A), FT_NO_MATCH if none is within 5%
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t FT_ClassifyBeacon(uint32_t Period)
+{
+  return Lookup(BeaconBins, Period);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static uint8_t Lookup(const uint8_t *Bins, uint32_t Period)
+{
+  uint32_t Exponent;
+
+  if (((Period >> MIN_EXP) == 0) || ((Period >> (MIN_EXP + NUM_OCTAVES)) != 0))
+  {
+    return FT_NO_MATCH;
+  }
+  Exponent = 31 - CLZ(Period);
+  return Bins[((Exponent - MIN_EXP) << MANT_BITS) |
+      ((Period >> (Exponent - MANT_BITS)) & MANT_MASK)];
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
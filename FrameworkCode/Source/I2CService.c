@@ -6,24 +6,63 @@
    1.0.1
 
  Description
-   Sample I2C interface file based on the TCS34725 Color sensor
+   Transaction manager for the devices on I2C1
 
  Notes
     Implements a generic interface based on lists of steps to be executed
-    in response to external requests. The basic state machine will step
-    though executing the steps with pauses based on waiting for the I2C 
-    step to complete or on time, since some devices require a delay between
-    issued commands.
- 
-    
+    in response to requests. Each device on the bus is described by an
+    I2CDevice_t (address, bus speed and its lists of steps), the driver
+    for the device asks for one of its lists with I2C_Request and is told
+    through its I2CDoneFunc_t when the list is done. Requests wait in a
+    ring of I2C_QUEUE_SIZE and run one after the other in the order they
+    were made.
+
+    The I2C1 master interrupt runs the steps: each time the hardware
+    finishes a transfer I2C_MasterISR takes the next steps up to the one
+    that starts another transfer, and at the end of a list it starts the
+    next request straight away, so the bus does not wait on the framework
+    while there is work queued. The service only hears about a request at
+    its end (EV_I2C_EOS) and at a step with a time wait (EV_I2C_Wait4Time),
+    since some devices require a delay between issued commands. It runs the
+    timer, resumes the list when it expires and calls the done functions,
+    so those run at task level and may make new requests. A time wait
+    keeps the bus, use them for power up sequences only.
+
+    The queue has one writer at each end: I2C_Request fills slots at Tail,
+    the bus side (the ISR, or the service resuming after a time wait) runs
+    them from Head, and the service reports and frees them from Finished.
+    Starting the bus from task level is done with interrupts off, with
+    PRIMASK kept in a local: running the queue can post to the service,
+    and the EnterCritical in the post would overwrite the one copy that
+    EnterCritical/ExitCritical share, leaving interrupts off.
+
+    A failed transfer (no ack, arbitration lost or a slave holding SCL low
+    past the clock low timeout) stops the list in the ISR and hands the bus
+    to the service with EV_I2C_BusError. The service ends the transfer with
+    a stop, and if the bus is still not free it takes the pins off the
+    module, clocks SCL by hand until the slave holding SDA lets go (at most
+    9 clocks, the rest of the byte it thinks it is sending), sends a stop
+    and resets the module. Then the request runs again from its first step,
+    up to MAX_RETRIES times before it is reported as failed. The lists are
+    register reads and writes, so running one again is harmless.
+
+    The drivers of the devices on the bus (ColourSensor) are services of
+    their own. Their requests may come before ES_INIT has set up the
+    module, those wait in the queue until it has.
+
+    Bus statistics count the bits clocked for every transfer, start, stop
+    and ack included, at the bus speed of the device: 1 address write plus
+    an 8 byte read is 102 bit times, about 1 ms at 100 kbps.
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
 // standard library includes
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 // gets us address of I2C peripheral
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
 
 //includes for TivaWare library references
 #include "driverlib/rom.h"
@@ -31,164 +70,114 @@
 #include "driverlib/gpio.h"
 #include "driverlib/i2c.h"
 #include "driverlib/pin_map.h"
+#include "driverlib/interrupt.h"
 
 // The usual Framework headers
 #include "ES_Configure.h"
 #include "ES_Framework.h"
-#include "ES_DeferRecall.h"
-
-// The info on the device that we will be talking to
-#include "TCS3472x.h"
+#include "ES_Port.h"
 
 //Finally our service header
 #include "I2CService.h"
 
 
 /*----------------------------- Module Defines ----------------------------*/
-#define DEVICE_ADDR TCS3472x_ADDRESS
+#define QUEUE_MASK (I2C_QUEUE_SIZE - 1)
 
-// do transaction with/without stop generation
-#define DO_STOP  true
-#define NO_STOP  false
+// bits on the bus for one byte: 8 data and the ack, plus the start and the
+// address byte before it and the stop after it when those are sent
+#define BYTE_BITS  9
+#define START_BITS (1 + BYTE_BITS)
+#define STOP_BITS  1
 
-// do transaction with/without start generation
-#define DO_START  true
-#define NO_START  false
+// BusBits counts in 400 kbps bit times (2.5 us), a 100 kbps bit is 4 of them
+#define SLOW_BIT_WEIGHT 4
 
-// are we aiting on busy or time?
-#define BUSY_WAIT  true
-#define TIME_WAIT  false
+// times a failed request is run again before it is reported as failed
+#define MAX_RETRIES 2
 
-// confirm that these match the order in the Sequence Lists
-#define INIT_INDEX 0
-#define READ_CLR   1
-#define READ_RED   2
-#define READ_GRN   3
-#define READ_BLU   4
+// SCL clocks to free a stuck SDA, and loops of polling for the error stop
+#define RECOVERY_PULSES 9
+#define BUSY_POLLS 1000
 
+// clock low timeout, in units of 16 SCL periods: about 40 ms at 100 kbps
+#define CLOCK_LOW_TIMEOUT 0xff
 
-// Integration Time, in ms for TCS3472x
-// make sure that this matches constant programmed in Init
-#define INT_TIME 350
+// SysCtlDelay loops (3 clocks each) for half of a 100 kbps bit
+#define HALF_BIT_LOOPS(Clock) ((Clock) / 600000)
 
 /*----------------------------- Module Types ----------------------------*/
-typedef enum    /* definitions for the possible steps in command sequence */
-{
-  CMD_Write8,     /* write 8 bits to I2C with start & stop */
-  CMD_Write8NS,   /* write 8 bits to I2C with no start but with stop */  
-  CMD_WriteMult,  /* write 8 bits to I2C with start but with-out stop */
-  CMD_WriteMultNS,/* write 8 bits to I2C with no start or stop */
-  CMD_Read8,      /* read 8 bits to I2C with start & stop */
-  CMD_Read8NS,    /* read 8 bits to I2C with no start but with stop */  
-  CMD_ReadMult,   /* read 8 bits to I2C with start but with-out stop */
-  CMD_ReadMultNS, /* read 8 bits to I2C with no start or stop */
-  CMD_GetResult,  /* fetches the result of the last read operation */
-  CMD_Form16,     /* combine 2 8-bit temp values into 16bit result */
-  CMD_NOP,        /* No-Operation, used for time-only delays */
-  CMD_EOS         /* End Of Sequence marker */
-} CMD_t;
-
-typedef struct  /* definition of each step */
+typedef struct  /* one request for a list of steps */
 {
-  CMD_t Command;
-  uint8_t Value;
-  uint16_t WaitTime;
-  bool BusyWait;
-  void * Result;
-}StepDefinition_t;
+  const I2CDevice_t *Device;
+  uint8_t Sequence;
+  I2CDoneFunc_t *Done;
+  bool Ok;
+}Request_t;
+
+typedef char QueueSizeIsPowerOfTwo[
+  ((I2C_QUEUE_SIZE & QUEUE_MASK) == 0) ? 1 : -1];
 
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this machine.
 */
 static void I2C1_Init(void);
+static void I2C1_SetUpModule(void);
 static void I2C1_Write1Byte( uint8_t slave_addr, uint8_t value, bool InclStart, bool InclStop);
 static void I2C1_Read1Byte( uint8_t slave_addr, bool InclStart,  bool InclStop);
+static void RunQueue(void);
+static bool RunSteps(void);
 static void InterpretCommand(StepDefinition_t CurrentStep);
+static void ReportFinished(void);
+static void HandleBusError(uint32_t Error);
+static void RecoverBus(void);
+static void CountBits(bool InclStart, bool InclStop);
+static void UpdateElapsed(void);
 
 /*---------------------------- Module Variables ---------------------------*/
 // everybody needs a state variable, you may need others as well.
 // type of state variable should match that of enum in header file
+// (InitPState until ES_INIT, then QueryI2CService works it out)
 static I2CState_t CurrentState;
 
 // with the introduction of Gen2, we need a module level Priority var as well
 static uint8_t MyPriority;
 
-// These are the local varaibles for the color sensor
-static uint8_t readOne;   // temp location for low byte of 16 bit reads
-static uint8_t readTwo;   // temp location for hi byte of 16 bit reads
-static uint16_t ClearValue;
-static uint16_t RedValue;
-static uint16_t GreenValue;
-static uint16_t BlueValue;
-
-// index for which of the posible command sequences we are executing
-static uint8_t CommandIndex;
+// the requests, see the notes above for who moves which index
+static Request_t Queue[I2C_QUEUE_SIZE];
+static volatile uint8_t Tail;       // next free slot, task side
+static volatile uint8_t Head;       // request on the bus or next to start
+static volatile uint8_t Finished;   // next request to report, service side
+static volatile bool Active;        // Head owns the bus
+static volatile bool TimeWait;      // ... and is in a time wait
+static volatile bool Recovering;    // ... and the service is clearing an error
+
+// the list being run, only touched by whoever owns the bus
+static const I2CDevice_t *Device;
+static const StepDefinition_t *Steps;
 // index for stepping through the steps in a command
 static uint8_t StepIndex;
 // Content of the current step in the sequence
 static StepDefinition_t CurrentStep;
-
-static const StepDefinition_t SequenceLists[5][9] = {
-  /* First up is the power-up initialization sequence */
-  { {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the Enable register */
-    {CMD_Write8NS, TCS3472x_ENABLE_PON, 0, BUSY_WAIT, NULL}, /* set the PON bit to power up */
-    {CMD_NOP, 0, 4, TIME_WAIT, NULL}, /* time wait for min. 3ms with timer uncertainty */
-    {CMD_WriteMult, (TCS3472x_ATIME_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the ATIME register */
-    {CMD_Write8NS, TCS3472x_INT_TIME_350MS, 0, BUSY_WAIT, NULL}, /* program the integration time */
-    {CMD_WriteMult, (TCS3472x_ENABLE_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the Enable register */
-    {CMD_Write8NS, (TCS3472x_ENABLE_PON | TCS3472x_ENABLE_AEN), 0, BUSY_WAIT, NULL}, /* set the PON & AEN bits to start conversion */
-    {CMD_NOP, 0, (INT_TIME+1), TIME_WAIT, NULL}, /* time wait for min. INT_TIME with timer uncertainty */
-    {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
-  },
-  /* next is read the clear results */
-  { {CMD_WriteMult, (TCS3472x_CDATAL_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the low byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readOne}, /* fetch result and move to next step */
-    {CMD_WriteMult, (TCS3472x_CDATAH_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the hi byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the hi byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readTwo}, /* fetch result and move to next step */
-    {CMD_Form16, 0, 0, TIME_WAIT, &ClearValue}, /* combine the 2 8-bit resutls */
-    {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
-  },
-  /* next is read the red results */
-  { {CMD_WriteMult, (TCS3472x_RDATAL_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the low byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readOne}, /* fetch result and move to next step */
-    {CMD_WriteMult, (TCS3472x_RDATAH_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the hi byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the hi byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readTwo}, /* fetch result and move to next step */
-    {CMD_Form16, 0, 0, TIME_WAIT, &RedValue}, /* combine the 2 8-bit resutls */
-    {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
-  },
-  /* next is read the green results */
-  { {CMD_WriteMult, (TCS3472x_GDATAL_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the low byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readOne}, /* fetch result and move to next step */
-    {CMD_WriteMult, (TCS3472x_GDATAH_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the hi byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the hi byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readTwo}, /* fetch result and move to next step */
-    {CMD_Form16, 0, 0, TIME_WAIT, &GreenValue}, /* combine the 2 8-bit resutls */
-    {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
-  },
-  /* next is read the blue results */
-  { {CMD_WriteMult, (TCS3472x_BDATAL_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the lo byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the low byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readOne}, /* fetch result and move to next step */
-    {CMD_WriteMult, (TCS3472x_BDATAH_REG | TCS3472x_COMMAND_BIT), 0, BUSY_WAIT, NULL}, /* select the hi byte result register */
-    {CMD_Read8, 0, 0, BUSY_WAIT, NULL}, /* read the hi byte value */
-    {CMD_GetResult, 0, 0, TIME_WAIT, &readTwo}, /* fetch result and move to next step */
-    {CMD_Form16, 0, 0, TIME_WAIT, &BlueValue}, /* combine the 2 8-bit resutls */
-    {CMD_EOS, 0, 0, TIME_WAIT, NULL} /* mark the end of this sequence */
-  }
-};
-
-// this flag is used by the event checker to detect the busy-not-busy transition
-static bool I2C1_Busy;
-
-// add a deferral queue for up to 5 pending deferrals of commands
-// +1 to allow for ovehead in queue
-// make sure that the I2Cservice queue is at least this size as well.
-static ES_Event_t DeferralQueue[5 + 1];
+// bytes of the current CMD_ReadBurst received so far
+static uint8_t BurstCount;
+// times the current request has been run again after an error
+static uint8_t Tries;
+// whether the last transfer ended with a stop
+static bool StopSent;
+// the last two bytes fetched by CMD_GetResult, for CMD_Form16
+static uint8_t readOne;   // the one before
+static uint8_t readTwo;   // the last one
+
+// speed the module is set up for, and the clock to work it out from
+static bool FastNow;
+static uint32_t SysClock;
+static uint32_t HalfBitLoops;
+
+// statistics
+static I2CStats_t Stats;
+static volatile uint32_t BusBits;
+static uint16_t LastTime;
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -214,9 +203,13 @@ bool InitI2CService(uint8_t Priority)
   ES_Event_t ThisEvent;
 
   MyPriority = Priority;
-  // initialize deferral queue to allow for commands that arrive before
-  // the last sequence was conpleted
-  ES_InitDeferralQueueWith(DeferralQueue, ARRAY_SIZE(DeferralQueue));
+  // start with nothing queued
+  Tail = 0;
+  Head = 0;
+  Finished = 0;
+  Active = false;
+  TimeWait = false;
+  Recovering = false;
   // put us into the Initial PseudoState
   CurrentState = InitPState;
   // post the initial transition event
@@ -264,226 +257,76 @@ bool PostI2CService(ES_Event_t ThisEvent)
    ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
 
  Description
-   add your description here
+   Starts the bus, runs the time waits of the lists and reports finished
+   requests
  Notes
-   uses nested switch/case to implement the machine.
+
  Author
    J. Edward Carryer, 01/15/19, 15:23
 ****************************************************************************/
 ES_Event_t RunI2CService(ES_Event_t ThisEvent)
 {
   ES_Event_t ReturnEvent;
+  uint32_t Mask;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
 
-  switch (CurrentState)
+  UpdateElapsed();
+  switch (ThisEvent.EventType)
   {
-    case InitPState:        // If current state is initial Psedudo State
+    case ES_INIT:
     {
-      if (ThisEvent.EventType == ES_INIT)    // only respond to ES_Init
+      if (InitPState == CurrentState)
       {
-        // Initialize the I2C module
+        // Initialize the I2C module, then run what was queued before it
         I2C1_Init();
-        // now put the machine into the idle state
+        Mask = CPUgetPRIMASK_cpsid();
         CurrentState = Idle;
-        // and post a message to ourselves to start the init sequnce
-        { 
-          ES_Event_t ThisEvent;
-          ThisEvent.EventType = EV_I2C_InitSensor;
-          PostI2CService( ThisEvent );
+        if (!Active)
+        {
+          RunQueue();
         }
+        CPUsetPRIMASK(Mask);
       }
-    } // end of InitPState processing
+    }
     break;
 
-    case Idle:
+    case EV_I2C_Wait4Time:
     {
-      switch (ThisEvent.EventType)
-      {
-        case EV_I2C_InitSensor:  
-        {  
-          // Set up the indices into the command sequence lists
-          CommandIndex = INIT_INDEX; // start with the initialization sequence
-        }
-        break;
-
-        case EV_I2C_ReadClear:  
-        {  
-          // Set up the indices into the command sequence lists
-          CommandIndex = READ_CLR; // read the clear result
-        }
-        break;
-
-        case EV_I2C_ReadRed:  
-        {  
-          // Set up the indices into the command sequence lists
-          CommandIndex = READ_RED; // read the clear result
-        }
-        break;
-
-        case EV_I2C_ReadGreen:  
-        {  
-          // Set up the indices into the command sequence lists
-          CommandIndex = READ_GRN; // read the clear result
-        }
-        break;
-
-        case EV_I2C_ReadBlue:  
-        {  
-          // Set up the indices into the command sequence lists
-          CommandIndex = READ_BLU; // read the clear result
-        }
-        break;
-
-        case EV_I2C_ReadAll:  
-        {  
-          // we read all by reading each color + clear
-          ES_Event_t ThisEvent;
-          ThisEvent.EventType = EV_I2C_ReadClear;
-          PostI2CService( ThisEvent );
-          ThisEvent.EventType = EV_I2C_ReadRed;
-          PostI2CService( ThisEvent );
-          ThisEvent.EventType = EV_I2C_ReadGreen;
-          PostI2CService( ThisEvent );
-          ThisEvent.EventType = EV_I2C_ReadBlue;
-          PostI2CService( ThisEvent );
-          CommandIndex = 0xff; // we didn't set up a list so skip that stuff
-        }
-        break;
-
-        case ES_TIMEOUT:  /* This is how we get repeating measurements */
-        {  
-          if(I2C_TIMER == ThisEvent.EventParam) // our timer?
-          {
-            ES_Event_t ThisEvent;
-            ThisEvent.EventType = EV_I2C_ReadAll;
-            PostI2CService( ThisEvent );
-          }
-          CommandIndex = 0xff; // we didn't set up a list so skip that stuff
-        }
-        default: // these are events that we don't process so flag that
-        {
-          CommandIndex = 0xff; // flag event as one we don't process
-        }  
-        break;
-      }  // end of switch on ThisEvent
-      
-      // code common to all legal transitions
-      if (0xff != CommandIndex) // don't do this unless we are setting up a list
-      {
-        StepIndex = 0; //start at the first step
-          
-        // put the machine into the interpreting state
-        CurrentState = Interpreting;
-        // and post a message to ourselves to take the next step in the sequence
-        { 
-          ES_Event_t ThisEvent;
-          ThisEvent.EventType = EV_I2C_NextStep;
-          PostI2CService( ThisEvent );
-        }
-      }
-    } // end of Idle state processing
+      // the list on the bus wants a delay before its next step
+      ES_Timer_InitTimer(I2C_TIMER, ThisEvent.EventParam);
+    }
     break;
 
-    case Interpreting:        
+    case EV_I2C_EOS:
     {
-      switch (ThisEvent.EventType)
-      {
-        case EV_I2C_NextStep:  
-        {   
-          // fetch the current instruction and inc the index to the next instruction
-          CurrentStep = SequenceLists[CommandIndex][StepIndex++];
-          InterpretCommand(CurrentStep);
-        }
-        break;
-
-        case EV_I2C_Wait4Busy:  
-        {   
-          CurrentState = Waiting4Busy;
-        }
-        break;
-
-        case EV_I2C_Wait4Time:  
-        {   
-          if( 0 != CurrentStep.WaitTime )
-          {
-            CurrentState = Waiting4Time;
-            ES_Timer_InitTimer(I2C_TIMER, CurrentStep.WaitTime);
-          }else
-          {   // if wait time is 0, then move to the next step immediately      
-            ES_Event_t ThisEvent;
-            ThisEvent.EventType = EV_I2C_NextStep;
-            PostI2CService( ThisEvent );
-            CurrentState = Interpreting;
-          }
-        }
-        break;
-
-        case EV_I2C_EOS:  
-        {   
-          CurrentState = Idle;
-          // recall any events that were deferred while processing
-          ES_RecallEvents(MyPriority, DeferralQueue);
-        }
-        break;
-
-        // if we didn't process it in this state, then defer it.
-        default:
-        {
-          ES_DeferEvent(DeferralQueue, ThisEvent);
-        }  
-        break;
-      }  // end of switch on ThisEvent
-    } // end of Interpreting state processing
+      ReportFinished();
+    }
     break;
-    
-    case Waiting4Busy:        
+
+    case EV_I2C_BusError:
     {
-      if( EV_I2C_StepFinished == ThisEvent.EventType)
-      {
-        // if no error, do the next step in the sequence
-        if (I2C_MASTER_ERR_NONE == ROM_I2CMasterErr(I2C1_BASE))
-        {  
-          ES_Event_t ThisEvent;
-          ThisEvent.EventType = EV_I2C_NextStep;
-          PostI2CService( ThisEvent );
-          CurrentState = Interpreting;
-        }else // otherwise go back to Idle
-        { 
-          puts("Error in I2C");
-          CurrentState = Idle;
-        }
-      }
-      else
-      {
-        // if we didn't process it in this state, then defer it.
-        ES_DeferEvent(DeferralQueue, ThisEvent);
-      }
-    } // end of Waiting4Busy state processing
+      HandleBusError(ThisEvent.EventParam);
+    }
     break;
-    
-    case Waiting4Time:        
+
+    case ES_TIMEOUT:
     {
-      if( (ES_TIMEOUT == ThisEvent.EventType) &&
-          (I2C_TIMER == ThisEvent.EventParam))
+      if ((I2C_TIMER == ThisEvent.EventParam) && TimeWait)
       {
-        ES_Event_t ThisEvent;
-        ThisEvent.EventType = EV_I2C_NextStep;
-        PostI2CService( ThisEvent );
-        CurrentState = Interpreting;
-      }else 
-      {
-        // if we didn't process it in this state, then defer it.
-        ES_DeferEvent(DeferralQueue, ThisEvent);
+        // carry on with the list after the wait
+        Mask = CPUgetPRIMASK_cpsid();
+        TimeWait = false;
+        RunQueue();
+        CPUsetPRIMASK(Mask);
       }
-    } // end of Waiting4Time state processing
+    }
     break;
 
-    // repeat state pattern as required for other states
     default:
     {
     }
     break;
-  }                                   // end switch on Current State
+  }
   return ReturnEvent;
 }
 
@@ -506,43 +349,203 @@ ES_Event_t RunI2CService(ES_Event_t ThisEvent)
 ****************************************************************************/
 I2CState_t QueryI2CService(void)
 {
-  return CurrentState;
+  if (InitPState == CurrentState)
+  {
+    return InitPState;
+  }
+  if (TimeWait)
+  {
+    return Waiting4Time;
+  }
+  return Active ? Running : Idle;
 }
 
-// Event checker to test when an I2C tranfer completes
-bool IsI2C1Finished(void)
+/****************************************************************************
+ Function
+     I2C_Request
+
+ Parameters
+     const I2CDevice_t * : the device, the descriptor must stay put
+     uint8_t : which of its lists to run
+     I2CDoneFunc_t * : called from the service when the list is done, or 0
+
+ Returns
+     bool : false if the queue is full or there is no such list
+
+ Description
+     Queues a list of steps for a device, it starts right away if the bus
+     is free
+ Notes
+     Task level only
+ Author
+     Sander Tonkens
+****************************************************************************/
+bool I2C_Request(const I2CDevice_t *Device, uint8_t Sequence,
+                 I2CDoneFunc_t *Done)
 {
-  if (( true == I2C1_Busy ) && (true != ROM_I2CMasterBusy(I2C1_BASE)))
-  {
-    ES_Event_t ThisEvent;
-    ThisEvent.EventType = EV_I2C_StepFinished;
-    PostI2CService( ThisEvent );
-    I2C1_Busy = false;   
-    return true;
-  }else
+  Request_t *Slot;
+  uint8_t NumWaiting;
+  uint32_t Mask;
+
+  if ((Sequence >= Device->NumSequences) ||
+      ((uint8_t)(Tail - Finished) >= I2C_QUEUE_SIZE))
   {
+    Stats.Refused++;
     return false;
   }
+  Slot = &Queue[Tail & QUEUE_MASK];
+  Slot->Device = Device;
+  Slot->Sequence = Sequence;
+  Slot->Done = Done;
+  Slot->Ok = false;
+  Stats.Requests++;
+
+  Mask = CPUgetPRIMASK_cpsid();
+  //publish the slot only once it is filled in
+  Tail++;
+  NumWaiting = (uint8_t)(Tail - Head);
+  if (NumWaiting > Stats.MaxWaiting)
+  {
+    Stats.MaxWaiting = NumWaiting;
+  }
+  if (!Active && (CurrentState != InitPState))
+  {
+    RunQueue();
+  }
+  CPUsetPRIMASK(Mask);
+  return true;
 }
 
-uint16_t I2C_GetClearValue( void )
+/****************************************************************************
+ Function
+     I2C_QueryWaiting
+
+ Parameters
+     None
+
+ Returns
+     uint8_t : requests queued or on the bus
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+uint8_t I2C_QueryWaiting(void)
 {
-  return(ClearValue);
+  return (uint8_t)(Tail - Head);
 }
-  
-uint16_t I2C_GetRedValue( void )
+
+/****************************************************************************
+ Function
+     I2C_QueryStats
+
+ Parameters
+     I2CStats_t * : filled in with the counts since I2C_ResetStats
+
+ Returns
+     None
+
+ Description
+     Bus utilization is BusUS / (ElapsedMS * 1000)
+ Notes
+     The elapsed time is kept up to date from the 16 bit framework time
+     every time the service runs, which the colour reads make sure is more
+     often than once a minute
+ Author
+     Sander Tonkens
+****************************************************************************/
+void I2C_QueryStats(I2CStats_t *StatsOut)
 {
-  return(RedValue);
+  uint32_t Bits = BusBits;
+
+  UpdateElapsed();
+  *StatsOut = Stats;
+  // 2.5 us per count, in two steps to stay inside 32 bits
+  StatsOut->BusUS = (Bits / 2) * 5 + (Bits % 2) * 2;
 }
-  
-uint16_t I2C_GetGreenValue( void )
+
+/****************************************************************************
+ Function
+     I2C_ResetStats
+
+ Parameters
+     None
+
+ Returns
+     None
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+void I2C_ResetStats(void)
 {
-  return(GreenValue);
+  Stats.Requests = 0;
+  Stats.Refused = 0;
+  Stats.Completed = 0;
+  Stats.Errors = 0;
+  Stats.Retries = 0;
+  Stats.Recoveries = 0;
+  Stats.ElapsedMS = 0;
+  Stats.MaxWaiting = 0;
+  BusBits = 0;
+  LastTime = ES_Timer_GetTime();
 }
-  
-uint16_t I2C_GetBlueValue( void )
+
+/****************************************************************************
+ Function
+     I2C_MasterISR
+
+ Parameters
+     None
+
+ Returns
+     None
+
+ Description
+     I2C1 master interrupt, the hardware finished a transfer. Keeps the byte
+     of a burst read and reads the next one, otherwise runs the list on to
+     the next transfer, or the next request.
+ Notes
+     On an error the list stops here and the service takes over the bus
+ Author
+     Sander Tonkens
+****************************************************************************/
+void I2C_MasterISR(void)
 {
-  return(BlueValue);
+  ES_Event_t ThisEvent;
+  uint32_t Status;
+  uint32_t Error;
+
+  Status = ROM_I2CMasterIntStatusEx(I2C1_BASE, true);
+  ROM_I2CMasterIntClearEx(I2C1_BASE, Status);
+  // nothing of ours, or the end of the stop the service sent after an error
+  if ((0 == Status) || Recovering || !Active)
+  {
+    return;
+  }
+
+  Error = ROM_I2CMasterErr(I2C1_BASE);
+  if (I2C_MASTER_ERR_NONE != Error)
+  {
+    Recovering = true;
+    ThisEvent.EventType = EV_I2C_BusError;
+    ThisEvent.EventParam = (uint16_t)Error;
+    PostI2CService( ThisEvent );
+    return;
+  }
+
+  if (CMD_ReadBurst == CurrentStep.Command)
+  {
+    // keep the byte, then read the next one with a stop on the last
+    ((uint8_t *)CurrentStep.Result)[BurstCount++] =
+        (uint8_t)ROM_I2CMasterDataGet(I2C1_BASE);
+    if (BurstCount < CurrentStep.Value)
+    {
+      I2C1_Read1Byte(Device->Address, NO_START,
+                     (BurstCount + 1) == CurrentStep.Value);
+      return;
+    }
+  }
+  RunQueue();
 }
 
 
@@ -558,30 +561,48 @@ static void I2C1_Init(void){
   while (ROM_SysCtlPeripheralReady(SYSCTL_PERIPH_I2C1) != true)
   {}
 
-  //reset I2C module 1
-  ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_I2C1);
-
   //enable GPIO port that contains I2C 1, Port A
   ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
- 
+
   //wait for the clock on the port to be ready
   while (ROM_SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOA) != true)
   {}
 
+  SysClock = SysCtlClockGet();
+  HalfBitLoops = HALF_BIT_LOOPS(SysClock);
+  FastNow = false;
+  I2C1_SetUpModule();
+  I2C_ResetStats();
+}
+
+// Reset the I2C module and set it up, at power up and after a bus recovery
+static void I2C1_SetUpModule(void){
+  //reset I2C module 1
+  ROM_SysCtlPeripheralReset(SYSCTL_PERIPH_I2C1);
+
   // Configure the pin muxing for I2C1 functions on port A6 and A7.
   ROM_GPIOPinConfigure(GPIO_PA6_I2C1SCL);
   ROM_GPIOPinConfigure(GPIO_PA7_I2C1SDA);
-		
+
   // Configure the pins for I2C, including enabling the PU on SCL.
   ROM_GPIOPinTypeI2CSCL(GPIO_PORTA_BASE, GPIO_PIN_6); // SCL
   ROM_GPIOPinTypeI2C(GPIO_PORTA_BASE, GPIO_PIN_7);    // SDA
-				
+
   // Enable and initialize the I2C1 master module.  Use the system clock for
   // the I2C1 module.  The last parameter sets the I2C data transfer rate.
   // If false the data rate is set to 100kbps and if true the data rate will
-  // be set to 400kbps.
-  ROM_I2CMasterInitExpClk(I2C1_BASE, SysCtlClockGet(), false);
-     
+  // be set to 400kbps. Each request sets the speed of its device.
+  ROM_I2CMasterInitExpClk(I2C1_BASE, SysClock, FastNow);
+
+  // a slave holding SCL low ends the transfer with an error
+  ROM_I2CMasterTimeoutSet(I2C1_BASE, CLOCK_LOW_TIMEOUT);
+
+  // interrupt at the end of every transfer, I2C_MasterISR runs the steps
+  ROM_I2CMasterIntClearEx(I2C1_BASE,
+                          I2C_MASTER_INT_DATA | I2C_MASTER_INT_TIMEOUT);
+  ROM_I2CMasterIntEnableEx(I2C1_BASE,
+                           I2C_MASTER_INT_DATA | I2C_MASTER_INT_TIMEOUT);
+  ROM_IntEnable(INT_I2C1_TM4C123);
 }
 
 // set up device address and write 1 byte
@@ -625,7 +646,8 @@ static void I2C1_Write1Byte( uint8_t slave_addr, uint8_t value, bool InclStart,
   }
   // now issue the command
   ROM_I2CMasterControl(I2C1_BASE, I2C_Command);
-  I2C1_Busy = true;
+  StopSent = InclStop;
+  CountBits(InclStart, InclStop);
 }
 
 // set up device address and read 1 byte
@@ -666,7 +688,211 @@ static void I2C1_Read1Byte( uint8_t slave_addr, bool InclStart,
   }
   // now issue the command
   ROM_I2CMasterControl(I2C1_BASE, I2C_Command);
-  I2C1_Busy = true;
+  StopSent = InclStop;
+  CountBits(InclStart, InclStop);
+}
+
+// Runs requests from Head until one has to wait for the hardware or for
+// time, or there are none left. Called by whoever owns the bus: the ISR,
+// or task level with interrupts off while the bus is idle, PRIMASK saved
+// in a local as this posts to the service.
+static void RunQueue(void)
+{
+  ES_Event_t ThisEvent;
+  Request_t *Current;
+
+  while (Head != Tail)
+  {
+    Current = &Queue[Head & QUEUE_MASK];
+    if (!Active)
+    {
+      // a new request, set the bus up for its device
+      Active = true;
+      Device = Current->Device;
+      Steps = Device->Sequences[Current->Sequence];
+      StepIndex = 0;
+      Tries = 0;
+      if (Device->FastMode != FastNow)
+      {
+        FastNow = Device->FastMode;
+        ROM_I2CMasterInitExpClk(I2C1_BASE, SysClock, FastNow);
+      }
+    }
+    if (!RunSteps())
+    {
+      return;
+    }
+    // end of the list, the service reports it
+    Current->Ok = true;
+    Head++;
+    Active = false;
+    ThisEvent.EventType = EV_I2C_EOS;
+    PostI2CService( ThisEvent );
+  }
+}
+
+// Runs the list from StepIndex up to the next step that has to wait: one
+// that started a transfer (the ISR calls back when it is done) or a time
+// wait (handed to the service). True at the end of the list.
+static bool RunSteps(void)
+{
+  ES_Event_t ThisEvent;
+
+  for (;;)
+  {
+    // fetch the current instruction and inc the index to the next instruction
+    CurrentStep = Steps[StepIndex++];
+    if (CMD_EOS == CurrentStep.Command)
+    {
+      return true;
+    }
+    InterpretCommand(CurrentStep);
+    if (true == CurrentStep.BusyWait)
+    {
+      return false;
+    }
+    if (0 != CurrentStep.WaitTime)
+    {
+      TimeWait = true;
+      ThisEvent.EventType = EV_I2C_Wait4Time;
+      ThisEvent.EventParam = CurrentStep.WaitTime;
+      PostI2CService( ThisEvent );
+      return false;
+    }
+  }
+}
+
+// Calls the done functions of the requests the bus side has finished, in
+// order, freeing each slot first so the done function can reuse it
+static void ReportFinished(void)
+{
+  Request_t *Slot;
+  I2CDoneFunc_t *Done;
+  bool Ok;
+
+  while (Finished != Head)
+  {
+    Slot = &Queue[Finished & QUEUE_MASK];
+    Done = Slot->Done;
+    Ok = Slot->Ok;
+    if (Ok)
+    {
+      Stats.Completed++;
+    }
+    else
+    {
+      Stats.Errors++;
+      puts("Error in I2C");
+    }
+    Finished++;
+    if (Done != 0)
+    {
+      Done(Ok);
+    }
+  }
+}
+
+// After a failed transfer: finish it with a stop, free the bus if that
+// doesn't, then run the request again from its first step or give up on it
+static void HandleBusError(uint32_t Error)
+{
+  ES_Event_t ThisEvent;
+  uint16_t Polls;
+  uint32_t Mask;
+
+  if (!StopSent)
+  {
+    ROM_I2CMasterControl(I2C1_BASE, I2C_MASTER_CMD_BURST_SEND_ERROR_STOP);
+  }
+  for (Polls = 0; ROM_I2CMasterBusy(I2C1_BASE) && (Polls < BUSY_POLLS);
+       Polls++)
+  {}
+  if ((0 != (Error & (I2C_MASTER_ERR_ARB_LOST | I2C_MASTER_ERR_CLK_TOUT))) ||
+      ROM_I2CMasterBusy(I2C1_BASE) || ROM_I2CMasterBusBusy(I2C1_BASE))
+  {
+    RecoverBus();
+    Stats.Recoveries++;
+  }
+
+  Mask = CPUgetPRIMASK_cpsid();
+  ROM_I2CMasterIntClearEx(I2C1_BASE,
+                          I2C_MASTER_INT_DATA | I2C_MASTER_INT_TIMEOUT);
+  Recovering = false;
+  if (Tries < MAX_RETRIES)
+  {
+    // same request from the top, Active stays set
+    Tries++;
+    Stats.Retries++;
+    StepIndex = 0;
+  }
+  else
+  {
+    // report it as finished, Ok stays false
+    Head++;
+    Active = false;
+    ThisEvent.EventType = EV_I2C_EOS;
+    PostI2CService( ThisEvent );
+  }
+  RunQueue();
+  CPUsetPRIMASK(Mask);
+}
+
+// Clocks SCL by hand until the slave holding SDA low lets go, then sends a
+// stop and resets the I2C module
+static void RecoverBus(void)
+{
+  uint8_t Pulses;
+
+  ROM_I2CMasterDisable(I2C1_BASE);
+  ROM_GPIOPinTypeGPIOOutputOD(GPIO_PORTA_BASE, GPIO_PIN_6); // SCL
+  ROM_GPIOPinTypeGPIOInput(GPIO_PORTA_BASE, GPIO_PIN_7);    // SDA
+  ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_6, GPIO_PIN_6);
+  ROM_SysCtlDelay(HalfBitLoops);
+  for (Pulses = 0; (Pulses < RECOVERY_PULSES) &&
+       (0 == ROM_GPIOPinRead(GPIO_PORTA_BASE, GPIO_PIN_7)); Pulses++)
+  {
+    ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_6, 0);
+    ROM_SysCtlDelay(HalfBitLoops);
+    ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_6, GPIO_PIN_6);
+    ROM_SysCtlDelay(HalfBitLoops);
+  }
+
+  // stop: SDA low to high while SCL is high
+  ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_6, 0);
+  ROM_GPIOPinTypeGPIOOutputOD(GPIO_PORTA_BASE, GPIO_PIN_7);
+  ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_7, 0);
+  ROM_SysCtlDelay(HalfBitLoops);
+  ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_6, GPIO_PIN_6);
+  ROM_SysCtlDelay(HalfBitLoops);
+  ROM_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_7, GPIO_PIN_7);
+  ROM_SysCtlDelay(HalfBitLoops);
+
+  I2C1_SetUpModule();
+}
+
+// Adds the bits of one transfer at the current bus speed to the statistics
+static void CountBits(bool InclStart, bool InclStop)
+{
+  uint32_t Bits = BYTE_BITS;
+
+  if (true == InclStart)
+  {
+    Bits += START_BITS;
+  }
+  if (true == InclStop)
+  {
+    Bits += STOP_BITS;
+  }
+  BusBits += FastNow ? Bits : (Bits * SLOW_BIT_WEIGHT);
+}
+
+// Adds the framework time since the last call to the elapsed time
+static void UpdateElapsed(void)
+{
+  uint16_t Now = ES_Timer_GetTime();
+
+  Stats.ElapsedMS += (uint16_t)(Now - LastTime);
+  LastTime = Now;
 }
 
 // I pulled this code out into a function in order to compact the state
@@ -677,91 +903,81 @@ static void InterpretCommand(StepDefinition_t CurrentStep)
   {
     case CMD_Write8:
     {
-      I2C1_Write1Byte(DEVICE_ADDR, CurrentStep.Value, DO_START, DO_STOP);
+      I2C1_Write1Byte(Device->Address, CurrentStep.Value, DO_START, DO_STOP);
     }
     break;
 
     case CMD_Write8NS:
     {
-      I2C1_Write1Byte(DEVICE_ADDR, CurrentStep.Value, NO_START, DO_STOP);
+      I2C1_Write1Byte(Device->Address, CurrentStep.Value, NO_START, DO_STOP);
     }
     break;
 
     case CMD_WriteMult:
     {
-      I2C1_Write1Byte(DEVICE_ADDR, CurrentStep.Value, DO_START, NO_STOP);
+      I2C1_Write1Byte(Device->Address, CurrentStep.Value, DO_START, NO_STOP);
     }
     break;
 
     case CMD_WriteMultNS:
     {
-      I2C1_Write1Byte(DEVICE_ADDR, CurrentStep.Value, NO_START, NO_STOP);
+      I2C1_Write1Byte(Device->Address, CurrentStep.Value, NO_START, NO_STOP);
     }
     break;
 
     case CMD_Read8:
     {
-      I2C1_Read1Byte(DEVICE_ADDR, DO_START, DO_STOP);
+      I2C1_Read1Byte(Device->Address, DO_START, DO_STOP);
     }
     break;
 
     case CMD_Read8NS:
     {
-      I2C1_Read1Byte(DEVICE_ADDR, NO_START, DO_STOP);
+      I2C1_Read1Byte(Device->Address, NO_START, DO_STOP);
     }
     break;
 
     case CMD_ReadMult:
     {
-      I2C1_Read1Byte(DEVICE_ADDR, DO_START, NO_STOP);
+      I2C1_Read1Byte(Device->Address, DO_START, NO_STOP);
     }
     break;
 
     case CMD_ReadMultNS:
     {
-      I2C1_Read1Byte(DEVICE_ADDR, NO_START, NO_STOP);
+      I2C1_Read1Byte(Device->Address, NO_START, NO_STOP);
+    }
+    break;
+
+    case CMD_ReadBurst:
+    {
+      // the first byte, I2C_MasterISR reads the rest
+      BurstCount = 0;
+      I2C1_Read1Byte(Device->Address, DO_START, (1 == CurrentStep.Value));
     }
     break;
 
     case CMD_GetResult:
     {
-      // getting the result is immediate, so move to next step right away
-      ES_Event_t ThisEvent;
-      ThisEvent.EventType = EV_I2C_NextStep;
-      PostI2CService( ThisEvent );
+      // getting the result is immediate, RunSteps moves on right away
       // don't forget to grab the result :-)
-      *(uint8_t *)CurrentStep.Result = (uint8_t)I2CMasterDataGet(I2C1_BASE);
+      readOne = readTwo;
+      readTwo = (uint8_t)ROM_I2CMasterDataGet(I2C1_BASE);
+      *(uint8_t *)CurrentStep.Result = readTwo;
     }
     break;
 
     case CMD_Form16:
     {
-      // this operation is immediate, so move to next step right away
-      ES_Event_t ThisEvent;
-      ThisEvent.EventType = EV_I2C_NextStep;
-      PostI2CService( ThisEvent );
-      // don't forget to combine the  bytes
+      // this operation is immediate, RunSteps moves on right away
+      // don't forget to combine the  bytes, the first one is the low byte
       *(uint16_t *)CurrentStep.Result = (((uint16_t)readTwo <<8) | readOne);
     }
     break;
 
     case CMD_NOP:
     {
-      // and post a message to ourselves that the sequence is compelte
-      ES_Event_t ThisEvent;
-      ThisEvent.EventType = EV_I2C_Wait4Time;
-      PostI2CService( ThisEvent );
-    }
-    break;
-
-    case CMD_EOS:
-    {
-      // and post a message to ourselves that the sequence is compelte
-      ES_Event_t ThisEvent;
-      ThisEvent.EventType = EV_I2C_EOS;
-      PostI2CService( ThisEvent );
-      // and start a timer for the next read
-      ES_Timer_InitTimer(I2C_TIMER, INT_TIME);
+      // nothing to do, RunSteps hands the wait to the service
     }
     break;
 
@@ -770,10 +986,4 @@ static void InterpretCommand(StepDefinition_t CurrentStep)
     }  
     break;
   }  // end of command interrpretation switch
-  if (true == CurrentStep.BusyWait)
-  {
-    ES_Event_t ThisEvent;
-    ThisEvent.EventType = EV_I2C_Wait4Busy;
-    PostI2CService( ThisEvent );
-  }
 }
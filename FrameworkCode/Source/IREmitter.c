@@ -33,6 +33,7 @@
 
 // Header for this module
 #include "IREmitter.h"
+#include "ParamStore.h"
 
 /*----------------------------- Module Defines ----------------------------*/
 // Pin Assignments
@@ -42,13 +43,13 @@
 #define GenA_Normal (PWM_2_GENA_ACTCMPAU_ONE | PWM_2_GENA_ACTCMPAD_ZERO)
 #define BitsPerNibble 4
 #define PWMTicksPerUS 1250  // 40*10^3/32 //40MHz clock divided by 32, converted to us
-#define PeriodInUS 600       //What is currently accepted by recycling centre
 
 
 /*---------------------------- Module Variables ---------------------------*/
 // everybody needs a state variable, you may need others as well.
 // type of state variable should match htat of enum in header file
-static uint32_t DesiredPeriod = PeriodInUS * PWMTicksPerUS;
+// starts at Param.EmitterUS, what is currently accepted by recycling centre
+static uint32_t DesiredPeriod;
 
 /*------------------------------ Module Code ------------------------------*/
 
@@ -58,6 +59,8 @@ static uint32_t DesiredPeriod = PeriodInUS * PWMTicksPerUS;
 ****************************************************************************/
 void InitEmitterPWM(void) // PWM1 GEN Block 1
 {
+  DesiredPeriod = Param.EmitterUS * PWMTicksPerUS;
+
   // start by enabling the clock to the PWM Module (PWM1)
   HWREG(SYSCTL_RCGCPWM) |= SYSCTL_RCGCPWM_R1;
 
@@ -133,6 +136,16 @@ void UpdateEmitterPeriod(uint32_t RecycleIRPeriod)
   HWREG(PWM1_BASE + PWM_O_2_LOAD) = (DesiredPeriod/1000) >> 1;
 }
 
+/****************************************************************************
+ Function
+     ApplyEmitterParams
+Description
+     Called by the parameter store when Param.EmitterUS is changed
+****************************************************************************/
+void ApplyEmitterParams(void)
+{
+  UpdateEmitterPeriod(Param.EmitterUS);
+}
 
 void EnableEmitterPWM(void)
 {
@@ -41,6 +41,7 @@
 #include "IREmitter.h"
 #include "EncoderCapture.h"
 #include "DriveCommandModule.h"
+#include "ParamStore.h"
 
 // This module
 #include "InitializeHardware.h"
@@ -77,8 +78,9 @@ static void InitializePorts(void);
 
 void InitializeHardware(void)
 {
+  //tuning parameters first, the modules read them at their own init
+  PS_Init();
   InitializePorts();
-	InitSPI();
   InitEmitterPWM();
 	InitDCPWM();
   InitDriveMotor();
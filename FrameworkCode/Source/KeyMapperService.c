@@ -23,7 +23,7 @@
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 #include "KeyMapperService.h"
-#include "I2CService.h"
+#include "ColourSensor.h"
 
 // to get toupper()
 #include <ctype.h>
@@ -127,9 +127,9 @@ ES_Event_t RunKeyMapperService( ES_Event_t ThisEvent )
         switch ( toupper(ThisEvent.EventParam))
         {
             case '.' : ThisEvent.EventType = EV_I2C_ReadClear;  break;
-            case ',' : ThisEvent.EventType = EV_I2C_StepFinished; break;
+            case ',' : ThisEvent.EventType = EV_I2C_ReadAll; break;
         }
-        PostI2CService(ThisEvent);
+        PostColourSensor(ThisEvent);
     }
     
   return ReturnEvent;
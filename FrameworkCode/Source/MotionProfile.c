@@ -0,0 +1,376 @@
+/****************************************************************************
+ Module
+   MotionProfile.c
+
+ Revision
+   1.0.1
+
+ Description
+   Jerk limited (S-curve) and trapezoidal setpoint generator for the drive
+   position and heading loops
+
+ Notes
+   The profile is planned once at command time as seven constant-jerk
+   phases (jerk up, hold accel, jerk down, cruise, and the mirror image for
+   deceleration). Phase lengths are rounded to whole control periods and the
+   jerk is then rescaled so that the discrete profile lands exactly on the
+   target with zero velocity. Sampling the profile in the control ISR is
+   three adds and a compare.
+
+   A trapezoidal profile is the same schedule with each jerk phase one
+   control period long.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 10:12 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "MotionProfile.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define US_PER_SECOND 1000000.0f
+
+// iterations of the bisection used to shrink the peak velocity of short moves
+#define VELOCITY_SEARCH_STEPS 24
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void ShapeForVelocity(float Velocity, float Accel, float Jerk,
+                             float *JerkTime, float *AccelTime);
+static float RampDistance(float Velocity, float Accel, float Jerk);
+static void Advance(float *Accel, float *Velocity, float *Position,
+                    float Jerk, uint32_t Periods);
+static uint32_t RoundPeriods(float Periods);
+
+/*---------------------------- Module Variables ---------------------------*/
+// sign of the jerk in each of the seven phases
+static const float PhaseJerkSign[MP_NUM_PHASES] = { 1, 0, -1, 0, -1, 0, 1 };
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   MP_Plan
+
+ Parameters
+   MotionProfile_t * : profile to fill in
+   float : signed distance to travel (encoder ticks)
+   const MotionLimits_t * : velocity, acceleration and jerk limits
+   uint32_t : control period in us
+
+ Returns
+   void
+
+ Description
+   Precomputes the phase schedule for a move of Distance ticks, starting
+   and ending at rest, and arms the profile so that MP_Step can be called
+   once per control period
+ Notes
+   Not to be called from the control ISR. With a velocity or acceleration
+   limit of 0 the profile is not armed and the position setpoint is the
+   target straight away (a step move), see MP_GetPosition
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MP_Plan(MotionProfile_t *Profile, float Distance,
+             const MotionLimits_t *Limits, uint32_t UpdateTimeUS)
+{
+  float Period = UpdateTimeUS / US_PER_SECOND;
+  float MaxVelocity = Limits->MaxVelocity * Period;
+  float MaxAccel = Limits->MaxAccel * Period * Period;
+  float MaxJerk;
+  float Magnitude = fabsf(Distance);
+  float Velocity;
+  float JerkTime;
+  float AccelTime;
+  float CruiseTime;
+  float Accel = 0;
+  float Speed = 0;
+  float UnitDistance = 0;
+  uint32_t Lengths[MP_NUM_PHASES];
+  uint32_t End = 0;
+  uint8_t i;
+
+  //a jerk limit of 0 selects the trapezoidal profile
+  if (Limits->MaxJerk > 0)
+  {
+    MaxJerk = Limits->MaxJerk * Period * Period * Period;
+  }
+  else
+  {
+    MaxJerk = MaxAccel;
+  }
+
+  Profile->Accel = 0;
+  Profile->Velocity = 0;
+  Profile->Position = 0;
+  Profile->Target = Distance;
+  Profile->Tick = 0;
+  Profile->Phase = 0;
+  Profile->Active = false;
+
+  //no limits to plan with (or nowhere to go): step straight to the target
+  if ((Magnitude == 0) || (MaxVelocity <= 0) || (MaxAccel <= 0))
+  {
+    Profile->Position = Distance;
+    for (i = 0; i < MP_NUM_PHASES; i++)
+    {
+      Profile->PhaseEnd[i] = 0;
+    }
+    return;
+  }
+
+  //Short moves never reach cruise: bisect for the peak velocity that fits
+  Velocity = MaxVelocity;
+  if (RampDistance(Velocity, MaxAccel, MaxJerk) > Magnitude)
+  {
+    float Low = 0;
+    float High = MaxVelocity;
+    for (i = 0; i < VELOCITY_SEARCH_STEPS; i++)
+    {
+      Velocity = (Low + High) / 2;
+      if (RampDistance(Velocity, MaxAccel, MaxJerk) > Magnitude)
+      {
+        High = Velocity;
+      }
+      else
+      {
+        Low = Velocity;
+      }
+    }
+    Velocity = Low;
+  }
+
+  ShapeForVelocity(Velocity, MaxAccel, MaxJerk, &JerkTime, &AccelTime);
+  CruiseTime = (Magnitude - RampDistance(Velocity, MaxAccel, MaxJerk)) / Velocity;
+
+  //Round the phases to whole periods (jerk phases last at least 1 period)
+  Lengths[0] = RoundPeriods(JerkTime);
+  if (Lengths[0] == 0)
+  {
+    Lengths[0] = 1;
+  }
+  Lengths[1] = RoundPeriods(AccelTime);
+  Lengths[2] = Lengths[0];
+  Lengths[3] = RoundPeriods(CruiseTime);
+  Lengths[4] = Lengths[0];
+  Lengths[5] = Lengths[1];
+  Lengths[6] = Lengths[0];
+
+  //Distance covered by the rounded schedule with a unit jerk
+  Speed = 0;
+  for (i = 0; i < MP_NUM_PHASES; i++)
+  {
+    Advance(&Accel, &Speed, &UnitDistance, PhaseJerkSign[i], Lengths[i]);
+    End += Lengths[i];
+    Profile->PhaseEnd[i] = End;
+  }
+
+  //Distance is linear in the jerk, so rescale it to land on the target
+  for (i = 0; i < MP_NUM_PHASES; i++)
+  {
+    Profile->PhaseJerk[i] = PhaseJerkSign[i] * Distance / UnitDistance;
+  }
+  Profile->Active = true;
+}
+
+/****************************************************************************
+ Function
+   MP_Step
+
+ Parameters
+   MotionProfile_t * : profile to advance
+
+ Returns
+   float : position setpoint for this control period (ticks)
+
+ Description
+   Advances the profile by one control period
+ Notes
+   Called from the control ISR, constant time
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MP_Step(MotionProfile_t *Profile)
+{
+  if (Profile->Active == false)
+  {
+    return Profile->Position;
+  }
+
+  //skip over phases that have ended (or have zero length)
+  while ((Profile->Phase < MP_NUM_PHASES) &&
+    (Profile->Tick >= Profile->PhaseEnd[Profile->Phase]))
+  {
+    Profile->Phase++;
+  }
+
+  if (Profile->Phase < MP_NUM_PHASES)
+  {
+    Profile->Accel += Profile->PhaseJerk[Profile->Phase];
+    Profile->Velocity += Profile->Accel;
+    Profile->Position += Profile->Velocity;
+    Profile->Tick++;
+  }
+
+  //Snap to the target on the last period to remove rounding residue
+  if (Profile->Tick >= Profile->PhaseEnd[MP_NUM_PHASES - 1])
+  {
+    Profile->Accel = 0;
+    Profile->Velocity = 0;
+    Profile->Position = Profile->Target;
+    Profile->Active = false;
+  }
+  return Profile->Position;
+}
+
+/****************************************************************************
+ Function
+   MP_Cancel
+
+ Parameters
+   MotionProfile_t * : profile to cancel
+
+ Returns
+   void
+
+ Description
+   Stops the profile where it is, the setpoint holds its last value
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MP_Cancel(MotionProfile_t *Profile)
+{
+  Profile->Active = false;
+  Profile->Accel = 0;
+  Profile->Velocity = 0;
+}
+
+/****************************************************************************
+ Function
+   MP_IsActive
+
+ Parameters
+   const MotionProfile_t * : profile to check
+
+ Returns
+   bool : true while the profile still has periods left to run
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool MP_IsActive(const MotionProfile_t *Profile)
+{
+  return Profile->Active;
+}
+
+/****************************************************************************
+ Function
+   MP_GetVelocity
+
+ Parameters
+   const MotionProfile_t * : profile to query
+
+ Returns
+   float : current velocity setpoint in ticks per control period
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MP_GetVelocity(const MotionProfile_t *Profile)
+{
+  return Profile->Velocity;
+}
+
+/****************************************************************************
+ Function
+   MP_GetPosition
+
+ Parameters
+   const MotionProfile_t * : profile to query
+
+ Returns
+   float : current position setpoint (ticks), 0 just after MP_Plan unless
+           the move is a step
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MP_GetPosition(const MotionProfile_t *Profile)
+{
+  return Profile->Position;
+}
+
+/****************************************************************************
+ Function
+   MP_GetDuration
+
+ Parameters
+   const MotionProfile_t * : profile to query
+
+ Returns
+   uint32_t : total length of the planned profile in control periods
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t MP_GetDuration(const MotionProfile_t *Profile)
+{
+  return Profile->PhaseEnd[MP_NUM_PHASES - 1];
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Jerk time and constant-acceleration time needed to reach Velocity from rest
+static void ShapeForVelocity(float Velocity, float Accel, float Jerk,
+                             float *JerkTime, float *AccelTime)
+{
+  *JerkTime = Accel / Jerk;
+  if (Velocity < Accel * (*JerkTime))
+  {
+    //peak acceleration is never reached
+    *JerkTime = sqrtf(Velocity / Jerk);
+    *AccelTime = 0;
+  }
+  else
+  {
+    *AccelTime = Velocity / Accel - *JerkTime;
+  }
+}
+
+// Distance covered accelerating to Velocity and back to rest
+static float RampDistance(float Velocity, float Accel, float Jerk)
+{
+  float JerkTime;
+  float AccelTime;
+
+  ShapeForVelocity(Velocity, Accel, Jerk, &JerkTime, &AccelTime);
+  return Velocity * (2 * JerkTime + AccelTime);
+}
+
+// Closed form of Periods iterations of: a += j; v += a; p += v
+static void Advance(float *Accel, float *Velocity, float *Position,
+                    float Jerk, uint32_t Periods)
+{
+  float n = Periods;
+
+  *Position += n * (*Velocity) + (*Accel) * n * (n + 1) / 2 +
+      Jerk * n * (n + 1) * (n + 2) / 6;
+  *Velocity += n * (*Accel) + Jerk * n * (n + 1) / 2;
+  *Accel += n * Jerk;
+}
+
+static uint32_t RoundPeriods(float Periods)
+{
+  if (Periods <= 0)
+  {
+    return 0;
+  }
+  return (uint32_t)(Periods + 0.5f);
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
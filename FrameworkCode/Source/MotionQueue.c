@@ -0,0 +1,534 @@
+/****************************************************************************
+ Module
+   MotionQueue.c
+
+ Revision
+   1.0.1
+
+ Description
+   Bounded queue of drive motion primitives, consumed by the drive control
+   ISR one segment after the other without stopping in between
+
+ Notes
+   Segments are pushed from task level (MQ_Push) and popped in the control
+   ISR (MQ_Step), single producer and single consumer so the ring needs no
+   lock. MQ_Clear and MQ_Start touch both ends and use a critical section.
+
+   Each segment has a lead axis (distance for straights, arcs and velocity
+   holds, heading for turns) that follows an online trapezoid: accelerate
+   to the segment's cruise speed, and brake in time to leave the segment
+   at the exit speed. The exit speed looks ahead at the next queued
+   segment; if it continues along the same axis in the same direction the
+   speed is carried over, otherwise the segment brakes to zero. On an arc
+   the heading is slaved to the distance.
+
+   Setpoints are absolute (relative to MQ_Start) so the encoder counts are
+   never reset between segments.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 16:40 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "MotionQueue.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define US_PER_SECOND 1000000.0f
+#define US_PER_MS 1000
+
+#define QUEUE_MASK (MQ_SIZE - 1)
+
+// Defaults match the distance profile limits in MotorSpeedControl
+#define DEFAULT_MAX_VEL 250   //ticks/s
+#define DEFAULT_MAX_ACC 1000  //ticks/s^2
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void LoadSegment(uint32_t UpdateTimeUS);
+static bool AdvanceSegment(float Period, float ExitSpeed);
+static bool HoldVelocity(float Period, float ExitSpeed);
+static float ExitSpeedForNext(void);
+static bool Compatible(const MotionSegment_t *This, const MotionSegment_t *Next);
+static bool LeadsWithDistance(const MotionSegment_t *Segment);
+static float LeadDirection(const MotionSegment_t *Segment);
+static float CruiseSpeed(const MotionSegment_t *Segment);
+
+/*---------------------------- Module Variables ---------------------------*/
+static MotionSegment_t Queue[MQ_SIZE];
+static volatile uint8_t Head;   // next segment to run, ISR side
+static volatile uint8_t Tail;   // next free slot, task side
+
+static MotionSegment_t Current;
+static bool Loaded;
+static float BaseDistance;
+static float BaseHeading;
+static float Progress;      // along the lead axis, always >= 0
+static float Speed;         // along the lead axis, always >= 0
+static float Length;
+static float Direction;
+static float Ratio;         // slaved axis per unit of lead axis
+static float Cruise;
+static uint32_t PeriodsLeft;
+
+static float MaxVelocity = DEFAULT_MAX_VEL;
+static float MaxAccel = DEFAULT_MAX_ACC;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   MQ_Init
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Empties the queue and puts the setpoints back at the origin
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MQ_Init(void)
+{
+  MQ_Clear();
+  MQ_Start();
+}
+
+/****************************************************************************
+ Function
+   MQ_Push
+
+ Parameters
+   const MotionSegment_t * : segment to add to the end of the queue
+
+ Returns
+   bool : false if the queue is full
+
+ Description
+   Adds a motion primitive, it may be pushed while the queue is running
+ Notes
+   Task level only
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool MQ_Push(const MotionSegment_t *Segment)
+{
+  MotionSegment_t *Slot;
+
+  if ((uint8_t)(Tail - Head) >= MQ_SIZE)
+  {
+    return false;
+  }
+  Slot = &Queue[Tail & QUEUE_MASK];
+  *Slot = *Segment;
+
+  //an arc with no distance is a turn in place
+  if ((Slot->Type == MQ_ARC) && (Slot->Distance == 0))
+  {
+    Slot->Type = MQ_TURN;
+  }
+  //publish the slot only once it is filled in
+  Tail++;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   MQ_Clear
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Drops the running segment and everything queued behind it
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MQ_Clear(void)
+{
+  EnterCritical();
+  Head = Tail;
+  Loaded = false;
+  Speed = 0;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   MQ_Count
+
+ Parameters
+   void
+
+ Returns
+   uint8_t : number of segments waiting (not counting the running one)
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t MQ_Count(void)
+{
+  return (uint8_t)(Tail - Head);
+}
+
+/****************************************************************************
+ Function
+   MQ_SetLimits
+
+ Parameters
+   float : max lead axis velocity (ticks/s)
+   float : max lead axis acceleration (ticks/s^2)
+
+ Returns
+   void
+
+ Description
+   Limits used for every segment loaded from now on
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MQ_SetLimits(float NewMaxVelocity, float NewMaxAccel)
+{
+  MaxVelocity = NewMaxVelocity;
+  MaxAccel = NewMaxAccel;
+}
+
+/****************************************************************************
+ Function
+   MQ_Start
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Moves the setpoint origin to the current position, call together with
+   resetting the encoder tick counts
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MQ_Start(void)
+{
+  EnterCritical();
+  Loaded = false;
+  BaseDistance = 0;
+  BaseHeading = 0;
+  Progress = 0;
+  Speed = 0;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   MQ_Step
+
+ Parameters
+   uint32_t : control period in us
+   MotionSetpoint_t * : filled in with this period's setpoints
+
+ Returns
+   uint8_t : MQ_SEGMENT_DONE, MQ_DRAINED and MQ_IDLE status bits
+
+ Description
+   Advances the running segment by one control period, loading the next
+   one from the queue as needed
+ Notes
+   Called from the control ISR, constant time
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t MQ_Step(uint32_t UpdateTimeUS, MotionSetpoint_t *Setpoint)
+{
+  float Period = UpdateTimeUS / US_PER_SECOND;
+  float LeadPosition;
+  float LeadVelocity;
+  uint8_t Status = 0;
+  bool Done = false;
+
+  if (!Loaded)
+  {
+    if (MQ_Count() == 0)
+    {
+      Setpoint->Distance = BaseDistance;
+      Setpoint->Heading = BaseHeading;
+      Setpoint->DistanceVelocity = 0;
+      Setpoint->HeadingVelocity = 0;
+      return MQ_IDLE;
+    }
+    LoadSegment(UpdateTimeUS);
+  }
+
+  switch (Current.Type)
+  {
+    case MQ_STRAIGHT:
+    case MQ_TURN:
+    case MQ_ARC:
+    {
+      Done = AdvanceSegment(Period, ExitSpeedForNext());
+    }
+    break;
+
+    case MQ_VELOCITY:
+    {
+      Done = HoldVelocity(Period, ExitSpeedForNext());
+    }
+    break;
+
+    default:  //MQ_WAIT
+    {
+      if (PeriodsLeft > 0)
+      {
+        PeriodsLeft--;
+      }
+      else
+      {
+        Done = true;
+      }
+    }
+    break;
+  }
+
+  LeadPosition = Direction * Progress;
+  LeadVelocity = Direction * Speed * Period;
+
+  if (Done)
+  {
+    //land exactly on the end of the segment
+    if (LeadsWithDistance(&Current))
+    {
+      BaseDistance += LeadPosition;
+      BaseHeading += LeadPosition * Ratio;
+    }
+    else
+    {
+      BaseHeading += LeadPosition;
+    }
+    LeadPosition = 0;
+    Progress = 0;
+    Loaded = false;
+    Status |= MQ_SEGMENT_DONE;
+
+    if (MQ_Count() == 0)
+    {
+      Status |= MQ_DRAINED;
+      Speed = 0;
+    }
+    else if (!Compatible(&Current, &Queue[Head & QUEUE_MASK]))
+    {
+      Speed = 0;
+    }
+    LeadVelocity = Direction * Speed * Period;
+  }
+
+  if (LeadsWithDistance(&Current))
+  {
+    Setpoint->Distance = BaseDistance + LeadPosition;
+    Setpoint->Heading = BaseHeading + LeadPosition * Ratio;
+    Setpoint->DistanceVelocity = LeadVelocity;
+    Setpoint->HeadingVelocity = LeadVelocity * Ratio;
+  }
+  else
+  {
+    Setpoint->Distance = BaseDistance;
+    Setpoint->Heading = BaseHeading + LeadPosition;
+    Setpoint->DistanceVelocity = 0;
+    Setpoint->HeadingVelocity = LeadVelocity;
+  }
+  return Status;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Pops the next segment into Current
+static void LoadSegment(uint32_t UpdateTimeUS)
+{
+  Current = Queue[Head & QUEUE_MASK];
+  Head++;
+  Loaded = true;
+  Progress = 0;
+
+  Direction = LeadDirection(&Current);
+  Cruise = CruiseSpeed(&Current);
+  Ratio = 0;
+  Length = 0;
+  switch (Current.Type)
+  {
+    case MQ_STRAIGHT:
+    {
+      Length = fabsf(Current.Distance);
+    }
+    break;
+
+    case MQ_TURN:
+    {
+      Length = fabsf(Current.Heading);
+    }
+    break;
+
+    case MQ_ARC:
+    {
+      Length = fabsf(Current.Distance);
+      Ratio = Current.Heading / fabsf(Current.Distance);
+    }
+    break;
+
+    default:
+      break;
+  }
+  //Direction is folded into the lead axis, keep the slaved one signed
+  if (Direction < 0)
+  {
+    Ratio = -Ratio;
+  }
+  PeriodsLeft = (uint32_t)Current.Duration * US_PER_MS / UpdateTimeUS;
+}
+
+// Online trapezoid along the lead axis, true once the segment is finished
+static bool AdvanceSegment(float Period, float ExitSpeed)
+{
+  float Remaining = Length - Progress;
+  float Allowed = sqrtf(ExitSpeed * ExitSpeed + 2 * MaxAccel * Remaining);
+  float Target = (Cruise < Allowed) ? Cruise : Allowed;
+  float Step;
+
+  if (Speed < Target)
+  {
+    Speed = fminf(Speed + MaxAccel * Period, Target);
+  }
+  else
+  {
+    Speed = fmaxf(Speed - MaxAccel * Period, Target);
+  }
+  //never faster than what still lets us brake in time
+  Speed = fminf(Speed, Allowed);
+
+  Step = Speed * Period;
+  if (Step >= Remaining)
+  {
+    Progress = Length;
+    return true;
+  }
+  Progress += Step;
+  return false;
+}
+
+// Ramp to the hold speed and keep it for the duration, then either hand
+// the speed over to a compatible next segment or brake to a stop
+static bool HoldVelocity(float Period, float ExitSpeed)
+{
+  if (PeriodsLeft > 0)
+  {
+    PeriodsLeft--;
+    if (Speed < Cruise)
+    {
+      Speed = fminf(Speed + MaxAccel * Period, Cruise);
+    }
+    else
+    {
+      Speed = fmaxf(Speed - MaxAccel * Period, Cruise);
+    }
+  }
+  else if ((ExitSpeed > 0) || (Speed == 0))
+  {
+    return true;
+  }
+  else
+  {
+    Speed = fmaxf(Speed - MaxAccel * Period, 0);
+  }
+  Progress += Speed * Period;
+  return false;
+}
+
+// Speed the running segment may keep at its end
+static float ExitSpeedForNext(void)
+{
+  const MotionSegment_t *Next;
+
+  if (MQ_Count() == 0)
+  {
+    return 0;
+  }
+  Next = &Queue[Head & QUEUE_MASK];
+  if (!Compatible(&Current, Next))
+  {
+    return 0;
+  }
+  return fminf(Cruise, CruiseSpeed(Next));
+}
+
+// Segments that continue along the same axis in the same direction
+static bool Compatible(const MotionSegment_t *This, const MotionSegment_t *Next)
+{
+  if ((This->Type == MQ_WAIT) || (Next->Type == MQ_WAIT))
+  {
+    return false;
+  }
+  return (LeadsWithDistance(This) == LeadsWithDistance(Next)) &&
+         (LeadDirection(This) == LeadDirection(Next));
+}
+
+static bool LeadsWithDistance(const MotionSegment_t *Segment)
+{
+  return (Segment->Type == MQ_STRAIGHT) || (Segment->Type == MQ_ARC) ||
+         (Segment->Type == MQ_VELOCITY);
+}
+
+static float LeadDirection(const MotionSegment_t *Segment)
+{
+  float Lead;
+
+  switch (Segment->Type)
+  {
+    case MQ_STRAIGHT:
+    case MQ_ARC:
+      Lead = Segment->Distance;
+      break;
+    case MQ_TURN:
+      Lead = Segment->Heading;
+      break;
+    case MQ_VELOCITY:
+      Lead = Segment->Speed;
+      break;
+    default:
+      Lead = 0;
+      break;
+  }
+  return (Lead < 0) ? -1 : 1;
+}
+
+// Lead axis cruise speed, on an arc the outer wheel sets the limit
+static float CruiseSpeed(const MotionSegment_t *Segment)
+{
+  switch (Segment->Type)
+  {
+    case MQ_STRAIGHT:
+    case MQ_TURN:
+      return MaxVelocity;
+    case MQ_ARC:
+      return MaxVelocity / (1 + fabsf(Segment->Heading / Segment->Distance));
+    case MQ_VELOCITY:
+      return fminf(fabsf(Segment->Speed), MaxVelocity);
+    default:
+      return 0;
+  }
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,443 @@
+/****************************************************************************
+ Module
+   MotorController.c
+
+ Revision
+   1.0.1
+
+ Description
+   Closed-loop speed control for the DC motors that have no control loop of
+   their own (pickup and transport), and the PI step the drive wheels share
+
+ Notes
+   Owners fill in a MotorController_t with gains, a measure and an output
+   function and register it once. MC_ServiceAll is called from the drive
+   control ISR every velocity period, so one timer interrupt services every
+   motor on the robot. Each call gives the controllers that still lack a
+   measurement for this MC_SERVICE_US period another try (a back-EMF sample
+   only comes once per PWM period), and once per period every controller
+   runs its PI loop and jam check.
+
+   Jam: duty within JAM_DUTY of the limit while the speed stays under
+   JAM_SPEED of the setpoint for JAM_MS. The motor is then run backwards at
+   ReverseDuty for REVERSE_MS and restarted. After MaxRetries jams without
+   CLEAR_MS of clean running in between the controller gives up, turns the
+   motor off and sits in MC_FAULT until the next MC_SetSpeed.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 20:10 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "ES_Port.h"
+#include "MotorController.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define SERVICE_MS (MC_SERVICE_US / 1000)
+
+#define JAM_DUTY 0.9f   // fraction of MaxDuty
+#define JAM_SPEED 0.25f // fraction of the setpoint
+#define JAM_MS 300      // longer than a spin up from rest
+#define REVERSE_MS 250
+#define CLEAR_MS 2000
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void UpdateController(MotorController_t *Controller);
+static void PostJamEvent(MotorController_t *Controller, ES_EventType_t Type);
+static float Clamp(float Value, float Lower, float Upper);
+
+/*---------------------------- Module Variables ---------------------------*/
+static MotorController_t *Controllers[MC_MAX_CONTROLLERS];
+static uint8_t NumControllers;
+
+static uint16_t UpdatesPerService = MC_SERVICE_US / 500;
+static uint16_t UpdateCount;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   MC_Init
+
+ Parameters
+   uint16_t : period MC_ServiceAll is called at, in us
+
+ Returns
+   void
+
+ Description
+   Sizes the service period for the control rate
+ Notes
+   Registered controllers are kept, so this may be called again when the
+   control rate changes
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MC_Init(uint16_t UpdatePeriodUS)
+{
+  UpdatesPerService = MC_SERVICE_US / UpdatePeriodUS;
+  if (UpdatesPerService == 0)
+  {
+    UpdatesPerService = 1;
+  }
+  UpdateCount = 0;
+}
+
+/****************************************************************************
+ Function
+   MC_Register
+
+ Parameters
+   MotorController_t * : controller with its setup fields filled in
+
+ Returns
+   bool : false if MC_MAX_CONTROLLERS are already registered
+
+ Description
+   Adds a controller to the ones serviced by MC_ServiceAll, it starts out
+   stopped
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool MC_Register(MotorController_t *Controller)
+{
+  bool ReturnVal = false;
+
+  Controller->Setpoint = 0;
+  Controller->Speed = 0;
+  Controller->Duty = 0;
+  Controller->Measured = false;
+  Controller->State = MC_STOPPED;
+  MC_ResetPI(&Controller->PI);
+
+  EnterCritical();
+  if (NumControllers < MC_MAX_CONTROLLERS)
+  {
+    Controllers[NumControllers++] = Controller;
+    ReturnVal = true;
+  }
+  ExitCritical();
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   MC_SetSpeed
+
+ Parameters
+   MotorController_t * : a registered controller
+   float : new speed in RPM, 0 turns the motor off
+
+ Returns
+   void
+
+ Description
+   Changes the setpoint. Starting from stopped or from a fault clears the
+   PI state and the retry count.
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MC_SetSpeed(MotorController_t *Controller, float RPM)
+{
+  EnterCritical();
+  Controller->Setpoint = RPM;
+  if (RPM == 0)
+  {
+    Controller->State = MC_STOPPED;
+    Controller->Duty = 0;
+    Controller->Output(0);
+  }
+  else if ((Controller->State == MC_STOPPED) || (Controller->State == MC_FAULT))
+  {
+    MC_ResetPI(&Controller->PI);
+    Controller->State = MC_RUNNING;
+    Controller->JamMS = 0;
+    Controller->CleanMS = 0;
+    Controller->Retries = 0;
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   MC_Stop
+
+ Parameters
+   MotorController_t * : a registered controller
+
+ Returns
+   void
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MC_Stop(MotorController_t *Controller)
+{
+  MC_SetSpeed(Controller, 0);
+}
+
+/****************************************************************************
+ Function
+   MC_QueryState
+
+ Parameters
+   MotorController_t * : a registered controller
+
+ Returns
+   MC_State_t : stopped, running, reversing out of a jam or given up
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+MC_State_t MC_QueryState(MotorController_t *Controller)
+{
+  return Controller->State;
+}
+
+/****************************************************************************
+ Function
+   MC_QuerySpeed
+
+ Parameters
+   MotorController_t * : a registered controller
+
+ Returns
+   float : last measured speed in RPM
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MC_QuerySpeed(MotorController_t *Controller)
+{
+  return Controller->Speed;
+}
+
+/****************************************************************************
+ Function
+   MC_QueryDuty
+
+ Parameters
+   MotorController_t * : a registered controller
+
+ Returns
+   float : duty last applied, percent
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MC_QueryDuty(MotorController_t *Controller)
+{
+  return Controller->Duty;
+}
+
+/****************************************************************************
+ Function
+   MC_ServiceAll
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Called every control period from the drive control ISR
+ Notes
+   Controllers that are off are still measured so their speed reads right
+   while coasting down
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MC_ServiceAll(void)
+{
+  MotorController_t *Controller;
+  uint8_t i;
+
+  for (i = 0; i < NumControllers; i++)
+  {
+    Controller = Controllers[i];
+    if (!Controller->Measured)
+    {
+      Controller->Measured = Controller->Measure(&Controller->Speed);
+    }
+  }
+
+  if (++UpdateCount < UpdatesPerService)
+  {
+    return;
+  }
+  UpdateCount = 0;
+  for (i = 0; i < NumControllers; i++)
+  {
+    UpdateController(Controllers[i]);
+    Controllers[i]->Measured = false;
+  }
+}
+
+/****************************************************************************
+ Function
+   MC_ResetPI
+
+ Parameters
+   MC_PI_t * : loop to clear
+
+ Returns
+   void
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+void MC_ResetPI(MC_PI_t *PI)
+{
+  PI->Integral = 0;
+  PI->Error = 0;
+}
+
+/****************************************************************************
+ Function
+   MC_RunPI
+
+ Parameters
+   MC_PI_t * : loop gains and state
+   float Setpoint, Measured : RPM
+   float IntegralScale : loop period over the period the gains are tuned at
+   float Limit : largest duty magnitude, percent
+
+ Returns
+   float : duty to apply, percent
+
+ Description
+   One PI step with anti-windup on both the integral term and the output
+ Notes
+   The integral itself is clamped to +-Limit, as the drive wheel loops
+   always have been, so it can hold at most IGain * Limit of duty (30% for
+   the wheels at I = 0.3). The wheel gains are tuned with that authority.
+ Author
+   Sander Tonkens
+****************************************************************************/
+float MC_RunPI(MC_PI_t *PI, float Setpoint, float Measured,
+               float IntegralScale, float Limit)
+{
+  PI->Error = Setpoint - Measured;
+  PI->Integral = Clamp(PI->Integral + IntegralScale * PI->Error, -Limit, Limit);
+  return Clamp(PI->PGain * PI->Error + PI->IGain * PI->Integral, -Limit, Limit);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// One MC_SERVICE_US step of the speed loop and the jam state machine
+static void UpdateController(MotorController_t *Controller)
+{
+  float Reverse;
+
+  switch (Controller->State)
+  {
+    case MC_RUNNING:
+    {
+      //without a new measurement the last duty is held
+      if (Controller->Measured)
+      {
+        Controller->Duty = MC_RunPI(&Controller->PI, Controller->Setpoint,
+            Controller->Speed, Controller->IntegralScale, Controller->MaxDuty);
+        Controller->Output(Controller->Duty);
+      }
+
+      if ((fabsf(Controller->Duty) >= JAM_DUTY * Controller->MaxDuty) &&
+          (fabsf(Controller->Speed) < JAM_SPEED * fabsf(Controller->Setpoint)))
+      {
+        Controller->JamMS += SERVICE_MS;
+        Controller->CleanMS = 0;
+      }
+      else
+      {
+        Controller->JamMS = 0;
+        if (Controller->CleanMS < CLEAR_MS)
+        {
+          Controller->CleanMS += SERVICE_MS;
+        }
+        else
+        {
+          Controller->Retries = 0;
+        }
+      }
+
+      if (Controller->JamMS >= JAM_MS)
+      {
+        if (Controller->Retries >= Controller->MaxRetries)
+        {
+          Controller->State = MC_FAULT;
+          Controller->Duty = 0;
+          Controller->Output(0);
+          PostJamEvent(Controller, EV_MOTOR_FAULT);
+        }
+        else
+        {
+          Controller->Retries++;
+          Controller->State = MC_REVERSING;
+          Controller->StateMS = 0;
+          Reverse = (Controller->Setpoint > 0) ? -Controller->ReverseDuty :
+              Controller->ReverseDuty;
+          Controller->Duty = Reverse;
+          Controller->Output(Reverse);
+          PostJamEvent(Controller, EV_MOTOR_JAM);
+        }
+      }
+    }
+    break;
+
+    case MC_REVERSING:
+    {
+      Controller->StateMS += SERVICE_MS;
+      if (Controller->StateMS >= REVERSE_MS)
+      {
+        //try again from scratch, the integral is wound up against the jam
+        MC_ResetPI(&Controller->PI);
+        Controller->State = MC_RUNNING;
+        Controller->JamMS = 0;
+        Controller->CleanMS = 0;
+        Controller->Duty = 0;
+        Controller->Output(0);
+      }
+    }
+    break;
+
+    default:
+      break;
+  }
+}
+
+static void PostJamEvent(MotorController_t *Controller, ES_EventType_t Type)
+{
+  ES_Event_t JamEvent;
+
+  if (Controller->Post != 0)
+  {
+    JamEvent.EventType = Type;
+    JamEvent.EventParam = Controller->Id;
+    Controller->Post(JamEvent);
+  }
+}
+
+static float Clamp(float Value, float Lower, float Upper)
+{
+  if (Value > Upper)
+  {
+    return Upper;
+  }
+  if (Value < Lower)
+  {
+    return Lower;
+  }
+  return Value;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
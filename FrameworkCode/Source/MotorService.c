@@ -37,6 +37,17 @@
 #include "DriveMotorPWM.h"
 
 #include "DriveCommandModule.h"
+#include "MotorSpeedControl.h"
+#include "ParamStore.h"
+#include "AutoTune.h"
+#include "EncoderCapture.h"
+#include "BeaconService.h"
+#include "PoseFilter.h"
+#include "FastMath.h"
+#include "Triangulation.h"
+#include "ColourClassifier.h"
+#include "SSIBus.h"
+#include "SPISM.h"
 // This module
 #include "MotorService.h"
 //#include "CommunicationSSI.h"
@@ -60,6 +71,12 @@
 static MotorState CurrentState = InitState;
 
 static uint8_t    MyPriority;
+
+//Distance typed in after a calibration drive (inches*100)
+static bool CalEntry;
+static uint32_t CalDistance;
+//Waiting for the digit of the colour to calibrate
+static bool ColourCalEntry;
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
  Function
@@ -171,13 +188,186 @@ ES_Event_t RunMotorService(ES_Event_t ThisEvent)
 			printf("Command Motor to turn -90 degrees \r\n");
 			Drive_Turn(-900);
 		}
+		else if('g' == ThisEvent.EventParam)
+		{
+			printf("Queued 2 feet square route\r\n");
+			Drive_QueueStraight(2400);
+			Drive_QueueTurn(900);
+			Drive_QueueStraight(2400);
+			Drive_QueueTurn(900);
+			Drive_QueueStraight(2400);
+			Drive_QueueTurn(900);
+			Drive_QueueStraight(2400);
+			Drive_StartQueue();
+		}
+		else if('w' == ThisEvent.EventParam)
+		{
+			//same 2 feet square as 'g', driven as one smooth path
+			float X;
+			float Y;
+			float Heading;
+			float Cos;
+			float Sin;
+			PF_QueryPose(&X, &Y, &Heading);
+			FM_SinCosf(Heading*FM_PI/180, &Sin, &Cos);
+			printf("Following 2 feet square path\r\n");
+			Drive_ClearWaypoints();
+			Drive_AddWaypoint((X + 24*Cos)*100, (Y + 24*Sin)*100);
+			Drive_AddWaypoint((X + 24*Cos - 24*Sin)*100, (Y + 24*Sin + 24*Cos)*100);
+			Drive_AddWaypoint((X - 24*Sin)*100, (Y + 24*Cos)*100);
+			Drive_AddWaypoint(X*100, Y*100);
+			Drive_FollowPath();
+		}
+		else if('b' == ThisEvent.EventParam)
+		{
+			ES_Event_t SweepEvent;
+			printf("Beacon sweep\r\n");
+			SweepEvent.EventType = EV_BEACON_SWEEP;
+			PostBeaconService(SweepEvent);
+		}
+		else if('p' == ThisEvent.EventParam)
+		{
+			//throughput and CPU cost of both SSI buses, the uDMA does the bytes
+			SSIStats_t SSIStats;
+			uint8_t Bus;
+			for (Bus = 0; Bus < SSI_NUM_BUSES; Bus++)
+			{
+				SSI_QueryStats(Bus, &SSIStats);
+				printf("SSI%u %u frames, %u items, %u refused, %u queued max\r\n",
+						Bus, SSIStats.Transfers, SSIStats.Items, SSIStats.Refused,
+						SSIStats.MaxWaiting);
+				printf("  %u us on the wire in %u ms, %u clocks per frame (max %u)\r\n",
+						SSIStats.BusUS, SSIStats.ElapsedMS, SSIStats.Clocks,
+						SSIStats.MaxClocks);
+				SSI_ResetStats(Bus);
+			}
+			printf("COMPASS status change seen within %u ms (max %u)\r\n",
+					GetStatusLatency(), GetMaxStatusLatency());
+		}
 		else if('q' == ThisEvent.EventParam)
 		{
 			printf("Stop MOTOR from moving");
       StopDrive();
 		}
+		else if('t' == ThisEvent.EventParam)
+		{
+			printf("Auto-tuning wheel speed loops\r\n");
+			Drive_StartAutoTune();
+		}
+		else if('c' == ThisEvent.EventParam)
+		{
+			printf("Calibration drive, then type the distance driven in inches*100 and Enter\r\n");
+			CalEntry = true;
+			CalDistance = 0;
+			Drive_StartDistanceCal();
+		}
+		else if('k' == ThisEvent.EventParam)
+		{
+			printf("Colour calibration, type 0 empty, 1 red, 2 orange, 3 yellow, 4 green, 5 blue, 6 pink\r\n");
+			ColourCalEntry = true;
+		}
+		else if(ColourCalEntry && ('0' <= ThisEvent.EventParam) && (ThisEvent.EventParam <= '9'))
+		{
+			ColourCalEntry = false;
+			if(CC_StartCalibration((BallColour_t)(ThisEvent.EventParam - '0')))
+			{
+				printf("Calibrating %s, hold it in front of the sensor\r\n",
+						CC_QueryName((BallColour_t)(ThisEvent.EventParam - '0')));
+			}
+		}
+		else if(CalEntry && ('0' <= ThisEvent.EventParam) && (ThisEvent.EventParam <= '9'))
+		{
+			CalDistance = CalDistance*10 + (ThisEvent.EventParam - '0');
+		}
+		else if(CalEntry && ('\r' == ThisEvent.EventParam))
+		{
+			float TicksPerInch = Drive_FinishDistanceCal(CalDistance);
+			CalEntry = false;
+			if((TicksPerInch > 0) && PS_Set(PS_ID_TicksPerInch, TicksPerInch))
+			{
+				printf("%d.%02d in, %d ticks per 10 in, %s\r\n", (int)(CalDistance/100),
+						(int)(CalDistance%100), (int)(TicksPerInch*10),
+						PS_Save() ? "saved" : "NOT saved");
+			}
+			else
+			{
+				printf("Distance rejected\r\n");
+			}
+		}
 	}
   
+  else if (ThisEvent.EventType == EV_SEGMENT_COMPLETED)
+  {
+    printf("Segment completed, %d queued\r\n", ThisEvent.EventParam);
+  }
+  else if (ThisEvent.EventType == EV_BEARINGS_READY)
+  {
+    float Angles[NUM_BEACONS];
+    Beacon_QueryBearings(Angles);
+    printf("Bearings A %d B %d C %d D %d, fix %s, ISR max %u clocks\r\n",
+        (int)Angles[BEACON_A], (int)Angles[BEACON_B], (int)Angles[BEACON_C],
+        (int)Angles[BEACON_D],
+        PF_CorrectFromBearings(Angles, NULL) ? "used" : "rejected",
+        Beacon_QueryISRMaxTime());
+  }
+  else if (ThisEvent.EventType == EV_WHEEL_STALL)
+  {
+    //duty is already cut, give up on the move
+    printf("Wheel %d stalled\r\n", ThisEvent.EventParam);
+    StopDrive();
+  }
+  else if (ThisEvent.EventType == EV_WHEEL_SLIP)
+  {
+    printf("Wheel %d slipping\r\n", ThisEvent.EventParam);
+  }
+  else if (ThisEvent.EventType == EV_AUTOTUNE_DONE)
+  {
+    AT_Result_t Result;
+    uint8_t Wheel;
+    ParamId_t PGain;
+    for (Wheel = WHEEL_1; Wheel <= WHEEL_2; Wheel++)
+    {
+      //P and I of each wheel are next to each other in the parameter list
+      PGain = (Wheel == WHEEL_1) ? PS_ID_WheelP1 : PS_ID_WheelP2;
+      if (AT_QueryResult(Wheel, &Result) &&
+          PS_Set(PGain, Result.PGain) &&
+          PS_Set((ParamId_t)(PGain + 1), Result.IGain))
+      {
+        printf("Wheel %d: Ku %d/1000, Tu %d ms, P %d/1000, I %d/10000\r\n",
+            Wheel, (int)(Result.Ku*1000), (int)(Result.Tu*1000),
+            (int)(Result.PGain*1000), (int)(Result.IGain*10000));
+      }
+      else
+      {
+        printf("Wheel %d: no limit cycle or gains out of range, kept\r\n",
+            Wheel);
+      }
+    }
+    if (ThisEvent.EventParam != 0)
+    {
+      printf("Gains %s\r\n", PS_Save() ? "saved" : "NOT saved");
+    }
+  }
+  else if (ThisEvent.EventType == EV_BALL_COLOUR)
+  {
+    printf("Ball %s, confidence %d/255\r\n",
+        CC_QueryName(CC_PARAM_COLOUR(ThisEvent.EventParam)),
+        CC_PARAM_CONFIDENCE(ThisEvent.EventParam));
+  }
+  else if (ThisEvent.EventType == EV_COLOUR_CAL_DONE)
+  {
+    uint8_t R;
+    uint8_t G;
+    ParamId_t Centroid;
+    //r and g of each colour are next to each other in the parameter list
+    Centroid = (ParamId_t)(PS_ID_EmptyR + 2 * ThisEvent.EventParam);
+    if (CC_QueryCalibration(&R, &G) && PS_Set(Centroid, R) &&
+        PS_Set((ParamId_t)(Centroid + 1), G))
+    {
+      printf("%s at r %d g %d, %s\r\n", CC_QueryName((BallColour_t)ThisEvent.EventParam),
+          R, G, PS_Save() ? "saved" : "NOT saved");
+    }
+  }
   else if (ThisEvent.EventType == EV_MOVE_COMPLETED)
   {
     StopDrive();
@@ -28,6 +28,15 @@
 #include "MotorSpeedControl.h"
 #include "EncoderCapture.h"
 #include "DriveMotorPWM.h"
+#include "MotionProfile.h"
+#include "MotionQueue.h"
+#include "Odometry.h"
+#include "PoseFilter.h"
+#include "StallDetect.h"
+#include "MotorController.h"
+#include "AutoTune.h"
+#include "PurePursuit.h"
+#include "ParamStore.h"
 
 #include "MotorService.h"
 
@@ -45,22 +54,32 @@
 /*----------------------------- Module Defines ----------------------------*/
 #define TICKS_PER_SECOND	 40000000
 #define TICKS_PER_MS 40000
+#define TICKS_PER_US 40
 #define GEAR_RATIO 50
 #define PULSES_PER_REV 3
 
 #define MIN_ERROR	2
-#define MIN_TICKS	0
 
-#define KPM	2
-#define KDM 10
-#define KPD	5
-#define KDD	10
+//A wheel with no encoder edge for this long is reported as stopped
+#define RPM_TIMEOUT_US	50000
 
-#define RPM_P_GAIN 2
-#define RPM_I_GAIN 0.3
+//Inner (wheel velocity) loop period if none is given, the periods in use
+//are Param.VelocityUS and Param.PositionUS
+#define VELOCITY_UPDATE_US	500		//2 kHz
 
+//Most velocity periods per position period, Decimation is a uint8_t
+#define MAX_DECIMATION	255
 
-#define UPDATE_TIME 2			//Adjusted every 2 ms
+//Default motion profile limits (in encoder ticks, 150 ticks per wheel rev)
+#define DISTANCE_MAX_VEL	250		//ticks/s (100 RPM)
+#define DISTANCE_MAX_ACC	1000	//ticks/s^2
+#define DISTANCE_MAX_JERK	10000	//ticks/s^3, 0 for trapezoidal
+#define HEADING_MAX_VEL		250
+#define HEADING_MAX_ACC		1000
+#define HEADING_MAX_JERK	10000
+
+//Fraction of the profile velocity fed forward into the wheel speed loops
+#define VELOCITY_FF_GAIN 1
 
 /*---------------------------- Module Functions ---------------------------*
   prototypes for private functions for this service.They should be functions
@@ -69,6 +88,15 @@
 
 //static void SetRPM(uint8_t wheel, float newSpeed);
 static float Clamp(float, float, float);
+static void EstimateSpeeds(void);
+static void RunPositionLoop(void);
+static void RunPathFollower(void);
+static void RunVelocityLoop(void);
+static void CheckWheelFaults(void);
+static void RunAutoTune(void);
+static void RecordStageTime(uint8_t Stage, uint32_t StartCount);
+static uint8_t ControlDecimation(uint16_t VelocityPeriod, uint16_t PositionPeriod);
+static bool PostFromISR(ES_Event_t ThisEvent);
 
 /*---------------------------- Module Variables ---------------------------*/
 
@@ -84,22 +112,52 @@ static float LastHeadingError;
 
 static int LastTickCount_1;
 static int LastTickCount_2;
+static uint32_t TimeSinceTick_1;
+static uint32_t TimeSinceTick_2;
 static float DesiredSpeed_1;
 static float DesiredSpeed_2;
 static float LastRecordedSpeed_1;
 static float LastRecordedSpeed_2;
 static float UpdatedDutyCycle_1;
 static float UpdatedDutyCycle_2;
-static float RPMError_1;
-static float RPMError_2;
-static float IntegralTerm_1;
-static float IntegralTerm_2;
+//Gains copied from Param by Drive_ApplyParams, the position loop PD gains
+//are read from Param directly
+static MC_PI_t WheelPI_1;
+static MC_PI_t WheelPI_2;
 
 static bool Driving;
 static float ClampRPM;
 
+static MotionProfile_t DistanceProfile;
+static MotionProfile_t HeadingProfile;
+static MotionLimits_t DistanceLimits = {DISTANCE_MAX_VEL, DISTANCE_MAX_ACC, DISTANCE_MAX_JERK};
+static MotionLimits_t HeadingLimits = {HEADING_MAX_VEL, HEADING_MAX_ACC, HEADING_MAX_JERK};
+
+//Setpoints come from the motion queue instead of the profiles
+static bool QueueMode;
+//Wheel speeds come straight from the pure pursuit path follower
+static bool PathMode;
+
 static uint32_t ControlLoopCount;
 
+//Multi-rate scheduling, set up in Drive_SpeedUpdateTimer_Init
+static uint16_t VelocityPeriodUS;
+static uint16_t PositionPeriodUS;
+static uint8_t Decimation = 1;
+static uint8_t DecimationCount;
+static float IntegralScale;
+static float DerivativeScale;
+static float ProfileToRPM;
+
+//Per-stage execution time in CPU clocks (last and worst case)
+static uint32_t StageTime[NUM_CONTROL_STAGES];
+static uint32_t StageMaxTime[NUM_CONTROL_STAGES];
+
+//Posts from the control ISR that found the MotorService queue full. The
+//arrival and fault events are posted again next period until they fit.
+static uint32_t LostPosts;
+static uint8_t PendingFaults;
+
 
 static float ClampPWM = 100;
 
@@ -160,12 +218,23 @@ void Drive_SpeedControl_Init(void){
 	//initialize drive motor encoders
 	//Enc_Sense_Init();
 	
-	 //initialize the periodic speed update timer
-	Drive_SpeedUpdateTimer_Init(UPDATE_TIME);
+	//start dead reckoning from the origin, position unknown until a beacon fix
+	Odo_Init();
+	PF_Init();
+	
+	MQ_Init();
+	
+	 //wheel gains and the periodic speed update timer, from the parameters
+	Drive_ApplyParams();
 }
 
 void Drive_Stop(void){
 	Driving = false;
+	QueueMode = false;
+	PathMode = false;
+	MQ_Clear();
+	MP_Cancel(&DistanceProfile);
+	MP_Cancel(&HeadingProfile);
 	 //reset control variables
 	DesiredDistance = 0;
 	DesiredHeading = 0;
@@ -176,8 +245,10 @@ void Drive_Stop(void){
 	LastTickCount_1 = 0;
 	LastTickCount_2 = 0;
 	//Reset integral term of controller
-	IntegralTerm_1 = 0;
-	IntegralTerm_2 = 0;
+	MC_ResetPI(&WheelPI_1);
+	MC_ResetPI(&WheelPI_2);
+	SD_Reset();
+	AT_Abort();
 }
 
 void Drive_SetDistance(float newLimit){
@@ -188,11 +259,18 @@ void Drive_SetDistance(float newLimit){
 	LastTickCount_1 = 0;
 	LastTickCount_2 = 0;
 	//Reset integral term of controller
-	IntegralTerm_1 = 0.0;
-	IntegralTerm_2 = 0.0;
-	 //set new distance setpoint
+	MC_ResetPI(&WheelPI_1);
+	MC_ResetPI(&WheelPI_2);
+	 //set new distance setpoint, ramped in by the motion profile
 	DesiredHeading = 0;
-	DesiredDistance = newLimit;
+	DesiredDistance = 0;
+	QueueMode = false;
+	PathMode = false;
+	MQ_Clear();
+	MP_Cancel(&HeadingProfile);
+	MP_Plan(&DistanceProfile, newLimit, &DistanceLimits, PositionPeriodUS);
+	DesiredDistance = MP_GetPosition(&DistanceProfile);
+	SD_Reset();
 	Driving = true;
 }
 
@@ -204,12 +282,129 @@ void Drive_SetHeading(float newLimit){
 	LastTickCount_1 = 0;
 	LastTickCount_2 = 0;
 	//Reset integral term of controller
-	IntegralTerm_1 = 0.0;
-	IntegralTerm_2 = 0.0;
-	//set new distance setpoint
-	DesiredHeading = newLimit;
+	MC_ResetPI(&WheelPI_1);
+	MC_ResetPI(&WheelPI_2);
+	//set new heading setpoint, ramped in by the motion profile
+	DesiredHeading = 0;
+	DesiredDistance = 0;
+	QueueMode = false;
+	PathMode = false;
+	MQ_Clear();
+	MP_Cancel(&DistanceProfile);
+	MP_Plan(&HeadingProfile, newLimit, &HeadingLimits, PositionPeriodUS);
+	DesiredHeading = MP_GetPosition(&HeadingProfile);
+	SD_Reset();
+	Driving = true;
+}
+
+/****************************************************************************
+ Function
+   Drive_RunQueue
+
+ Parameters
+	void
+
+ Returns
+   void
+
+ Description
+	starts driving the segments in the motion queue, from the current
+	position. EV_SEGMENT_COMPLETED is posted as each segment ends and
+	EV_MOVE_COMPLETED once the queue has drained and the robot has settled
+ Notes
+   Segments may still be pushed while the queue runs
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_RunQueue(void){
+	//start from rest at a fresh origin, once for the whole queue
+	QueueMode = false;
+	PathMode = false;
+	MP_Cancel(&DistanceProfile);
+	MP_Cancel(&HeadingProfile);
+	ResetEncoderTickCount(BOTH_WHEELS);
+	LastTickCount_1 = 0;
+	LastTickCount_2 = 0;
+	MC_ResetPI(&WheelPI_1);
+	MC_ResetPI(&WheelPI_2);
+	DesiredHeading = 0;
+	DesiredDistance = 0;
+	MQ_Start();
+	SD_Reset();
+	QueueMode = true;
+	Driving = true;
+}
+
+/****************************************************************************
+ Function
+   Drive_RunPath
+
+ Parameters
+	void
+
+ Returns
+   bool : false if the path has no waypoints
+
+ Description
+	starts following the pure pursuit path from the current pose.
+	EV_SEGMENT_COMPLETED is posted as each waypoint is passed and
+	EV_MOVE_COMPLETED at the last one
+ Notes
+   The wheel speeds come from PurePursuit, the position loops are idle
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool Drive_RunPath(void){
+	QueueMode = false;
+	PathMode = false;
+	MQ_Clear();
+	MP_Cancel(&DistanceProfile);
+	MP_Cancel(&HeadingProfile);
+	ResetEncoderTickCount(BOTH_WHEELS);
+	LastTickCount_1 = 0;
+	LastTickCount_2 = 0;
+	MC_ResetPI(&WheelPI_1);
+	MC_ResetPI(&WheelPI_2);
+	DesiredHeading = 0;
 	DesiredDistance = 0;
+	if(!PP_Start()){
+		return false;
+	}
+	SD_Reset();
+	PathMode = true;
 	Driving = true;
+	return true;
+}
+
+/****************************************************************************
+ Function
+   Drive_SetDistanceLimits / Drive_SetHeadingLimits
+
+ Parameters
+	float : max velocity (ticks/s)
+	float : max acceleration (ticks/s^2)
+	float : max jerk (ticks/s^3), 0 selects a trapezoidal profile
+
+ Returns
+   void
+
+ Description
+	set the motion profile limits used by the next distance/heading command
+ Notes
+   
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_SetDistanceLimits(float MaxVelocity, float MaxAccel, float MaxJerk){
+	DistanceLimits.MaxVelocity = MaxVelocity;
+	DistanceLimits.MaxAccel = MaxAccel;
+	DistanceLimits.MaxJerk = MaxJerk;
+}
+
+void Drive_SetHeadingLimits(float MaxVelocity, float MaxAccel, float MaxJerk){
+	HeadingLimits.MaxVelocity = MaxVelocity;
+	HeadingLimits.MaxAccel = MaxAccel;
+	HeadingLimits.MaxJerk = MaxJerk;
 }
 
 /****************************************************************************
@@ -233,6 +428,62 @@ void Drive_SetClampRPM(float MaxRPM){
 	ClampRPM = MaxRPM;
 }
 
+/****************************************************************************
+ Function
+   Drive_ApplyParams
+
+ Parameters
+	void
+
+ Returns
+   void
+
+ Description
+	picks up the wheel PI gains and loop periods from Param, called at init
+	and by the parameter store when one of them is changed
+ Notes
+   The timer is only restarted if a period actually changed, the position
+	period compared as the decimation Drive_SpeedUpdateTimer_Init would pick
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_ApplyParams(void){
+	EnterCritical();
+	WheelPI_1.PGain = Param.WheelP1;
+	WheelPI_1.IGain = Param.WheelI1;
+	WheelPI_2.PGain = Param.WheelP2;
+	WheelPI_2.IGain = Param.WheelI2;
+	ExitCritical();
+	
+	if((Param.VelocityUS != VelocityPeriodUS) ||
+			(ControlDecimation(Param.VelocityUS, Param.PositionUS) != Decimation)){
+		Drive_SpeedUpdateTimer_Init(Param.VelocityUS, Param.PositionUS);
+	}
+}
+
+/****************************************************************************
+ Function
+   Drive_StartAutoTune
+
+ Parameters
+	void
+
+ Returns
+   void
+
+ Description
+	stop and run the relay auto-tune on both wheels, EV_AUTOTUNE_DONE is
+	posted to MotorService when it finishes
+ Notes
+   The robot pivots about each wheel in turn for a few seconds
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Drive_StartAutoTune(void){
+	Drive_Stop();
+	AT_Start(VelocityPeriodUS, NOMINAL_UPDATE_US);
+}
+
 /****************************************************************************
  Function
   QueryDriveRPM
@@ -262,6 +513,89 @@ float QueryDriveRPM(uint8_t wheel){
 	}
 }
 
+/****************************************************************************
+ Function
+  QueryControlDecimation
+
+ Parameters
+	void
+
+ Returns
+	uint8_t : number of velocity loop periods per position loop period
+
+ Description
+	getter for the multi-rate decimation ratio
+ Notes
+   
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t QueryControlDecimation(void){
+	return Decimation;
+}
+
+/****************************************************************************
+ Function
+  QueryStageTime / QueryStageMaxTime
+
+ Parameters
+	uint8_t : control stage (CONTROL_STAGE_xxx)
+
+ Returns
+	uint32_t : last / worst case execution time of that stage in CPU clocks
+
+ Description
+	CPU time of each stage of the control ISR, measured against the
+	count of the control timer itself
+ Notes
+   divide by 40 for microseconds
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t QueryStageTime(uint8_t Stage){
+	if(Stage < NUM_CONTROL_STAGES){
+		return StageTime[Stage];
+	}
+	return 0;
+}
+
+uint32_t QueryStageMaxTime(uint8_t Stage){
+	if(Stage < NUM_CONTROL_STAGES){
+		return StageMaxTime[Stage];
+	}
+	return 0;
+}
+
+/****************************************************************************
+ Function
+  QueryLostPosts
+
+ Parameters
+	void
+
+ Returns
+	uint32_t : posts from the control ISR refused by a full MotorService
+	queue since reset
+
+ Description
+	getter for the lost post count
+ Notes
+   A refused arrival or fault event is posted again the next period, so
+   only segment events are actually lost
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t QueryLostPosts(void){
+	return LostPosts;
+}
+
+void ResetStageTimes(void){
+	uint8_t Stage;
+	for(Stage = 0; Stage < NUM_CONTROL_STAGES; Stage++){
+		StageMaxTime[Stage] = 0;
+	}
+}
+
 /****************************************************************************
  Function
    Drive_SpeedControlISR
@@ -275,11 +609,14 @@ float QueryDriveRPM(uint8_t wheel){
  Description
 	interrupt response for DC motor control loop
  Notes
-   
+	Runs at the velocity loop rate. Speed estimation and the PI velocity
+	loops run every period, the position/heading loops and move completion
+	only every Decimation periods.
  Author
    Sander Tonkens
 ****************************************************************************/
 void Drive_SpeedControlISR(void){
+	uint32_t StartCount;
 	
 	ControlLoopCount++;
 	//printf("Timer interrupt\r\n");
@@ -287,106 +624,34 @@ void Drive_SpeedControlISR(void){
 	HWREG(WTIMER5_BASE+TIMER_O_ICR) = TIMER_ICR_TATOCINT;
 	
 	//***Gather new info from DriveMotorPWM module***//
+	StartCount = HWREG(WTIMER5_BASE+TIMER_O_TAV);
+	EstimateSpeeds();
+	Odo_Update();
+	RecordStageTime(CONTROL_STAGE_RPM, StartCount);
 	
-	//Determine Tick Counts for Motor 1
-	//If not enough new ticks have not been registered (i.e. Motor is at standstill)
-	if(fabsf(QueryEncoderTickCount(1) - LastTickCount_1) <= MIN_TICKS)
-	{
-		//Set last recorded Motor RPM to 0
-		LastRecordedSpeed_1 = 0;
-	}
-
-	else
-	{
-		//Calculate RPM from current period
-		LastRecordedSpeed_1 = ((TICKS_PER_SECOND/(QueryEncoderPeriod(WHEEL1A))*60)/(PULSES_PER_REV*GEAR_RATIO));
-		//Query new tick count
-		LastTickCount_1 = QueryEncoderTickCount(1);
+	//***Position and Heading control, at the decimated rate***//
+	if(++DecimationCount >= Decimation){
+		DecimationCount = 0;
+		StartCount = HWREG(WTIMER5_BASE+TIMER_O_TAV);
+		RunPositionLoop();
+		RecordStageTime(CONTROL_STAGE_POSITION, StartCount);
 	}
 	
-	//Determine Tick Counts for Motor 2
-	//If not enough new ticks have not been registered (i.e. Motor is at standstill)
-	if(fabsf(QueryEncoderTickCount(2) - LastTickCount_2) <= MIN_TICKS)
-	{
-		//Set last recorded Motor RPM to 0
-		LastRecordedSpeed_2 = 0;
+	//***Speed control for both motors***//
+	StartCount = HWREG(WTIMER5_BASE+TIMER_O_TAV);
+	if(AT_IsRunning()){
+		RunAutoTune();
 	}
 	else{
-		//Calculate current RPM from current period
-		LastRecordedSpeed_2 = ((TICKS_PER_SECOND/(QueryEncoderPeriod(WHEEL2A))*60)/(PULSES_PER_REV*GEAR_RATIO));
-		//Capture new tick count
-		LastTickCount_2 = QueryEncoderTickCount(2);
-	}
-	
-	//***Position and Heading control***//
-	
-	//Based on PD controller
-	DistanceError = (DesiredDistance - ((LastTickCount_1+LastTickCount_2)/2)); //taking average of wheel 1 and 2 when driving straight
-  //printf("E:%f\r \n", DistanceError);
-	//printf("1:%d\r\n", LastTickCount_1);
-  //printf("2:%d\r\n", LastTickCount_2);
-  HeadingError = (DesiredHeading- ((LastTickCount_2-LastTickCount_1)/2)); //Subtracting both to take average when turning
-  //printf("HeadingError:%f", HeadingError);
-	DistancePDTerm = KPM*DistanceError + KDM*(DistanceError-LastDistanceError);
-	HeadingPDTerm = KPD*HeadingError + KDD*(HeadingError-LastHeadingError); //Positive HeadingError is wheel 2, negative wheel 1
-	DesiredSpeed_1 = Clamp(DistancePDTerm - HeadingPDTerm, -ClampRPM, ClampRPM);
-	DesiredSpeed_2 = Clamp(DistancePDTerm + HeadingPDTerm, -ClampRPM, ClampRPM);
-	LastDistanceError = DistanceError;
-	LastHeadingError = HeadingError;
- 
-	//***Speed control for Motor 1***//
-	
-	RPMError_1 = DesiredSpeed_1 - LastRecordedSpeed_1;
-	
-	//Add RPM Error to integral term
-	IntegralTerm_1 += RPMError_1;
-	//Include Anti-windup for integral term
-	IntegralTerm_1 = Clamp(IntegralTerm_1, -ClampPWM, ClampPWM); 
-	
-  //Compute UpdatedDutyCycle based on PI controller
-	UpdatedDutyCycle_1 = RPM_P_GAIN*RPMError_1 + RPM_I_GAIN*IntegralTerm_1;
-  
-	//Include anti-windup for full term
-	//Positive = Turn CW, Negative = Turn CCW (To update if necessary)
-	UpdatedDutyCycle_1 = Clamp(UpdatedDutyCycle_1, -ClampPWM, ClampPWM); 
-	//printf("1:%f \r\n", UpdatedDutyCycle_1);
-	//Set Duty Cycle for Motor 1
-	PWMSetDutyCycle_1(UpdatedDutyCycle_1); //REMOVED FOR TESTING
-  //PWMSetDutyCycle_1(ClampPWM); //ADDED FOR TESTING
-	 
-	//***Speed control for Motor 2***//
-	
-	RPMError_2 = DesiredSpeed_2 - LastRecordedSpeed_2;
-	
-	//Add RPM Error to integral term
-	IntegralTerm_2 += RPMError_2;
-	//Include Anti-windup for integral term
-	IntegralTerm_2 = Clamp(IntegralTerm_2, -ClampPWM, ClampPWM);
-	
-	//Compute UpdatedDutyCycle based on PI controller
-	UpdatedDutyCycle_2 = RPM_P_GAIN*RPMError_2 + RPM_I_GAIN*IntegralTerm_2;
-	//Include anti-windup for full term
-	//Positive = Turn CW, Negative = Turn CCW (To update if necessary)
-	UpdatedDutyCycle_2 = Clamp(UpdatedDutyCycle_2, -ClampPWM, ClampPWM);
-	//printf("2:%f \r\n", UpdatedDutyCycle_2);
-	//Set Duty Cycle for Motor 2
-	PWMSetDutyCycle_2(UpdatedDutyCycle_2); //REMOVED FOR TESTING
-  //PWMSetDutyCycle_2(ClampPWM); //ADDED FOR TESTING
-	
-	//***Desired geolocation monitor***//
-	
-	 //if Distance Error and Heading Error is within error bounds
-	if((fabsf(DistanceError) <= MIN_ERROR) && (fabsf(HeadingError) <= MIN_ERROR) && Driving == true){
-		printf("Amount of ticks executed: %d", LastTickCount_1);
-		
-		Driving = false;
-		
-		//post event to Master SM indicating that target has been reached
-		ES_Event_t doneEvent;
-		doneEvent.EventType = EV_MOVE_COMPLETED;
-		PostMotorService(doneEvent);
+		RunVelocityLoop();
+		CheckWheelFaults();
 	}
+	RecordStageTime(CONTROL_STAGE_VELOCITY, StartCount);
 	
+	//***Pickup and transport motors***//
+	StartCount = HWREG(WTIMER5_BASE+TIMER_O_TAV);
+	MC_ServiceAll();
+	RecordStageTime(CONTROL_STAGE_MOTORS, StartCount);
 }
 
 /****************************************************************************
@@ -394,21 +659,25 @@ void Drive_SpeedControlISR(void){
     Drive_SpeedUpdateTimer_Init
 
  Parameters
- uint16_t : speed update delay in ms
+ uint16_t : velocity loop period in us
+ uint16_t : position/heading loop period in us
 
  Returns
    void
 
  Description
-   initializes periodic timer functionality for wide timer 5A
+   initializes periodic timer functionality for wide timer 5A, may be called
+   again at runtime to change the loop rates
  Notes
-   
+   The position period is rounded down to a whole number of velocity
+   periods, 1 to MAX_DECIMATION of them. Profiles already running keep the period they were planned at.
+   Stall faults latched by StallDetect, and the safe duty they impose, are
+   kept across a rate change.
  Author
    Sander Tonkens
 ****************************************************************************/
-void Drive_SpeedUpdateTimer_Init(uint16_t updateTime){
+void Drive_SpeedUpdateTimer_Init(uint16_t VelocityPeriod, uint16_t PositionPeriod){
 	//initialization for Periodic Timer (Timer 5-A)
-	printf("Update control loop \r\n");
 	//start by enabling the clock to the timer (Wide Timer 5)
 	HWREG(SYSCTL_RCGCWTIMER) |= SYSCTL_RCGCWTIMER_R5;
 	
@@ -418,6 +687,22 @@ void Drive_SpeedUpdateTimer_Init(uint16_t updateTime){
 	
 	//make sure that timer (Timer A) is disabled before configuring
 	HWREG(WTIMER5_BASE+TIMER_O_CTL) &= ~TIMER_CTL_TAEN;
+	
+	//with the timer stopped the ISR can't see a half-updated schedule
+	if(VelocityPeriod == 0){
+		VelocityPeriod = VELOCITY_UPDATE_US;
+	}
+	Decimation = ControlDecimation(VelocityPeriod, PositionPeriod);
+	DecimationCount = 0;
+	VelocityPeriodUS = VelocityPeriod;
+	PositionPeriodUS = Decimation*VelocityPeriod;
+	IntegralScale = (float)VelocityPeriodUS/NOMINAL_UPDATE_US;
+	DerivativeScale = (float)NOMINAL_UPDATE_US/PositionPeriodUS;
+	ProfileToRPM = (1000000.0f/PositionPeriodUS)*60/(PULSES_PER_REV*GEAR_RATIO);
+	ResetStageTimes();
+	SD_Init(VelocityPeriodUS);
+	MC_Init(VelocityPeriodUS);
+	
 	//set it up in 32bit wide (individual, not concatenated) mode
 	HWREG(WTIMER5_BASE+TIMER_O_CFG) = TIMER_CFG_16_BIT;
 	
@@ -425,7 +710,7 @@ void Drive_SpeedUpdateTimer_Init(uint16_t updateTime){
 	HWREG(WTIMER5_BASE+TIMER_O_TAMR) = (HWREG(WTIMER5_BASE+TIMER_O_TAMR)& ~TIMER_TAMR_TAMR_M)| TIMER_TAMR_TAMR_PERIOD;
 	
 	//set Periodic timeout rate
-	HWREG(WTIMER5_BASE+TIMER_O_TAILR) = TICKS_PER_MS * updateTime; //***************
+	HWREG(WTIMER5_BASE+TIMER_O_TAILR) = TICKS_PER_US * VelocityPeriodUS;
 	
 	//enable a local timeout interrupt
 	HWREG(WTIMER5_BASE+TIMER_O_IMR) |= TIMER_IMR_TATOIM;
@@ -441,6 +726,309 @@ void Drive_SpeedUpdateTimer_Init(uint16_t updateTime){
 	HWREG(WTIMER5_BASE+TIMER_O_CTL) |= (TIMER_CTL_TAEN | TIMER_CTL_TASTALL);
 }
 
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+/****************************************************************************
+ Function
+  ControlDecimation
+
+ Description
+	velocity periods per position period, rounded down and kept within
+	1 to MAX_DECIMATION. A VelocityPeriod of 0 counts as VELOCITY_UPDATE_US.
+****************************************************************************/
+static uint8_t ControlDecimation(uint16_t VelocityPeriod, uint16_t PositionPeriod){
+	uint16_t Periods;
+	
+	if(VelocityPeriod == 0){
+		VelocityPeriod = VELOCITY_UPDATE_US;
+	}
+	Periods = PositionPeriod/VelocityPeriod;
+	if(Periods == 0){
+		Periods = 1;
+	}
+	else if(Periods > MAX_DECIMATION){
+		Periods = MAX_DECIMATION;
+	}
+	return (uint8_t)Periods;
+}
+
+/****************************************************************************
+ Function
+  EstimateSpeeds
+
+ Description
+	updates the measured RPM of both wheels from the last encoder period,
+	a wheel with no new edge for RPM_TIMEOUT_US is reported as stopped
+****************************************************************************/
+static void EstimateSpeeds(void){
+	int TickCount;
+	
+	//Determine Tick Counts for Motor 1
+	TickCount = QueryEncoderTickCount(WHEEL_1);
+	if(TickCount != LastTickCount_1)
+	{
+		//Calculate RPM from current period
+		LastRecordedSpeed_1 = ((TICKS_PER_SECOND/(QueryEncoderPeriod(WHEEL1A))*60)/(PULSES_PER_REV*GEAR_RATIO));
+		//Query new tick count
+		LastTickCount_1 = TickCount;
+		TimeSinceTick_1 = 0;
+	}
+	else if(TimeSinceTick_1 < RPM_TIMEOUT_US)
+	{
+		TimeSinceTick_1 += VelocityPeriodUS;
+	}
+	else
+	{
+		//Motor is at standstill, set last recorded Motor RPM to 0
+		LastRecordedSpeed_1 = 0;
+	}
+	
+	//Determine Tick Counts for Motor 2
+	TickCount = QueryEncoderTickCount(WHEEL_2);
+	if(TickCount != LastTickCount_2)
+	{
+		//Calculate current RPM from current period
+		LastRecordedSpeed_2 = ((TICKS_PER_SECOND/(QueryEncoderPeriod(WHEEL2A))*60)/(PULSES_PER_REV*GEAR_RATIO));
+		//Capture new tick count
+		LastTickCount_2 = TickCount;
+		TimeSinceTick_2 = 0;
+	}
+	else if(TimeSinceTick_2 < RPM_TIMEOUT_US)
+	{
+		TimeSinceTick_2 += VelocityPeriodUS;
+	}
+	else
+	{
+		LastRecordedSpeed_2 = 0;
+	}
+}
+
+/****************************************************************************
+ Function
+  RunPositionLoop
+
+ Description
+	PD position and heading loops, sets the wheel speed setpoints and posts
+	EV_MOVE_COMPLETED once the move is done
+****************************************************************************/
+static void RunPositionLoop(void){
+	MotionSetpoint_t Setpoint;
+	float DistanceVelocity;
+	float HeadingVelocity;
+	bool Moving;
+	
+	if(PathMode){
+		RunPathFollower();
+		return;
+	}
+	if(QueueMode){
+		//Setpoints from the running queue segment
+		uint8_t Status = MQ_Step(PositionPeriodUS, &Setpoint);
+		DesiredDistance = Setpoint.Distance;
+		DesiredHeading = Setpoint.Heading;
+		DistanceVelocity = Setpoint.DistanceVelocity;
+		HeadingVelocity = Setpoint.HeadingVelocity;
+		Moving = !(Status & (MQ_DRAINED | MQ_IDLE));
+		
+		if(Status & MQ_SEGMENT_DONE){
+			ES_Event_t segmentEvent;
+			segmentEvent.EventType = EV_SEGMENT_COMPLETED;
+			segmentEvent.EventParam = MQ_Count();
+			PostFromISR(segmentEvent);
+		}
+	}
+	else{
+		//Sample the motion profiles for this period's setpoints
+		if(MP_IsActive(&DistanceProfile)){
+			DesiredDistance = MP_Step(&DistanceProfile);
+		}
+		if(MP_IsActive(&HeadingProfile)){
+			DesiredHeading = MP_Step(&HeadingProfile);
+		}
+		DistanceVelocity = MP_GetVelocity(&DistanceProfile);
+		HeadingVelocity = MP_GetVelocity(&HeadingProfile);
+		Moving = MP_IsActive(&DistanceProfile) || MP_IsActive(&HeadingProfile);
+	}
+	
+	//Based on PD controller, with profile velocity fed forward
+	DistanceError = (DesiredDistance - ((LastTickCount_1+LastTickCount_2)/2)); //taking average of wheel 1 and 2 when driving straight
+  //printf("E:%f\r \n", DistanceError);
+	//printf("1:%d\r\n", LastTickCount_1);
+  //printf("2:%d\r\n", LastTickCount_2);
+  HeadingError = (DesiredHeading- ((LastTickCount_2-LastTickCount_1)/2)); //Subtracting both to take average when turning
+  //printf("HeadingError:%f", HeadingError);
+	DistancePDTerm = Param.DistanceP*DistanceError + Param.DistanceD*DerivativeScale*(DistanceError-LastDistanceError);
+	HeadingPDTerm = Param.HeadingP*HeadingError + Param.HeadingD*DerivativeScale*(HeadingError-LastHeadingError); //Positive HeadingError is wheel 2, negative wheel 1
+	DistancePDTerm += VELOCITY_FF_GAIN*ProfileToRPM*DistanceVelocity;
+	HeadingPDTerm += VELOCITY_FF_GAIN*ProfileToRPM*HeadingVelocity;
+	DesiredSpeed_1 = Clamp(DistancePDTerm - HeadingPDTerm, -ClampRPM, ClampRPM);
+	DesiredSpeed_2 = Clamp(DistancePDTerm + HeadingPDTerm, -ClampRPM, ClampRPM);
+	LastDistanceError = DistanceError;
+	LastHeadingError = HeadingError;
+	
+	//***Desired geolocation monitor***//
+	
+	 //if the profiles or queue have finished and Distance Error and Heading Error is within error bounds
+	if(!Moving && (fabsf(DistanceError) <= MIN_ERROR) && (fabsf(HeadingError) <= MIN_ERROR) && Driving == true){
+		//post event to Master SM indicating that target has been reached,
+		//still driving until it is queued so the next period tries again
+		ES_Event_t doneEvent;
+		doneEvent.EventType = EV_MOVE_COMPLETED;
+		if(PostFromISR(doneEvent)){
+			Driving = false;
+			QueueMode = false;
+		}
+	}
+}
+
+/****************************************************************************
+ Function
+  RunPathFollower
+
+ Description
+	pure pursuit in place of the PD loops, sets the wheel speed setpoints and
+	posts the waypoint and arrival events
+****************************************************************************/
+static void RunPathFollower(void){
+	ES_Event_t PathEvent;
+	uint8_t Status = PP_Step(PositionPeriodUS, ClampRPM, &DesiredSpeed_1, &DesiredSpeed_2);
+	
+	if(Status & PP_WAYPOINT_DONE){
+		PathEvent.EventType = EV_SEGMENT_COMPLETED;
+		PathEvent.EventParam = PP_Count();
+		PostFromISR(PathEvent);
+	}
+	//stays in path mode holding zero speed until the next command
+	if((Status & PP_ARRIVED) && Driving){
+		PathEvent.EventType = EV_MOVE_COMPLETED;
+		if(PostFromISR(PathEvent)){
+			Driving = false;
+		}
+	}
+}
+
+/****************************************************************************
+ Function
+  RunVelocityLoop
+
+ Description
+	PI wheel speed loops, integral gain is rescaled for the loop period
+****************************************************************************/
+static void RunVelocityLoop(void){
+	//a stalled wheel may be limited below ClampPWM
+	float DutyLimit_1 = Clamp(SD_QueryDutyLimit(WHEEL_1), 0, ClampPWM);
+	float DutyLimit_2 = Clamp(SD_QueryDutyLimit(WHEEL_2), 0, ClampPWM);
+	
+	//***Speed control for Motor 1***//
+	//Positive = Turn CW, Negative = Turn CCW (To update if necessary)
+	UpdatedDutyCycle_1 = MC_RunPI(&WheelPI_1, DesiredSpeed_1, LastRecordedSpeed_1,
+		IntegralScale, DutyLimit_1);
+	//printf("1:%f \r\n", UpdatedDutyCycle_1);
+	//Set Duty Cycle for Motor 1
+	PWMSetDutyCycle_1(UpdatedDutyCycle_1);
+	 
+	//***Speed control for Motor 2***//
+	UpdatedDutyCycle_2 = MC_RunPI(&WheelPI_2, DesiredSpeed_2, LastRecordedSpeed_2,
+		IntegralScale, DutyLimit_2);
+	//printf("2:%f \r\n", UpdatedDutyCycle_2);
+	//Set Duty Cycle for Motor 2
+	PWMSetDutyCycle_2(UpdatedDutyCycle_2);
+}
+
+/****************************************************************************
+ Function
+  CheckWheelFaults
+
+ Description
+	feeds the stall/slip detector while driving, posts EV_WHEEL_STALL or
+	EV_WHEEL_SLIP with the wheel as the parameter when one is first seen,
+	one event per wheel and kind, held in PendingFaults until it is queued
+****************************************************************************/
+static void CheckWheelFaults(void){
+	ES_Event_t FaultEvent;
+	uint8_t Bit;
+	
+	if(!Driving){
+		PendingFaults = 0;
+		return;
+	}
+	PendingFaults |= SD_Update(UpdatedDutyCycle_1, UpdatedDutyCycle_2,
+		LastRecordedSpeed_1, LastRecordedSpeed_2, DesiredSpeed_1, DesiredSpeed_2);
+	if(PendingFaults & (SD_STALL_1 | SD_STALL_2)){
+		Bit = (PendingFaults & SD_STALL_1) ? SD_STALL_1 : SD_STALL_2;
+		FaultEvent.EventType = EV_WHEEL_STALL;
+		FaultEvent.EventParam = (Bit == SD_STALL_1) ? WHEEL_1 : WHEEL_2;
+		if(PostFromISR(FaultEvent)){
+			PendingFaults &= ~Bit;
+		}
+	}
+	if(PendingFaults & (SD_SLIP_1 | SD_SLIP_2)){
+		Bit = (PendingFaults & SD_SLIP_1) ? SD_SLIP_1 : SD_SLIP_2;
+		FaultEvent.EventType = EV_WHEEL_SLIP;
+		FaultEvent.EventParam = (Bit == SD_SLIP_1) ? WHEEL_1 : WHEEL_2;
+		if(PostFromISR(FaultEvent)){
+			PendingFaults &= ~Bit;
+		}
+	}
+}
+
+/****************************************************************************
+ Function
+  RunAutoTune
+
+ Description
+	relay test in place of the wheel speed loops, when it finishes the
+	position loops start again from where the robot ended up
+****************************************************************************/
+static void RunAutoTune(void){
+	AT_Step(LastRecordedSpeed_1, LastRecordedSpeed_2, &UpdatedDutyCycle_1, &UpdatedDutyCycle_2);
+	PWMSetDutyCycle_1(UpdatedDutyCycle_1);
+	PWMSetDutyCycle_2(UpdatedDutyCycle_2);
+	if(!AT_IsRunning()){
+		ResetEncoderTickCount(BOTH_WHEELS);
+		LastTickCount_1 = 0;
+		LastTickCount_2 = 0;
+		DesiredDistance = 0;
+		DesiredHeading = 0;
+		MC_ResetPI(&WheelPI_1);
+		MC_ResetPI(&WheelPI_2);
+	}
+}
+
+/****************************************************************************
+ Function
+  PostFromISR
+
+ Description
+	posts to MotorService from the control ISR, counting the refusals
+****************************************************************************/
+static bool PostFromISR(ES_Event_t ThisEvent){
+	if(PostMotorService(ThisEvent)){
+		return true;
+	}
+	LostPosts++;
+	return false;
+}
+
+/****************************************************************************
+ Function
+  RecordStageTime
+
+ Description
+	stores the time since StartCount for a stage, the control timer counts
+	down so elapsed clocks are Start - Now
+****************************************************************************/
+static void RecordStageTime(uint8_t Stage, uint32_t StartCount){
+	uint32_t Elapsed = StartCount - HWREG(WTIMER5_BASE+TIMER_O_TAV);
+	
+	StageTime[Stage] = Elapsed;
+	if(Elapsed > StageMaxTime[Stage]){
+		StageMaxTime[Stage] = Elapsed;
+	}
+}
+
 /****************************************************************************
  Function
   clamp
@@ -0,0 +1,284 @@
+/****************************************************************************
+ Module
+   Odometry.c
+
+ Revision
+   1.0.1
+
+ Description
+   Dead-reckoning pose estimate from the drive wheel encoders
+
+ Notes
+   Odo_Update is called from the drive control ISR every control tick. It
+   takes the change in the running encoder totals (which Drive_Stop does not
+   reset) and integrates it into (X, Y, Theta) in fixed point, using the
+   heading at the midpoint of the step.
+
+   The pose is only written from the control ISR and from Odo_SetPose inside
+   a critical section, so Odo_QueryPose returns a consistent copy.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 14:05 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdlib.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "EncoderCapture.h"
+#include "FastMath.h"
+#include "Odometry.h"
+#include "ParamStore.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// Binary angle units per degree
+#define ANGLE_PER_DEGREE (4294967296.0f / 360)
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+
+/*---------------------------- Module Variables ---------------------------*/
+static Pose_t Pose;
+// Forward travel per tick in pose units, and heading change per tick of
+// wheel 2 - wheel 1 in binary angle units, from Param by Odo_ApplyParams
+static int32_t PosePerTick;
+static int32_t AnglePerTickDiff;
+static int32_t LastOdometer_1;
+static int32_t LastOdometer_2;
+// Total path length (pose units) and rotation (1/65536 turn), both unsigned
+// and free running, for the pose filter's uncertainty growth
+static uint32_t Travel;
+static uint32_t Rotation;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   Odo_Init
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Zeroes the pose and latches the current encoder totals
+ Notes
+   Call before the control timer is started
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_Init(void)
+{
+  Pose.X = 0;
+  Pose.Y = 0;
+  Pose.Theta = 0;
+  Odo_ApplyParams();
+  LastOdometer_1 = QueryEncoderOdometer(WHEEL_1);
+  LastOdometer_2 = QueryEncoderOdometer(WHEEL_2);
+}
+
+/****************************************************************************
+ Function
+   Odo_Update
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Integrates the encoder movement since the last call into the pose
+ Notes
+   Called from the control ISR, fixed point only
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_Update(void)
+{
+  int32_t Odometer_1 = QueryEncoderOdometer(WHEEL_1);
+  int32_t Odometer_2 = QueryEncoderOdometer(WHEEL_2);
+  int32_t Delta_1 = Odometer_1 - LastOdometer_1;
+  int32_t Delta_2 = Odometer_2 - LastOdometer_2;
+  int32_t Distance;
+  uint32_t DeltaTheta;
+  uint32_t MidTheta;
+
+  if ((Delta_1 == 0) && (Delta_2 == 0))
+  {
+    return;
+  }
+  LastOdometer_1 = Odometer_1;
+  LastOdometer_2 = Odometer_2;
+
+  Distance = (Delta_1 + Delta_2) * PosePerTick / 2;
+  DeltaTheta = (uint32_t)((Delta_2 - Delta_1) * AnglePerTickDiff);
+
+  //Move along the heading halfway through the step
+  MidTheta = Pose.Theta + (uint32_t)((int32_t)DeltaTheta / 2);
+  Pose.X += (int32_t)(((int64_t)Distance * FM_CosQ15(MidTheta)) >> 15);
+  Pose.Y += (int32_t)(((int64_t)Distance * FM_SinQ15(MidTheta)) >> 15);
+  Pose.Theta += DeltaTheta;
+
+  Travel += abs(Distance);
+  Rotation += (uint32_t)abs((int32_t)DeltaTheta) >> 16;
+}
+
+/****************************************************************************
+ Function
+   Odo_ApplyParams
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Picks up the distance and turn calibration (Param.TicksPerInch and
+   Param.TicksPerDegree, per wheel turning in place)
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_ApplyParams(void)
+{
+  int32_t NewPosePerTick = (int32_t)(POSE_ONE_INCH / Param.TicksPerInch + 0.5f);
+  int32_t NewAnglePerTickDiff =
+      (int32_t)(ANGLE_PER_DEGREE / (2 * Param.TicksPerDegree) + 0.5f);
+
+  EnterCritical();
+  PosePerTick = NewPosePerTick;
+  AnglePerTickDiff = NewAnglePerTickDiff;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   Odo_QueryPose
+
+ Parameters
+   Pose_t * : filled in with the current pose
+
+ Returns
+   void
+
+ Description
+   Copies out the pose without tearing against the control ISR
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_QueryPose(Pose_t *Out)
+{
+  EnterCritical();
+  *Out = Pose;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   Odo_QueryHeading
+
+ Parameters
+   void
+
+ Returns
+   uint32_t : Theta as a binary angle
+
+ Description
+   Heading on its own, a single word so it needs no critical section and
+   is cheap enough to call from other ISRs
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint32_t Odo_QueryHeading(void)
+{
+  return Pose.Theta;
+}
+
+/****************************************************************************
+ Function
+   Odo_SetPose
+
+ Parameters
+   const Pose_t * : new pose, e.g. from a beacon fix
+
+ Returns
+   void
+
+ Description
+   Overwrites the pose, the next update integrates from here
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_SetPose(const Pose_t *In)
+{
+  EnterCritical();
+  Pose = *In;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   Odo_AdjustPose
+
+ Parameters
+   int32_t : change in X (pose units)
+   int32_t : change in Y (pose units)
+   int32_t : change in Theta (binary angle)
+
+ Returns
+   void
+
+ Description
+   Shifts the pose by a correction without losing any movement the
+   control ISR integrates in the meantime
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_AdjustPose(int32_t DeltaX, int32_t DeltaY, int32_t DeltaTheta)
+{
+  EnterCritical();
+  Pose.X += DeltaX;
+  Pose.Y += DeltaY;
+  Pose.Theta += (uint32_t)DeltaTheta;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   Odo_QueryTravel
+
+ Parameters
+   uint32_t * : total path length in pose units
+   uint32_t * : total rotation in 1/65536 turn
+
+ Returns
+   void
+
+ Description
+   Free running distance and rotation totals, take differences between
+   calls to find how far the robot has moved
+ Author
+   Sander Tonkens
+****************************************************************************/
+void Odo_QueryTravel(uint32_t *OutTravel, uint32_t *OutRotation)
+{
+  EnterCritical();
+  *OutTravel = Travel;
+  *OutRotation = Rotation;
+  ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
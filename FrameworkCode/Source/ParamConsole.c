@@ -0,0 +1,334 @@
+/****************************************************************************
+ Module
+   ParamConsole.c
+
+ Revision
+   1.0.1
+
+ Description
+   Serial console for the run time parameters in ParamStore
+
+ Notes
+   Check4Keystroke sends keys here instead of to MotorService once ':' has
+   opened a command line. The line is echoed as it is typed (backspace
+   works), Enter runs it and closes the console, Esc throws it away.
+
+     :list              every parameter with its value and range
+     :get NAME          one parameter
+     :set NAME VALUE    change it now, in RAM
+     :save              write the changes to the EEPROM
+     :defaults          every parameter back to its default, in RAM
+
+   Nothing here waits on the UART: each key is one event, and list prints
+   one parameter per EV_CONSOLE_LIST event it posts to itself, so a long
+   listing doesn't hold up the other services. save blocks for the EEPROM
+   writes of the words that changed, don't use it while driving.
+
+   printf has no %f here, values are printed as fixed point.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 22:40 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "ParamStore.h"
+#include "ParamConsole.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define LINE_LENGTH 40
+
+#define KEY_ENTER '\r'
+#define KEY_ESC 0x1b
+#define KEY_BACKSPACE 0x08
+#define KEY_DELETE 0x7f
+
+// Decimal places printed for PS_FLOAT values
+#define FLOAT_SCALE 10000
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void HandleKey(char Key);
+static void RunLine(void);
+static bool FindParam(const char *Name, ParamId_t *Id);
+static void PrintParam(ParamId_t Id);
+static void PrintValue(ParamType_t Type, float Value);
+
+/*---------------------------- Module Variables ---------------------------*/
+// with the introduction of Gen2, we need a module level Priority variable
+static uint8_t MyPriority;
+
+static bool Active;
+static char Line[LINE_LENGTH + 1];
+static uint8_t LineLength;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     InitParamConsole
+
+ Parameters
+     uint8_t : the priorty of this service
+
+ Returns
+     bool, false if error in initialization, true otherwise
+
+ Description
+     Saves away the priority
+ Notes
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+bool InitParamConsole(uint8_t Priority)
+{
+  ES_Event_t ThisEvent;
+
+  MyPriority = Priority;
+  Active = false;
+
+  ThisEvent.EventType = ES_INIT;
+  if (ES_PostToService(MyPriority, ThisEvent) == true)
+  {
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+/****************************************************************************
+ Function
+     PostParamConsole
+
+ Parameters
+     EF_Event ThisEvent ,the event to post to the queue
+
+ Returns
+     bool false if the Enqueue operation failed, true otherwise
+
+ Description
+     Posts an event to this state machine's queue
+ Notes
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+bool PostParamConsole(ES_Event_t ThisEvent)
+{
+  return ES_PostToService(MyPriority, ThisEvent);
+}
+
+/****************************************************************************
+ Function
+    RunParamConsole
+
+ Parameters
+   ES_Event_t : the event to process
+
+ Returns
+   ES_Event, ES_NO_EVENT if no error ES_ERROR otherwise
+
+ Description
+   ES_NEW_KEY edits or runs the command line, EV_CONSOLE_LIST prints one
+   line of a listing
+ Notes
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+ES_Event_t RunParamConsole(ES_Event_t ThisEvent)
+{
+  ES_Event_t ReturnEvent;
+
+  ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
+
+  if (ThisEvent.EventType == ES_NEW_KEY)
+  {
+    HandleKey((char)ThisEvent.EventParam);
+  }
+  else if ((ThisEvent.EventType == EV_CONSOLE_LIST) &&
+      (ThisEvent.EventParam < PS_NUM_PARAMS))
+  {
+    PrintParam((ParamId_t)ThisEvent.EventParam);
+    ThisEvent.EventParam++;
+    if (ThisEvent.EventParam < PS_NUM_PARAMS)
+    {
+      PostParamConsole(ThisEvent);
+    }
+  }
+  return ReturnEvent;
+}
+
+/****************************************************************************
+ Function
+   PC_IsActive
+
+ Parameters
+   void
+
+ Returns
+   bool : true while a command line is open, keys belong to the console
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PC_IsActive(void)
+{
+  return Active;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static void HandleKey(char Key)
+{
+  if (!Active)
+  {
+    if (Key == PC_OPEN_KEY)
+    {
+      Active = true;
+      LineLength = 0;
+      printf("\r\n:");
+    }
+  }
+  else if (Key == KEY_ENTER)
+  {
+    printf("\r\n");
+    Line[LineLength] = '\0';
+    Active = false;
+    RunLine();
+  }
+  else if (Key == KEY_ESC)
+  {
+    printf("\r\n");
+    Active = false;
+  }
+  else if ((Key == KEY_BACKSPACE) || (Key == KEY_DELETE))
+  {
+    if (LineLength > 0)
+    {
+      LineLength--;
+      printf("\b \b");
+    }
+  }
+  else if ((Key >= ' ') && (Key <= '~') && (LineLength < LINE_LENGTH))
+  {
+    Line[LineLength++] = Key;
+    printf("%c", Key);
+  }
+}
+
+// Splits the line into words and runs the command
+static void RunLine(void)
+{
+  const char *Command = strtok(Line, " ");
+  const char *Name = strtok(NULL, " ");
+  const char *Text = strtok(NULL, " ");
+  ES_Event_t ListEvent;
+  ParamId_t Id;
+  char *End;
+  float Value;
+
+  if (Command == NULL)
+  {
+    return;
+  }
+  if (strcmp(Command, "list") == 0)
+  {
+    ListEvent.EventType = EV_CONSOLE_LIST;
+    ListEvent.EventParam = 0;
+    PostParamConsole(ListEvent);
+  }
+  else if ((strcmp(Command, "get") == 0) && FindParam(Name, &Id))
+  {
+    PrintParam(Id);
+  }
+  else if ((strcmp(Command, "set") == 0) && FindParam(Name, &Id))
+  {
+    if (Text == NULL)
+    {
+      printf("set %s needs a value\r\n", Name);
+      return;
+    }
+    Value = (float)strtod(Text, &End);
+    if ((*End != '\0') || !PS_Set(Id, Value))
+    {
+      printf("%s not set, out of range\r\n", Name);
+    }
+    PrintParam(Id);
+  }
+  else if (strcmp(Command, "save") == 0)
+  {
+    printf("Parameters %s\r\n", PS_Save() ? "saved" : "NOT saved");
+  }
+  else if (strcmp(Command, "defaults") == 0)
+  {
+    PS_RestoreDefaults();
+    printf("Defaults restored, save to keep them\r\n");
+  }
+  else if ((strcmp(Command, "get") != 0) && (strcmp(Command, "set") != 0))
+  {
+    printf("list, get NAME, set NAME VALUE, save or defaults\r\n");
+  }
+}
+
+static bool FindParam(const char *Name, ParamId_t *Id)
+{
+  if ((Name != NULL) && PS_Find(Name, Id))
+  {
+    return true;
+  }
+  printf("No parameter %s\r\n", (Name != NULL) ? Name : "given");
+  return false;
+}
+
+// NAME = value [min, max]
+static void PrintParam(ParamId_t Id)
+{
+  float Min;
+  float Max;
+  ParamType_t Type = PS_QueryType(Id);
+
+  PS_QueryRange(Id, &Min, &Max);
+  printf("%s = ", PS_QueryName(Id));
+  PrintValue(Type, PS_Get(Id));
+  printf(" [");
+  PrintValue(Type, Min);
+  printf(", ");
+  PrintValue(Type, Max);
+  printf("]\r\n");
+}
+
+static void PrintValue(ParamType_t Type, float Value)
+{
+  uint32_t Scaled;
+
+  if (Type == PS_UINT)
+  {
+    printf("%u", (unsigned int)Value);
+    return;
+  }
+  if (Value < 0)
+  {
+    printf("-");
+    Value = -Value;
+  }
+  Scaled = (uint32_t)(Value * FLOAT_SCALE + 0.5f);
+  printf("%u.%04u", (unsigned int)(Scaled / FLOAT_SCALE),
+      (unsigned int)(Scaled % FLOAT_SCALE));
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,431 @@
+/****************************************************************************
+ Module
+   ParamStore.c
+
+ Revision
+   1.0.1
+
+ Description
+   Registry of the run time tuning parameters listed in ParamStore.h, with
+   their copy in the TM4C123 EEPROM
+
+ Notes
+   Param is a plain struct built from the list, so code on the hot path
+   reads Param.Name at the cost of one load. The registry (names, types,
+   ranges, defaults and change hooks) is a const table built from the same
+   list and is only used by PS_Set, PS_Find and the console.
+
+   EEPROM layout from EEPROM_ADDRESS, one word each:
+     magic, layout hash, the parameters in list order, checksum
+   The layout hash covers the names and types, so reordering, renaming or
+   adding a parameter makes an old copy fail to load instead of landing in
+   the wrong place. A copy that fails the checks is ignored and the defaults
+   are used; a value that loads but is out of its range gets its default.
+
+   Wear: the EEPROM is only written by PS_Save, and only the words that
+   differ from what is already stored are programmed, so saving after one
+   change costs two word writes (the value and the checksum).
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 22:10 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <string.h>
+#include <stdio.h>
+
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/eeprom.h"
+
+#include "MotorSpeedControl.h"
+#include "Odometry.h"
+#include "IREmitter.h"
+#include "ColourSensor.h"
+#include "ColourClassifier.h"
+#include "ParamStore.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define EEPROM_ADDRESS 0
+#define PS_MAGIC 0x50415231 // "PAR1"
+
+#define HEADER_WORDS 2
+#define STORED_WORDS (HEADER_WORDS + PS_NUM_PARAMS + 1)
+#define WORD_ADDRESS(i) (EEPROM_ADDRESS + 4 * (i))
+
+#define PS_INFO(Name, Type, Min, Max, Default, OnChange) \
+  {#Name, Type, Min, Max, Default, OnChange},
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static float Limit(ParamId_t Id, float Value);
+static uint32_t LayoutHash(void);
+static uint32_t Checksum(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+typedef struct
+{
+  const char *Name;
+  ParamType_t Type;
+  float Min;
+  float Max;
+  float Default;
+  void (*OnChange)(void);
+}ParamInfo_t;
+
+// Every parameter must be exactly one word for the indexing below
+typedef char ParamBlockIsWords[
+  (sizeof(ParamBlock_t) == PS_NUM_PARAMS * sizeof(uint32_t)) ? 1 : -1];
+
+typedef union
+{
+  float F;
+  uint32_t U;
+}ParamWord_t;
+
+ParamBlock_t Param;
+
+static ParamWord_t * const Words = (ParamWord_t *)&Param;
+static const ParamInfo_t Info[PS_NUM_PARAMS] = {
+  PS_PARAM_LIST(PS_INFO)
+};
+static bool EEPROMReady;
+static bool HooksEnabled = false;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   PS_Init
+
+ Parameters
+   void
+
+ Returns
+   bool : true if the saved parameters were loaded, false for the defaults
+
+ Description
+   Fills Param from the EEPROM, or with the defaults
+ Notes
+   Call before any module that reads Param is initialized. The OnChange
+   hooks are not called, the modules pick the values up at their own init.
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PS_Init(void)
+{
+  uint32_t Header[HEADER_WORDS];
+  uint32_t Stored;
+  uint8_t i;
+  bool Loaded = false;
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+  while (!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+  {}
+  EEPROMReady = (EEPROMInit() == EEPROM_INIT_OK);
+
+  if (EEPROMReady)
+  {
+    EEPROMRead(Header, EEPROM_ADDRESS, sizeof(Header));
+    if ((Header[0] == PS_MAGIC) && (Header[1] == LayoutHash()))
+    {
+      EEPROMRead((uint32_t *)&Param, WORD_ADDRESS(HEADER_WORDS),
+          sizeof(Param));
+      EEPROMRead(&Stored, WORD_ADDRESS(STORED_WORDS - 1), sizeof(Stored));
+      Loaded = (Stored == Checksum());
+    }
+  }
+
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    //a value that is out of range (or from a bad copy) gets its default
+    if (!Loaded || !PS_Set((ParamId_t)i, PS_Get((ParamId_t)i)))
+    {
+      PS_Set((ParamId_t)i, Info[i].Default);
+    }
+  }
+  HooksEnabled = true;
+  printf("Parameters: %s\r\n", Loaded ? "loaded" : "defaults");
+  return Loaded;
+}
+
+/****************************************************************************
+ Function
+   PS_Find
+
+ Parameters
+   const char * : parameter name, as in the list
+   ParamId_t * : set to its id if found
+
+ Returns
+   bool : false if there is no such parameter
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PS_Find(const char *Name, ParamId_t *Id)
+{
+  uint8_t i;
+
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    if (strcmp(Name, Info[i].Name) == 0)
+    {
+      *Id = (ParamId_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+   PS_QueryName
+
+ Parameters
+   ParamId_t : parameter
+
+ Returns
+   const char * : its name
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+const char *PS_QueryName(ParamId_t Id)
+{
+  return Info[Id].Name;
+}
+
+/****************************************************************************
+ Function
+   PS_QueryType
+
+ Parameters
+   ParamId_t : parameter
+
+ Returns
+   ParamType_t : PS_FLOAT or PS_UINT
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+ParamType_t PS_QueryType(ParamId_t Id)
+{
+  return Info[Id].Type;
+}
+
+/****************************************************************************
+ Function
+   PS_QueryRange
+
+ Parameters
+   ParamId_t : parameter
+   float *, float * : filled in with the lowest and highest value PS_Set
+                      accepts
+
+ Returns
+   void
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PS_QueryRange(ParamId_t Id, float *Min, float *Max)
+{
+  *Min = Info[Id].Min;
+  *Max = Info[Id].Max;
+}
+
+/****************************************************************************
+ Function
+   PS_Get
+
+ Parameters
+   ParamId_t : parameter
+
+ Returns
+   float : its value, whatever its type
+
+ Description
+   For the console and other code that works by id, the hot path reads
+   Param directly
+ Author
+   Sander Tonkens
+****************************************************************************/
+float PS_Get(ParamId_t Id)
+{
+  if (Info[Id].Type == PS_UINT)
+  {
+    return (float)Words[Id].U;
+  }
+  return Words[Id].F;
+}
+
+/****************************************************************************
+ Function
+   PS_Set
+
+ Parameters
+   ParamId_t : parameter
+   float : new value, rounded for PS_UINT
+
+ Returns
+   bool : false if the value is outside the parameter's range
+
+ Description
+   Changes a parameter in RAM and calls its OnChange hook. PS_Save makes
+   the change permanent.
+ Notes
+   The hooks are not called from PS_Init, the modules aren't running yet
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PS_Set(ParamId_t Id, float Value)
+{
+  if ((Id >= PS_NUM_PARAMS) || (Limit(Id, Value) != Value))
+  {
+    return false;
+  }
+  if (Info[Id].Type == PS_UINT)
+  {
+    Words[Id].U = (uint32_t)(Value + 0.5f);
+  }
+  else
+  {
+    Words[Id].F = Value;
+  }
+
+  if (HooksEnabled && (Info[Id].OnChange != 0))
+  {
+    Info[Id].OnChange();
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+   PS_RestoreDefaults
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Every parameter back to its default, PS_Save to make it stick
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PS_RestoreDefaults(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    PS_Set((ParamId_t)i, Info[i].Default);
+  }
+}
+
+/****************************************************************************
+ Function
+   PS_Save
+
+ Parameters
+   void
+
+ Returns
+   bool : false if the EEPROM is not working or a write failed
+
+ Description
+   Writes the parameters to the EEPROM, only the words that changed
+ Notes
+   Blocks for each word programmed (a few hundred us), so not while driving
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PS_Save(void)
+{
+  uint32_t Image[STORED_WORDS];
+  uint32_t Stored;
+  uint8_t i;
+  bool Ok = true;
+
+  if (!EEPROMReady)
+  {
+    return false;
+  }
+  Image[0] = PS_MAGIC;
+  Image[1] = LayoutHash();
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    Image[HEADER_WORDS + i] = Words[i].U;
+  }
+  Image[STORED_WORDS - 1] = Checksum();
+
+  for (i = 0; i < STORED_WORDS; i++)
+  {
+    EEPROMRead(&Stored, WORD_ADDRESS(i), sizeof(Stored));
+    if (Stored != Image[i])
+    {
+      Ok = (EEPROMProgram(&Image[i], WORD_ADDRESS(i), sizeof(Image[i])) == 0)
+          && Ok;
+    }
+  }
+  return Ok;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Value clamped to the parameter's range (NaN comes back as the minimum)
+static float Limit(ParamId_t Id, float Value)
+{
+  if (!(Value >= Info[Id].Min))
+  {
+    return Info[Id].Min;
+  }
+  if (Value > Info[Id].Max)
+  {
+    return Info[Id].Max;
+  }
+  return Value;
+}
+
+// FNV-1a over every name and type
+static uint32_t LayoutHash(void)
+{
+  uint32_t Hash = 2166136261u;
+  const char *Name;
+  uint8_t i;
+
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    for (Name = Info[i].Name; *Name != '\0'; Name++)
+    {
+      Hash = (Hash ^ (uint8_t)*Name) * 16777619u;
+    }
+    Hash = (Hash ^ Info[i].Type) * 16777619u;
+  }
+  return Hash;
+}
+
+// Rotate and add over the parameter words
+static uint32_t Checksum(void)
+{
+  uint32_t Sum = PS_MAGIC;
+  uint8_t i;
+
+  for (i = 0; i < PS_NUM_PARAMS; i++)
+  {
+    Sum = ((Sum << 5) | (Sum >> 27)) + Words[i].U;
+  }
+  return Sum;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,453 @@
+/****************************************************************************
+ Module
+   PoseFilter.c
+
+ Revision
+   1.0.1
+
+ Description
+   Blends the encoder odometry with beacon (triangulation) fixes
+
+ Notes
+   The pose itself lives in Odometry, which integrates the wheels at the
+   control rate. This module keeps a diagonal covariance for X, Y and
+   Heading alongside it and, when a fix arrives, applies a Kalman style
+   correction to the odometry pose through Odo_AdjustPose.
+
+   Uncertainty grows linearly with distance driven and angle turned, so
+   the prediction step only has to be brought up to date when a fix or a
+   query needs it (PF_Predict), nothing extra runs in the control ISR.
+
+   The measurement covariance of a fix comes from the beacon geometry: with
+   bearing noise s, cov = s^2 (H'H)^-1 where H is the Jacobian of the
+   beacon bearings wrt (X, Y, Heading). Near-singular geometry (robot on
+   the circle through the beacons) gives a huge covariance and the fix is
+   dropped. Fixes whose innovation fails a chi-square gate are rejected as
+   outliers, after MAX_CONSECUTIVE_REJECTS in a row the filter assumes it
+   is the one that is lost and reopens its uncertainty.
+
+   Field frame: inches from the center of the field, Heading in degrees
+   CCW from East (same as Triangulation).
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 15:20 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+#include <stddef.h>
+
+#include "Odometry.h"
+#include "Triangulation.h"
+#include "PoseFilter.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define PI 3.14159265358979f
+#define RAD_TO_DEG (180.0f / PI)
+#define DEG_TO_RAD (PI / 180.0f)
+
+#define X_STATE 0
+#define Y_STATE 1
+#define HEADING_STATE 2
+#define NUM_STATES 3
+
+// Uncertainty before the first fix (or after losing track)
+#define INITIAL_POSITION_VAR 10000.0f // in^2
+#define INITIAL_HEADING_VAR 32400.0f  // deg^2
+
+// Odometry drift
+#define POSITION_VAR_PER_INCH 0.02f   // in^2 per inch driven
+#define HEADING_VAR_PER_INCH 0.01f    // deg^2 per inch driven
+#define HEADING_VAR_PER_DEGREE 0.05f  // deg^2 per degree turned
+
+// Beacon bearing noise
+#define BEARING_SIGMA_DEG 1.0f
+
+// Fixes worse than this (per axis) are not worth using
+#define MAX_FIX_POSITION_VAR 36.0f  // in^2
+#define MAX_FIX_HEADING_VAR 100.0f  // deg^2
+
+// Chi-square, 3 degrees of freedom, 99%
+#define INNOVATION_GATE 11.34f
+#define MAX_CONSECUTIVE_REJECTS 5
+
+// Only trust our own estimate to single out a bad bearing below this
+#define MAX_PRIOR_POSITION_VAR 100.0f // in^2
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static bool FixVariance(float X, float Y, uint8_t NumBeacons,
+                        const float *BeaconX, const float *BeaconY, float *Var);
+static float WrapDegrees(float Angle);
+static void ResetVariance(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+static float Variance[NUM_STATES];
+static uint32_t LastTravel;
+static uint32_t LastRotation;
+static uint8_t ConsecutiveRejects;
+static uint16_t RejectCount;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   PF_Init
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Starts the filter with no knowledge of where the robot is
+ Notes
+   Call after Odo_Init
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PF_Init(void)
+{
+  ResetVariance();
+  Odo_QueryTravel(&LastTravel, &LastRotation);
+  ConsecutiveRejects = 0;
+  RejectCount = 0;
+}
+
+/****************************************************************************
+ Function
+   PF_Predict
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Grows the uncertainty by the odometry drift since the last call
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PF_Predict(void)
+{
+  uint32_t Travel;
+  uint32_t Rotation;
+  float Distance;
+  float Turn;
+
+  Odo_QueryTravel(&Travel, &Rotation);
+  Distance = POSE_TO_INCHES((float)(Travel - LastTravel));
+  Turn = ROTATION_TO_DEGREES((float)(Rotation - LastRotation));
+  LastTravel = Travel;
+  LastRotation = Rotation;
+
+  Variance[X_STATE] += POSITION_VAR_PER_INCH * Distance;
+  Variance[Y_STATE] += POSITION_VAR_PER_INCH * Distance;
+  Variance[HEADING_STATE] += HEADING_VAR_PER_INCH * Distance +
+      HEADING_VAR_PER_DEGREE * Turn;
+}
+
+/****************************************************************************
+ Function
+   PF_Correct
+
+ Parameters
+   float : fix X (inches)
+   float : fix Y (inches)
+   float : fix Heading (degrees CCW from East)
+   uint8_t : number of beacons used for the fix
+   const float * : X of each beacon used
+   const float * : Y of each beacon used
+
+ Returns
+   bool : true if the fix was used, false if it was rejected
+
+ Description
+   Corrects the odometry pose with a beacon fix, weighted by how well the
+   beacons constrain the position
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PF_Correct(float X, float Y, float Heading, uint8_t NumBeacons,
+                const float *BeaconX, const float *BeaconY)
+{
+  Pose_t Pose;
+  float FixVar[NUM_STATES];
+  float Innovation[NUM_STATES];
+  float Gain[NUM_STATES];
+  float Distance = 0;
+  uint8_t i;
+
+  PF_Predict();
+
+  if (!FixVariance(X, Y, NumBeacons, BeaconX, BeaconY, FixVar))
+  {
+    RejectCount++;
+    return false;
+  }
+
+  Odo_QueryPose(&Pose);
+  Innovation[X_STATE] = X - POSE_TO_INCHES((float)Pose.X);
+  Innovation[Y_STATE] = Y - POSE_TO_INCHES((float)Pose.Y);
+  Innovation[HEADING_STATE] = WrapDegrees(Heading - POSE_TO_DEGREES(Pose.Theta));
+
+  //Normalized innovation squared against the outlier gate
+  for (i = 0; i < NUM_STATES; i++)
+  {
+    Distance += Innovation[i] * Innovation[i] / (Variance[i] + FixVar[i]);
+  }
+  if (Distance > INNOVATION_GATE)
+  {
+    RejectCount++;
+    if (++ConsecutiveRejects >= MAX_CONSECUTIVE_REJECTS)
+    {
+      //Beacons keep disagreeing with us, trust the next fix
+      ResetVariance();
+      ConsecutiveRejects = 0;
+    }
+    return false;
+  }
+  ConsecutiveRejects = 0;
+
+  for (i = 0; i < NUM_STATES; i++)
+  {
+    Gain[i] = Variance[i] / (Variance[i] + FixVar[i]);
+    Variance[i] *= 1 - Gain[i];
+  }
+  Odo_AdjustPose((int32_t)(Gain[X_STATE] * Innovation[X_STATE] * POSE_ONE_INCH),
+                 (int32_t)(Gain[Y_STATE] * Innovation[Y_STATE] * POSE_ONE_INCH),
+                 (int32_t)DEGREES_TO_POSE(Gain[HEADING_STATE] * Innovation[HEADING_STATE]));
+  return true;
+}
+
+/****************************************************************************
+ Function
+   PF_CorrectFromBeacons
+
+ Parameters
+   Angles to the beacons as for Triangulate, -1 for a beacon not seen
+
+ Returns
+   bool : true if the fix was used
+
+ Description
+   PF_CorrectFromBearings with equal confidence in every bearing
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PF_CorrectFromBeacons(float AngleA, float AngleB, float AngleC, float AngleD)
+{
+  const float Angles[NUM_BEACONS] = { AngleA, AngleB, AngleC, AngleD };
+
+  return PF_CorrectFromBearings(Angles, NULL);
+}
+
+/****************************************************************************
+ Function
+   PF_CorrectFromBearings
+
+ Parameters
+   const float * : angle to each beacon as for TriangulateWeighted
+   const float * : confidence in each bearing (NULL for all 1)
+
+ Returns
+   bool : true if the fix was used
+
+ Description
+   Triangulates, using the current estimate to pick out a bad bearing, and
+   feeds the result to PF_Correct
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PF_CorrectFromBearings(const float *Angles, const float *Confidence)
+{
+  float Prior[3];
+  float BeaconX[NUM_BEACONS];
+  float BeaconY[NUM_BEACONS];
+  uint8_t Used;
+  uint8_t NumBeacons = 0;
+  uint8_t i;
+
+  PF_QueryPose(&Prior[0], &Prior[1], &Prior[2]);
+  if (!TriangulateWeighted(Angles, Confidence,
+      (Variance[X_STATE] + Variance[Y_STATE] < MAX_PRIOR_POSITION_VAR) ? Prior : NULL))
+  {
+    RejectCount++;
+    return false;
+  }
+
+  //Geometry of the beacons that made it into the fix
+  Used = QueryFixBeacons();
+  for (i = 0; i < NUM_BEACONS; i++)
+  {
+    if (Used & (1 << i))
+    {
+      QueryBeaconPosition(i, &BeaconX[NumBeacons], &BeaconY[NumBeacons]);
+      NumBeacons++;
+    }
+  }
+  return PF_Correct(QueryXCoordinate(), QueryYCoordinate(), QueryHeading(),
+                    NumBeacons, BeaconX, BeaconY);
+}
+
+/****************************************************************************
+ Function
+   PF_QueryPose
+
+ Parameters
+   float * : X in inches
+   float * : Y in inches
+   float * : Heading in degrees CCW from East, 0 to 360
+
+ Returns
+   void
+
+ Description
+   Current best estimate of the pose
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PF_QueryPose(float *X, float *Y, float *Heading)
+{
+  Pose_t Pose;
+
+  Odo_QueryPose(&Pose);
+  *X = POSE_TO_INCHES((float)Pose.X);
+  *Y = POSE_TO_INCHES((float)Pose.Y);
+  *Heading = POSE_TO_DEGREES(Pose.Theta);
+  if (*Heading < 0)
+  {
+    *Heading += 360;
+  }
+}
+
+/****************************************************************************
+ Function
+   PF_QueryVariance
+
+ Parameters
+   float * : X variance (in^2)
+   float * : Y variance (in^2)
+   float * : Heading variance (deg^2)
+
+ Returns
+   void
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PF_QueryVariance(float *VarX, float *VarY, float *VarHeading)
+{
+  PF_Predict();
+  *VarX = Variance[X_STATE];
+  *VarY = Variance[Y_STATE];
+  *VarHeading = Variance[HEADING_STATE];
+}
+
+/****************************************************************************
+ Function
+   PF_QueryRejectCount
+
+ Parameters
+   void
+
+ Returns
+   uint16_t : number of fixes rejected since PF_Init
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint16_t PF_QueryRejectCount(void)
+{
+  return RejectCount;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Per-axis variance of a fix from the beacon geometry, false if it is too
+// poor to use
+static bool FixVariance(float X, float Y, uint8_t NumBeacons,
+                        const float *BeaconX, const float *BeaconY, float *Var)
+{
+  float A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+  float C00, C11, C22;
+  float Det;
+  float Scale;
+  uint8_t i;
+
+  if (NumBeacons < 3)
+  {
+    return false;
+  }
+
+  //A = H'H, each row of H is d(bearing)/d(X, Y, Heading) = (dy/r^2, -dx/r^2, -1)
+  for (i = 0; i < NumBeacons; i++)
+  {
+    float dx = BeaconX[i] - X;
+    float dy = BeaconY[i] - Y;
+    float r2 = dx * dx + dy * dy;
+    float Hx;
+    float Hy;
+
+    if (r2 < 1)
+    {
+      return false;
+    }
+    Hx = dy / r2;
+    Hy = -dx / r2;
+    A00 += Hx * Hx;
+    A01 += Hx * Hy;
+    A02 -= Hx;
+    A11 += Hy * Hy;
+    A12 -= Hy;
+    A22 += 1;
+  }
+
+  //Diagonal of the inverse through the cofactors
+  C00 = A11 * A22 - A12 * A12;
+  C11 = A00 * A22 - A02 * A02;
+  C22 = A00 * A11 - A01 * A01;
+  Det = A00 * C00 - A01 * (A01 * A22 - A12 * A02) + A02 * (A01 * A12 - A11 * A02);
+  if (Det <= 0)
+  {
+    return false;
+  }
+
+  Scale = BEARING_SIGMA_DEG * DEG_TO_RAD * BEARING_SIGMA_DEG * DEG_TO_RAD / Det;
+  Var[X_STATE] = Scale * C00;
+  Var[Y_STATE] = Scale * C11;
+  Var[HEADING_STATE] = Scale * C22 * RAD_TO_DEG * RAD_TO_DEG;
+
+  return (Var[X_STATE] <= MAX_FIX_POSITION_VAR) &&
+         (Var[Y_STATE] <= MAX_FIX_POSITION_VAR) &&
+         (Var[HEADING_STATE] <= MAX_FIX_HEADING_VAR);
+}
+
+// Wraps an angle difference into -180..180 degrees
+static float WrapDegrees(float Angle)
+{
+  while (Angle > 180)
+  {
+    Angle -= 360;
+  }
+  while (Angle < -180)
+  {
+    Angle += 360;
+  }
+  return Angle;
+}
+
+static void ResetVariance(void)
+{
+  Variance[X_STATE] = INITIAL_POSITION_VAR;
+  Variance[Y_STATE] = INITIAL_POSITION_VAR;
+  Variance[HEADING_STATE] = INITIAL_HEADING_VAR;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,348 @@
+/****************************************************************************
+ Module
+   PurePursuit.c
+
+ Revision
+   1.0.1
+
+ Description
+   Drives smooth arcs through a list of field waypoints by pure pursuit
+
+ Notes
+   The path is the polyline from the pose at PP_Start through the waypoints
+   (field frame, inches, as PoseFilter). Every position loop period PP_Step
+   takes the odometry pose (which the pose filter keeps corrected), finds
+   the point LOOKAHEAD_IN further along the path than the robot, and steers
+   on the arc through it:
+
+     curvature = 2 * lateral offset of the point / distance to it ^ 2
+
+   The speed along the arc is the lowest of MaxRPM, the acceleration ramp
+   from the last period, the speed that can still stop at the end of the
+   path (plus a creep so it gets there), and the speed that keeps the
+   sideways acceleration of the arc under LATERAL_ACCEL. The two wheel speeds follow from the curvature and
+   the track width, which comes from the turn calibration.
+
+   PP_Start does the square roots and divisions for the segments once, so
+   PP_Step is a fixed amount of arithmetic plus one sqrtf per limit and two
+   short walks along the precomputed segments. Each walk is bounded by
+   PP_MAX_WAYPOINTS and is normally zero or one step. It runs inside the
+   position stage of the control ISR, see QueryStageMaxTime.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 23:20 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+
+#include "FastMath.h"
+#include "Odometry.h"
+#include "ParamStore.h"
+#include "PurePursuit.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MAX_POINTS (PP_MAX_WAYPOINTS + 1)
+
+#define LOOKAHEAD_IN 8
+#define ACCEL 60           // in/s^2, about the 1000 ticks/s^2 of the profiles
+#define LATERAL_ACCEL 40   // in/s^2
+#define ARRIVE_IN 0.5f
+#define CREEP_SPEED 1.5f   // in/s, still moving when ARRIVE_IN is reached
+
+// Encoder ticks per wheel revolution, as MotorSpeedControl
+#define TICKS_PER_REV 150
+
+#define Q15_ONE 32768.0f
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static float Min(float a, float b);
+
+/*---------------------------- Module Variables ---------------------------*/
+// Point 0 is the start, segment i runs from point i to point i + 1
+static float PointX[MAX_POINTS];
+static float PointY[MAX_POINTS];
+static uint8_t NumPoints = 1;
+
+static float UnitX[PP_MAX_WAYPOINTS];
+static float UnitY[PP_MAX_WAYPOINTS];
+static float Length[PP_MAX_WAYPOINTS];
+static float LengthAfter[PP_MAX_WAYPOINTS]; // rest of the path past segment i
+
+static uint8_t Segment;
+static float Speed;         // in/s along the path
+static float HalfTrack;     // in
+static float RPMPerInchPerS;
+static float MaxCurvature;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   PP_Clear
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Empties the waypoint list
+ Notes
+   Not while a path is being followed
+ Author
+   Sander Tonkens
+****************************************************************************/
+void PP_Clear(void)
+{
+  NumPoints = 1;
+  Segment = 0;
+}
+
+/****************************************************************************
+ Function
+   PP_AddWaypoint
+
+ Parameters
+   float X, Y : field position in inches
+
+ Returns
+   bool : false if there are already PP_MAX_WAYPOINTS
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PP_AddWaypoint(float X, float Y)
+{
+  if (NumPoints >= MAX_POINTS)
+  {
+    return false;
+  }
+  PointX[NumPoints] = X;
+  PointY[NumPoints] = Y;
+  NumPoints++;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   PP_Count
+
+ Parameters
+   void
+
+ Returns
+   uint8_t : waypoints not yet reached (all of them before PP_Start)
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t PP_Count(void)
+{
+  return NumPoints - 1 - Segment;
+}
+
+/****************************************************************************
+ Function
+   PP_Start
+
+ Parameters
+   void
+
+ Returns
+   bool : false if there are no waypoints
+
+ Description
+   Starts the path at the current pose, PP_Step follows it from then on
+ Notes
+   Waypoints closer than ARRIVE_IN to the one before them are dropped
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool PP_Start(void)
+{
+  Pose_t Pose;
+  float dx;
+  float dy;
+  uint8_t Kept = 1;
+  uint8_t i;
+
+  Odo_QueryPose(&Pose);
+  PointX[0] = POSE_TO_INCHES(Pose.X);
+  PointY[0] = POSE_TO_INCHES(Pose.Y);
+
+  for (i = 1; i < NumPoints; i++)
+  {
+    dx = PointX[i] - PointX[Kept - 1];
+    dy = PointY[i] - PointY[Kept - 1];
+    Length[Kept - 1] = sqrtf(dx * dx + dy * dy);
+    if (Length[Kept - 1] >= ARRIVE_IN)
+    {
+      PointX[Kept] = PointX[i];
+      PointY[Kept] = PointY[i];
+      UnitX[Kept - 1] = dx / Length[Kept - 1];
+      UnitY[Kept - 1] = dy / Length[Kept - 1];
+      Kept++;
+    }
+  }
+  NumPoints = Kept;
+  Segment = 0;
+  if (NumPoints < 2)
+  {
+    return false;
+  }
+
+  LengthAfter[NumPoints - 2] = 0;
+  for (i = NumPoints - 2; i > 0; i--)
+  {
+    LengthAfter[i - 1] = LengthAfter[i] + Length[i];
+  }
+
+  //a wheel turning in place covers TicksPerDegree per degree of rotation
+  HalfTrack = Param.TicksPerDegree * 180 / (FM_PI * Param.TicksPerInch);
+  MaxCurvature = 1 / HalfTrack; // inner wheel stopped
+  RPMPerInchPerS = Param.TicksPerInch * 60 / TICKS_PER_REV;
+  Speed = 0;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   PP_Step
+
+ Parameters
+   uint32_t UpdateTimeUS : time since the last call
+   float MaxRPM : neither wheel goes faster than this
+   float *RPM_1, *RPM_2 : wheel speed setpoints
+
+ Returns
+   uint8_t : PP_WAYPOINT_DONE and PP_ARRIVED status bits
+
+ Description
+   One position loop period of the path, called from the control ISR
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t PP_Step(uint32_t UpdateTimeUS, float MaxRPM, float *RPM_1, float *RPM_2)
+{
+  Pose_t Pose;
+  uint8_t Status = 0;
+  uint8_t Last = NumPoints - 2;
+  uint8_t i;
+  float X;
+  float Y;
+  float Cos;
+  float Sin;
+  float Along;
+  float Remaining;
+  float Ahead;
+  float dx;
+  float dy;
+  float Lateral;
+  float Distance2;
+  float Curvature = 0;
+  float MaxSpeed = MaxRPM / RPMPerInchPerS;
+  float Outer;
+
+  if (Segment > Last)
+  {
+    *RPM_1 = 0;
+    *RPM_2 = 0;
+    return PP_ARRIVED;
+  }
+
+  Odo_QueryPose(&Pose);
+  X = POSE_TO_INCHES(Pose.X);
+  Y = POSE_TO_INCHES(Pose.Y);
+  Cos = FM_CosQ15(Pose.Theta) / Q15_ONE;
+  Sin = FM_SinQ15(Pose.Theta) / Q15_ONE;
+
+  //move on to the next segment once the robot is level with its end
+  for (;;)
+  {
+    Along = (X - PointX[Segment]) * UnitX[Segment] +
+        (Y - PointY[Segment]) * UnitY[Segment];
+    if ((Along < Length[Segment]) || (Segment == Last))
+    {
+      break;
+    }
+    Segment++;
+    Status |= PP_WAYPOINT_DONE;
+  }
+  if (Along < 0)
+  {
+    Along = 0;
+  }
+  Remaining = Length[Segment] - Along + LengthAfter[Segment];
+  if (Remaining < ARRIVE_IN)
+  {
+    Segment = Last + 1;
+    Speed = 0;
+    *RPM_1 = 0;
+    *RPM_2 = 0;
+    return Status | PP_WAYPOINT_DONE | PP_ARRIVED;
+  }
+
+  //the lookahead point, clamped to the end of the path
+  Ahead = Along + LOOKAHEAD_IN;
+  i = Segment;
+  while ((Ahead > Length[i]) && (i < Last))
+  {
+    Ahead -= Length[i];
+    i++;
+  }
+  if (Ahead > Length[i])
+  {
+    Ahead = Length[i];
+  }
+  dx = PointX[i] + Ahead * UnitX[i] - X;
+  dy = PointY[i] + Ahead * UnitY[i] - Y;
+
+  //offset to the left of the robot, and the arc through the point
+  Lateral = Cos * dy - Sin * dx;
+  Distance2 = dx * dx + dy * dy;
+  if (Distance2 > ARRIVE_IN * ARRIVE_IN)
+  {
+    Curvature = 2 * Lateral / Distance2;
+  }
+  if (Curvature > MaxCurvature)
+  {
+    Curvature = MaxCurvature;
+  }
+  else if (Curvature < -MaxCurvature)
+  {
+    Curvature = -MaxCurvature;
+  }
+
+  Speed = Min(Speed + ACCEL * UpdateTimeUS / 1000000.0f, MaxSpeed);
+  Speed = Min(Speed, sqrtf(2 * ACCEL * (Remaining - ARRIVE_IN)) + CREEP_SPEED);
+  if (Curvature != 0)
+  {
+    Speed = Min(Speed, sqrtf(LATERAL_ACCEL / fabsf(Curvature)));
+  }
+  //the outer wheel runs faster than the center, keep it under MaxRPM
+  Outer = 1 + fabsf(Curvature) * HalfTrack;
+  Speed = Min(Speed, MaxSpeed / Outer);
+
+  //wheel 2 ahead of wheel 1 turns left (CCW), as the odometry
+  *RPM_1 = Speed * (1 - Curvature * HalfTrack) * RPMPerInchPerS;
+  *RPM_2 = Speed * (1 + Curvature * HalfTrack) * RPMPerInchPerS;
+  return Status;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+static float Min(float a, float b)
+{
+  return (a < b) ? a : b;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
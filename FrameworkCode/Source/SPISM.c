@@ -35,17 +35,12 @@
 #include "inc/hw_gpio.h"
 #include "inc/hw_sysctl.h"
 #include "inc/hw_pwm.h"
-#include "inc/hw_ssi.h"
-#include "inc/hw_nvic.h"
 
+#include "FrequencyTable.h"
 #include "MotorService.h"
+#include "ParamStore.h"
+#include "SSIBus.h"
 /*----------------------------- Module Defines ----------------------------*/
-#define SSI_PRESCALE 0x00000014
-#define SCR_VALUE    0x0000C800
-
-#define CPSDVSR 0x00000014 
-#define SCR 0x0000C800
-
 #define REG_NORTH 0x10
 #define REG_SOUTH 0x01
 
@@ -53,16 +48,11 @@
 #define ACK_SOUTH 0xA3
 #define ACK_MASK  0xF3
 
-#define SSI0Clk BIT2HI
-#define SSI0Fss BIT3HI
-#define SSI0Rx BIT4HI
-#define SSI0Tx BIT5HI
-
-#define BitsPerNibble 4
-
-#define SPI_QUERYTIME 2
 #define SPI_REFRESHTIME 100
 
+// the first tick of an ES timer can come at once, one more keeps the gap
+#define GAP_TICKS (Param.SPIQueryMS + 1)
+
 #define SPI_INITIALIZING 0xFF
 
 #define TEAM_NORTH 1
@@ -76,12 +66,23 @@
 
 #define ZERO_BYTE 0x00
 
+// command then two bytes to clock the answer out
+#define FRAME_LENGTH 3
+
+// RESPONSE_RECEIVED carries bytes 1 and 2 of the frame, the answer is in
+// byte 2. Byte 0 comes in while the COMPASS is still taking the command.
+#define FRAME_PARAM(Rx) (((uint16_t)(Rx)[1] << 8) | (Rx)[2])
+#define RESPONSE_BYTE(Param) ((uint8_t)((Param) & 0xff))
+
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this machine.They should be functions
    relevant to the behavior of this state machine*/
 //void SPIReceiveISR(void);
 //static void SPISend(uint8_t message);
 static void WriteToSPI(uint8_t TransmitMessage);
+static void ResponseDone(const void *Rx, uint8_t Length);
+static uint16_t StatusInterval(uint16_t Now);
+static void ScheduleNext(uint16_t Now);
 
 /*---------------------------- Module Variables ---------------------------*/
 // everybody needs a state variable, you may need others as well.
@@ -91,6 +92,12 @@ static SPISM_t CurrentState;
 // with the introduction of Gen2, we need a module level Priority var as well
 static uint8_t MyPriority;
 
+// the COMPASS on SSI0: mode 3, 40 MHz / (20 * (1 + 200)), just under 10 kHz,
+// 8 bit items, selected by the FSS pin
+static const SSIDevice_t Compass = {
+  SSI_BUS0, SSI_MODE_SPO | SSI_MODE_SPH, 20, 200, 8, SSI_CS_FSS, 0
+};
+
 //My team
 static uint8_t TeamStatusByte;
 static uint8_t GameStatusByte;
@@ -106,8 +113,9 @@ static uint8_t ValueTxByte = 0x69;
 //static uint8_t StatusCmd = 0x78;
 //static uint8_t ValCmd = 0x69;
 
-static uint16_t RecycleActFreq[16] = {1000,947,893,840,787,733,680,627,
-                                       573,520,467,413,360,307,253,200};
+static const uint16_t RecycleActFreq[FT_NUM_RECYCLE_FREQUENCIES] = {
+  FT_RECYCLE_LIST(FT_FREQUENCY, 0, 0)
+};
 
 static uint8_t ExpectedAckByte;
 
@@ -121,6 +129,22 @@ static uint16_t AssignedFrequency;
 
 static uint8_t TeamSwitchValue;
 
+static uint8_t TxFrame[FRAME_LENGTH];
+
+//query times and status changes, ES_Timer_GetTime ms
+static uint16_t LastStatusMS;
+static uint16_t LastValueMS;
+static uint16_t LastStatusSeenMS;
+static uint16_t LastTickMS;
+static uint32_t SinceChangeMS;
+static uint32_t ChangePeriodMS;
+
+//an answer that differs from the last, waiting for the next to agree
+static bool Confirming;
+static uint8_t CandidateByte;
+static uint16_t StatusLatencyMS;
+static uint16_t MaxStatusLatencyMS;
+
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -147,8 +171,7 @@ bool InitSPISM(uint8_t Priority)
   MyPriority = Priority;  // save our priority
   ThisEvent.EventType = ES_INIT;
 
-  //initialize SPI hardware
-  //InitSPI();
+  SSI_InitDevice(&Compass);
 
   printf("SSI Init Complete\r\n");
 
@@ -160,6 +183,7 @@ bool InitSPISM(uint8_t Priority)
   AssignedColor = 0xFF;
   LastGameState = 0xFF;
   CurrentGameState = 0xFF;
+  Confirming = false;
 	
   AssignedFrequency = 0xFFFF;
 
@@ -190,9 +214,7 @@ bool InitSPISM(uint8_t Priority)
 
   //Start Timer to start sending messages to COMPASS
 	
-	ES_Timer_InitTimer(SPI_TIMER, SPI_QUERYTIME);
-  //disable interrupt
-  HWREG(SSI0_BASE + SSI_O_IM) &= ~SSI_IM_TXIM;
+	ES_Timer_InitTimer(SPI_TIMER, Param.SPIQueryMS);
   
   //Transition to initial state
   CurrentState = Registering;
@@ -244,9 +266,19 @@ bool PostSPISM(ES_Event_t ThisEvent)
    ES_Event_t, ES_NO_EVENT if no error ES_ERROR otherwise
 
  Description
-   add your description here
+   Registers, reads the team info, then polls status and value
  Notes
    uses nested switch/case to implement the machine.
+   Once registered every frame is started from SPI_TIMER, set when the
+   answer to the last one comes in: after the COMPASS gap if something is
+   due, else when the first thing falls due. Status is due every frame
+   while a change is likely: waiting for the start, for StatusHotMS after
+   a change (they come in bursts), and within StatusHotMS of when the next
+   one is expected, the time between the last two changes later (the
+   recycling colours move on a fixed period). Otherwise it is polled every
+   StatusSlowMS, value every SPI_REFRESHTIME.
+   Team info and status changes are only taken when two answers in a row
+   agree, the second one is asked for straight away.
  Author
    Sander TOnkens, 02/15/19, 19:08
 ****************************************************************************/
@@ -257,6 +289,8 @@ ES_Event_t RunSPISM(ES_Event_t ThisEvent)
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
   SPISM_t NextState = CurrentState;
 	uint8_t ReceivedAckByte;
+  uint8_t ReceivedByte;
+  uint16_t Now = ES_Timer_GetTime();
 
   switch (CurrentState)
   {
@@ -265,33 +299,21 @@ ES_Event_t RunSPISM(ES_Event_t ThisEvent)
       if((ThisEvent.EventType == ES_TIMEOUT) && 
         (ThisEvent.EventParam == SPI_TIMER))
       {
-				printf("Writing to SPI \r\n");
         WriteToSPI(RegistrationByte);
-
       }
       else if (ThisEvent.EventType == RESPONSE_RECEIVED)
       {
-				printf("Response received \r\n");
         //Bits 2&3 have to be masked, as ACK byte is unknown
-        ReceivedAckByte = ThisEvent.EventParam;
+        ReceivedAckByte = RESPONSE_BYTE(ThisEvent.EventParam);
 
         //Move to next state only if behaviour is as expected
         if(ReceivedAckByte == ExpectedAckByte)
         {
 					printf("Successfully registered team \n \r");
-          ES_Timer_InitTimer(SPI_TIMER, SPI_QUERYTIME);
-
-          //Disable interrupt
-          HWREG(SSI0_BASE + SSI_O_IM) &= ~SSI_IM_TXIM;
-          //NextState = QueryTeamInfo;
 					NextState = QueryTeamInfo;
         }
-
-        else
-        {
-          printf("Failed to Register Team \n\r");
-        }
-
+        //else registers again after the gap
+        ES_Timer_InitTimer(SPI_TIMER, GAP_TICKS);
       }
     }
     break;
@@ -304,7 +326,17 @@ ES_Event_t RunSPISM(ES_Event_t ThisEvent)
 	    }
 	    else if (ThisEvent.EventType == RESPONSE_RECEIVED)
       {
-				TeamStatusByte = ThisEvent.EventParam;
+        ReceivedByte = RESPONSE_BYTE(ThisEvent.EventParam);
+        if (!Confirming || (ReceivedByte != CandidateByte))
+        {
+          //taken once two answers agree
+          Confirming = true;
+          CandidateByte = ReceivedByte;
+          ES_Timer_InitTimer(SPI_TIMER, GAP_TICKS);
+          break;
+        }
+        Confirming = false;
+				TeamStatusByte = ReceivedByte;
 				
 				AssignedColor = (TeamStatusByte & (BIT1HI|BIT2HI|BIT3HI)) >> 1;
         printf("Assigned Color: %d\n\r", AssignedColor);
@@ -312,73 +344,93 @@ ES_Event_t RunSPISM(ES_Event_t ThisEvent)
           (BIT4HI|BIT5HI|BIT6HI|BIT7HI)) >> 4];
         printf("Assigned Frequency: %d\n\r", AssignedFrequency);
 				
-				//Initialize timers and disable SSI interrupt 
-				//in preparation for move to next state
-				ES_Timer_InitTimer(SPI_TIMER, SPI_QUERYTIME);
-		    ES_Timer_InitTimer(SPI_REFRESH_TIMER, SPI_REFRESHTIME);
-				HWREG(SSI0_BASE + SSI_O_IM) &= ~SSI_IM_TXIM;
+        //status and value are both due straight away
+        LastStatusMS = Now - SPI_REFRESHTIME;
+        LastValueMS = Now - SPI_REFRESHTIME;
+        LastStatusSeenMS = Now;
+        LastTickMS = Now;
+				ScheduleNext(Now);
 				NextState = QueryingStatus;
       }
     }
     break;
 	
 	case QueryingStatus:
+	case QueryingValue:
     {
       if ((ThisEvent.EventType == ES_TIMEOUT) && 
         (ThisEvent.EventParam == SPI_TIMER))
       {
-        WriteToSPI(GameStatusTxByte);
+        //status first when both are due
+        if ((uint16_t)(Now - LastStatusMS) >= StatusInterval(Now))
+        {
+          LastStatusMS = Now;
+          NextState = QueryingStatus;
+          WriteToSPI(GameStatusTxByte);
+        }
+        else
+        {
+          LastValueMS = Now;
+          NextState = QueryingValue;
+          WriteToSPI(ValueTxByte);
+        }
 	    }
-	    else if (ThisEvent.EventType == RESPONSE_RECEIVED)
+	    else if ((ThisEvent.EventType == RESPONSE_RECEIVED) &&
+        (CurrentState == QueryingStatus))
       {
-				GameStatusByte = ThisEvent.EventParam;
-				CurrentGameState = (GameStatusByte & (BIT0HI|BIT1HI));
-				//printf("Current Game State: %d\n\r", CurrentGameState);
-				
-				if ((CurrentGameState == RECYCLING) && 
-          (LastGameState == WAITING_FOR_START))
+        ReceivedByte = RESPONSE_BYTE(ThisEvent.EventParam);
+        if (ReceivedByte == GameStatusByte)
         {
-          printf("Game Started; event not posted\n\r");
-          CommunicationEvent.EventType = ES_CLEANING_UP;
-          PostMotorService(CommunicationEvent);
+          //no change, or a one frame glitch
+          Confirming = false;
+          LastStatusSeenMS = Now;
         }
-        else if ((CurrentGameState == GAME_OVER) && 
-          (LastGameState == RECYCLING))
+        else if (!Confirming || (ReceivedByte != CandidateByte))
         {
-          printf("Game Over; event not posted\n\r");
-          CommunicationEvent.EventType = ES_GAME_OVER;
-          PostMotorService(CommunicationEvent);
+          //a change counts once the next answer agrees, so a corrupted
+          //byte cannot start or end the game
+          Confirming = true;
+          CandidateByte = ReceivedByte;
         }
-        LastGameState = CurrentGameState;
-				
-				//Initialize timer and disable SSI interrupt
-				//in preparation for move to next state
-		    ES_Timer_InitTimer(SPI_TIMER, SPI_QUERYTIME);
-				HWREG(SSI0_BASE + SSI_O_IM) &= ~SSI_IM_TXIM;
-		    NextState = QueryingValue;
+        else
+        {
+          //it changed some time after the last answer with the old value
+          Confirming = false;
+          StatusLatencyMS = Now - LastStatusSeenMS;
+          if (StatusLatencyMS > MaxStatusLatencyMS)
+          {
+            MaxStatusLatencyMS = StatusLatencyMS;
+          }
+          StatusInterval(Now);
+          ChangePeriodMS = SinceChangeMS;
+          SinceChangeMS = 0;
+          LastStatusSeenMS = Now;
+
+          GameStatusByte = ReceivedByte;
+          CurrentGameState = (GameStatusByte & (BIT0HI|BIT1HI));
+
+          if ((CurrentGameState == RECYCLING) &&
+            (LastGameState == WAITING_FOR_START))
+          {
+            printf("Game Started; event not posted\n\r");
+            CommunicationEvent.EventType = ES_CLEANING_UP;
+            PostMotorService(CommunicationEvent);
+          }
+          else if ((CurrentGameState == GAME_OVER) &&
+            (LastGameState == RECYCLING))
+          {
+            printf("Game Over; event not posted\n\r");
+            CommunicationEvent.EventType = ES_GAME_OVER;
+            PostMotorService(CommunicationEvent);
+          }
+          LastGameState = CurrentGameState;
+        }
+        ScheduleNext(Now);
       }
-    }
-    break;
-	
-	case QueryingValue:
-    {
-      if ((ThisEvent.EventType == ES_TIMEOUT) && 
-        (ThisEvent.EventParam == SPI_TIMER))
-      {
-        WriteToSPI(ValueTxByte);
-	    }  
 	    else if (ThisEvent.EventType == RESPONSE_RECEIVED)
       {
-        ValueByte = ThisEvent.EventParam;
-      }
-	    else if ((ThisEvent.EventType == ES_TIMEOUT) && 
-        (ThisEvent.EventParam == SPI_REFRESH_TIMER))
-      {
-				//prep for move to QueryingSTATUS state
-        ES_Timer_InitTimer(SPI_TIMER, SPI_QUERYTIME);
-		    ES_Timer_InitTimer(SPI_REFRESH_TIMER, SPI_REFRESHTIME);
-		    HWREG(SSI0_BASE + SSI_O_IM) &= ~SSI_IM_TXIM;
-				NextState = QueryingStatus;
+        ValueByte = RESPONSE_BYTE(ThisEvent.EventParam);
+        ScheduleNext(Now);
       }
     }
     break;
@@ -391,42 +443,6 @@ ES_Event_t RunSPISM(ES_Event_t ThisEvent)
   return ReturnEvent;
 }
 
-/****************************************************************************
- Function
-     SPIISRResponse
-
- Parameters
-     None
-
- Returns
-     None
-
- Description
-     
- Notes
-
- Author
-     Sander TOnkens, 02/15/2019, 13:14
-****************************************************************************/
-void SPIISRResponse(void)
-{
-  uint8_t ResponseMessage;
-	//printf("ISR triggered");
-  //Clear source of interrupt
-  HWREG(SSI0_BASE + SSI_O_ICR) = SSI_ICR_RTIC;
-
-  //Read the data register
-	HWREG(SSI0_BASE+SSI_O_DR);
-	HWREG(SSI0_BASE+SSI_O_DR);
-  ResponseMessage = HWREG(SSI0_BASE + SSI_O_DR);
-
-  //Post message to SPI SM
-  ES_Event_t ThisEvent;
-  ThisEvent.EventType = RESPONSE_RECEIVED;
-  ThisEvent.EventParam = ResponseMessage;
-  PostSPISM(ThisEvent);
-
-}
 /****************************************************************************
  Function
      GetTeamByte
@@ -537,6 +553,35 @@ uint8_t GetGameState(void)
 	return CurrentGameState;
 }
 
+/****************************************************************************
+ Function
+     GetStatusLatency / GetMaxStatusLatency
+
+ Parameters
+     None
+
+ Returns
+     ms from the status answer before the last change to the one that
+     showed it, the last time and the worst case
+
+ Description
+     The change came some time in between, so this bounds how late it was
+     seen. The frame itself adds FRAME_LENGTH bytes of clock time.
+ Notes
+
+ Author
+     Sander Tonkens
+****************************************************************************/
+uint16_t GetStatusLatency(void)
+{
+  return StatusLatencyMS;
+}
+
+uint16_t GetMaxStatusLatency(void)
+{
+  return MaxStatusLatencyMS;
+}
+
 /****************************************************************************
  Function
      QueryWhichRecycle
@@ -646,145 +691,134 @@ uint16_t GetRightRecycleFreq(void)
   return RightRecycleFrequency;
 }
 
+ /***************************************************************************
+ private functions
+ ***************************************************************************/
+
 /****************************************************************************
  Function
-     InitSPI
+     WriteToSPI
 
  Parameters
-     None
+     message to send
 
  Returns
-     None
+     nothing
 
  Description
      
  Notes
 
  Author
-     Sander TOnkens, 02/18/2019, 19:41
+     Sander TOnkens, 02/15/2019, 16:02
 ****************************************************************************/
-void InitSPI(void)
+static void WriteToSPI(uint8_t TransmitMessage)
 {
- __disable_irq();
-	printf("Initializing the SSI Module \n \r");
-
-    // Enable the clock to the GPIO Port
-	HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R0;
-  
-	// Enable the clock to the SSI module
-	HWREG(SYSCTL_RCGCSSI) |= SYSCTL_RCGCSSI_R0;
-
-    // Wait for GPIO port to be ready
-	while((HWREG(SYSCTL_PRGPIO) & SYSCTL_PRGPIO_R0) != SYSCTL_PRGPIO_R0)
-	{
-	}	
-  while((HWREG(SYSCTL_PRSSI) & SYSCTL_PRSSI_R0) != SYSCTL_PRSSI_R0)
-  {}
-	// Program the GPIO to use the alternate functions
-	// on the SSI pins. The alternate pins are PA2, 3, 4 and 5
-	// CLK line = PA2
-	// SS line = PA3
-	// MISO line = PA4
-	// MOSI line = PA5
-	HWREG(GPIO_PORTA_BASE + GPIO_O_AFSEL) |= (SSI0Clk | SSI0Fss | SSI0Rx | SSI0Tx); //enable 2-5 for alternative
-
-	//Set mux position in GPIOPCTL to select the SSI use of the pins
-	//Mask 2,3,4,5 and send 2 to the position
-	HWREG(GPIO_PORTA_BASE + GPIO_O_PCTL) =
-		(HWREG(GPIO_PORTA_BASE + GPIO_O_PCTL) & 0xff0000ff) + (2 << (5 * BitsPerNibble)) +
-		(2 << (4 * BitsPerNibble)) + (2 << (3 * BitsPerNibble)) + (2 << (2 * BitsPerNibble));
-
-  	// Program the port lines for digital I/O (PA2, PA3, PA4, PA5)
-	HWREG(GPIO_PORTA_BASE + GPIO_O_DEN) |= (SSI0Clk | SSI0Fss | SSI0Rx | SSI0Tx);
-
-	// Program the required data directions on the port lines
-	// Tx(3), Fs(1) & Clk(0) are all outputs
-	// Rx(2) is an input
-	HWREG(GPIO_PORTD_BASE + GPIO_O_DIR) |= (SSI0Clk | SSI0Fss | SSI0Tx);
-	HWREG(GPIO_PORTD_BASE + GPIO_O_DIR) &= ~(SSI0Rx);
-  	
-	// If using SPI mode 3, program the pull-up on the clock line (PA2)
-	HWREG(GPIO_PORTD_BASE + GPIO_O_PUR) |= SSI0Clk;
-
-  	// Wait for SSI0 to be ready
-	while((HWREG(SYSCTL_PRSSI) & SYSCTL_PRSSI_R0) != SYSCTL_PRSSI_R0)
-	{
-	}
-	// Make sure that the SSI is disabled before programming mode bits
-	HWREG(SSI0_BASE + SSI_O_CR1) &= ~SSI_CR1_SSE;
-
-  // Select master mode (MS) & TXRIS indicating End of Transmit (EOT)
-	HWREG(SSI0_BASE + SSI_O_CR1) &= ~SSI_CR1_MS;
-	HWREG(SSI0_BASE + SSI_O_CR1) |= SSI_CR1_EOT;
-
-  //set the system clock as the clock source
-  HWREG(SSI0_BASE + SSI_O_CC) &= ~SSI_CC_CS_M;
-
-  	// Configure the clock prescaler
-	HWREG(SSI0_BASE + SSI_O_CPSR) &= 0xffffff00; //~SSI_CPSR_CPSDVSR_M;
-	HWREG(SSI0_BASE + SSI_O_CPSR) |= CPSDVSR;
-
-	// Configure clock rate, clock phase & clock polarity
-
-  HWREG(SSI0_BASE + SSI_O_CR0) &= 0xffff00ff; //~(SSI_CR0_SCR_M);
-  HWREG(SSI0_BASE + SSI_O_CR0) |= SCR;
-
-  //Set SPH and SP0 to 1 for mode 3
-	HWREG(SSI0_BASE + SSI_O_CR0) |= (SSI_CR0_SPH | SSI_CR0_SPO);
-
-  //set the communications type to freescale SPI
-  HWREG(SSI0_BASE + SSI_O_CR0) &= ~SSI_CR0_FRF_M;
-
-  //set the data size to 8
-  HWREG(SSI0_BASE + SSI_O_CR0) &= ~SSI_CR0_DSS_M;
-  HWREG(SSI0_BASE + SSI_O_CR0) |= SSI_CR0_DSS_8;
-
-	// Locally enable interrupts
-	HWREG(SSI0_BASE + SSI_O_IM) |= (SSI_IM_TXIM | SSI_IM_RXIM);
-
-  // Make sure that the SSI is enabled for operation
-  HWREG(SSI0_BASE + SSI_O_CR1) |= SSI_CR1_SSE;
-
-	// Enable NVIC interrupt for SSI when starting transmission
-	// NVIC_EN0 handles IRQs 0-31
-	// SSI0 = IRQ 7 --> EN_0 |= BIT7HI
-	HWREG(NVIC_EN0) |= BIT7HI;
-
-	// Enable interrupts globally
-	__enable_irq();
-
-	printf("SSI Initialization Complete \n\r");
+  TxFrame[0] = TransmitMessage;
+  TxFrame[1] = ZERO_BYTE;
+  TxFrame[2] = ZERO_BYTE;
+  //the bus queue is full, try again at the next query time
+  if (!SSI_Transfer(&Compass, TxFrame, FRAME_LENGTH, ResponseDone))
+  {
+    ES_Timer_InitTimer(SPI_TIMER, Param.SPIQueryMS);
+  }
 }
 
- 
- /***************************************************************************
- private functions
- ***************************************************************************/
-
 /****************************************************************************
  Function
-     WriteToSPI
+     ResponseDone
 
  Parameters
-     message to send
+     const void *Rx : the frame clocked in, uint8_t items
+     uint8_t Length : FRAME_LENGTH
 
  Returns
      nothing
 
  Description
-     
+     SSI done function, posts the answer as RESPONSE_RECEIVED
  Notes
+     Runs in the SSI0 interrupt
+ Author
+     Sander Tonkens
+****************************************************************************/
+static void ResponseDone(const void *Rx, uint8_t Length)
+{
+  const uint8_t *Frame = Rx;
+  ES_Event_t ThisEvent;
+  ThisEvent.EventType = RESPONSE_RECEIVED;
+  ThisEvent.EventParam = FRAME_PARAM(Frame);
+  PostSPISM(ThisEvent);
+}
+
+/****************************************************************************
+ Function
+     StatusInterval
 
+ Parameters
+     uint16_t Now : ES_Timer_GetTime
+
+ Returns
+     ms between status queries, 0 for every frame
+
+ Description
+     Every frame while a change is likely, else StatusSlowMS. Also keeps
+     the time since the last change.
  Author
-     Sander TOnkens, 02/15/2019, 16:02
+     Sander Tonkens
 ****************************************************************************/
-static void WriteToSPI(uint8_t TransmitMessage)
+static uint16_t StatusInterval(uint16_t Now)
 {
-	//printf("%d", TransmitMessage);
-  //Write data to data register
-  HWREG(SSI0_BASE + SSI_O_DR) = TransmitMessage;
-	HWREG(SSI0_BASE + SSI_O_DR) = ZERO_BYTE;
-	HWREG(SSI0_BASE + SSI_O_DR) = ZERO_BYTE;
-  //Enable interrupt
-  HWREG(SSI0_BASE + SSI_O_IM) |= SSI_IM_TXIM;
+  //called at least every StatusSlowMS, long before the ms count wraps
+  SinceChangeMS += (uint16_t)(Now - LastTickMS);
+  LastTickMS = Now;
+
+  if (Confirming || (CurrentGameState == WAITING_FOR_START) ||
+      (SinceChangeMS < Param.StatusHotMS) ||
+      ((ChangePeriodMS > 0) &&
+       (SinceChangeMS + Param.StatusHotMS >= ChangePeriodMS) &&
+       (SinceChangeMS <= ChangePeriodMS + Param.StatusHotMS)))
+  {
+    return 0;
+  }
+  return Param.StatusSlowMS;
+}
+
+/****************************************************************************
+ Function
+     ScheduleNext
+
+ Parameters
+     uint16_t Now : ES_Timer_GetTime
+
+ Returns
+     nothing
+
+ Description
+     Sets SPI_TIMER for the next frame, the gap or until status or value
+     falls due, whichever is later
+ Author
+     Sander Tonkens
+****************************************************************************/
+static void ScheduleNext(uint16_t Now)
+{
+  uint16_t StatusAge = Now - LastStatusMS;
+  uint16_t ValueAge = Now - LastValueMS;
+  uint16_t Interval = StatusInterval(Now);
+  uint16_t Wait = 0;
+
+  if ((StatusAge < Interval) && (ValueAge < SPI_REFRESHTIME))
+  {
+    Wait = Interval - StatusAge;
+    if (SPI_REFRESHTIME - ValueAge < Wait)
+    {
+      Wait = SPI_REFRESHTIME - ValueAge;
+    }
+  }
+  if (Wait < Param.SPIQueryMS)
+  {
+    Wait = Param.SPIQueryMS;
+  }
+  //one more, the first tick can come at once
+  ES_Timer_InitTimer(SPI_TIMER, Wait + 1);
 }
@@ -0,0 +1,636 @@
+/****************************************************************************
+ Module
+   SSIBus.c
+
+ Revision
+   1.1.0
+
+ Description
+   Queued frame transfers on SSI0 and SSI1, shared by any number of devices,
+   with one interrupt per frame
+
+ Notes
+   Each device is an SSIDevice_t: the bus, SPI mode, clock divisor and
+   rate, bits per item and its chip select. The SSIDevice_t is what the
+   bus knows the device by, so it has to stay put (a static const in the
+   module that owns the device). SSI_InitDevice sets up the bus the first
+   time one of its devices comes along, and the select pin.
+
+   SSI_Transfer copies the frame into the queue of the bus, SSI_QUEUE_SIZE
+   frames deep, and returns; it only refuses when the queue is full. The
+   frame at the head of the queue is on the wire: it is written whole into
+   the transmit FIFO (it holds SSI_MAX_FRAME items, so no transmit
+   interrupt or DMA is needed) and the uDMA channel of the receive side is
+   armed to move as many items out of the receive FIFO. The SSI raises no
+   interrupts of its own; when the channel has moved the last item the
+   uDMA done signal comes in on the vector of the SSI, the ISR releases
+   the select, starts the next frame in the queue and then hands the one
+   just done to the SSIDoneFunc_t of its transfer. Before a frame for a
+   different device than the last one the SSI is switched off and
+   reprogrammed with the mode, divisor, rate and data size of the device.
+
+   Chip select: a device with CSPort SSI_CS_FSS uses the FSS pin of the
+   bus, which the SSI drives low around each frame (or pulses per item
+   with SPH clear, which is what the 'HC595 on the byte debug port wants).
+   Only one device on a bus can do that. Others get a GPIO pin of their
+   own, driven low here while the frame is on the wire.
+
+     SSI0 : PA2 Clk, PA3 Fss, PA4 Rx, PA5 Tx, uDMA channel 10 encoding 0
+     SSI1 : PF2 Clk, PF3 Fss, PF1 Tx, uDMA channel 24 encoding 0. PF0 (Rx)
+            is the IR emitter, so SSI1 devices are write only and the items
+            clocked in are meaningless, the done interrupt still comes.
+
+   Received frames land in two buffers per bus used in turn, so a frame
+   handed to a done function stays put while the next one comes in.
+
+   Throughput: every completed frame adds its items and the time they
+   took on the wire (DataBits * Divisor * (1 + Rate) clocks an item) to the
+   stats of its bus, SSI_QueryStats has them with the time since the last
+   SSI_ResetStats, BusUS / (ElapsedMS * 1000) is the bus utilization.
+
+   CPU cost is measured against SysTick: the clocks spent in SSI_Transfer
+   plus those in the ISR (done function included, not the 12 clock
+   interrupt entry).
+
+   The uDMA control table is the one for the whole chip (CTLBASE). It
+   lives here as this is the only user of the uDMA so far.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 23:59 ST       first pass
+ 10/19/26 23:59 ST       queue per bus, devices with their own settings, SSI1
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_sysctl.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_udma.h"
+#include "inc/hw_nvic.h"
+
+#include "SSIBus.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define CLOCKS_PER_US 40
+
+// each control table entry is source end, destination end, control, spare
+#define ENTRY_WORDS 4
+#define SRC_END 0
+#define DST_END 1
+#define CONTROL 2
+
+// reads of the data register into consecutive items, one per request
+#define RX_CONTROL_8 (UDMA_CHCTL_DSTINC_8 | UDMA_CHCTL_DSTSIZE_8 | \
+    UDMA_CHCTL_SRCINC_NONE | UDMA_CHCTL_SRCSIZE_8 | UDMA_CHCTL_ARBSIZE_1 | \
+    UDMA_CHCTL_XFERMODE_BASIC)
+#define RX_CONTROL_16 (UDMA_CHCTL_DSTINC_16 | UDMA_CHCTL_DSTSIZE_16 | \
+    UDMA_CHCTL_SRCINC_NONE | UDMA_CHCTL_SRCSIZE_16 | UDMA_CHCTL_ARBSIZE_1 | \
+    UDMA_CHCTL_XFERMODE_BASIC)
+
+// GPIO data register address that writes only the pins in Mask
+#define GPIO_MASKED(Port, Mask) ((Port) + GPIO_O_DATA + ((uint32_t)(Mask) << 2))
+
+// the uDMA control table has to start on a 1 KB boundary
+#if defined(__CC_ARM)
+#define ALIGN_1024 __align(1024)
+#else
+#define ALIGN_1024 __attribute__((aligned(1024)))
+#endif
+
+/*------------------------------ Module Types -----------------------------*/
+// what is fixed about each bus
+typedef struct
+{
+  uint32_t Base;          /* SSI */
+  uint32_t SSIEnable;     /* RCGCSSI and PRSSI bit */
+  uint32_t Port;          /* GPIO port of the pins */
+  uint32_t PortEnable;    /* RCGCGPIO and PRGPIO bit */
+  uint8_t Pins;           /* pins with the SSI function */
+  uint8_t ClkPin;
+  uint32_t PctlMask;      /* PCTL fields of the pins */
+  uint32_t PctlValue;     /* and the SSI function in them */
+  uint8_t Channel;        /* uDMA channel of the receive FIFO */
+  uint32_t ChMap;         /* uDMA channel map register of the channel */
+  uint32_t ChMapMask;     /* its field, encoding 0 is the SSI */
+  uint32_t NvicEnable;    /* NVIC ENn register of the SSI */
+  uint32_t NvicBit;
+}BusHW_t;
+
+// one queued frame
+typedef struct
+{
+  const SSIDevice_t *Device;
+  uint16_t Tx[SSI_MAX_FRAME];
+  uint8_t Length;
+  SSIDoneFunc_t *Done;
+  uint32_t Clocks;        /* spent in SSI_Transfer */
+}Frame_t;
+
+typedef struct
+{
+  Frame_t Queue[SSI_QUEUE_SIZE];
+  uint8_t Head;           /* on the wire while Count is not 0 */
+  uint8_t Count;
+  const SSIDevice_t *Current;   /* the SSI is set up for */
+  uint16_t RxFrame[2][SSI_MAX_FRAME];
+  uint8_t RxHalf;
+  bool Ready;
+  uint32_t BusClocks;     /* below one us, not in Stats.BusUS yet */
+  uint16_t LastTime;
+  SSIStats_t Stats;
+}Bus_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void InitDMA(void);
+static void InitBus(uint8_t Bus);
+static void StartFrame(uint8_t Bus);
+static void Configure(uint32_t Base, const SSIDevice_t *Device);
+static void FrameDone(uint8_t Bus);
+static uint32_t PortEnableBit(uint32_t Port);
+static void UpdateElapsed(Bus_t *ThisBus);
+static uint32_t ClocksSince(uint32_t Start);
+
+/*---------------------------- Module Variables ---------------------------*/
+static const BusHW_t BusHW[SSI_NUM_BUSES] = {
+  // SSI0, function 2 on PA2-5, interrupt 7
+  { SSI0_BASE, SYSCTL_RCGCSSI_R0, GPIO_PORTA_BASE, SYSCTL_RCGCGPIO_R0,
+    BIT2HI | BIT3HI | BIT4HI | BIT5HI, BIT2HI, 0x00ffff00, 0x00222200,
+    10, UDMA_CHMAP1, UDMA_CHMAP1_CH10SEL_M, NVIC_EN0, BIT7HI },
+  // SSI1, function 2 on PF1-3, interrupt 34
+  { SSI1_BASE, SYSCTL_RCGCSSI_R1, GPIO_PORTF_BASE, SYSCTL_RCGCGPIO_R5,
+    BIT1HI | BIT2HI | BIT3HI, BIT2HI, 0x0000fff0, 0x00002220,
+    24, UDMA_CHMAP3, UDMA_CHMAP3_CH24SEL_M, NVIC_EN1, BIT2HI }
+};
+
+// primary then alternate entries for all 32 channels
+ALIGN_1024 static uint32_t ControlTable[2 * 32 * ENTRY_WORDS];
+static bool DMAReady;
+
+static Bus_t Buses[SSI_NUM_BUSES];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   SSI_InitDevice
+
+ Parameters
+   const SSIDevice_t * : the device, kept by the caller for good
+
+ Returns
+   void
+
+ Description
+   Sets up the bus of the device as master if this is its first device,
+   and the chip select pin of the device, high
+ Notes
+   The settings of the device go into the SSI before its first frame
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SSI_InitDevice(const SSIDevice_t *Device)
+{
+  const BusHW_t *HW;
+  uint32_t Enable;
+
+  if (Device->Bus >= SSI_NUM_BUSES)
+  {
+    return;
+  }
+  HW = &BusHW[Device->Bus];
+  if (!DMAReady)
+  {
+    InitDMA();
+  }
+  if (!Buses[Device->Bus].Ready)
+  {
+    InitBus(Device->Bus);
+  }
+
+  // a clock that idles high is pulled up for while the SSI is off
+  if (Device->Mode & SSI_MODE_SPO)
+  {
+    HWREG(HW->Port + GPIO_O_PUR) |= HW->ClkPin;
+  }
+
+  if (Device->CSPort != SSI_CS_FSS)
+  {
+    Enable = PortEnableBit(Device->CSPort);
+    HWREG(SYSCTL_RCGCGPIO) |= Enable;
+    while ((HWREG(SYSCTL_PRGPIO) & Enable) != Enable)
+    {}
+    HWREG(GPIO_MASKED(Device->CSPort, Device->CSPin)) = Device->CSPin;
+    HWREG(Device->CSPort + GPIO_O_DEN) |= Device->CSPin;
+    HWREG(Device->CSPort + GPIO_O_DIR) |= Device->CSPin;
+  }
+}
+
+/****************************************************************************
+ Function
+   SSI_Transfer
+
+ Parameters
+   const SSIDevice_t *Device : set up by SSI_InitDevice
+   const void *Tx : the frame to send, uint8_t items for devices of up to 8
+                    data bits, uint16_t above that, copied here
+   uint8_t Length : items in the frame, 1 to SSI_MAX_FRAME
+   SSIDoneFunc_t *Done : gets the items clocked in, may be NULL
+
+ Returns
+   bool : false if the queue of the bus is full, Length is bad or the
+          device was never set up
+
+ Description
+   Queues a frame and starts it if the bus is free, Done is called from
+   the interrupt at its end
+ Notes
+   Safe to call from a done function or inside a critical section, the
+   PRIMASK is kept in a local rather than in _PRIMASK_temp
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool SSI_Transfer(const SSIDevice_t *Device, const void *Tx, uint8_t Length,
+                  SSIDoneFunc_t *Done)
+{
+  uint32_t Start = HWREG(NVIC_ST_CURRENT);
+  uint32_t Mask;
+  Bus_t *ThisBus;
+  Frame_t *Frame;
+  uint8_t i;
+
+  if ((Device->Bus >= SSI_NUM_BUSES) || !Buses[Device->Bus].Ready)
+  {
+    return false;
+  }
+  ThisBus = &Buses[Device->Bus];
+
+  Mask = CPUgetPRIMASK_cpsid();
+  UpdateElapsed(ThisBus);
+  if ((ThisBus->Count == SSI_QUEUE_SIZE) || (Length == 0) ||
+      (Length > SSI_MAX_FRAME))
+  {
+    ThisBus->Stats.Refused++;
+    CPUsetPRIMASK(Mask);
+    return false;
+  }
+
+  Frame = &ThisBus->Queue[(ThisBus->Head + ThisBus->Count) % SSI_QUEUE_SIZE];
+  Frame->Device = Device;
+  Frame->Length = Length;
+  Frame->Done = Done;
+  for (i = 0; i < Length; i++)
+  {
+    Frame->Tx[i] = (Device->DataBits > 8) ? ((const uint16_t *)Tx)[i] :
+        ((const uint8_t *)Tx)[i];
+  }
+
+  ThisBus->Count++;
+  if (ThisBus->Count > ThisBus->Stats.MaxWaiting)
+  {
+    ThisBus->Stats.MaxWaiting = ThisBus->Count;
+  }
+  if (ThisBus->Count == 1)
+  {
+    StartFrame(Device->Bus);
+  }
+  Frame->Clocks = ClocksSince(Start);
+  CPUsetPRIMASK(Mask);
+  return true;
+}
+
+/****************************************************************************
+ Function
+   SSI_QueryWaiting
+
+ Parameters
+   uint8_t Bus
+
+ Returns
+   uint8_t : frames queued on the bus, the one on the wire included
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t SSI_QueryWaiting(uint8_t Bus)
+{
+  return (Bus < SSI_NUM_BUSES) ? Buses[Bus].Count : 0;
+}
+
+/****************************************************************************
+ Function
+   SSI_0ISR / SSI_1ISR
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   SSI vectors, the uDMA has the whole received frame
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SSI_0ISR(void)
+{
+  FrameDone(SSI_BUS0);
+}
+
+void SSI_1ISR(void)
+{
+  FrameDone(SSI_BUS1);
+}
+
+/****************************************************************************
+ Function
+   SSI_QueryStats
+
+ Parameters
+   uint8_t Bus
+   SSIStats_t * : filled in with the counts since SSI_ResetStats
+
+ Returns
+   void
+
+ Description
+   Bus utilization is BusUS / (ElapsedMS * 1000), throughput is Items
+   over ElapsedMS
+ Notes
+   The elapsed time comes from the 16 bit framework time, kept up to date
+   by every SSI_Transfer, so a bus left idle for over a minute loses
+   multiples of 65.5 s from it
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SSI_QueryStats(uint8_t Bus, SSIStats_t *Stats2Fill)
+{
+  if (Bus >= SSI_NUM_BUSES)
+  {
+    return;
+  }
+  EnterCritical();
+  UpdateElapsed(&Buses[Bus]);
+  *Stats2Fill = Buses[Bus].Stats;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   SSI_ResetStats
+
+ Parameters
+   uint8_t Bus
+
+ Returns
+   void
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SSI_ResetStats(uint8_t Bus)
+{
+  Bus_t *ThisBus;
+
+  if (Bus >= SSI_NUM_BUSES)
+  {
+    return;
+  }
+  ThisBus = &Buses[Bus];
+  EnterCritical();
+  ThisBus->Stats.Transfers = 0;
+  ThisBus->Stats.Refused = 0;
+  ThisBus->Stats.Items = 0;
+  ThisBus->Stats.BusUS = 0;
+  ThisBus->Stats.ElapsedMS = 0;
+  ThisBus->Stats.MaxClocks = 0;
+  ThisBus->Stats.MaxWaiting = ThisBus->Count;
+  ThisBus->BusClocks = 0;
+  ThisBus->LastTime = ES_Timer_GetTime();
+  ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// uDMA on with the control table, once for both buses
+static void InitDMA(void)
+{
+  HWREG(SYSCTL_RCGCDMA) |= SYSCTL_RCGCDMA_R0;
+  while ((HWREG(SYSCTL_PRDMA) & SYSCTL_PRDMA_R0) != SYSCTL_PRDMA_R0)
+  {}
+  HWREG(UDMA_CFG) = UDMA_CFG_MASTEN;
+  HWREG(UDMA_CTLBASE) = (uint32_t)ControlTable;
+  DMAReady = true;
+}
+
+// pins, SSI as master and the receive channel of a bus. The SSI itself is
+// programmed for a device by Configure before the first frame.
+static void InitBus(uint8_t Bus)
+{
+  const BusHW_t *HW = &BusHW[Bus];
+  uint32_t ChannelBit = (uint32_t)1 << HW->Channel;
+
+  // Enable the clocks to the port and the SSI and wait for them
+  HWREG(SYSCTL_RCGCGPIO) |= HW->PortEnable;
+  HWREG(SYSCTL_RCGCSSI) |= HW->SSIEnable;
+  while ((HWREG(SYSCTL_PRGPIO) & HW->PortEnable) != HW->PortEnable)
+  {}
+  while ((HWREG(SYSCTL_PRSSI) & HW->SSIEnable) != HW->SSIEnable)
+  {}
+
+  HWREG(HW->Port + GPIO_O_AFSEL) |= HW->Pins;
+  HWREG(HW->Port + GPIO_O_PCTL) =
+    (HWREG(HW->Port + GPIO_O_PCTL) & ~HW->PctlMask) | HW->PctlValue;
+  HWREG(HW->Port + GPIO_O_DEN) |= HW->Pins;
+
+  // master, system clock, no SSI interrupts, the uDMA done for the receive
+  // side is the only one
+  HWREG(HW->Base + SSI_O_CR1) &= ~SSI_CR1_SSE;
+  HWREG(HW->Base + SSI_O_CR1) &= ~SSI_CR1_MS;
+  HWREG(HW->Base + SSI_O_CC) &= ~SSI_CC_CS_M;
+  HWREG(HW->Base + SSI_O_IM) = 0;
+  HWREG(HW->Base + SSI_O_DMACTL) = SSI_DMACTL_RXDMAE;
+
+  // the channel to the SSI receive FIFO taking single requests (a frame can
+  // be shorter than the FIFO burst level), primary entry, normal priority
+  HWREG(HW->ChMap) &= ~HW->ChMapMask;
+  HWREG(UDMA_USEBURSTCLR) = ChannelBit;
+  HWREG(UDMA_ALTCLR) = ChannelBit;
+  HWREG(UDMA_PRIOCLR) = ChannelBit;
+  HWREG(UDMA_REQMASKCLR) = ChannelBit;
+  ControlTable[HW->Channel * ENTRY_WORDS + SRC_END] = HW->Base + SSI_O_DR;
+
+  Buses[Bus].LastTime = ES_Timer_GetTime();
+  Buses[Bus].Ready = true;
+
+  HWREG(HW->NvicEnable) |= HW->NvicBit;
+}
+
+// puts the frame at the head of the queue on the wire, interrupts are off
+static void StartFrame(uint8_t Bus)
+{
+  const BusHW_t *HW = &BusHW[Bus];
+  Bus_t *ThisBus = &Buses[Bus];
+  const Frame_t *Frame = &ThisBus->Queue[ThisBus->Head];
+  const SSIDevice_t *Device = Frame->Device;
+  uint32_t *Entry = &ControlTable[HW->Channel * ENTRY_WORDS];
+  uint8_t *Rx = (uint8_t *)ThisBus->RxFrame[ThisBus->RxHalf];
+  uint8_t i;
+
+  if (Device != ThisBus->Current)
+  {
+    Configure(HW->Base, Device);
+    ThisBus->Current = Device;
+  }
+
+  // nothing left over from before may take the place of this frame
+  while (HWREG(HW->Base + SSI_O_SR) & SSI_SR_RNE)
+  {
+    HWREG(HW->Base + SSI_O_DR);
+  }
+
+  if (Device->DataBits > 8)
+  {
+    Entry[DST_END] = (uint32_t)&Rx[2 * (Frame->Length - 1)];
+    Entry[CONTROL] = RX_CONTROL_16 |
+        ((uint32_t)(Frame->Length - 1) << UDMA_CHCTL_XFERSIZE_S);
+  }
+  else
+  {
+    Entry[DST_END] = (uint32_t)&Rx[Frame->Length - 1];
+    Entry[CONTROL] = RX_CONTROL_8 |
+        ((uint32_t)(Frame->Length - 1) << UDMA_CHCTL_XFERSIZE_S);
+  }
+  HWREG(UDMA_ENASET) = (uint32_t)1 << HW->Channel;
+
+  if (Device->CSPort != SSI_CS_FSS)
+  {
+    HWREG(GPIO_MASKED(Device->CSPort, Device->CSPin)) = 0;
+  }
+  for (i = 0; i < Frame->Length; i++)
+  {
+    HWREG(HW->Base + SSI_O_DR) = Frame->Tx[i];
+  }
+}
+
+// freescale SPI with the mode, clock and data size of the device
+static void Configure(uint32_t Base, const SSIDevice_t *Device)
+{
+  uint32_t Control = ((uint32_t)Device->Rate << SSI_CR0_SCR_S) |
+      SSI_CR0_FRF_MOTO | (uint32_t)(Device->DataBits - 1);
+
+  if (Device->Mode & SSI_MODE_SPH)
+  {
+    Control |= SSI_CR0_SPH;
+  }
+  if (Device->Mode & SSI_MODE_SPO)
+  {
+    Control |= SSI_CR0_SPO;
+  }
+  // the SSI has to be off while its mode bits change
+  HWREG(Base + SSI_O_CR1) &= ~SSI_CR1_SSE;
+  HWREG(Base + SSI_O_CPSR) = Device->Divisor;
+  HWREG(Base + SSI_O_CR0) = Control;
+  HWREG(Base + SSI_O_CR1) |= SSI_CR1_SSE;
+}
+
+// the interrupt of a bus: release the select, keep the bus going with the
+// next frame, then hand over the one done
+static void FrameDone(uint8_t Bus)
+{
+  uint32_t Start = HWREG(NVIC_ST_CURRENT);
+  uint32_t ChannelBit = (uint32_t)1 << BusHW[Bus].Channel;
+  Bus_t *ThisBus = &Buses[Bus];
+  const Frame_t *Frame;
+  const SSIDevice_t *Device;
+  const uint16_t *Rx;
+  SSIDoneFunc_t *Done;
+  uint8_t Length;
+  uint32_t Clocks;
+
+  // clear the source of the interrupt, the uDMA done for the channel
+  if (!(HWREG(UDMA_CHIS) & ChannelBit) || (ThisBus->Count == 0))
+  {
+    return;
+  }
+  HWREG(UDMA_CHIS) = ChannelBit;
+
+  Frame = &ThisBus->Queue[ThisBus->Head];
+  Device = Frame->Device;
+  if (Device->CSPort != SSI_CS_FSS)
+  {
+    HWREG(GPIO_MASKED(Device->CSPort, Device->CSPin)) = Device->CSPin;
+  }
+  Done = Frame->Done;
+  Length = Frame->Length;
+  Clocks = Frame->Clocks;
+  Rx = ThisBus->RxFrame[ThisBus->RxHalf];
+
+  ThisBus->Stats.Transfers++;
+  ThisBus->Stats.Items += Length;
+  ThisBus->BusClocks += (uint32_t)Length * Device->DataBits *
+      Device->Divisor * (1 + Device->Rate);
+  ThisBus->Stats.BusUS += ThisBus->BusClocks / CLOCKS_PER_US;
+  ThisBus->BusClocks %= CLOCKS_PER_US;
+
+  ThisBus->Head = (ThisBus->Head + 1) % SSI_QUEUE_SIZE;
+  ThisBus->Count--;
+  ThisBus->RxHalf ^= 1;
+  if (ThisBus->Count != 0)
+  {
+    StartFrame(Bus);
+  }
+
+  if (Done != NULL)
+  {
+    Done(Rx, Length);
+  }
+
+  ThisBus->Stats.Clocks = Clocks + ClocksSince(Start);
+  if (ThisBus->Stats.Clocks > ThisBus->Stats.MaxClocks)
+  {
+    ThisBus->Stats.MaxClocks = ThisBus->Stats.Clocks;
+  }
+}
+
+// RCGCGPIO bit of a port, A to D are 4 KB apart from 0x40004000, E and F
+// follow on from 0x40024000
+static uint32_t PortEnableBit(uint32_t Port)
+{
+  if (Port >= GPIO_PORTE_BASE)
+  {
+    return SYSCTL_RCGCGPIO_R4 << ((Port - GPIO_PORTE_BASE) >> 12);
+  }
+  return SYSCTL_RCGCGPIO_R0 << ((Port - GPIO_PORTA_BASE) >> 12);
+}
+
+// Adds the framework time since the last call to the elapsed time
+static void UpdateElapsed(Bus_t *ThisBus)
+{
+  uint16_t Now = ES_Timer_GetTime();
+
+  ThisBus->Stats.ElapsedMS += (uint16_t)(Now - ThisBus->LastTime);
+  ThisBus->LastTime = Now;
+}
+
+// SysTick counts down from its reload value, once per CPU clock
+static uint32_t ClocksSince(uint32_t Start)
+{
+  uint32_t Now = HWREG(NVIC_ST_CURRENT);
+
+  if (Now > Start)
+  {
+    return Start + HWREG(NVIC_ST_RELOAD) + 1 - Now;
+  }
+  return Start - Now;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,343 @@
+/****************************************************************************
+ Module
+   StallDetect.c
+
+ Revision
+   1.0.1
+
+ Description
+   Detects a drive wheel that is stalled (blocked while being driven hard)
+   or slipping (the two wheels disagreeing beyond what was commanded)
+
+ Notes
+   SD_Update is called from the control ISR every velocity loop period. It
+   accumulates |duty| and the commanded ticks for each wheel into slots of
+   SLOT_US, and reads the measured ticks from the encoder odometers at each
+   slot boundary. The last WINDOW_SLOTS slots form a sliding window that is
+   checked once per slot, so the per-tick cost is a few adds.
+
+   Stall: mean |duty| over the window above STALL_DUTY, no more than
+   STALL_MAX_TICKS of movement and the measured RPM down at zero.
+
+   Slip: the difference between the wheels' travel over the window is off
+   the commanded difference by more than SLIP_TICKS. It is reported on the
+   wheel that is furthest from its own command. A wheel spinning freely at
+   its commanded speed looks the same as one driving, the encoders alone
+   can't tell them apart.
+
+   Faults latch until SD_Reset (called on every new drive command, not on
+  a control rate change), and
+   while a stall is latched SD_QueryDutyLimit returns the safe duty so the
+   speed loop stops pushing into the wall.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 19:30 ST       first pass
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <math.h>
+#include <stdlib.h>
+
+#include "EncoderCapture.h"
+#include "StallDetect.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// 150 encoder ticks per wheel rev
+#define TICKS_PER_REV 150
+
+#define SLOT_US 20000
+#define WINDOW_SLOTS 10 // 200 ms window
+
+#define STALL_DUTY 80      // percent
+#define STALL_MAX_TICKS 2  // over the window
+#define STALL_RPM 5
+#define SLIP_TICKS 15      // about an inch over the window
+
+#define DEFAULT_SAFE_DUTY 30
+#define FULL_DUTY 100
+
+#define NUM_WHEELS 2
+
+/*---------------------------- Module Functions ---------------------------*/
+/* prototypes for private functions for this service.They should be functions
+   relevant to the behavior of this service
+*/
+static void ClearWindow(void);
+static uint8_t CheckWindow(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint16_t UpdatesPerSlot = SLOT_US / 500;
+static float CommandTicksPerRPM = TICKS_PER_REV / 60.0f * 500 / 1000000;
+
+// Slot being filled
+static uint16_t UpdateCount;
+static float DutySum[NUM_WHEELS];
+static float CommandSum[NUM_WHEELS];
+static int32_t SlotStartOdometer[NUM_WHEELS];
+static float LastRPM[NUM_WHEELS];
+
+// Finished slots, a ring of the last WINDOW_SLOTS
+static float WindowDuty[NUM_WHEELS][WINDOW_SLOTS];
+static float WindowCommand[NUM_WHEELS][WINDOW_SLOTS];
+static int32_t WindowMeasured[NUM_WHEELS][WINDOW_SLOTS];
+static uint8_t Slot;
+static uint8_t SlotsFilled;
+
+static uint8_t Faults;
+static bool LimitEnabled = true;
+static float SafeDuty = DEFAULT_SAFE_DUTY;
+
+/*------------------------------ Module Code ------------------------------*/
+
+/****************************************************************************
+ Function
+   SD_Init
+
+ Parameters
+   uint16_t : period SD_Update is called at, in us
+
+ Returns
+   void
+
+ Description
+   Sizes the slots for the control rate and clears the window
+ Notes
+   Call with the control timer stopped. Latched faults are kept, so a
+   stalled wheel stays held to the safe duty across a rate change
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SD_Init(uint16_t UpdatePeriodUS)
+{
+  UpdatesPerSlot = SLOT_US / UpdatePeriodUS;
+  if (UpdatesPerSlot == 0)
+  {
+    UpdatesPerSlot = 1;
+  }
+  CommandTicksPerRPM = TICKS_PER_REV / 60.0f * UpdatePeriodUS / 1000000;
+  ClearWindow();
+}
+
+/****************************************************************************
+ Function
+   SD_Reset
+
+ Parameters
+   void
+
+ Returns
+   void
+
+ Description
+   Clears the window and any latched faults, for the start of a new move
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SD_Reset(void)
+{
+  ClearWindow();
+  Faults = 0;
+}
+
+/****************************************************************************
+ Function
+   SD_Update
+
+ Parameters
+   float Duty_1, Duty_2 : duty just applied, percent
+   float RPM_1, RPM_2 : measured wheel speeds
+   float CommandRPM_1, CommandRPM_2 : speed setpoints
+
+ Returns
+   uint8_t : SD_STALL_x / SD_SLIP_x bits for faults detected this call
+
+ Description
+   One control period of data, the window is checked at the end of each
+   slot
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t SD_Update(float Duty_1, float Duty_2, float RPM_1, float RPM_2,
+                  float CommandRPM_1, float CommandRPM_2)
+{
+  int32_t Odometer;
+  uint8_t i;
+
+  DutySum[0] += fabsf(Duty_1);
+  DutySum[1] += fabsf(Duty_2);
+  CommandSum[0] += CommandRPM_1 * CommandTicksPerRPM;
+  CommandSum[1] += CommandRPM_2 * CommandTicksPerRPM;
+  LastRPM[0] = RPM_1;
+  LastRPM[1] = RPM_2;
+
+  if (++UpdateCount < UpdatesPerSlot)
+  {
+    return 0;
+  }
+
+  //close the slot
+  UpdateCount = 0;
+  for (i = 0; i < NUM_WHEELS; i++)
+  {
+    Odometer = QueryEncoderOdometer(WHEEL_1 + i);
+    WindowDuty[i][Slot] = DutySum[i];
+    WindowCommand[i][Slot] = CommandSum[i];
+    WindowMeasured[i][Slot] = Odometer - SlotStartOdometer[i];
+    SlotStartOdometer[i] = Odometer;
+    DutySum[i] = 0;
+    CommandSum[i] = 0;
+  }
+  if (++Slot >= WINDOW_SLOTS)
+  {
+    Slot = 0;
+  }
+  if (SlotsFilled < WINDOW_SLOTS)
+  {
+    SlotsFilled++;
+    return 0;
+  }
+  return CheckWindow();
+}
+
+/****************************************************************************
+ Function
+   SD_SetDutyLimit
+
+ Parameters
+   bool : cut the duty of a stalled wheel
+   float : duty to cut to, percent
+
+ Returns
+   void
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+void SD_SetDutyLimit(bool Enable, float NewSafeDuty)
+{
+  LimitEnabled = Enable;
+  SafeDuty = NewSafeDuty;
+}
+
+/****************************************************************************
+ Function
+   SD_QueryDutyLimit
+
+ Parameters
+   uint8_t : WHEEL_1 or WHEEL_2
+
+ Returns
+   float : largest duty the speed loop should apply to that wheel
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+float SD_QueryDutyLimit(uint8_t Wheel)
+{
+  if (LimitEnabled && (Wheel == WHEEL_1) && (Faults & SD_STALL_1))
+  {
+    return SafeDuty;
+  }
+  if (LimitEnabled && (Wheel == WHEEL_2) && (Faults & SD_STALL_2))
+  {
+    return SafeDuty;
+  }
+  return FULL_DUTY;
+}
+
+/****************************************************************************
+ Function
+   SD_QueryFaults
+
+ Parameters
+   void
+
+ Returns
+   uint8_t : SD_STALL_x / SD_SLIP_x bits latched since the last SD_Reset
+
+ Author
+   Sander Tonkens
+****************************************************************************/
+uint8_t SD_QueryFaults(void)
+{
+  return Faults;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Starts the window over from the current odometers, slots summed at the
+// old rate would be averaged with the new UpdatesPerSlot
+static void ClearWindow(void)
+{
+  uint8_t i;
+
+  UpdateCount = 0;
+  Slot = 0;
+  SlotsFilled = 0;
+  for (i = 0; i < NUM_WHEELS; i++)
+  {
+    DutySum[i] = 0;
+    CommandSum[i] = 0;
+    SlotStartOdometer[i] = QueryEncoderOdometer(WHEEL_1 + i);
+  }
+}
+
+// Sums the window and returns the faults that were not already latched
+static uint8_t CheckWindow(void)
+{
+  float Duty[NUM_WHEELS];
+  float Command[NUM_WHEELS];
+  int32_t Measured[NUM_WHEELS];
+  float Divergence;
+  uint8_t Detected = 0;
+  uint8_t NewFaults;
+  uint8_t Latest;
+  uint8_t i, j;
+
+  for (i = 0; i < NUM_WHEELS; i++)
+  {
+    Duty[i] = 0;
+    Command[i] = 0;
+    Measured[i] = 0;
+    for (j = 0; j < WINDOW_SLOTS; j++)
+    {
+      Duty[i] += WindowDuty[i][j];
+      Command[i] += WindowCommand[i][j];
+      Measured[i] += WindowMeasured[i][j];
+    }
+    Duty[i] /= (float)WINDOW_SLOTS * UpdatesPerSlot;
+
+    if ((Duty[i] >= STALL_DUTY) && (abs(Measured[i]) <= STALL_MAX_TICKS) &&
+        (fabsf(LastRPM[i]) < STALL_RPM))
+    {
+      Detected |= SD_STALL_1 << i;
+    }
+  }
+
+  //a wheel that stopped turning in the last slot is a stall in the making,
+  //so slip is only looked for while both wheels are still moving
+  Latest = (Slot + WINDOW_SLOTS - 1) % WINDOW_SLOTS;
+  Divergence = (Measured[1] - Measured[0]) - (Command[1] - Command[0]);
+  if ((WindowMeasured[0][Latest] != 0) && (WindowMeasured[1][Latest] != 0) &&
+      (fabsf(Divergence) > SLIP_TICKS))
+  {
+    if (fabsf(Measured[0] - Command[0]) > fabsf(Measured[1] - Command[1]))
+    {
+      Detected |= SD_SLIP_1;
+    }
+    else
+    {
+      Detected |= SD_SLIP_2;
+    }
+  }
+
+  NewFaults = Detected & ~Faults;
+  Faults |= Detected;
+  return NewFaults;
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -42,6 +42,7 @@
 
 // Our application
 #include "I2CService.h"
+#include "ColourSensor.h"
 
 // This module
 #include "TestHarnessService0.h"
@@ -159,10 +160,10 @@ ES_Event_t RunTestHarnessI2C(ES_Event_t ThisEvent)
       uint16_t BlueValue;
       
       ES_Timer_InitTimer(I2C_TEST_TIMER, ONE_SEC);
-      ClearValue = I2C_GetClearValue();
-      RedValue   = I2C_GetRedValue();
-      GreenValue = I2C_GetGreenValue();
-      BlueValue  = I2C_GetBlueValue();
+      ClearValue = CS_GetClearValue();
+      RedValue   = CS_GetRedValue();
+      GreenValue = CS_GetGreenValue();
+      BlueValue  = CS_GetBlueValue();
       
       printf("Clr: %d, Red: %d, Grn: %d, Blu: %d, R%%: %.2f, G%% %.2f, B%% %.2f \r\n",
           ClearValue, RedValue, GreenValue, BlueValue, 
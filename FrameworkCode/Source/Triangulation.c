@@ -9,7 +9,28 @@
    Returns coordinates based on angles from all beacons
 
  Notes
-	
+	Tienstra's formula on three of the four beacons. The beacon triangles
+	are fixed by the field, so the vertex order and the cotangents of their
+	interior angles are tabulated below, one row per beacon left out.
+	Vertices are listed clockwise around the field, which matches beacon
+	angles that increase clockwise as seen from above.
+
+	With all four beacons the Tienstra fix seeds a fixed number of weighted
+	Gauss-Newton iterations over (X, Y, Heading). The one redundant bearing
+	is enough to detect a bad bearing (chi-square on the residuals) but not
+	to tell which one it is, so the bearing dropped is the one whose
+	three-beacon fix lands closest to a prior pose if one is given, or
+	otherwise the most redundant one (the one the other three do best
+	without, a low confidence makes a bearing more redundant).
+
+	How much of an error in bearing i reaches the residuals is its
+	redundancy number r_i (they sum to 1 over the four): the error adds
+	r_i e^2 to the chi-square. Over most of the field the robot is close to
+	the circle through three of the beacons and the fourth has r_i of a few
+	percent, so a bearing off by 10 degrees passes the gate while pulling the
+	fix inches away. Bearings that could hide MAX_HIDDEN_BIAS_DEG are
+	reported by QueryUncheckedBeacons, and with a prior the three-beacon
+	fixes without them compete with the full fix for the one closest to it.
    
 Author
    Sander Tonkens
@@ -18,84 +39,78 @@ Author
 /* include header files for the framework and this service
 */
 
-#include <math.h> //for acos and atan
+#include <math.h> //for fabsf
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
-#include "inc/hw_memmap.h"
-#include "inc/hw_types.h"
-#include "inc/hw_gpio.h"
-#include "inc/hw_sysctl.h"
-#include "inc/hw_timer.h"
-#include "inc/hw_nvic.h"
-#include "driverlib/sysctl.h"
-#include "driverlib/pin_map.h"
-#include "driverlib/gpio.h"
-#include "driverlib/timer.h"
-#include "driverlib/interrupt.h"
-
 
+#include "FastMath.h"
 #include "Triangulation.h"
 /*----------------------------- Module Defines ----------------------------*/
 // Readability defines:
-#define pi 3.14159265358979
+#define PI 3.14159265358979f
+#define DEG_TO_RAD (PI/180.0f)
+#define RAD_TO_DEG (180.0f/PI)
+
+#define NO_ANGLE -1
+
+//Below this the robot is on (or near) the circle through the beacons
+#define MIN_SCALER_SUM 1e-6f
+
+//Weighted least squares over all four bearings
+#define GN_ITERATIONS 3
+#define BEARING_SIGMA_DEG 1.0f
+//Chi-square, 1 degree of freedom, 99%
+#define OUTLIER_GATE 6.63f
+//Largest bearing error the gate has to catch on its own
+#define MAX_HIDDEN_BIAS_DEG 8.0f
+//Redundancy below which MAX_HIDDEN_BIAS_DEG slips under the gate
+#define MIN_REDUNDANCY (OUTLIER_GATE*BEARING_SIGMA_DEG*BEARING_SIGMA_DEG/ \
+	(MAX_HIDDEN_BIAS_DEG*MAX_HIDDEN_BIAS_DEG))
 
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service.They should be functions
    relevant to the behavior of this service
 */
-
+static bool Tienstra(uint8_t Missing, const float *Angles, float *OutX,
+	float *OutY, float *OutHeading);
+static void GaussNewtonStep(const float *Angles, const float *Weights);
+static float ComputeResiduals(const float *Angles, const float *Weights);
+static void ComputeRedundancy(const float *Weights, float *Redundancy);
+static float Cot(float Angle);
+static float WrapPI(float Angle);
+static float Wrap360(float Angle);
 
 /*---------------------------- Module Variables ---------------------------*/
 // Data private to the module
 
-static float Xf;
-static float Yf;
-static float theta;
-static float XRelative;
-static float YRelative;
-static float RelativeTheta;
+typedef struct
+{
+  uint8_t Beacon[3];  // vertices, clockwise
+  float CotInterior[3]; // cot of the triangle's interior angle at each vertex
+}BeaconTriangle_t;
+
+// Beacons A (2000Hz), B (1667Hz), C (1429Hz), D (1200Hz), in inches
+static const float BeaconX[NUM_BEACONS] = { -48, 48, -30, 30 };
+static const float BeaconY[NUM_BEACONS] = { 12, -12, -58.8f, 58.8f };
+
+// Indexed by the beacon that is left out
+static const BeaconTriangle_t Triangles[NUM_BEACONS] = {
+  { {1, 2, 3}, {-0.3000000f, 1.6000000f, 1.1384615f} }, //B C D, no West Recycling Center
+  { {2, 0, 3}, {1.1384615f, -0.3000000f, 1.6000000f} }, //C A D, no East Recycling Center
+  { {3, 1, 0}, {0.3000000f, 0.5384615f, 1.0000000f} },  //D B A, no South Landfill
+  { {0, 1, 2}, {0.5384615f, 1.0000000f, 0.3000000f} }   //A B C, no North Landfill
+};
 
 static float X = 0; //Data to return, coordinates of bot
 static float Y = 0;
 static float Heading = 0;
 
-static float XA; //Data of beacons for calculation
-static float XB;
-static float XC;
-static float YA;
-static float YB;
-static float YC;
-
-// Data for angles
-static float AngA; // interior angles of traingle ABC
-static float AngB;
-static float AngC;
-static float AngAlpha;  // angles from bot perspective, between beacons B,C
-static float AngBeta; // between beacons A,C
-static float AngGamma; // between beacons A,B
-static float Alpha; //IN DEGREES
-static float Gamma;
-
-//cotangents of angles
-static float COT_A;
-static float COT_B;
-static float COT_C;
-static float COT_Alpha;
-static float COT_Beta;
-static float COT_Gamma;
-
-//Tienstra scalers
-static float KA;
-static float KB;
-static float KC;
-static float K;
-
-//intermediate angles
-static float firstAngle;
-static float secondAngle;
-static float thirdAngle;
+static float Residual[NUM_BEACONS]; //measured - predicted bearing, degrees
+static uint8_t FixBeacons;          //bit per beacon used for the fix
+static uint8_t RejectedBeacon = NO_BEACON;
+static uint8_t UncheckedBeacons;    //bit per bearing the residuals cannot vouch for
 
 /*------------------------------ Module Code ------------------------------*/
 
@@ -104,332 +119,209 @@ static float thirdAngle;
    Triangulate
 
  Parameters
-	Angles to 3 of 4 beacons, ordered by their position and frequency:
+	Angles to 3 or 4 beacons, ordered by their position and frequency:
 	AngleA @ 2000Hz, AngleB @ 1667Hz, AngleC @ 1429Hz, and AngleD @ 1200Hz
+	in degrees, increasing clockwise from the robot's heading
 
  Returns
-   Void. Saves X,Y, and Heading
+   bool : false if no fix could be computed. Saves X,Y, and Heading
 
  Description
-   Application of Tienstra's Algorithm/Formula (see https://en.wikipedia.org/wiki/Tienstra_formula)
-
+   TriangulateWeighted with equal confidence in every bearing
  Notes
    If one angle has not been observed, pass anglex = -1
    
  Author
    Sander Tonkens
 ****************************************************************************/
-void Triangulate(float AngleA, float AngleB, float AngleC, float AngleD) {
+bool Triangulate(float AngleA, float AngleB, float AngleC, float AngleD) {
+	const float Angles[NUM_BEACONS] = { AngleA, AngleB, AngleC, AngleD };
 	
-	if (AngleA == -1) 
-	{	
-    
-    //Not using Angle to West Recycling Center
-    Angle1 = AngleB;
-    Angle2 = AngleC;
-    Angle3 = AngleD;
-    X1 = 48;
-    Y1 = -12;
-    X2 = -30;
-    Y2 = -58.8;
-    X3 = 30;
-    Y3 = 58.8;
-    
-    AngA = 1.862253121;
-    AngB = 0.558599315;
-    AngC = 0.720740217;
-    Alpha = Angle3 - Angle2;
-    if (Alpha <0)
-    {
-      Alpha += 360; 
-    }
-    Beta = Angle1 - Angle3;
-    if (Beta < 0)
-    {
-      Beta += 360;
-    }
-    Gamma = Angle2 - Angle1;
-    if (Gamma < 0)
-    {
-      Gamma += 360;
-    }
-    AngAlpha = Alpha*PI/180;
-    AngBeta = Beta*PI/180;
-    AngGamma = Gamma*PI/180;
-    
-    //Application of Tienstra's algorithm
-
-    //COTANGENTS
-    COT_A = 1/tan(AngA);
-    COT_B = 1/tan(AngB);
-    COT_C = 1/tan(AngC);
-    COT_Alpha = 1/tan(AngAlpha);
-    COT_Beta = 1/tan(AngBeta);
-    COT_Gamma = 1/tan(AngGamma);
-    
-    // calculate scalers
-    KA = 1/(COT_A - COT_Alpha);
-    KB = 1/(COT_B - COT_Beta);
-    KC = 1/(COT_C - COT_Gamma);
-    K  = KA + KB + KC;
-    
-    // calculate middle frame coordinates
-    Xf = (KA*XA + KB*XB + KC*XC)/K;
-    Yf = (KA*YA + KB*YB + KC*YC)/K;
-    
-    //Calculate heading
-    XRelative = X1 - Xf;
-    YRelative = Y1 - Yf;
-    
-    
-    RelativeTheta = atan2((YRelative), (XRelative));
-    
-    if(((AngleB - RelativeTheta) >= 0))
-    {
-      Heading = (AngleB - RelativeTheta)*180/PI;
-      
-      if (Heading < 0) 
-      {
-        Heading = - Heading;
-      }
-    }
-    else
-    {
-      Heading = (AngleB - RelativeTheta + 2*PI) * 180/PI;
-    }
-	} 
-
-	else if (AngleB == -1) //
+	return TriangulateWeighted(Angles, NULL, NULL);
+}
+
+/****************************************************************************
+ Function
+   TriangulateWeighted
+
+ Parameters
+	const float * : angle to each beacon A..D (degrees, clockwise from the
+	                heading), -1 if not seen
+	const float * : confidence in each bearing, 1 nominal, 0 ignores it
+	                (NULL for all 1)
+	const float * : prior X, Y, Heading used to pick the bearing to drop
+	                when the four disagree or one cannot be checked
+	                (NULL for none)
+
+ Returns
+   bool : false if no fix could be computed. Saves X,Y, and Heading
+
+ Description
+   Tienstra with three bearings, weighted least squares with four
+ Notes
+   Fixed cost: up to four Tienstra solutions (only on an outlier, or on an
+   unchecked bearing when there is a prior), three Gauss-Newton iterations,
+   one residual pass and one redundancy pass
+ Author
+   Sander Tonkens
+****************************************************************************/
+bool TriangulateWeighted(const float *Angles, const float *Confidence,
+	const float *Prior) {
+	float Weights[NUM_BEACONS];
+	float Redundancy[NUM_BEACONS];
+	float Chi2;
+	float BestScore = 0;
+	float SubsetX, SubsetY, SubsetHeading;
+	uint8_t NumUsed = 0;
+	uint8_t Missing = NO_BEACON;
+	uint8_t Drop = NO_BEACON;
+	uint8_t i;
+	
+	RejectedBeacon = NO_BEACON;
+	FixBeacons = 0;
+	UncheckedBeacons = 0;
+	for (i = 0; i < NUM_BEACONS; i++)
 	{
-    //Not using Angle to East Recycling Center
-    Angle1 = AngleC;
-    Angle2 = AngleD;
-    Angle3 = AngleA;
-    X1 = -30;
-    Y1 = -58.8;
-    X2 = 30;
-    Y2 = 58.8;
-    X3 = -48;
-    Y3 = 12;
-    
-    AngA = 0.720740217;
-    AngB = 0.558599315;
-    AngC = 1.862253121;
-    Alpha = Angle3 - Angle2;
-    if (Alpha <0)
-    {
-      Alpha += 360; 
-    }
-    Beta = Angle1 - Angle3;
-    if (Beta < 0)
-    {
-      Beta += 360;
-    }
-    Gamma = Angle2 - Angle1;
-    if (Gamma < 0)
-    {
-      Gamma += 360;
-    }
-    AngAlpha = Alpha*PI/180;
-    AngBeta = Beta*PI/180;
-    AngGamma = Gamma*PI/180;
-    
-    //Application of Tienstra's algorithm
-
-    //COTANGENTS
-    COT_A = 1/tan(AngA);
-    COT_B = 1/tan(AngB);
-    COT_C = 1/tan(AngC);
-    COT_Alpha = 1/tan(AngAlpha);
-    COT_Beta = 1/tan(AngBeta);
-    COT_Gamma = 1/tan(AngGamma);
-    
-    // calculate scalers
-    KA = 1/(COT_A - COT_Alpha);
-    KB = 1/(COT_B - COT_Beta);
-    KC = 1/(COT_C - COT_Gamma);
-    K  = KA + KB + KC;
-    
-    // calculate middle frame coordinates
-    Xf = (KA*XA + KB*XB + KC*XC)/K;
-    Yf = (KA*YA + KB*YB + KC*YC)/K;
-    
-    //Calculate heading
-    XRelative = X3 - Xf;
-    YRelative = Y3 - Yf;
-    
-    //HEADING POSSIBLY TO BE UPDATED
-    RelativeTheta = atan2((YRelative), (XRelative));
-    
-    if(((AngleA - RelativeTheta) >= 0))
-    {
-      Heading = (AngleA - RelativeTheta)*180/PI;
-      
-      if (Heading < 0) 
-      {
-        Heading = - Heading;
-      }
-    }
-    else
-    {
-      Heading = (AngleA - RelativeTheta + 2*PI) * 180/PI;
-    }
-	} 
-
-	else if (AngleC == -1) 
-	{	
-    
-    //Not using Angle to South Landfill
-    Angle1 = AngleD;
-    Angle2 = AngleA;
-    Angle3 = AngleB;
-    X1 = 30;
-    Y1 = 58.8;
-    X2 = -48;
-    Y2 = 12;
-    X3 = 48;
-    Y3 = -12;
-    
-    AngA = 1.279339532;
-    AngB = 0.785398163;
-    AngC = 1.076854958;
-    Alpha = Angle3 - Angle2;
-    if (Alpha <0)
-    {
-      Alpha += 360; 
-    }
-    Beta = Angle1 - Angle3;
-    if (Beta < 0)
-    {
-      Beta += 360;
-    }
-    Gamma = Angle2 - Angle1;
-    if (Gamma < 0)
-    {
-      Gamma += 360;
-    }
-    AngAlpha = Alpha*PI/180;
-    AngBeta = Beta*PI/180;
-    AngGamma = Gamma*PI/180;
-    
-    //Application of Tienstra's algorithm
-
-    //COTANGENTS
-    COT_A = 1/tan(AngA);
-    COT_B = 1/tan(AngB);
-    COT_C = 1/tan(AngC);
-    COT_Alpha = 1/tan(AngAlpha);
-    COT_Beta = 1/tan(AngBeta);
-    COT_Gamma = 1/tan(AngGamma);
-    
-    // calculate scalers
-    KA = 1/(COT_A - COT_Alpha);
-    KB = 1/(COT_B - COT_Beta);
-    KC = 1/(COT_C - COT_Gamma);
-    K  = KA + KB + KC;
-    
-    // calculate middle frame coordinates
-    Xf = (KA*XA + KB*XB + KC*XC)/K;
-    Yf = (KA*YA + KB*YB + KC*YC)/K;
-    
-    //Calculate heading
-    XRelative = X1 - Xf;
-    YRelative = Y1 - Yf;
-    
-    
-    RelativeTheta = atan2((YRelative), (XRelative));
-    
-    if(((AngleB - RelativeTheta) >= 0))
-    {
-      Heading = (AngleB - RelativeTheta)*180/PI;
-      
-      if (Heading < 0) 
-      {
-        Heading = - Heading;
-      }
-    }
-    else
-    {
-      Heading = (AngleB - RelativeTheta + 2*PI) * 180/PI;
-    }
+		Weights[i] = (Confidence == NULL) ? 1.0f : Confidence[i];
+		if ((Angles[i] == NO_ANGLE) || !(Weights[i] > 0))
+		{
+			Weights[i] = 0;
+			Missing = i;
+		}
+		else
+		{
+			NumUsed++;
+		}
 	}
-
-	else //AngleD is not considered
-	{	
-    //Not using Angle to North Landfill
-    Angle1 = AngleA;
-    Angle2 = AngleB;
-    Angle3 = AngleC;
-    X1 = -48;
-    Y1 = 12;
-    X2 = 48;
-    Y2 = -12;
-    X3 = -30;
-    Y3 = -58.8;
-    
-    AngA = 1.076854958;
-    AngB = 0.785398163;
-    AngC = 1.279339532;
-    Alpha = Angle3 - Angle2;
-    if (Alpha <0)
-    {
-      Alpha += 360; 
-    }
-    Beta = Angle1 - Angle3;
-    if (Beta < 0)
-    {
-      Beta += 360;
-    }
-    Gamma = Angle2 - Angle1;
-    if (Gamma < 0)
-    {
-      Gamma += 360;
-    }
-    AngAlpha = Alpha*PI/180;
-    AngBeta = Beta*PI/180;
-    AngGamma = Gamma*PI/180;
-    
-    //Application of Tienstra's algorithm
-
-    //COTANGENTS
-    COT_A = 1/tan(AngA);
-    COT_B = 1/tan(AngB);
-    COT_C = 1/tan(AngC);
-    COT_Alpha = 1/tan(AngAlpha);
-    COT_Beta = 1/tan(AngBeta);
-    COT_Gamma = 1/tan(AngGamma);
-    
-    // calculate scalers
-    KA = 1/(COT_A - COT_Alpha);
-    KB = 1/(COT_B - COT_Beta);
-    KC = 1/(COT_C - COT_Gamma);
-    K  = KA + KB + KC;
-    
-    // calculate middle frame coordinates
-    Xf = (KA*XA + KB*XB + KC*XC)/K;
-    Yf = (KA*YA + KB*YB + KC*YC)/K;
-    
-    //Calculate heading
-    XRelative = X1 - Xf;
-    YRelative = Y1 - Yf;
-    
-    
-    RelativeTheta = atan2((YRelative), (XRelative));
-    
-    if(((AngleB - RelativeTheta) >= 0))
-    {
-      Heading = (AngleB - RelativeTheta)*180/PI;
-      
-      if (Heading < 0) 
-      {
-        Heading = - Heading;
-      }
-    }
-    else
-    {
-      Heading = (AngleB - RelativeTheta + 2*PI) * 180/PI;
-    }
+	if (NumUsed < 3)
+	{
+		return false;
+	}
+	
+	if (NumUsed == 3)
+	{
+		if (!Tienstra(Missing, Angles, &X, &Y, &Heading))
+		{
+			return false;
+		}
+		FixBeacons = (uint8_t)(0x0F & ~(1 << Missing));
+		UncheckedBeacons = FixBeacons; //no redundancy at all
+		ComputeResiduals(Angles, Weights);
+		return true;
+	}
+	
+	//Seed from the triangle without the least trusted beacon (D on a tie)
+	Missing = NUM_BEACONS - 1;
+	for (i = 0; i < NUM_BEACONS - 1; i++)
+	{
+		if (Weights[i] < Weights[Missing])
+		{
+			Missing = i;
+		}
+	}
+	if (!Tienstra(Missing, Angles, &X, &Y, &Heading))
+	{
+		//on that triangle's circle, any other triangle will do
+		for (i = 0; i < NUM_BEACONS; i++)
+		{
+			if ((i != Missing) && Tienstra(i, Angles, &X, &Y, &Heading))
+			{
+				break;
+			}
+		}
+		if (i == NUM_BEACONS)
+		{
+			return false;
+		}
 	}
+	
+	//Near that triangle's circle the seed is poor and three iterations do
+	//not pull it in. The most redundant bearing is the one the others pin
+	//down best without, reseed from the triangle that leaves it out.
+	ComputeRedundancy(Weights, Redundancy);
+	Drop = Missing;
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		if (Redundancy[i] > Redundancy[Drop])
+		{
+			Drop = i;
+		}
+	}
+	if (Drop != Missing)
+	{
+		Tienstra(Drop, Angles, &X, &Y, &Heading);
+	}
+	Drop = NO_BEACON;
+	
+	for (i = 0; i < GN_ITERATIONS; i++)
+	{
+		GaussNewtonStep(Angles, Weights);
+	}
+	FixBeacons = 0x0F;
+	Chi2 = ComputeResiduals(Angles, Weights);
+	ComputeRedundancy(Weights, Redundancy);
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		if ((Weights[i] > 0) && (Redundancy[i] < MIN_REDUNDANCY))
+		{
+			UncheckedBeacons |= (uint8_t)(1 << i);
+		}
+	}
+	if ((Chi2 <= OUTLIER_GATE) && ((UncheckedBeacons == 0) || (Prior == NULL)))
+	{
+		return true;
+	}
+	
+	//The bearings disagree, or one of them could be off without showing:
+	//let the prior pick between the full fix and three beacon fixes
+	if (Prior != NULL)
+	{
+		if (Chi2 <= OUTLIER_GATE)
+		{
+			BestScore = (X - Prior[0])*(X - Prior[0]) + (Y - Prior[1])*(Y - Prior[1]);
+		}
+		for (i = 0; i < NUM_BEACONS; i++)
+		{
+			if (((Chi2 > OUTLIER_GATE) || (UncheckedBeacons & (1 << i))) &&
+				Tienstra(i, Angles, &SubsetX, &SubsetY, &SubsetHeading))
+			{
+				float dX = SubsetX - Prior[0];
+				float dY = SubsetY - Prior[1];
+				float Score = dX*dX + dY*dY;
+				if (((Drop == NO_BEACON) && (Chi2 > OUTLIER_GATE)) || (Score < BestScore))
+				{
+					BestScore = Score;
+					Drop = i;
+				}
+			}
+		}
+		if ((Chi2 <= OUTLIER_GATE) && (Drop == NO_BEACON))
+		{
+			return true;
+		}
+	}
+	if (Drop == NO_BEACON)
+	{
+		//no way to tell which, drop the one the other three do best without
+		Drop = 0;
+		for (i = 1; i < NUM_BEACONS; i++)
+		{
+			if (Redundancy[i] > Redundancy[Drop])
+			{
+				Drop = i;
+			}
+		}
+	}
+	if (!Tienstra(Drop, Angles, &X, &Y, &Heading))
+	{
+		return false;
+	}
+	RejectedBeacon = Drop;
+	FixBeacons = (uint8_t)(0x0F & ~(1 << Drop));
+	UncheckedBeacons = 0;
+	Weights[Drop] = 0;
+	ComputeResiduals(Angles, Weights);
+	return true;
 }
 
 /****************************************************************************
@@ -459,3 +351,253 @@ float QueryYCoordinate( void ) {
 float QueryHeading( void ) {
 	return Heading;
 }
+
+/****************************************************************************
+ Functions
+   QueryResiduals, QueryFixBeacons, QueryRejectedBeacon,
+   QueryUncheckedBeacons
+
+ Parameters
+	float * : (QueryResiduals) filled with the residual of each bearing in
+	          degrees, 0 for bearings that were not measured
+
+ Returns
+   bit mask of the beacons used for the last fix (BIT0 = A)
+		beacon dropped as an outlier on the last fix, or NO_BEACON
+		bit mask of the bearings in the last fix that could be off by
+		MAX_HIDDEN_BIAS_DEG without failing the outlier gate
+
+ Description
+   Get Funct.
+   
+ Author
+   Sander Tonkens
+****************************************************************************/
+void QueryResiduals(float *Residuals) {
+	uint8_t i;
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		Residuals[i] = Residual[i];
+	}
+}
+uint8_t QueryFixBeacons(void) {
+	return FixBeacons;
+}
+uint8_t QueryRejectedBeacon(void) {
+	return RejectedBeacon;
+}
+uint8_t QueryUncheckedBeacons(void) {
+	return UncheckedBeacons;
+}
+
+/****************************************************************************
+ Function
+   QueryBeaconPosition
+
+ Parameters
+	uint8_t : beacon (BEACON_A..BEACON_D)
+	float * : X of the beacon in inches
+	float * : Y of the beacon in inches
+
+ Returns
+   void
+ Author
+   Sander Tonkens
+****************************************************************************/
+void QueryBeaconPosition(uint8_t Beacon, float *OutX, float *OutY) {
+	if (Beacon < NUM_BEACONS)
+	{
+		*OutX = BeaconX[Beacon];
+		*OutY = BeaconY[Beacon];
+	}
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+// Tienstra's formula on the triangle without beacon Missing
+static bool Tienstra(uint8_t Missing, const float *Angles, float *OutX,
+	float *OutY, float *OutHeading)
+{
+	const BeaconTriangle_t *Triangle = &Triangles[Missing];
+	float Angle1 = Angles[Triangle->Beacon[0]];
+	float Angle2 = Angles[Triangle->Beacon[1]];
+	float Angle3 = Angles[Triangle->Beacon[2]];
+	float K1, K2, K3, K;
+	
+	//Tienstra scalers from the angles each side subtends at the robot
+	K1 = 1.0f/(Triangle->CotInterior[0] - Cot(Wrap360(Angle3 - Angle2)*DEG_TO_RAD));
+	K2 = 1.0f/(Triangle->CotInterior[1] - Cot(Wrap360(Angle1 - Angle3)*DEG_TO_RAD));
+	K3 = 1.0f/(Triangle->CotInterior[2] - Cot(Wrap360(Angle2 - Angle1)*DEG_TO_RAD));
+	K = K1 + K2 + K3;
+	if (!(fabsf(K) > MIN_SCALER_SUM))
+	{
+		return false;
+	}
+	
+	*OutX = (K1*BeaconX[Triangle->Beacon[0]] + K2*BeaconX[Triangle->Beacon[1]] +
+		K3*BeaconX[Triangle->Beacon[2]])/K;
+	*OutY = (K1*BeaconY[Triangle->Beacon[0]] + K2*BeaconY[Triangle->Beacon[1]] +
+		K3*BeaconY[Triangle->Beacon[2]])/K;
+	
+	//Field bearing to the first beacon, plus its clockwise angle off the heading
+	*OutHeading = Wrap360(FM_Atan2f(BeaconY[Triangle->Beacon[0]] - *OutY,
+		BeaconX[Triangle->Beacon[0]] - *OutX)*RAD_TO_DEG + Angle1);
+	return true;
+}
+
+// One weighted Gauss-Newton update of X, Y, Heading. The predicted
+// (clockwise) bearing of beacon i is Heading - atan2(dy, dx)
+static void GaussNewtonStep(const float *Angles, const float *Weights)
+{
+	float A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+	float G0 = 0, G1 = 0, G2 = 0;
+	float C00, C01, C02, C11, C12, C22;
+	float Det;
+	float HeadingRad = Heading*DEG_TO_RAD;
+	uint8_t i;
+	
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		float dx, dy, r2, Jx, Jy, r, w;
+		
+		if (Weights[i] == 0)
+		{
+			continue;
+		}
+		dx = BeaconX[i] - X;
+		dy = BeaconY[i] - Y;
+		r2 = dx*dx + dy*dy;
+		r = WrapPI(Angles[i]*DEG_TO_RAD - (HeadingRad - FM_Atan2f(dy, dx)));
+		Jx = -dy/r2;
+		Jy = dx/r2;
+		w = Weights[i];
+		//Normal equations, the heading column of the Jacobian is 1
+		A00 += w*Jx*Jx;
+		A01 += w*Jx*Jy;
+		A02 += w*Jx;
+		A11 += w*Jy*Jy;
+		A12 += w*Jy;
+		A22 += w;
+		G0 += w*Jx*r;
+		G1 += w*Jy*r;
+		G2 += w*r;
+	}
+	
+	//Symmetric 3x3 solve through the cofactors
+	C00 = A11*A22 - A12*A12;
+	C01 = A02*A12 - A01*A22;
+	C02 = A01*A12 - A02*A11;
+	C11 = A00*A22 - A02*A02;
+	C12 = A01*A02 - A00*A12;
+	C22 = A00*A11 - A01*A01;
+	Det = A00*C00 + A01*C01 + A02*C02;
+	if (!(fabsf(Det) > 0))
+	{
+		return;
+	}
+	X += (C00*G0 + C01*G1 + C02*G2)/Det;
+	Y += (C01*G0 + C11*G1 + C12*G2)/Det;
+	Heading = Wrap360((HeadingRad + (C02*G0 + C12*G1 + C22*G2)/Det)*RAD_TO_DEG);
+}
+
+// Fills Residual[] (degrees) for the current fix, returns the weighted
+// sum of squares normalized by the bearing noise
+static float ComputeResiduals(const float *Angles, const float *Weights)
+{
+	float Chi2 = 0;
+	uint8_t i;
+	
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		if (Angles[i] == NO_ANGLE)
+		{
+			Residual[i] = 0;
+			continue;
+		}
+		Residual[i] = Wrap360(Angles[i] - (Heading -
+			FM_Atan2f(BeaconY[i] - Y, BeaconX[i] - X)*RAD_TO_DEG) + 180.0f) - 180.0f;
+		Chi2 += Weights[i]*(Residual[i]/BEARING_SIGMA_DEG)*(Residual[i]/BEARING_SIGMA_DEG);
+	}
+	return Chi2;
+}
+
+// Redundancy number of each bearing at the current fix, the share of an
+// error in it that shows in the residuals: r_i = 1 - w_i J_i (J'WJ)^-1 J_i'
+static void ComputeRedundancy(const float *Weights, float *Redundancy)
+{
+	float Jx[NUM_BEACONS], Jy[NUM_BEACONS];
+	float A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+	float C00, C01, C02, C11, C12, C22;
+	float Det;
+	uint8_t i;
+	
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		float dx = BeaconX[i] - X;
+		float dy = BeaconY[i] - Y;
+		float r2 = dx*dx + dy*dy;
+		float w = Weights[i];
+		
+		Jx[i] = -dy/r2;
+		Jy[i] = dx/r2;
+		A00 += w*Jx[i]*Jx[i];
+		A01 += w*Jx[i]*Jy[i];
+		A02 += w*Jx[i];
+		A11 += w*Jy[i]*Jy[i];
+		A12 += w*Jy[i];
+		A22 += w;
+	}
+	C00 = A11*A22 - A12*A12;
+	C01 = A02*A12 - A01*A22;
+	C02 = A01*A12 - A02*A11;
+	C11 = A00*A22 - A02*A02;
+	C12 = A01*A02 - A00*A12;
+	C22 = A00*A11 - A01*A01;
+	Det = A00*C00 + A01*C01 + A02*C02;
+	for (i = 0; i < NUM_BEACONS; i++)
+	{
+		if (!(fabsf(Det) > 0) || (Weights[i] == 0))
+		{
+			Redundancy[i] = 0;
+			continue;
+		}
+		Redundancy[i] = 1.0f - Weights[i]*(C00*Jx[i]*Jx[i] + 2*C01*Jx[i]*Jy[i] +
+			2*C02*Jx[i] + C11*Jy[i]*Jy[i] + 2*C12*Jy[i] + C22)/Det;
+	}
+}
+
+// cot() in one range reduction, +-inf at multiples of PI like 1/tanf
+static float Cot(float Angle)
+{
+	float Sin, Cos;
+	
+	FM_SinCosf(Angle, &Sin, &Cos);
+	return Cos/Sin;
+}
+
+// Wraps an angle into -PI..PI
+static float WrapPI(float Angle)
+{
+	while (Angle > PI)
+	{
+		Angle -= 2*PI;
+	}
+	while (Angle < -PI)
+	{
+		Angle += 2*PI;
+	}
+	return Angle;
+}
+
+// Wraps an angle into 0..360 degrees
+static float Wrap360(float Angle)
+{
+	Angle = fmodf(Angle, 360.0f);
+	if (Angle < 0)
+	{
+		Angle += 360.0f;
+	}
+	return Angle;
+}